@@ -84,9 +84,6 @@ $(intermediates)/glsl/glsl_parser.cpp: $(LOCAL_PATH)/glsl/glsl_parser.yy
 
 $(intermediates)/glsl/glsl_parser.h: $(intermediates)/glsl/glsl_parser.cpp
 
-$(intermediates)/glsl/glcpp/glcpp-lex.c: $(LOCAL_PATH)/glsl/glcpp/glcpp-lex.l
-	$(call local-l-or-ll-to-c-or-cpp)
-
 $(intermediates)/glsl/glcpp/glcpp-parse.c: $(LOCAL_PATH)/glsl/glcpp/glcpp-parse.y
 	$(call glsl_local-y-to-c-and-h)
 
@@ -43,14 +43,12 @@ glsl_env.Append(YACCFLAGS = [
 # "glsl_parser.h", causing glsl_parser.cpp to be regenerated every time
 glsl_env['YACCHXXFILESUFFIX'] = '.h'
 
-glcpp_lexer = glcpp_env.CFile('glsl/glcpp/glcpp-lex.c', 'glsl/glcpp/glcpp-lex.l')
 glcpp_parser = glcpp_env.CFile('glsl/glcpp/glcpp-parse.c', 'glsl/glcpp/glcpp-parse.y')
 glsl_lexer = glsl_env.CXXFile('glsl/glsl_lexer.cpp', 'glsl/glsl_lexer.ll')
 glsl_parser = glsl_env.CXXFile('glsl/glsl_parser.cpp', 'glsl/glsl_parser.yy')
 
 # common generated sources
 glsl_sources = [
-    glcpp_lexer,
     glcpp_parser[0],
     glsl_lexer,
     glsl_parser[0],
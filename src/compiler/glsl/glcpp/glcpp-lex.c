@@ -0,0 +1,934 @@
+/*
+ * Copyright © 2010 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* The glcpp lexer.
+ *
+ * This used to be generated by flex, and it still implements the same rules
+ * with the same start conditions, (INITIAL, COMMENT, DEFINE, HASH, DONE and
+ * NEWLINE_CATCHUP), down to the longest-match behavior of the old patterns.
+ * Working directly on a copy of the shader source avoids the generic
+ * machinery of a table-driven scanner, which used to show up prominently
+ * when preprocessing large shaders.
+ *
+ * All identifiers are interned, so that the parser can look up and compare
+ * macro names by pointer.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "glcpp.h"
+#include "glcpp-parse.h"
+#include "util/hash_table.h"
+#include "util/set.h"
+
+enum lexer_state {
+	STATE_INITIAL,
+	STATE_COMMENT,
+	STATE_DEFINE,
+	STATE_DONE,
+	STATE_HASH,
+	STATE_NEWLINE_CATCHUP,
+};
+
+struct glcpp_lexer {
+	glcpp_parser_t *parser;
+
+	/* A private, writable copy of the source string. */
+	char *source;
+	char *pos;
+	char *end;
+
+	enum lexer_state state;
+	/* The state to return to at the end of a multi-line comment. */
+	enum lexer_state comment_state;
+
+	bool started;
+	int lineno;
+	int column;
+
+	/* Set of all interned identifier strings. */
+	struct set *identifiers;
+};
+
+/* Returned by the rules below when no token is to be returned to the
+ * parser, and lexing should simply continue. */
+#define NO_TOKEN -1
+
+enum char_class {
+	CLASS_HSPACE = 1 << 0,     /* [ \t\v\f] */
+	CLASS_NEWLINE = 1 << 1,    /* [\r\n] */
+	CLASS_IDENTIFIER = 1 << 2, /* [_a-zA-Z] */
+	CLASS_DIGIT = 1 << 3,      /* [0-9] */
+	CLASS_PUNCTUATOR = 1 << 4, /* [][(){}.&*~!/%<>^|;,=+-] */
+	CLASS_OTHER = 1 << 5,      /* Anything else, except for '#' and NUL */
+};
+
+#define H CLASS_HSPACE
+#define N CLASS_NEWLINE
+#define I CLASS_IDENTIFIER
+#define D CLASS_DIGIT
+#define P CLASS_PUNCTUATOR
+#define O CLASS_OTHER
+
+static const unsigned char char_class[256] = {
+	0, O, O, O, O, O, O, O, O, H, N, H, H, N, O, O,
+	O, O, O, O, O, O, O, O, O, O, O, O, O, O, O, O,
+	H, P, O, 0, O, P, P, O, P, P, P, P, P, P, P, P,
+	D, D, D, D, D, D, D, D, D, D, O, P, P, P, P, O,
+	O, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I,
+	I, I, I, I, I, I, I, I, I, I, I, P, O, P, P, I,
+	O, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I,
+	I, I, I, I, I, I, I, I, I, I, I, P, P, P, P, O,
+	O, O, O, O, O, O, O, O, O, O, O, O, O, O, O, O,
+	O, O, O, O, O, O, O, O, O, O, O, O, O, O, O, O,
+	O, O, O, O, O, O, O, O, O, O, O, O, O, O, O, O,
+	O, O, O, O, O, O, O, O, O, O, O, O, O, O, O, O,
+	O, O, O, O, O, O, O, O, O, O, O, O, O, O, O, O,
+	O, O, O, O, O, O, O, O, O, O, O, O, O, O, O, O,
+	O, O, O, O, O, O, O, O, O, O, O, O, O, O, O, O,
+	O, O, O, O, O, O, O, O, O, O, O, O, O, O, O, O,
+};
+
+#undef H
+#undef N
+#undef I
+#undef D
+#undef P
+#undef O
+
+static inline bool
+is_class(char c, unsigned mask)
+{
+	return (char_class[(unsigned char) c] & mask) != 0;
+}
+
+static inline bool
+is_hex_digit(char c)
+{
+	return (c >= '0' && c <= '9') ||
+	       (c >= 'a' && c <= 'f') ||
+	       (c >= 'A' && c <= 'F');
+}
+
+/* Anything but [[:space:]] and the end of the source. */
+static inline bool
+is_nonspace(char c)
+{
+	return c != '\0' && !is_class(c, CLASS_HSPACE | CLASS_NEWLINE);
+}
+
+/* Length of a {NEWLINE}, (\r\n|\n\r|\r|\n), at p, or 0. */
+static unsigned
+newline_length(const char *p)
+{
+	if (p[0] == '\r')
+		return p[1] == '\n' ? 2 : 1;
+	if (p[0] == '\n')
+		return p[1] == '\r' ? 2 : 1;
+	return 0;
+}
+
+static unsigned
+run_length(const char *p, unsigned mask)
+{
+	const char *start = p;
+
+	while (is_class(*p, mask))
+		p++;
+
+	return p - start;
+}
+
+static unsigned
+nonspace_length(const char *p)
+{
+	const char *start = p;
+
+	while (is_nonspace(*p))
+		p++;
+
+	return p - start;
+}
+
+static unsigned
+to_end_of_line_length(const char *p)
+{
+	const char *start = p;
+
+	while (*p != '\0' && *p != '\r' && *p != '\n')
+		p++;
+
+	return p - start;
+}
+
+/* If p starts with word, returns the length of word, otherwise 0. */
+static unsigned
+word_length(const char *p, const char *word)
+{
+	unsigned len = strlen(word);
+
+	return strncmp(p, word, len) == 0 ? len : 0;
+}
+
+/* Length of the longest of {DECIMAL_INTEGER}, {OCTAL_INTEGER} and
+ * {HEXADECIMAL_INTEGER} at p, or 0. */
+static unsigned
+integer_length(const char *p)
+{
+	const char *start = p;
+
+	if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X') && is_hex_digit(p[2])) {
+		p += 2;
+		while (is_hex_digit(*p))
+			p++;
+	} else if (p[0] == '0') {
+		p++;
+		while (*p >= '0' && *p <= '7')
+			p++;
+	} else if (is_class(*p, CLASS_DIGIT)) {
+		p += run_length(p, CLASS_DIGIT);
+	} else {
+		return 0;
+	}
+
+	if (*p == 'u' || *p == 'U')
+		p++;
+
+	return p - start;
+}
+
+/* Length of a {PP_NUMBER}, [.]?[0-9]([._a-zA-Z0-9]|[eEpP][-+])*, at p,
+ * which must start with one. */
+static unsigned
+pp_number_length(const char *p)
+{
+	const char *start = p;
+
+	if (*p == '.')
+		p++;
+	p++;
+
+	for (;;) {
+		if ((*p == 'e' || *p == 'E' || *p == 'p' || *p == 'P') &&
+		    (p[1] == '+' || p[1] == '-')) {
+			p += 2;
+		} else if (*p == '.' ||
+			   is_class(*p, CLASS_IDENTIFIER | CLASS_DIGIT)) {
+			p++;
+		} else {
+			break;
+		}
+	}
+
+	return p - start;
+}
+
+/* Update all state necessary for each token being returned.
+ *
+ * Here we'll be tracking newlines and spaces so that the lexer can
+ * alter its behavior as necessary, (for example, '#' has special
+ * significance if it is the first non-whitespace, non-comment token
+ * in a line, but does not otherwise).
+ *
+ * NOTE: If this function returns FALSE, then no token should be
+ * returned at all. This is used to suprress duplicate SPACE tokens.
+ */
+static int
+glcpp_lex_update_state_per_token (glcpp_parser_t *parser, int token)
+{
+	if (token != NEWLINE && token != SPACE && token != HASH_TOKEN &&
+	    !parser->lexing_version_directive) {
+		glcpp_parser_resolve_implicit_version(parser);
+	}
+
+	/* After the first non-space token in a line, we won't
+	 * allow any '#' to introduce a directive. */
+	if (token == NEWLINE) {
+		parser->first_non_space_token_this_line = 1;
+	} else if (token != SPACE) {
+		parser->first_non_space_token_this_line = 0;
+	}
+
+	/* Track newlines just to know whether a newline needs
+	 * to be inserted if end-of-file comes early. */
+	if (token == NEWLINE) {
+		parser->last_token_was_newline = 1;
+	} else {
+		parser->last_token_was_newline = 0;
+	}
+
+	/* Track spaces to avoid emitting multiple SPACE
+	 * tokens in a row. */
+	if (token == SPACE) {
+		if (! parser->last_token_was_space) {
+			parser->last_token_was_space = 1;
+			return 1;
+		} else {
+			parser->last_token_was_space = 1;
+			return 0;
+		}
+	} else {
+		parser->last_token_was_space = 0;
+		return 1;
+	}
+}
+
+/* The rules below return one of the following, which correspond to the
+ * RETURN_TOKEN_NEVER_SKIP, RETURN_TOKEN and RETURN_STRING_TOKEN macros of
+ * the old flex lexer.
+ *
+ * lex_token_never_skip is needed for things like #if and the tokens of its
+ * condition, since these must be evaluated by the parser even when
+ * otherwise skipping, (such as within #if 0...#else).
+ */
+static int
+lex_token_never_skip(glcpp_parser_t *parser, int token)
+{
+	if (glcpp_lex_update_state_per_token(parser, token))
+		return token;
+
+	return NO_TOKEN;
+}
+
+static int
+lex_token(glcpp_parser_t *parser, int token)
+{
+	if (parser->skipping)
+		return NO_TOKEN;
+
+	return lex_token_never_skip(parser, token);
+}
+
+static int
+lex_string_token(glcpp_parser_t *parser, YYSTYPE *yylval, int token,
+		 const char *text, unsigned len)
+{
+	if (parser->skipping)
+		return NO_TOKEN;
+
+	yylval->str = linear_alloc_child(parser->linalloc, len + 1);
+	memcpy(yylval->str, text, len);
+	yylval->str[len] = '\0';
+
+	return lex_token_never_skip(parser, token);
+}
+
+static int
+lex_identifier_token(struct glcpp_lexer *lexer, YYSTYPE *yylval, int token,
+		     char *text, unsigned len)
+{
+	glcpp_parser_t *parser = lexer->parser;
+	char c;
+
+	if (parser->skipping)
+		return NO_TOKEN;
+
+	/* The source is our own copy, so the identifier can be terminated
+	 * in place for the lookup. */
+	c = text[len];
+	text[len] = '\0';
+	yylval->str = glcpp_lex_intern(parser, text);
+	text[len] = c;
+
+	return lex_token_never_skip(parser, token);
+}
+
+/* Consumes the next len characters of the source as the text of the current
+ * token, updating the location accordingly, and returns that text. */
+static char *
+begin_token(struct glcpp_lexer *lexer, YYLTYPE *yylloc, unsigned len)
+{
+	glcpp_parser_t *parser = lexer->parser;
+	char *text = lexer->pos;
+
+	if (parser->has_new_line_number)
+		lexer->lineno = parser->new_line_number;
+	if (parser->has_new_source_number)
+		yylloc->source = parser->new_source_number;
+	yylloc->first_column = lexer->column + 1;
+	yylloc->first_line = yylloc->last_line = lexer->lineno;
+	lexer->column += len;
+	yylloc->last_column = lexer->column + 1;
+	parser->has_new_line_number = 0;
+	parser->has_new_source_number = 0;
+
+	lexer->pos += len;
+
+	return text;
+}
+
+/* Single-line and multi-line comments, which may appear in the INITIAL,
+ * DEFINE and HASH states.  Returns true if a comment was started. */
+static bool
+lex_comment_start(struct glcpp_lexer *lexer, YYLTYPE *yylloc)
+{
+	const char *p = lexer->pos;
+
+	if (p[0] != '/')
+		return false;
+
+	if (p[1] == '/') {
+		begin_token(lexer, yylloc, 2 + to_end_of_line_length(p + 2));
+		return true;
+	}
+
+	if (p[1] == '*') {
+		begin_token(lexer, yylloc, 2);
+		lexer->comment_state = lexer->state;
+		lexer->state = STATE_COMMENT;
+		return true;
+	}
+
+	return false;
+}
+
+/* We preserve all newlines, even between #if 0..#endif, so no skipping. */
+static int
+lex_newline(struct glcpp_lexer *lexer, YYLTYPE *yylloc, unsigned len)
+{
+	glcpp_parser_t *parser = lexer->parser;
+
+	begin_token(lexer, yylloc, len);
+
+	if (parser->commented_newlines)
+		lexer->state = STATE_NEWLINE_CATCHUP;
+	else
+		lexer->state = STATE_INITIAL;
+	parser->space_tokens = 1;
+	parser->lexing_directive = 0;
+	parser->lexing_version_directive = 0;
+	lexer->lineno++;
+	lexer->column = 0;
+
+	return lex_token_never_skip(parser, NEWLINE);
+}
+
+static int
+lex_end_of_file(struct glcpp_lexer *lexer, YYLTYPE *yylloc)
+{
+	glcpp_parser_t *parser = lexer->parser;
+
+	if (lexer->state == STATE_COMMENT)
+		glcpp_error(yylloc, parser, "Unterminated comment");
+
+	/* Don't keep matching this rule forever. */
+	lexer->state = STATE_DONE;
+	parser->lexing_directive = 0;
+	parser->lexing_version_directive = 0;
+
+	if (! parser->last_token_was_newline)
+		return lex_token(parser, NEWLINE);
+
+	return NO_TOKEN;
+}
+
+static int
+lex_initial(struct glcpp_lexer *lexer, YYSTYPE *yylval, YYLTYPE *yylloc)
+{
+	static const struct {
+		char text[3];
+		int token;
+	} operators[] = {
+		{ "<<", LEFT_SHIFT },
+		{ ">>", RIGHT_SHIFT },
+		{ "<=", LESS_OR_EQUAL },
+		{ ">=", GREATER_OR_EQUAL },
+		{ "==", EQUAL },
+		{ "!=", NOT_EQUAL },
+		{ "&&", AND },
+		{ "||", OR },
+		{ "++", PLUS_PLUS },
+		{ "--", MINUS_MINUS },
+	};
+	glcpp_parser_t *parser = lexer->parser;
+	char *p = lexer->pos;
+	char *text;
+	unsigned len;
+
+	if (lex_comment_start(lexer, yylloc))
+		return NO_TOKEN;
+
+	if (p[0] == '#') {
+		if (p[1] == '#') {
+			begin_token(lexer, yylloc, 2);
+			if (parser->skipping)
+				return NO_TOKEN;
+			if (parser->is_gles)
+				glcpp_error(yylloc, parser, "Token pasting (##) is illegal in GLES");
+			return lex_token(parser, PASTE);
+		}
+
+		/* If the '#' is the first non-whitespace, non-comment token on
+		 * this line, then it introduces a directive, switch to the HASH
+		 * state.
+		 *
+		 * Otherwise, this is just punctuation, so return the HASH_TOKEN
+		 * token. */
+		begin_token(lexer, yylloc, 1);
+		if (parser->first_non_space_token_this_line) {
+			lexer->state = STATE_HASH;
+			parser->in_define = false;
+		}
+		return lex_token_never_skip(parser, HASH_TOKEN);
+	}
+
+	if (is_class(p[0], CLASS_PUNCTUATOR)) {
+		for (unsigned i = 0; i < ARRAY_SIZE(operators); i++) {
+			if (p[0] == operators[i].text[0] &&
+			    p[1] == operators[i].text[1]) {
+				begin_token(lexer, yylloc, 2);
+				return lex_token(parser, operators[i].token);
+			}
+		}
+	}
+
+	if (is_class(p[0], CLASS_DIGIT) ||
+	    (p[0] == '.' && is_class(p[1], CLASS_DIGIT))) {
+		/* Anything that looks like a number, but isn't an integer, is
+		 * passed through as OTHER. */
+		unsigned int_len = integer_length(p);
+
+		len = pp_number_length(p);
+		text = begin_token(lexer, yylloc, len);
+		return lex_string_token(parser, yylval,
+					len == int_len ? INTEGER_STRING : OTHER,
+					text, len);
+	}
+
+	switch (char_class[(unsigned char) p[0]]) {
+	case CLASS_IDENTIFIER:
+		len = 1 + run_length(p + 1, CLASS_IDENTIFIER | CLASS_DIGIT);
+		text = begin_token(lexer, yylloc, len);
+		if (len == 7 && strncmp(text, "defined", 7) == 0)
+			return lex_token(parser, DEFINED);
+		return lex_identifier_token(lexer, yylval, IDENTIFIER, text, len);
+
+	case CLASS_PUNCTUATOR:
+		text = begin_token(lexer, yylloc, 1);
+		return lex_token(parser, text[0]);
+
+	case CLASS_OTHER:
+		len = run_length(p, CLASS_OTHER);
+		text = begin_token(lexer, yylloc, len);
+		return lex_string_token(parser, yylval, OTHER, text, len);
+
+	case CLASS_HSPACE:
+		begin_token(lexer, yylloc, 1);
+		if (parser->space_tokens)
+			return lex_token(parser, SPACE);
+		return NO_TOKEN;
+
+	default:
+		return lex_newline(lexer, yylloc, newline_length(p));
+	}
+}
+
+/* When we lex a multi-line comment, we replace it (as specified) with a
+ * single space.  The newlines it contains are counted in
+ * parser->commented_newlines, see glcpp_lex.
+ */
+static int
+lex_comment(struct glcpp_lexer *lexer, YYLTYPE *yylloc)
+{
+	glcpp_parser_t *parser = lexer->parser;
+	const char *p = lexer->pos;
+	unsigned len = 0, nl;
+
+	if (p[0] == '*') {
+		while (p[len] == '*')
+			len++;
+
+		if (p[len] == '/') {
+			begin_token(lexer, yylloc, len + 1);
+			lexer->state = lexer->comment_state;
+			/* In the HASH state, we don't want any SPACE token. */
+			if (parser->space_tokens && lexer->state != STATE_HASH)
+				return lex_token(parser, SPACE);
+			return NO_TOKEN;
+		}
+
+		while (p[len] != '\0' && p[len] != '*' && p[len] != '/' &&
+		       !is_class(p[len], CLASS_NEWLINE))
+			len++;
+	} else {
+		while (p[len] != '\0' && p[len] != '*' &&
+		       !is_class(p[len], CLASS_NEWLINE))
+			len++;
+	}
+
+	nl = newline_length(p + len);
+	begin_token(lexer, yylloc, len + nl);
+	if (nl) {
+		lexer->lineno++;
+		lexer->column = 0;
+		parser->commented_newlines++;
+	}
+
+	return NO_TOKEN;
+}
+
+static int
+lex_hash(struct glcpp_lexer *lexer, YYSTYPE *yylval, YYLTYPE *yylloc)
+{
+	/* For the pre-processor directives, we return these tokens
+	 * even when we are otherwise skipping. */
+	static const struct {
+		const char *name;
+		int token;
+		bool needs_delimiter;
+		bool lexing_directive;
+	} conditionals[] = {
+		{ "ifndef", IFNDEF, false, true  },
+		{ "ifdef",  IFDEF,  false, true  },
+		{ "if",     IF,     true,  true  },
+		{ "elif",   ELIF,   true,  true  },
+		{ "else",   ELSE,   false, false },
+		{ "endif",  ENDIF,  false, false },
+	};
+	glcpp_parser_t *parser = lexer->parser;
+	char *p = lexer->pos;
+	char *text;
+	unsigned len, spaces;
+
+	if (lex_comment_start(lexer, yylloc))
+		return NO_TOKEN;
+
+	if ((len = word_length(p, "version")) &&
+	    (spaces = run_length(p + len, CLASS_HSPACE))) {
+		text = begin_token(lexer, yylloc, len + spaces);
+		lexer->state = STATE_INITIAL;
+		parser->space_tokens = 0;
+		parser->lexing_version_directive = 1;
+		return lex_string_token(parser, yylval, VERSION_TOKEN,
+					text, len + spaces);
+	}
+
+	/* Swallow empty #pragma directives, (to avoid confusing the
+	 * downstream compiler). */
+	if ((len = word_length(p, "pragma"))) {
+		spaces = run_length(p + len, CLASS_HSPACE);
+		if (is_class(p[len + spaces], CLASS_NEWLINE)) {
+			begin_token(lexer, yylloc, len + spaces);
+			lexer->state = STATE_INITIAL;
+			return NO_TOKEN;
+		}
+	}
+
+	/* glcpp doesn't handle #extension, #version, or #pragma directives.
+	 * Simply pass them through to the main compiler's lexer/parser. */
+	if ((len = word_length(p, "extension")) ||
+	    (len = word_length(p, "pragma"))) {
+		len += to_end_of_line_length(p + len);
+		text = begin_token(lexer, yylloc, len);
+		lexer->state = STATE_INITIAL;
+		return lex_string_token(parser, yylval, PRAGMA, text, len);
+	}
+
+	if ((len = word_length(p, "line")) &&
+	    (spaces = run_length(p + len, CLASS_HSPACE))) {
+		begin_token(lexer, yylloc, len + spaces);
+		lexer->state = STATE_INITIAL;
+		return lex_token(parser, LINE);
+	}
+
+	if ((len = newline_length(p))) {
+		begin_token(lexer, yylloc, len);
+		lexer->state = STATE_INITIAL;
+		parser->space_tokens = 0;
+		lexer->lineno++;
+		lexer->column = 0;
+		return lex_token_never_skip(parser, NEWLINE);
+	}
+
+	for (unsigned i = 0; i < ARRAY_SIZE(conditionals); i++) {
+		len = word_length(p, conditionals[i].name);
+		if (!len)
+			continue;
+
+		/* "if" and "elif" must not be followed by an identifier
+		 * character, (nor by the end of the source). */
+		if (conditionals[i].needs_delimiter &&
+		    (p[len] == '\0' ||
+		     is_class(p[len], CLASS_IDENTIFIER | CLASS_DIGIT)))
+			continue;
+
+		begin_token(lexer, yylloc, len);
+		if (parser->in_define)
+			return NO_TOKEN;
+
+		lexer->state = STATE_INITIAL;
+		if (conditionals[i].lexing_directive)
+			parser->lexing_directive = 1;
+		parser->space_tokens = 0;
+		return lex_token_never_skip(parser, conditionals[i].token);
+	}
+
+	if ((len = word_length(p, "error"))) {
+		len += to_end_of_line_length(p + len);
+		text = begin_token(lexer, yylloc, len);
+		lexer->state = STATE_INITIAL;
+		return lex_string_token(parser, yylval, ERROR_TOKEN, text, len);
+	}
+
+	/* After we see a "#define" we enter the DEFINE state, see
+	 * lex_define. */
+	if ((len = word_length(p, "define"))) {
+		begin_token(lexer, yylloc, len + run_length(p + len, CLASS_HSPACE));
+		parser->in_define = true;
+		if (parser->skipping)
+			return NO_TOKEN;
+		lexer->state = STATE_DEFINE;
+		parser->space_tokens = 0;
+		return lex_token(parser, DEFINE_TOKEN);
+	}
+
+	if ((len = word_length(p, "undef"))) {
+		begin_token(lexer, yylloc, len);
+		lexer->state = STATE_INITIAL;
+		parser->space_tokens = 0;
+		return lex_token(parser, UNDEF);
+	}
+
+	/* It's legal to have space between the '#' and the directive, so
+	 * don't leave the HASH state. */
+	if ((len = run_length(p, CLASS_HSPACE))) {
+		begin_token(lexer, yylloc, len);
+		return NO_TOKEN;
+	}
+
+	/* This will catch any non-directive garbage after a HASH */
+	begin_token(lexer, yylloc, 1);
+	if (parser->skipping)
+		return NO_TOKEN;
+	lexer->state = STATE_INITIAL;
+	return lex_token(parser, GARBAGE);
+}
+
+/* Within the DEFINE state we are looking for the first identifier and
+ * specifically checking whether the identifier is followed by a '(' or not,
+ * (to lex either a FUNC_IDENTIFIER or an OBJ_IDENTIFIER token).
+ *
+ * Comments and whitespace are ignored, anything else generates an error.
+ */
+static int
+lex_define(struct glcpp_lexer *lexer, YYSTYPE *yylval, YYLTYPE *yylloc)
+{
+	glcpp_parser_t *parser = lexer->parser;
+	char *p = lexer->pos;
+	char *text;
+	unsigned len;
+
+	if (lex_comment_start(lexer, yylloc))
+		return NO_TOKEN;
+
+	if (is_class(p[0], CLASS_IDENTIFIER)) {
+		len = 1 + run_length(p + 1, CLASS_IDENTIFIER | CLASS_DIGIT);
+		text = begin_token(lexer, yylloc, len);
+		lexer->state = STATE_INITIAL;
+		return lex_identifier_token(lexer, yylval,
+					    p[len] == '(' ? FUNC_IDENTIFIER :
+							    OBJ_IDENTIFIER,
+					    text, len);
+	}
+
+	if ((len = run_length(p, CLASS_HSPACE))) {
+		begin_token(lexer, yylloc, len);
+		return NO_TOKEN;
+	}
+
+	if ((len = newline_length(p)))
+		return lex_newline(lexer, yylloc, len);
+
+	if (p[0] == '/') {
+		if (p[1] == '\0') {
+			begin_token(lexer, yylloc, 1);
+			glcpp_error(yylloc, parser, "Internal compiler error: Unexpected character: /");
+			return NO_TOKEN;
+		}
+
+		/* '/' not followed by '*', so not a comment. */
+		len = 2 + nonspace_length(p + 2);
+	} else {
+		/* A character that can't start an identifier, comment, or
+		 * space. */
+		len = nonspace_length(p);
+	}
+
+	text = begin_token(lexer, yylloc, len);
+	lexer->state = STATE_INITIAL;
+	glcpp_error(yylloc, parser, "#define followed by a non-identifier: %.*s",
+		    (int) len, text);
+	return lex_string_token(parser, yylval, INTEGER_STRING, text, len);
+}
+
+int
+glcpp_lex (YYSTYPE *yylval, YYLTYPE *yylloc, yyscan_t scanner)
+{
+	struct glcpp_lexer *lexer = scanner;
+	glcpp_parser_t *parser = lexer->parser;
+	int token;
+
+	if (!lexer->started) {
+		lexer->started = true;
+		lexer->lineno = 1;
+		lexer->column = 0;
+		yylloc->source = 0;
+	}
+
+	/* When we lex a multi-line comment, we replace it (as
+	 * specified) with a single space. But if the comment spanned
+	 * multiple lines, then subsequent parsing stages will not
+	 * count correct line numbers. To avoid this problem we keep
+	 * track of all newlines that were commented out by a
+	 * multi-line comment, and we emit a NEWLINE token for each at
+	 * the next legal opportunity, (which is when the lexer would
+	 * be emitting a NEWLINE token anyway).
+	 */
+	if (lexer->state == STATE_NEWLINE_CATCHUP) {
+		if (parser->commented_newlines)
+			parser->commented_newlines--;
+		if (parser->commented_newlines == 0)
+			lexer->state = STATE_INITIAL;
+		return lex_token_never_skip(parser, NEWLINE);
+	}
+
+	/* Set up the parser->skipping bit here before doing any lexing.
+	 *
+	 * This bit controls whether tokens are skipped, (as implemented by
+	 * lex_token), such as between "#if 0" and "#endif".
+	 *
+	 * The parser maintains a skip_stack indicating whether we should be
+	 * skipping, (and nested levels of #if/#ifdef/#ifndef/#endif) will
+	 * push and pop items from the stack.
+	 *
+	 * Here are the rules for determining whether we are skipping:
+	 *
+	 *	1. If the skip stack is NULL, we are outside of all #if blocks
+	 *         and we are not skipping.
+	 *
+	 *	2. If the skip stack is non-NULL, the type of the top node in
+	 *	   the stack determines whether to skip. A type of
+	 *	   SKIP_NO_SKIP is used for blocks wheere we are emitting
+	 *	   tokens, (such as between #if 1 and #endif, or after the
+	 *	   #else of an #if 0, etc.).
+	 *
+	 *	3. The lexing_directive bit overrides the skip stack. This bit
+	 *	   is set when we are actively lexing the expression for a
+	 *	   pre-processor condition, (such as #if, #elif, or #else). In
+	 *	   this case, even if otherwise skipping, we need to emit the
+	 *	   tokens for this condition so that the parser can evaluate
+	 *	   the expression. (For, #else, there's no expression, but we
+	 *	   emit tokens so the parser can generate a nice error message
+	 *	   if there are any tokens here).
+	 */
+	if (parser->skip_stack &&
+	    parser->skip_stack->type != SKIP_NO_SKIP &&
+	    ! parser->lexing_directive)
+	{
+		parser->skipping = 1;
+	} else {
+		parser->skipping = 0;
+	}
+
+	do {
+		if (lexer->state == STATE_DONE)
+			return 0;
+
+		if (lexer->pos == lexer->end) {
+			token = lex_end_of_file(lexer, yylloc);
+			continue;
+		}
+
+		switch (lexer->state) {
+		case STATE_COMMENT:
+			token = lex_comment(lexer, yylloc);
+			break;
+		case STATE_DEFINE:
+			token = lex_define(lexer, yylval, yylloc);
+			break;
+		case STATE_HASH:
+			token = lex_hash(lexer, yylval, yylloc);
+			break;
+		default:
+			token = lex_initial(lexer, yylval, yylloc);
+			break;
+		}
+	} while (token == NO_TOKEN);
+
+	return token;
+}
+
+int
+glcpp_lex_init_extra (glcpp_parser_t *parser, yyscan_t* scanner)
+{
+	struct glcpp_lexer *lexer = rzalloc(NULL, struct glcpp_lexer);
+
+	lexer->parser = parser;
+	lexer->state = STATE_INITIAL;
+	lexer->identifiers = _mesa_set_create(lexer, _mesa_key_hash_string,
+					      _mesa_key_string_equal);
+
+	*scanner = lexer;
+	return 0;
+}
+
+void
+glcpp_lex_set_source_string(glcpp_parser_t *parser, const char *shader)
+{
+	struct glcpp_lexer *lexer = parser->scanner;
+
+	lexer->source = ralloc_strdup(lexer, shader);
+	lexer->pos = lexer->source;
+	lexer->end = lexer->source + strlen(lexer->source);
+}
+
+int
+glcpp_lex_destroy (yyscan_t scanner)
+{
+	ralloc_free(scanner);
+	return 0;
+}
+
+/* Returns the unique copy of the given identifier, so that identifiers can
+ * be compared by pointer.  The result lives as long as the parser, and must
+ * not be modified.
+ */
+char *
+glcpp_lex_intern(glcpp_parser_t *parser, const char *identifier)
+{
+	struct glcpp_lexer *lexer = parser->scanner;
+	uint32_t hash = _mesa_hash_string(identifier);
+	struct set_entry *entry;
+	char *str;
+
+	entry = _mesa_set_search_pre_hashed(lexer->identifiers, hash,
+					    identifier);
+	if (entry)
+		return (char *) entry->key;
+
+	str = linear_strdup(parser->linalloc, identifier);
+	_mesa_set_add_pre_hashed(lexer->identifiers, hash, str);
+
+	return str;
+}
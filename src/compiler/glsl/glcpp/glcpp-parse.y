@@ -99,6 +99,7 @@ _token_list_equal_ignoring_space(token_list_t *a, token_list_t *b);
 
 static void
 _parser_active_list_push(glcpp_parser_t *parser, const char *identifier,
+                         macro_t *macro, token_node_t *prev,
                          token_node_t *marker);
 
 static void
@@ -321,6 +322,7 @@ control_line_success:
 		entry = _mesa_hash_table_search (parser->defines, $3);
 		if (entry) {
 			_mesa_hash_table_remove (parser->defines, entry);
+			parser->defines_generation++;
 		}
 	}
 |	HASH_TOKEN IF pp_tokens NEWLINE {
@@ -1304,6 +1306,9 @@ _token_paste(glcpp_parser_t *parser, token_t *token, token_t *other)
       if (combined_type == INTEGER)
          combined_type = INTEGER_STRING;
 
+      if (combined_type == IDENTIFIER)
+         str = glcpp_lex_intern(parser, str);
+
       combined = _token_create_str (parser, combined_type, str);
       combined->location = token->location;
       return combined;
@@ -1348,7 +1353,7 @@ add_builtin_define(glcpp_parser_t *parser, const char *name, int value)
 
    list = _token_list_create(parser);
    _token_list_append(parser, list, tok);
-   _define_object_macro(parser, NULL, name, list);
+   _define_object_macro(parser, NULL, glcpp_lex_intern(parser, name), list);
 }
 
 /* Initial output buffer size, 4096 minus ralloc() overhead. It was selected
@@ -1365,10 +1370,16 @@ glcpp_parser_create(const struct gl_extensions *extension_list,
    parser = ralloc (NULL, glcpp_parser_t);
 
    glcpp_lex_init_extra (parser, &parser->scanner);
-   parser->defines = _mesa_hash_table_create(NULL, _mesa_key_hash_string,
-                                             _mesa_key_string_equal);
+   parser->defines = _mesa_hash_table_create(NULL, _mesa_hash_pointer,
+                                             _mesa_key_pointer_equal);
+   parser->defines_generation = 0;
    parser->linalloc = linear_alloc_parent(parser, 0);
    parser->active = NULL;
+   parser->expanded_macros = NULL;
+   parser->num_expanded_macros = 0;
+   parser->expanded_macros_size = 0;
+   parser->expand_depth = 0;
+   parser->uncacheable = 0;
    parser->lexing_directive = 0;
    parser->lexing_version_directive = 0;
    parser->space_tokens = 1;
@@ -1593,8 +1604,10 @@ _glcpp_parser_evaluate_defined(glcpp_parser_t *parser, token_node_t *node,
 
    *last = node;
 
+   /* The argument may be an OTHER token, which isn't interned. */
    return _mesa_hash_table_search(parser->defines,
-                                  argument->token->value.str) ? 1 : 0;
+                                  glcpp_lex_intern(parser,
+                                                   argument->token->value.str)) ? 1 : 0;
 
 FAIL:
    glcpp_error (&defined->token->location, parser,
@@ -1757,6 +1770,9 @@ _glcpp_parser_expand_function(glcpp_parser_t *parser, token_node_t *node,
    case FUNCTION_STATUS_SUCCESS:
       break;
    case FUNCTION_NOT_A_FUNCTION:
+      /* Whether this is a call may depend on what follows the expansion
+       * of an enclosing macro. */
+      parser->uncacheable++;
       return NULL;
    case FUNCTION_UNBALANCED_PARENTHESES:
       glcpp_error(&node->token->location, parser, "Macro %s call has unbalanced parentheses\n", identifier);
@@ -1818,6 +1834,58 @@ _glcpp_parser_expand_function(glcpp_parser_t *parser, token_node_t *node,
    return substituted;
 }
 
+/* Records that the macro named 'identifier' was expanded, so that the
+ * expansions in progress know what their result depends on.
+ */
+static void
+_parser_log_expanded_macro(glcpp_parser_t *parser, const char *identifier)
+{
+   if (parser->num_expanded_macros == parser->expanded_macros_size) {
+      parser->expanded_macros_size = parser->expanded_macros_size ?
+                                     parser->expanded_macros_size * 2 : 16;
+      parser->expanded_macros = reralloc(parser, parser->expanded_macros,
+                                         const char *,
+                                         parser->expanded_macros_size);
+   }
+
+   parser->expanded_macros[parser->num_expanded_macros++] = identifier;
+}
+
+/* A cached expansion can be used as long as no macro was defined or
+ * undefined since it was recorded, and none of the macros it expanded to
+ * would now be left alone for being expanded already.
+ */
+static bool
+_expansion_cache_is_usable(glcpp_parser_t *parser, expansion_cache_t *cache)
+{
+   if (cache->tokens == NULL ||
+       cache->generation != parser->defines_generation)
+      return false;
+
+   for (unsigned i = 0; i < cache->num_macros; i++) {
+      if (_parser_active_list_contains(parser, cache->macros[i]))
+         return false;
+   }
+
+   return true;
+}
+
+/* Copy the tokens from 'node' up to, but not including, 'end'. */
+static token_list_t *
+_token_list_copy_until(glcpp_parser_t *parser, token_node_t *node,
+                       token_node_t *end)
+{
+   token_list_t *copy = _token_list_create(parser);
+
+   for (; node != end; node = node->next) {
+      token_t *new_token = linear_alloc_child(parser->linalloc, sizeof(token_t));
+      *new_token = *node->token;
+      _token_list_append(parser, copy, new_token);
+   }
+
+   return copy;
+}
+
 /* Compute the complete expansion of node, (and subsequent nodes after
  * 'node' in the case that 'node' is a function-like macro and
  * subsequent nodes are arguments).
@@ -1833,19 +1901,26 @@ _glcpp_parser_expand_function(glcpp_parser_t *parser, token_node_t *node,
  *   As the token of the closing right parenthesis in the case of
  *   function-like macro expansion.
  *
+ * *macro_out is set to the macro that was expanded, if any. *complete is set
+ * when the expansion came from the macro's cache, meaning that it needs no
+ * further expansion.
+ *
  * See the documentation of _glcpp_parser_expand_token_list for a description
  * of the "mode" parameter.
  */
 static token_list_t *
 _glcpp_parser_expand_node(glcpp_parser_t *parser, token_node_t *node,
                           token_node_t **last, expansion_mode_t mode,
-                          int line)
+                          int line, macro_t **macro_out, bool *complete)
 {
    token_t *token = node->token;
    const char *identifier;
    struct hash_entry *entry;
    macro_t *macro;
 
+   *macro_out = NULL;
+   *complete = false;
+
    /* We only expand identifiers */
    if (token->type != IDENTIFIER) {
       return NULL;
@@ -1857,12 +1932,16 @@ _glcpp_parser_expand_node(glcpp_parser_t *parser, token_node_t *node,
    /* Special handling for __LINE__ and __FILE__, (not through
     * the hash table). */
    if (*identifier == '_') {
-      if (strcmp(identifier, "__LINE__") == 0)
+      if (strcmp(identifier, "__LINE__") == 0) {
+         parser->uncacheable++;
          return _token_list_create_with_one_integer(parser, line);
+      }
 
-      if (strcmp(identifier, "__FILE__") == 0)
+      if (strcmp(identifier, "__FILE__") == 0) {
+         parser->uncacheable++;
          return _token_list_create_with_one_integer(parser,
                                                     node->token->location.source);
+      }
    }
 
    /* Look up this identifier in the hash table. */
@@ -1886,16 +1965,27 @@ _glcpp_parser_expand_node(glcpp_parser_t *parser, token_node_t *node,
       final = _token_create_str(parser, OTHER, str);
       expansion = _token_list_create(parser);
       _token_list_append(parser, expansion, final);
+      parser->uncacheable++;
       return expansion;
    }
 
+   *macro_out = macro;
+
    if (! macro->is_function) {
       token_list_t *replacement;
+      expansion_cache_t *cache = &macro->cache[mode];
 
       /* Replace a macro defined as empty with a SPACE token. */
       if (macro->replacements == NULL)
          return _token_list_create_with_one_space(parser);
 
+      if (_expansion_cache_is_usable(parser, cache)) {
+         for (unsigned i = 0; i < cache->num_macros; i++)
+            _parser_log_expanded_macro(parser, cache->macros[i]);
+         *complete = true;
+         return _token_list_copy(parser, cache->tokens);
+      }
+
       replacement = _token_list_copy(parser, macro->replacements);
       _glcpp_parser_apply_pastes(parser, replacement);
       return replacement;
@@ -1910,17 +2000,28 @@ _glcpp_parser_expand_node(glcpp_parser_t *parser, token_node_t *node,
  * expansion of 'identifier'. That is, when the list iterator begins
  * examining 'marker', then it is time to pop this node from the
  * active stack.
+ *
+ * 'prev' is the node preceding the expansion, which lets
+ * _parser_active_list_finish find the expansion once it's complete.
  */
 static void
 _parser_active_list_push(glcpp_parser_t *parser, const char *identifier,
+                         macro_t *macro, token_node_t *prev,
                          token_node_t *marker)
 {
    active_list_t *node;
 
+   _parser_log_expanded_macro(parser, identifier);
+
    node = linear_alloc_child(parser->linalloc, sizeof(active_list_t));
-   node->identifier = linear_strdup(parser->linalloc, identifier);
+   node->identifier = identifier;
    node->marker = marker;
    node->next = parser->active;
+   node->macro = macro;
+   node->prev = prev;
+   node->first_expanded_macro = parser->num_expanded_macros;
+   node->uncacheable = parser->uncacheable;
+   node->info_log_length = parser->info_log->length;
 
    parser->active = node;
 }
@@ -1939,6 +2040,42 @@ _parser_active_list_pop(glcpp_parser_t *parser)
    parser->active = node;
 }
 
+/* Pop the top of the active list when the list iterator reaches its marker.
+ *
+ * At that point, the expansion is complete. If it's the expansion of an
+ * object-like macro that didn't depend on anything but macro definitions
+ * (nor generated any diagnostics), it is recorded in the macro's cache so
+ * that later expansions of the macro can simply copy it.
+ */
+static void
+_parser_active_list_finish(glcpp_parser_t *parser, token_list_t *list,
+                           expansion_mode_t mode)
+{
+   active_list_t *active = parser->active;
+   macro_t *macro = active->macro;
+
+   if (macro && !macro->is_function &&
+       active->uncacheable == parser->uncacheable &&
+       active->info_log_length == parser->info_log->length &&
+       !(macro->cache[mode].tokens &&
+         macro->cache[mode].generation == parser->defines_generation)) {
+      expansion_cache_t *cache = &macro->cache[mode];
+      token_node_t *start = active->prev ? active->prev->next : list->head;
+
+      cache->generation = parser->defines_generation;
+      cache->tokens = _token_list_copy_until(parser, start, active->marker);
+      cache->num_macros = parser->num_expanded_macros -
+                          active->first_expanded_macro;
+      cache->macros = linear_alloc_child(parser->linalloc,
+                                         cache->num_macros * sizeof(const char *));
+      memcpy(cache->macros,
+             &parser->expanded_macros[active->first_expanded_macro],
+             cache->num_macros * sizeof(const char *));
+   }
+
+   _parser_active_list_pop(parser);
+}
+
 static int
 _parser_active_list_contains(glcpp_parser_t *parser, const char *identifier)
 {
@@ -1947,8 +2084,9 @@ _parser_active_list_contains(glcpp_parser_t *parser, const char *identifier)
    if (parser->active == NULL)
       return 0;
 
+   /* Identifiers are interned, see glcpp_lex_intern. */
    for (node = parser->active; node; node = node->next)
-      if (strcmp(node->identifier, identifier) == 0)
+      if (node->identifier == identifier)
          return 1;
 
    return 0;
@@ -1983,6 +2121,8 @@ _glcpp_parser_expand_token_list(glcpp_parser_t *parser, token_list_t *list,
    token_node_t *node, *last = NULL;
    token_list_t *expansion;
    active_list_t *active_initial = parser->active;
+   macro_t *macro;
+   bool complete;
    int line;
 
    if (list == NULL)
@@ -1998,25 +2138,34 @@ _glcpp_parser_expand_token_list(glcpp_parser_t *parser, token_list_t *list,
    if (mode == EXPANSION_MODE_EVALUATE_DEFINED)
       _glcpp_parser_evaluate_defined_in_list (parser, list);
 
+   parser->expand_depth++;
+
    while (node) {
 
       while (parser->active && parser->active->marker == node)
-         _parser_active_list_pop (parser);
+         _parser_active_list_finish (parser, list, mode);
 
-      expansion = _glcpp_parser_expand_node (parser, node, &last, mode, line);
+      expansion = _glcpp_parser_expand_node (parser, node, &last, mode, line,
+                                             &macro, &complete);
       if (expansion) {
          token_node_t *n;
 
-         if (mode == EXPANSION_MODE_EVALUATE_DEFINED) {
+         if (mode == EXPANSION_MODE_EVALUATE_DEFINED && !complete) {
             _glcpp_parser_evaluate_defined_in_list (parser, expansion);
          }
 
+         /* A function-like macro invocation may consume the end of other
+          * expansions, which are then incomplete and can't be cached. */
          for (n = node; n != last->next; n = n->next)
             while (parser->active && parser->active->marker == n) {
                _parser_active_list_pop (parser);
             }
 
-         _parser_active_list_push(parser, node->token->value.str, last->next);
+         if (complete)
+            _parser_log_expanded_macro(parser, node->token->value.str);
+         else
+            _parser_active_list_push(parser, node->token->value.str, macro,
+                                     node_prev, last->next);
 
          /* Splice expansion into list, supporting a simple deletion if the
           * expansion is empty.
@@ -2029,6 +2178,10 @@ _glcpp_parser_expand_token_list(glcpp_parser_t *parser, token_list_t *list,
             expansion->tail->next = last->next;
             if (last == list->tail)
                list->tail = expansion->tail;
+
+            /* A cached expansion is already fully expanded. */
+            if (complete)
+               node_prev = expansion->tail;
          } else {
             if (node_prev)
                node_prev->next = last->next;
@@ -2045,11 +2198,19 @@ _glcpp_parser_expand_token_list(glcpp_parser_t *parser, token_list_t *list,
 
    /* Remove any lingering effects of this invocation on the
     * active list. That is, pop until the list looks like it did
-    * at the beginning of this function. */
-   while (parser->active && parser->active != active_initial)
-      _parser_active_list_pop (parser);
+    * at the beginning of this function. Expansions that reach the end
+    * of the list are complete. */
+   while (parser->active && parser->active != active_initial) {
+      if (parser->active->marker == NULL)
+         _parser_active_list_finish (parser, list, mode);
+      else
+         _parser_active_list_pop (parser);
+   }
 
    list->non_space_tail = list->tail;
+
+   if (--parser->expand_depth == 0)
+      parser->num_expanded_macros = 0;
 }
 
 void
@@ -2126,11 +2287,11 @@ _define_object_macro(glcpp_parser_t *parser, YYLTYPE *loc,
    if (loc != NULL)
       _check_for_reserved_macro_name(parser, loc, identifier);
 
-   macro = linear_alloc_child(parser->linalloc, sizeof(macro_t));
+   macro = linear_zalloc_child(parser->linalloc, sizeof(macro_t));
 
    macro->is_function = 0;
    macro->parameters = NULL;
-   macro->identifier = linear_strdup(parser->linalloc, identifier);
+   macro->identifier = identifier;
    macro->replacements = replacements;
 
    entry = _mesa_hash_table_search(parser->defines, identifier);
@@ -2143,6 +2304,7 @@ _define_object_macro(glcpp_parser_t *parser, YYLTYPE *loc,
    }
 
    _mesa_hash_table_insert (parser->defines, identifier, macro);
+   parser->defines_generation++;
 }
 
 void
@@ -2161,11 +2323,11 @@ _define_function_macro(glcpp_parser_t *parser, YYLTYPE *loc,
       glcpp_error (loc, parser, "Duplicate macro parameter \"%s\"", dup);
    }
 
-   macro = linear_alloc_child(parser->linalloc, sizeof(macro_t));
+   macro = linear_zalloc_child(parser->linalloc, sizeof(macro_t));
 
    macro->is_function = 1;
    macro->parameters = parameters;
-   macro->identifier = linear_strdup(parser->linalloc, identifier);
+   macro->identifier = identifier;
    macro->replacements = replacements;
 
    entry = _mesa_hash_table_search(parser->defines, identifier);
@@ -2178,6 +2340,7 @@ _define_function_macro(glcpp_parser_t *parser, YYLTYPE *loc,
    }
 
    _mesa_hash_table_insert(parser->defines, identifier, macro);
+   parser->defines_generation++;
 }
 
 static int
@@ -143,11 +143,25 @@ glcpp_parser_classify_token (glcpp_parser_t *parser,
 			     const char *identifier,
 			     int *parameter_index);
 
+/* The complete expansion of an object-like macro, as computed the last time
+ * it was expanded. It remains valid as long as no macro is defined or
+ * undefined, (see glcpp_parser.defines_generation), and may only be reused
+ * when none of the macros it expanded to is currently being expanded.
+ */
+typedef struct expansion_cache {
+	unsigned generation;
+	token_list_t *tokens;
+	const char **macros;
+	unsigned num_macros;
+} expansion_cache_t;
+
 typedef struct {
 	int is_function;
 	string_list_t *parameters;
 	const char *identifier;
 	token_list_t *replacements;
+	/* Indexed by expansion_mode_t. */
+	expansion_cache_t cache[2];
 } macro_t;
 
 typedef struct expansion_node {
@@ -173,6 +187,18 @@ typedef struct active_list {
 	const char *identifier;
 	token_node_t *marker;
 	struct active_list *next;
+
+	/* State needed to record the expansion of an object-like macro in
+	 * its cache once it's complete: the macro, the node preceding the
+	 * expansion in the list, (NULL if it starts the list), where the
+	 * macros it expands to start in glcpp_parser.expanded_macros, and
+	 * the values of glcpp_parser.uncacheable and of the info log length
+	 * before the expansion. */
+	macro_t *macro;
+	token_node_t *prev;
+	unsigned first_expanded_macro;
+	unsigned uncacheable;
+	uint32_t info_log_length;
 } active_list_t;
 
 struct _mesa_glsl_parse_state;
@@ -187,8 +213,20 @@ typedef void (*glcpp_extension_iterator)(
 struct glcpp_parser {
 	void *linalloc;
 	yyscan_t scanner;
+	/* Maps interned identifiers, (see glcpp_lex_intern), to macro_t. */
 	struct hash_table *defines;
+	/* Incremented whenever a macro is defined or undefined. */
+	unsigned defines_generation;
 	active_list_t *active;
+	/* Identifiers of all macros expanded by the outermost
+	 * _glcpp_parser_expand_token_list call in progress. */
+	const char **expanded_macros;
+	unsigned num_expanded_macros;
+	unsigned expanded_macros_size;
+	unsigned expand_depth;
+	/* Incremented whenever an expansion depends on more than the
+	 * definitions of the macros involved, (such as __LINE__). */
+	unsigned uncacheable;
 	int lexing_directive;
 	int lexing_version_directive;
 	int space_tokens;
@@ -254,7 +292,7 @@ glcpp_error (YYLTYPE *locp, glcpp_parser_t *parser, const char *fmt, ...);
 void
 glcpp_warning (YYLTYPE *locp, glcpp_parser_t *parser, const char *fmt, ...);
 
-/* Generated by glcpp-lex.l to glcpp-lex.c */
+/* Functions from glcpp-lex.c */
 
 int
 glcpp_lex_init_extra (glcpp_parser_t *parser, yyscan_t* scanner);
@@ -268,6 +306,9 @@ glcpp_lex (YYSTYPE *lvalp, YYLTYPE *llocp, yyscan_t scanner);
 int
 glcpp_lex_destroy (yyscan_t scanner);
 
+char *
+glcpp_lex_intern(glcpp_parser_t *parser, const char *identifier);
+
 /* Generated by glcpp-parse.y to glcpp-parse.c */
 
 int
@@ -0,0 +1,29 @@
+#define A B C
+#define B b
+#define C c B
+A A
+#define D A D
+D D
+#undef B
+A
+#define B bb
+A
+#define L __LINE__
+L
+L
+#define F(x) (x)
+#define G F
+G(1) G (2) G
+G x
+G(3)
+#define DEF defined(B)
+#if DEF
+defined
+#endif
+#undef B
+#if DEF
+not defined
+#else
+undefined
+#endif
+A
@@ -34,9 +34,11 @@
 #include "util/ralloc.h"
 #include "util/disk_cache.h"
 #include "util/mesa-sha1.h"
+#include "util/os_time.h"
 #include "ast.h"
 #include "glsl_parser_extras.h"
 #include "glsl_parser.h"
+#include "program.h"
 #include "ir_optimization.h"
 #include "loop_analysis.h"
 #include "builtin_functions.h"
@@ -2051,9 +2053,12 @@ opt_shader_and_create_symbol_table(struct gl_context *ctx,
       &ctx->Const.ShaderCompilerOptions[shader->Stage];
 
    /* Do some optimization at compile time to reduce shader IR size
-    * and reduce later work if the same shader is linked multiple times
+    * and reduce later work if the same shader is linked multiple times.
+    * Drivers that ask for it optimize the linked shader in NIR instead.
     */
-   if (ctx->Const.GLSLOptimizeConservatively) {
+   if (options->NirOptions && ctx->Const.GLSLMinimalIROptimization) {
+      /* Left to the NIR optimization loop. */
+   } else if (ctx->Const.GLSLOptimizeConservatively) {
       /* Run it just once. */
       do_common_optimization(shader->ir, false, false, options,
                              ctx->Const.NativeIntegers);
@@ -2103,9 +2108,33 @@ opt_shader_and_create_symbol_table(struct gl_context *ctx,
                                       shader->symbols);
 }
 
+/* Adds the time since *start to *total and restarts the clock. */
+static void
+add_phase_time(int64_t *total, int64_t *start)
+{
+   int64_t now = os_time_get_nano();
+   *total += now - *start;
+   *start = now;
+}
+
 void
 _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
                           bool dump_ast, bool dump_hir, bool force_recompile)
+{
+   _mesa_glsl_compile_shader_timed(ctx, shader, dump_ast, dump_hir,
+                                   force_recompile, NULL);
+}
+
+/**
+ * Like _mesa_glsl_compile_shader(), and adds the time spent in each phase of
+ * the compile to \p timings if it isn't NULL.
+ */
+void
+_mesa_glsl_compile_shader_timed(struct gl_context *ctx,
+                                struct gl_shader *shader,
+                                bool dump_ast, bool dump_hir,
+                                bool force_recompile,
+                                struct _mesa_glsl_compile_timings *timings)
 {
    const char *source = force_recompile && shader->FallbackSource ?
       shader->FallbackSource : shader->Source;
@@ -2144,9 +2173,14 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
       (void) p_atomic_cmpxchg(&ir_variable::temporaries_allocate_names,
                               false, true);
 
+   int64_t phase_start = timings ? os_time_get_nano() : 0;
+
    state->error = glcpp_preprocess(state, &source, &state->info_log,
                                    add_builtin_defines, state, ctx);
 
+   if (timings)
+      add_phase_time(&timings->preprocess, &phase_start);
+
    if (!state->error) {
      _mesa_glsl_lexer_ctor(state, source);
      _mesa_glsl_parse(state);
@@ -2154,6 +2188,9 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
      do_late_parsing_checks(state);
    }
 
+   if (timings)
+      add_phase_time(&timings->parse, &phase_start);
+
    if (dump_ast) {
       foreach_list_typed(ast_node, ast, link, &state->translation_unit) {
          ast->print();
@@ -2175,6 +2212,9 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
       }
    }
 
+   if (timings)
+      add_phase_time(&timings->ast_to_hir, &phase_start);
+
    if (shader->InfoLog)
       ralloc_free(shader->InfoLog);
 
@@ -2193,6 +2233,9 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
       opt_shader_and_create_symbol_table(ctx, state->symbols, shader);
    }
 
+   if (timings)
+      add_phase_time(&timings->opt, &phase_start);
+
    if (!force_recompile) {
       free((void *)shader->FallbackSource);
       shader->FallbackSource = NULL;
@@ -2212,6 +2255,51 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
 }
 
 } /* extern "C" */
+/**
+ * Unroll the loops the driver allows and clean up after it, so that indices
+ * that depended on the induction variable become constant.
+ */
+static bool
+do_loop_unrolling(exec_list *ir,
+                  const struct gl_shader_compiler_options *options)
+{
+   bool progress = false;
+
+   if (options->MaxUnrollIterations) {
+      loop_state *ls = analyze_loop_variables(ir);
+      if (ls->loop_found) {
+         bool loop_progress = unroll_loops(ir, ls, options);
+         while (loop_progress) {
+            loop_progress = false;
+            loop_progress |= do_constant_propagation(ir);
+            loop_progress |= do_if_simplification(ir);
+
+            /* Some drivers only call do_common_optimization() once rather
+             * than in a loop. So we must call do_lower_jumps() after
+             * unrolling a loop because for drivers that use LLVM validation
+             * will fail if a jump is not the last instruction in the block.
+             * For example the following will fail LLVM validation:
+             *
+             *   (loop (
+             *      ...
+             *   break
+             *   (assign  (x) (var_ref v124)  (expression int + (var_ref v124)
+             *      (constant int (1)) ) )
+             *   ))
+             */
+            loop_progress |= do_lower_jumps(ir, true, true,
+                                            options->EmitNoMainReturn,
+                                            options->EmitNoCont,
+                                            options->EmitNoLoops);
+         }
+         progress |= loop_progress;
+      }
+      delete ls;
+   }
+
+   return progress;
+}
+
 /**
  * Do the set of common optimizations passes
  *
@@ -2298,39 +2386,49 @@ do_common_optimization(exec_list *ir, bool linked,
    OPT(optimize_split_arrays, ir, linked);
    OPT(optimize_redundant_jumps, ir);
 
-   if (options->MaxUnrollIterations) {
-      loop_state *ls = analyze_loop_variables(ir);
-      if (ls->loop_found) {
-         bool loop_progress = unroll_loops(ir, ls, options);
-         while (loop_progress) {
-            loop_progress = false;
-            loop_progress |= do_constant_propagation(ir);
-            loop_progress |= do_if_simplification(ir);
-
-            /* Some drivers only call do_common_optimization() once rather
-             * than in a loop. So we must call do_lower_jumps() after
-             * unrolling a loop because for drivers that use LLVM validation
-             * will fail if a jump is not the last instruction in the block.
-             * For example the following will fail LLVM validation:
-             *
-             *   (loop (
-             *      ...
-             *   break
-             *   (assign  (x) (var_ref v124)  (expression int + (var_ref v124)
-             *      (constant int (1)) ) )
-             *   ))
-             */
-            loop_progress |= do_lower_jumps(ir, true, true,
-                                            options->EmitNoMainReturn,
-                                            options->EmitNoCont,
-                                            options->EmitNoLoops);
-         }
-         progress |= loop_progress;
-      }
-      delete ls;
-   }
+   OPT(do_loop_unrolling, ir, options);
 
 #undef OPT
 
    return progress;
 }
+
+/**
+ * Do the optimizations passes a linked shader needs before it is handed to
+ * glsl_to_nir
+ *
+ * Drivers that consume NIR run their own optimization loop, which does
+ * everything do_common_optimization() does and more.  This only inlines
+ * functions, makes constant arrays and indices visible to the linker's
+ * lowering and validation, drops the declarations of unused variables so
+ * they don't count against the limits, and removes code after jumps.
+ *
+ * \param ir       List of instructions to be optimized
+ * \param options  The driver's preferred shader options.
+ * \param unroll   Also unroll loops, for when something has to see constant
+ *                 indices in place of loop induction variables, such as
+ *                 the GLSL IR lowering of indirect addressing.
+ */
+bool
+do_minimal_optimization(exec_list *ir,
+                        const struct gl_shader_compiler_options *options,
+                        bool unroll)
+{
+   bool progress = false;
+
+   progress = do_function_inlining(ir) || progress;
+   progress = do_dead_functions(ir) || progress;
+   propagate_invariance(ir);
+   progress = do_constant_variable(ir) || progress;
+   progress = do_constant_folding(ir) || progress;
+   if (unroll)
+      progress = do_loop_unrolling(ir, options) || progress;
+   progress = do_dead_code(ir, false) || progress;
+   progress = do_lower_jumps(ir, true, true, options->EmitNoMainReturn,
+                             options->EmitNoCont, options->EmitNoLoops) ||
+              progress;
+   progress = do_vec_index_to_swizzle(ir) || progress;
+   progress = lower_vector_insert(ir, false) || progress;
+
+   return progress;
+}
@@ -94,6 +94,9 @@ bool do_common_optimization(exec_list *ir, bool linked,
 			    bool uniform_locations_assigned,
                             const struct gl_shader_compiler_options *options,
                             bool native_integers);
+bool do_minimal_optimization(exec_list *ir,
+                             const struct gl_shader_compiler_options *options,
+                             bool unroll);
 
 bool ir_constant_fold(ir_rvalue **rvalue);
 
@@ -4836,21 +4836,36 @@ link_varyings_and_uniforms(unsigned first, unsigned last,
 }
 
 static void
-linker_optimisation_loop(struct gl_context *ctx, exec_list *ir,
+linker_optimisation_loop(struct gl_context *ctx,
+                         struct gl_shader_program *prog, exec_list *ir,
                          unsigned stage)
 {
-      if (ctx->Const.GLSLOptimizeConservatively) {
-         /* Run it just once. */
-         do_common_optimization(ir, true, false,
-                                &ctx->Const.ShaderCompilerOptions[stage],
-                                ctx->Const.NativeIntegers);
-      } else {
-         /* Repeat it until it stops making changes. */
-         while (do_common_optimization(ir, true, false,
-                                       &ctx->Const.ShaderCompilerOptions[stage],
-                                       ctx->Const.NativeIntegers))
-            ;
-      }
+   const struct gl_shader_compiler_options *options =
+      &ctx->Const.ShaderCompilerOptions[stage];
+
+   if (options->NirOptions && ctx->Const.GLSLMinimalIROptimization) {
+      /* The loops still have to be unrolled for the sampler array indexing
+       * validation below and for the GLSL IR lowering of indirect
+       * addressing, which both want constant indices.
+       */
+      const bool unroll =
+         (!prog->IsES && prog->data->Version < 130) ||
+         (prog->IsES && prog->data->Version < 300) ||
+         options->EmitNoIndirectInput || options->EmitNoIndirectOutput ||
+         options->EmitNoIndirectTemp || options->EmitNoIndirectUniform ||
+         options->EmitNoIndirectSampler;
+
+      do_minimal_optimization(ir, options, unroll);
+   } else if (ctx->Const.GLSLOptimizeConservatively) {
+      /* Run it just once. */
+      do_common_optimization(ir, true, false, options,
+                             ctx->Const.NativeIntegers);
+   } else {
+      /* Repeat it until it stops making changes. */
+      while (do_common_optimization(ir, true, false, options,
+                                    ctx->Const.NativeIntegers))
+         ;
+   }
 }
 
 void
@@ -5192,12 +5207,12 @@ link_shaders(struct gl_context *ctx, struct gl_shader_program *prog)
       /* Call opts before lowering const arrays to uniforms so we can const
        * propagate any elements accessed directly.
        */
-      linker_optimisation_loop(ctx, prog->_LinkedShaders[i]->ir, i);
+      linker_optimisation_loop(ctx, prog, prog->_LinkedShaders[i]->ir, i);
 
       /* Call opts after lowering const arrays to copy propagate things. */
       if (ctx->Const.GLSLLowerConstArrays &&
           lower_const_arrays_to_uniforms(prog->_LinkedShaders[i]->ir, i))
-         linker_optimisation_loop(ctx, prog->_LinkedShaders[i]->ir, i);
+         linker_optimisation_loop(ctx, prog, prog->_LinkedShaders[i]->ir, i);
    }
 
    /* Validation for special cases where we allow sampler array indexing
@@ -47,6 +47,11 @@ const struct option compiler_opts[] = {
    { "link",     no_argument, &options.do_link,  1 },
    { "just-log", no_argument, &options.just_log, 1 },
    { "version",  required_argument, NULL, 'v' },
+   { "bench",    no_argument, &options.bench,    1 },
+   { "jobs",     required_argument, NULL, 'j' },
+   { "minimal-ir-opts", no_argument, &options.minimal_ir_opts, 1 },
+   { "profile-nir", no_argument, &options.profile_nir, 1 },
+   { "slab-ralloc", no_argument, &options.slab_ralloc, 1 },
    { NULL, 0, NULL, 0 }
 };
 
@@ -59,9 +64,11 @@ usage_fail(const char *name)
 
    const char *header =
       "usage: %s [options] <file.vert | file.tesc | file.tese | file.geom | file.frag | file.comp>\n"
+      "       %s --bench [--jobs N] [--minimal-ir-opts] [--profile-nir] [--slab-ralloc]\n"
+      "                [options] <file.shader_test | directory>...\n"
       "\n"
       "Possible options are:\n";
-   printf(header, name);
+   printf(header, name, name);
    for (const struct option *o = compiler_opts; o->name != 0; ++o) {
       printf("    --%s", o->name);
       if (o->has_arg == required_argument)
@@ -83,6 +90,9 @@ main(int argc, char * const* argv)
       case 'v':
          options.glsl_version = strtol(optarg, NULL, 10);
          break;
+      case 'j':
+         options.jobs = strtol(optarg, NULL, 10);
+         break;
       default:
          break;
       }
@@ -91,6 +101,9 @@ main(int argc, char * const* argv)
    if (argc <= optind)
       usage_fail(argv[0]);
 
+   if (options.bench)
+      return standalone_bench(&options, argc - optind, &argv[optind]);
+
    struct gl_shader_program *whole_program;
    static struct gl_context local_ctx;
 
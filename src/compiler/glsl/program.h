@@ -25,6 +25,8 @@
 #ifndef GLSL_PROGRAM_H
 #define GLSL_PROGRAM_H
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -37,6 +39,26 @@ extern void
 _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
 			  bool dump_ast, bool dump_hir, bool force_recompile);
 
+/**
+ * Time spent in each phase of the compile, in nanoseconds.
+ *
+ * \sa _mesa_glsl_compile_shader_timed
+ */
+struct _mesa_glsl_compile_timings {
+   int64_t preprocess;
+   int64_t parse;
+   int64_t ast_to_hir;
+   /** Lowering and optimizations of the unlinked GLSL IR */
+   int64_t opt;
+};
+
+extern void
+_mesa_glsl_compile_shader_timed(struct gl_context *ctx,
+                                struct gl_shader *shader,
+                                bool dump_ast, bool dump_hir,
+                                bool force_recompile,
+                                struct _mesa_glsl_compile_timings *timings);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -42,6 +42,11 @@
  * in the hope that the final linked shader will be found in the cache.
  * If anything goes wrong (shader variant not found, backend cache item is
  * corrupt, etc) we will use a fallback path to compile and link the IR.
+ *
+ * Drivers that consume NIR can store the final, driver-lowered NIR of each
+ * stage in their driver blob with shader_cache_write_nir().  Since that NIR
+ * depends on the driver's NIR compiler options these are part of the
+ * program key.
  */
 
 #include "compiler/shader_info.h"
@@ -54,6 +59,7 @@
 #include "linker.h"
 #include "link_varyings.h"
 #include "nir.h"
+#include "nir_serialize.h"
 #include "program.h"
 #include "serialize.h"
 #include "shader_cache.h"
@@ -74,6 +80,100 @@ compile_shaders(struct gl_context *ctx, struct gl_shader_program *prog) {
    }
 }
 
+/**
+ * Hash the NIR compiler options field by field, so that the padding between
+ * them doesn't end up in the key.  New options have to be added here.
+ */
+static void
+hash_nir_options(const struct nir_shader_compiler_options *options,
+                 unsigned char *sha1)
+{
+   struct mesa_sha1 ctx;
+   _mesa_sha1_init(&ctx);
+
+#define HASH(field) \
+   _mesa_sha1_update(&ctx, &options->field, sizeof(options->field))
+
+   HASH(lower_fdiv);
+   HASH(lower_ffma);
+   HASH(fuse_ffma);
+   HASH(lower_flrp16);
+   HASH(lower_flrp32);
+   HASH(lower_flrp64);
+   HASH(lower_fpow);
+   HASH(lower_fsat);
+   HASH(lower_fsqrt);
+   HASH(lower_sincos);
+   HASH(lower_fmod);
+   HASH(lower_bitfield_extract);
+   HASH(lower_bitfield_extract_to_shifts);
+   HASH(lower_bitfield_insert);
+   HASH(lower_bitfield_insert_to_shifts);
+   HASH(lower_bitfield_insert_to_bitfield_select);
+   HASH(lower_bitfield_reverse);
+   HASH(lower_bit_count);
+   HASH(lower_ifind_msb);
+   HASH(lower_find_lsb);
+   HASH(lower_uadd_carry);
+   HASH(lower_usub_borrow);
+   HASH(lower_mul_high);
+   HASH(lower_negate);
+   HASH(lower_sub);
+   HASH(lower_scmp);
+   HASH(lower_vector_cmp);
+   HASH(lower_idiv);
+   HASH(lower_bitops);
+   HASH(lower_isign);
+   HASH(lower_fsign);
+   HASH(lower_fdph);
+   HASH(lower_fdot);
+   HASH(fdot_replicates);
+   HASH(lower_ffloor);
+   HASH(lower_ffract);
+   HASH(lower_fceil);
+   HASH(lower_ftrunc);
+   HASH(lower_ldexp);
+   HASH(lower_pack_half_2x16);
+   HASH(lower_pack_unorm_2x16);
+   HASH(lower_pack_snorm_2x16);
+   HASH(lower_pack_unorm_4x8);
+   HASH(lower_pack_snorm_4x8);
+   HASH(lower_unpack_half_2x16);
+   HASH(lower_unpack_unorm_2x16);
+   HASH(lower_unpack_snorm_2x16);
+   HASH(lower_unpack_unorm_4x8);
+   HASH(lower_unpack_snorm_4x8);
+   HASH(lower_extract_byte);
+   HASH(lower_extract_word);
+   HASH(lower_all_io_to_temps);
+   HASH(lower_all_io_to_elements);
+   HASH(vertex_id_zero_based);
+   HASH(lower_base_vertex);
+   HASH(lower_helper_invocation);
+   HASH(optimize_sample_mask_in);
+   HASH(lower_cs_local_index_from_id);
+   HASH(lower_cs_local_id_from_index);
+   HASH(lower_device_index_to_zero);
+   HASH(lower_wpos_pntc);
+   HASH(lower_hadd);
+   HASH(lower_add_sat);
+   HASH(vectorize_io);
+   HASH(lower_to_scalar);
+   HASH(use_interpolated_input_intrinsics);
+   HASH(lower_mul_2x32_64);
+   HASH(lower_rotate);
+   HASH(has_imul24);
+   HASH(intel_vec4);
+   HASH(max_unroll_iterations);
+   HASH(use_instr_arena);
+   HASH(lower_int64_options);
+   HASH(lower_doubles_options);
+
+#undef HASH
+
+   _mesa_sha1_final(&ctx, sha1);
+}
+
 static void
 create_binding_str(const char *key, unsigned value, void *closure)
 {
@@ -102,12 +202,13 @@ shader_cache_write_program_metadata(struct gl_context *ctx,
    struct blob metadata;
    blob_init(&metadata);
 
-   if (ctx->Driver.ShaderCacheSerializeDriverBlob) {
-      for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
-         struct gl_linked_shader *sh = prog->_LinkedShaders[i];
-         if (sh)
-            ctx->Driver.ShaderCacheSerializeDriverBlob(ctx, sh->Program);
-      }
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      struct gl_linked_shader *sh = prog->_LinkedShaders[i];
+      if (!sh)
+         continue;
+
+      if (ctx->Driver.ShaderCacheSerializeDriverBlob)
+         ctx->Driver.ShaderCacheSerializeDriverBlob(ctx, sh->Program);
    }
 
    serialize_glsl_program(&metadata, ctx, prog);
@@ -200,6 +301,22 @@ shader_cache_read_program_metadata(struct gl_context *ctx,
    _mesa_sha1_format(sha1buf, ctx->Const.dri_config_options_sha1);
    ralloc_strcat(&buf, sha1buf);
 
+   /* The NIR stored in the driver blob was optimized and lowered according
+    * to the driver's NIR compiler options, so include them too.
+    */
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      const struct nir_shader_compiler_options *nir_options =
+         ctx->Const.ShaderCompilerOptions[i].NirOptions;
+      if (!nir_options)
+         continue;
+
+      unsigned char nir_options_sha1[20];
+      hash_nir_options(nir_options, nir_options_sha1);
+      _mesa_sha1_format(sha1buf, nir_options_sha1);
+      ralloc_asprintf_append(&buf, "nir %s: %s\n",
+                             _mesa_shader_stage_to_abbrev(i), sha1buf);
+   }
+
    for (unsigned i = 0; i < prog->NumShaders; i++) {
       struct gl_shader *sh = prog->Shaders[i];
       _mesa_sha1_format(sha1buf, sh->sha1);
@@ -262,3 +379,32 @@ shader_cache_read_program_metadata(struct gl_context *ctx,
 
    return true;
 }
+
+/**
+ * Append the final NIR of \p prog to a driver cache blob.
+ */
+void
+shader_cache_write_nir(struct blob *blob, struct gl_program *prog)
+{
+   assert(prog->nir);
+   nir_serialize(blob, prog->nir, false);
+}
+
+/**
+ * Read back NIR written by shader_cache_write_nir() into gl_program::nir.
+ *
+ * Returns false if the blob was truncated or written by another version of
+ * the NIR serializer.
+ */
+bool
+shader_cache_read_nir(struct gl_context *ctx, struct blob_reader *blob,
+                      struct gl_program *prog)
+{
+   const struct nir_shader_compiler_options *options =
+      ctx->Const.ShaderCompilerOptions[prog->info.stage].NirOptions;
+
+   assert(options);
+   prog->nir = nir_deserialize(NULL, options, blob);
+
+   return prog->nir && !blob->overrun;
+}
@@ -24,9 +24,15 @@
 #ifndef SHADER_CACHE_H
 #define SHADER_CACHE_H
 
+#include "util/blob.h"
 #include "util/disk_cache.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 struct gl_context;
+struct gl_program;
 struct gl_shader_program;
 
 void
@@ -37,4 +43,15 @@ bool
 shader_cache_read_program_metadata(struct gl_context *ctx,
                                    struct gl_shader_program *prog);
 
+void
+shader_cache_write_nir(struct blob *blob, struct gl_program *prog);
+
+bool
+shader_cache_read_nir(struct gl_context *ctx, struct blob_reader *blob,
+                      struct gl_program *prog);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* SHADER_CACHE_H */
@@ -21,6 +21,7 @@
  * DEALINGS IN THE SOFTWARE.
  */
 #include <getopt.h>
+#include <inttypes.h>
 
 /** @file standalone.cpp
  *
@@ -41,10 +42,22 @@
 #include "linker.h"
 #include "glsl_parser_extras.h"
 #include "ir_builder_print_visitor.h"
+#include "ir_uniform.h"
 #include "builtin_functions.h"
 #include "opt_add_neg_to_sub.h"
 #include "main/mtypes.h"
 #include "program/program.h"
+#include "glsl_to_nir.h"
+#include "gl_nir.h"
+#include "compiler/nir/nir_pass_pipeline.h"
+#include "util/os_time.h"
+#include "util/u_queue.h"
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#endif
 
 class dead_variable_visitor : public ir_hierarchical_visitor {
 public:
@@ -389,6 +402,56 @@ load_text_file(void *ctx, const char *file_name)
    return text;
 }
 
+static struct gl_shader_program *
+create_shader_program(void *mem_ctx)
+{
+   struct gl_shader_program *whole_program;
+
+   whole_program = rzalloc (mem_ctx, struct gl_shader_program);
+   assert(whole_program != NULL);
+   whole_program->data = rzalloc(whole_program, struct gl_shader_program_data);
+   assert(whole_program->data != NULL);
+   whole_program->data->InfoLog = ralloc_strdup(whole_program->data, "");
+
+   /* Created just to avoid segmentation faults */
+   whole_program->AttributeBindings = new string_to_uint_map;
+   whole_program->FragDataBindings = new string_to_uint_map;
+   whole_program->FragDataIndexBindings = new string_to_uint_map;
+
+   return whole_program;
+}
+
+static void
+destroy_shader_program(struct gl_shader_program *whole_program)
+{
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (whole_program->_LinkedShaders[i])
+         ralloc_free(whole_program->_LinkedShaders[i]->Program);
+   }
+
+   delete whole_program->AttributeBindings;
+   delete whole_program->FragDataBindings;
+   delete whole_program->FragDataIndexBindings;
+
+   ralloc_free(whole_program);
+}
+
+static struct gl_shader *
+add_shader(struct gl_shader_program *whole_program)
+{
+   whole_program->Shaders =
+         reralloc(whole_program, whole_program->Shaders,
+               struct gl_shader *, whole_program->NumShaders + 1);
+   assert(whole_program->Shaders != NULL);
+
+   struct gl_shader *shader = rzalloc(whole_program, gl_shader);
+
+   whole_program->Shaders[whole_program->NumShaders] = shader;
+   whole_program->NumShaders++;
+
+   return shader;
+}
+
 static void
 compile_shader(struct gl_context *ctx, struct gl_shader *shader)
 {
@@ -446,29 +509,10 @@ standalone_compile_shader(const struct standalone_options *_options,
       initialize_context(ctx, options->glsl_version > 130 ? API_OPENGL_CORE : API_OPENGL_COMPAT);
    }
 
-   struct gl_shader_program *whole_program;
-
-   whole_program = rzalloc (NULL, struct gl_shader_program);
-   assert(whole_program != NULL);
-   whole_program->data = rzalloc(whole_program, struct gl_shader_program_data);
-   assert(whole_program->data != NULL);
-   whole_program->data->InfoLog = ralloc_strdup(whole_program->data, "");
-
-   /* Created just to avoid segmentation faults */
-   whole_program->AttributeBindings = new string_to_uint_map;
-   whole_program->FragDataBindings = new string_to_uint_map;
-   whole_program->FragDataIndexBindings = new string_to_uint_map;
+   struct gl_shader_program *whole_program = create_shader_program(NULL);
 
    for (unsigned i = 0; i < num_files; i++) {
-      whole_program->Shaders =
-            reralloc(whole_program, whole_program->Shaders,
-                  struct gl_shader *, whole_program->NumShaders + 1);
-      assert(whole_program->Shaders != NULL);
-
-      struct gl_shader *shader = rzalloc(whole_program, gl_shader);
-
-      whole_program->Shaders[whole_program->NumShaders] = shader;
-      whole_program->NumShaders++;
+      struct gl_shader *shader = add_shader(whole_program);
 
       const unsigned len = strlen(files[i]);
       if (len < 6)
@@ -598,27 +642,792 @@ standalone_compile_shader(const struct standalone_options *_options,
    return whole_program;
 
 fail:
-   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
-      if (whole_program->_LinkedShaders[i])
-         ralloc_free(whole_program->_LinkedShaders[i]->Program);
-   }
-
-   ralloc_free(whole_program);
+   destroy_shader_program(whole_program);
    return NULL;
 }
 
 extern "C" void
 standalone_compiler_cleanup(struct gl_shader_program *whole_program)
 {
+   destroy_shader_program(whole_program);
+   _mesa_glsl_builtin_functions_decref();
+}
+
+/*
+ * Benchmark mode.
+ *
+ * Compiles and links every shader_test found under the given paths the way
+ * a NIR driver would: GLSL IR compile, link and lowering, glsl_to_nir and a
+ * NIR optimization loop.  The time spent in each phase is accumulated over
+ * the whole corpus and printed at the end, together with the throughput
+ * and the peak memory usage of the process.  The number of NIR instructions
+ * left after optimization stands in for the quality of the code, and the
+ * number of active uniforms shows what the GLSL IR optimizations proved
+ * unused.
+ *
+ * --profile-nir breaks the NIR opts phase down per pass with the NIR_PASS
+ * profiler, which is only turned on around the NIR linking and optimization
+ * so that the cleanup glsl_to_nir does isn't mixed in.  It only works on a
+ * single thread.  Counting the instructions around each pass costs about a
+ * third of the phase on small shaders, so the NIR opts time in the phase
+ * table is only meaningful without it; the per-pass times are not affected.
+ *
+ * By default the whole GLSL IR optimization loop runs before glsl_to_nir;
+ * --minimal-ir-opts only runs the passes linking needs, like a driver that
+ * sets GLSLMinimalIROptimization.
+ *
+ * --slab-ralloc roots the gl_shader_program of each shader_test in a
+ * ralloc_slab_context() and prints the allocator statistics.  The shaders,
+ * their GLSL IR and the compiler state hang off the program; the linked
+ * shaders and the NIR shaders are ralloc'ed from NULL by the linker and
+ * glsl_to_nir, so they keep using malloc.
+ */
+
+enum bench_phase {
+   BENCH_PREPROCESS,
+   BENCH_PARSE,
+   BENCH_AST_TO_HIR,
+   BENCH_IR_OPTS,
+   BENCH_LINK,
+   BENCH_GLSL_TO_NIR,
+   BENCH_NIR_OPTS,
+   BENCH_NUM_PHASES,
+};
+
+static const char *const bench_phase_names[BENCH_NUM_PHASES] = {
+   "preprocess",
+   "parse",
+   "ast_to_hir",
+   "IR opts",
+   "link",
+   "glsl_to_nir",
+   "NIR opts",
+};
+
+struct bench_counters {
+   int64_t time[BENCH_NUM_PHASES];
+   unsigned num_shaders;
+   unsigned nir_instrs;
+   unsigned active_uniforms;
+   unsigned compile_failures;
+   unsigned link_failures;
+   struct ralloc_slab_stats slab;
+};
+
+struct bench_thread {
+   struct gl_context ctx;
+   struct bench_counters counters;
+};
+
+struct bench_test {
+   const char *path;
+   struct bench_thread *threads;
+   struct util_queue_fence fence;
+};
+
+static nir_shader_compiler_options bench_nir_options;
+static bool bench_profile_nir;
+
+/* Options of a typical scalar NIR backend, so that the NIR part of the
+ * pipeline does the kind of work a real driver would ask for.
+ */
+static void
+init_bench_nir_options(nir_shader_compiler_options *nir_options)
+{
+   memset(nir_options, 0, sizeof(*nir_options));
+   nir_options->lower_to_scalar = true;
+   nir_options->lower_fpow = true;
+   nir_options->lower_fsat = true;
+   nir_options->lower_sub = true;
+   nir_options->lower_fdiv = true;
+   nir_options->lower_flrp32 = true;
+   nir_options->lower_flrp64 = true;
+   nir_options->lower_fmod = true;
+   nir_options->lower_ldexp = true;
+   nir_options->lower_pack_half_2x16 = true;
+   nir_options->lower_unpack_half_2x16 = true;
+   nir_options->lower_extract_byte = true;
+   nir_options->lower_extract_word = true;
+   nir_options->vertex_id_zero_based = true;
+   nir_options->max_unroll_iterations = 32;
+}
+
+static void
+init_bench_context(struct gl_context *ctx)
+{
+   initialize_context(ctx, API_OPENGL_COMPAT);
+   ctx->Const.NativeIntegers = true;
+   ctx->Const.GLSLMinimalIROptimization = options->minimal_ir_opts;
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++)
+      ctx->Const.ShaderCompilerOptions[i].NirOptions = &bench_nir_options;
+}
+
+/* The NIR part of the benchmark follows what st_link_nir() does for a
+ * driver that can read outputs and doesn't ask for vectorized I/O: the
+ * preprocessing of st_nir_preprocess(), the linking of the stages from the
+ * last to the first with st_nir_link_shaders(), and st_nir_opts().  They
+ * live in src/mesa/state_tracker/st_glsl_to_nir.cpp, which glsl_compiler
+ * doesn't link with, so these are copies.  Keep them in sync, or the
+ * benchmark stops measuring the pipeline drivers actually run.
+ */
+static void
+bench_nir_opts(nir_shader *nir)
+{
+   bool progress;
+   nir_pass_pipeline pipeline;
+
+   nir_pass_pipeline_init(&pipeline);
+
+   do {
+      progress = false;
+
+      NIR_PIPELINE_PASS_V(&pipeline, nir, nir_lower_vars_to_ssa);
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_remove_dead_variables,
+                        (nir_variable_mode)(nir_var_function_temp |
+                                            nir_var_shader_temp |
+                                            nir_var_mem_shared));
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_copy_prop_vars);
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_dead_write_vars);
+
+      if (nir->options->lower_to_scalar) {
+         NIR_PIPELINE_PASS_V(&pipeline, nir, nir_lower_alu_to_scalar,
+                             NULL, NULL);
+         NIR_PIPELINE_PASS_V(&pipeline, nir, nir_lower_phis_to_scalar);
+      }
+
+      NIR_PIPELINE_PASS_V(&pipeline, nir, nir_lower_alu);
+      NIR_PIPELINE_PASS_V(&pipeline, nir, nir_lower_pack);
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_copy_prop);
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_remove_phis);
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_dce);
+
+      bool trivial_continues_progress = false;
+      NIR_PIPELINE_PASS(trivial_continues_progress, &pipeline, nir,
+                        nir_opt_trivial_continues);
+      if (trivial_continues_progress) {
+         progress = true;
+         NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_copy_prop);
+         NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_dce);
+      }
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_if, false);
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_dead_cf);
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_cse);
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_peephole_select,
+                        8, true, true);
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_algebraic);
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_constant_folding);
+
+      if (!nir->info.flrp_lowered) {
+         unsigned lower_flrp =
+            (nir->options->lower_flrp16 ? 16 : 0) |
+            (nir->options->lower_flrp32 ? 32 : 0) |
+            (nir->options->lower_flrp64 ? 64 : 0);
+
+         if (lower_flrp) {
+            bool lower_flrp_progress = false;
+
+            NIR_PIPELINE_PASS(lower_flrp_progress, &pipeline, nir,
+                              nir_lower_flrp,
+                              lower_flrp,
+                              false /* always_precise */,
+                              nir->options->lower_ffma);
+            if (lower_flrp_progress) {
+               NIR_PIPELINE_PASS(progress, &pipeline, nir,
+                                 nir_opt_constant_folding);
+               progress = true;
+            }
+         }
+
+         nir->info.flrp_lowered = true;
+      }
+
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_undef);
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_conditional_discard);
+      if (nir->options->max_unroll_iterations) {
+         NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_loop_unroll,
+                           (nir_variable_mode)0);
+      }
+   } while (progress);
+}
+
+static void
+bench_nir_preprocess(nir_shader *nir, struct gl_shader_program *prog)
+{
+   nir_remove_dead_variables(nir, (nir_variable_mode) (nir_var_shader_in |
+                                                       nir_var_shader_out));
+
+   if (nir->info.stage == MESA_SHADER_VERTEX ||
+       nir->info.stage == MESA_SHADER_GEOMETRY) {
+      NIR_PASS_V(nir, nir_lower_io_to_temporaries,
+                 nir_shader_get_entrypoint(nir), true, true);
+   } else if (nir->info.stage == MESA_SHADER_FRAGMENT) {
+      NIR_PASS_V(nir, nir_lower_io_to_temporaries,
+                 nir_shader_get_entrypoint(nir), true, false);
+   }
+
+   NIR_PASS_V(nir, nir_lower_global_vars_to_local);
+   NIR_PASS_V(nir, nir_split_var_copies);
+   NIR_PASS_V(nir, nir_lower_var_copies);
+
+   if (nir->options->lower_to_scalar)
+      NIR_PASS_V(nir, nir_lower_alu_to_scalar, NULL, NULL);
+
+   NIR_PASS_V(nir, gl_nir_lower_bindless_images);
+   NIR_PASS_V(nir, gl_nir_lower_buffers, prog);
+   NIR_PASS_V(nir, nir_opt_constant_folding);
+
+   if (nir->options->lower_to_scalar)
+      NIR_PASS_V(nir, nir_lower_load_const_to_scalar);
+}
+
+static void
+bench_nir_link_shaders(nir_shader *producer, nir_shader *consumer)
+{
+   if (producer->options->lower_to_scalar) {
+      NIR_PASS_V(producer, nir_lower_io_to_scalar_early, nir_var_shader_out);
+      NIR_PASS_V(consumer, nir_lower_io_to_scalar_early, nir_var_shader_in);
+   }
+
+   nir_lower_io_arrays_to_elements(producer, consumer);
+
+   bench_nir_opts(producer);
+   bench_nir_opts(consumer);
+
+   if (nir_link_opt_varyings(producer, consumer))
+      bench_nir_opts(consumer);
+
+   NIR_PASS_V(producer, nir_remove_dead_variables, nir_var_shader_out);
+   NIR_PASS_V(consumer, nir_remove_dead_variables, nir_var_shader_in);
+
+   if (nir_remove_unused_varyings(producer, consumer)) {
+      NIR_PASS_V(producer, nir_lower_global_vars_to_local);
+      NIR_PASS_V(consumer, nir_lower_global_vars_to_local);
+
+      bench_nir_opts(producer);
+      bench_nir_opts(consumer);
+
+      NIR_PASS_V(producer, nir_remove_dead_variables, nir_var_shader_out);
+      NIR_PASS_V(consumer, nir_remove_dead_variables, nir_var_shader_in);
+   }
+}
+
+static unsigned
+bench_count_instrs(nir_shader *nir)
+{
+   unsigned count = 0;
+
+   nir_foreach_function(function, nir) {
+      if (!function->impl)
+         continue;
+
+      nir_foreach_block(block, function->impl) {
+         nir_foreach_instr(instr, block)
+            count++;
+      }
+   }
+
+   return count;
+}
+
+/* Lowering st_link_shader does on the linked GLSL IR of a NIR driver. */
+static void
+bench_lower_ir(exec_list *ir)
+{
+   lower_packing_builtins(ir, LOWER_PACK_SNORM_2x16 |
+                              LOWER_UNPACK_SNORM_2x16 |
+                              LOWER_PACK_UNORM_2x16 |
+                              LOWER_UNPACK_UNORM_2x16 |
+                              LOWER_PACK_SNORM_4x8 |
+                              LOWER_UNPACK_SNORM_4x8 |
+                              LOWER_UNPACK_UNORM_4x8 |
+                              LOWER_PACK_UNORM_4x8);
+   do_mat_op_to_vec(ir);
+   lower_instructions(ir, FDIV_TO_MUL_RCP |
+                          EXP_TO_EXP2 |
+                          LOG_TO_LOG2 |
+                          MUL64_TO_MUL_AND_MUL_HIGH |
+                          LDEXP_TO_ARITH |
+                          DFREXP_DLDEXP_TO_ARITH |
+                          CARRY_TO_ARITH |
+                          BORROW_TO_ARITH |
+                          DOPS_TO_DFRAC);
+   do_vec_index_to_cond_assign(ir);
+   lower_vector_insert(ir, true);
+   lower_quadop_vector(ir, false);
+   lower_noise(ir);
+}
+
+static const char bench_passthrough_vs[] =
+   "#version 130\n"
+   "in vec4 piglit_vertex;\n"
+   "void main() { gl_Position = piglit_vertex; }\n";
+
+static const struct {
+   const char *name;
+   GLenum type;
+} bench_sections[] = {
+   { "[vertex shader]",                 GL_VERTEX_SHADER },
+   { "[tessellation control shader]",   GL_TESS_CONTROL_SHADER },
+   { "[tessellation evaluation shader]", GL_TESS_EVALUATION_SHADER },
+   { "[geometry shader]",               GL_GEOMETRY_SHADER },
+   { "[fragment shader]",               GL_FRAGMENT_SHADER },
+   { "[compute shader]",                GL_COMPUTE_SHADER },
+};
+
+static struct gl_shader *
+bench_add_shader(struct gl_shader_program *prog, GLenum type,
+                 const char *source, size_t len)
+{
+   struct gl_shader *shader = add_shader(prog);
+   shader->Type = type;
+   shader->Stage = _mesa_shader_enum_to_shader_stage(type);
+   shader->Source = ralloc_strndup(prog, source, len);
+   return shader;
+}
+
+/* Splits a shader_test into its shaders.  Returns false if it has none. */
+static bool
+bench_parse_shader_test(struct gl_shader_program *prog, const char *text)
+{
+   const char *source = NULL;
+   GLenum type = 0;
+
+   for (const char *line = text; *line; ) {
+      const char *next = strchr(line, '\n');
+      next = next ? next + 1 : line + strlen(line);
+
+      if (line[0] == '[') {
+         if (source)
+            bench_add_shader(prog, type, source, line - source);
+         source = NULL;
+
+         if (strncmp(line, "[vertex shader passthrough]", 27) == 0) {
+            bench_add_shader(prog, GL_VERTEX_SHADER, bench_passthrough_vs,
+                             sizeof(bench_passthrough_vs) - 1);
+         } else {
+            for (unsigned i = 0; i < ARRAY_SIZE(bench_sections); i++) {
+               const char *name = bench_sections[i].name;
+               if (strncmp(line, name, strlen(name)) == 0) {
+                  type = bench_sections[i].type;
+                  source = next;
+                  break;
+               }
+            }
+         }
+      }
+
+      line = next;
+   }
+
+   if (source)
+      bench_add_shader(prog, type, source, strlen(source));
+
+   return prog->NumShaders > 0;
+}
+
+static void
+bench_add_time(int64_t *total, int64_t *start)
+{
+   int64_t now = os_time_get_nano();
+   *total += now - *start;
+   *start = now;
+}
+
+static void
+bench_run_program(struct bench_test *test, struct gl_context *ctx,
+                  struct bench_counters *counters,
+                  struct gl_shader_program *prog)
+{
+   char *text = load_text_file(prog, test->path);
+   if (!text || !bench_parse_shader_test(prog, text))
+      return;
+
+   for (unsigned i = 0; i < prog->NumShaders; i++) {
+      struct gl_shader *shader = prog->Shaders[i];
+      struct _mesa_glsl_compile_timings timings = { };
+
+      _mesa_glsl_compile_shader_timed(ctx, shader, false, false, true,
+                                      &timings);
+
+      counters->time[BENCH_PREPROCESS] += timings.preprocess;
+      counters->time[BENCH_PARSE] += timings.parse;
+      counters->time[BENCH_AST_TO_HIR] += timings.ast_to_hir;
+      counters->time[BENCH_IR_OPTS] += timings.opt;
+      counters->num_shaders++;
+
+      if (!shader->CompileStatus) {
+         fprintf(stderr, "%s: %s shader failed to compile:\n%s",
+                 test->path, _mesa_shader_stage_to_string(shader->Stage),
+                 shader->InfoLog);
+         counters->compile_failures++;
+         return;
+      }
+   }
+
+   int64_t start = os_time_get_nano();
+
+   _mesa_clear_shader_program_data(ctx, prog);
+   link_shaders(ctx, prog);
+
    for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
-      if (whole_program->_LinkedShaders[i])
-         ralloc_free(whole_program->_LinkedShaders[i]->Program);
+      if (prog->_LinkedShaders[i])
+         bench_lower_ir(prog->_LinkedShaders[i]->ir);
    }
 
-   delete whole_program->AttributeBindings;
-   delete whole_program->FragDataBindings;
-   delete whole_program->FragDataIndexBindings;
+   bench_add_time(&counters->time[BENCH_LINK], &start);
 
-   ralloc_free(whole_program);
-   _mesa_glsl_builtin_functions_decref();
+   if (!prog->data->LinkStatus) {
+      fprintf(stderr, "%s: failed to link:\n%s",
+              test->path, prog->data->InfoLog);
+      counters->link_failures++;
+      return;
+   }
+
+   for (unsigned i = 0; i < prog->data->NumUniformStorage; i++) {
+      if (!prog->data->UniformStorage[i].hidden)
+         counters->active_uniforms++;
+   }
+
+   nir_shader *nir[MESA_SHADER_STAGES] = { NULL };
+   unsigned num_stages = 0;
+   int last = -1;
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (!prog->_LinkedShaders[i])
+         continue;
+
+      nir[i] = glsl_to_nir(ctx, prog, (gl_shader_stage) i,
+                           &bench_nir_options);
+      bench_nir_preprocess(nir[i], prog);
+      num_stages++;
+      last = i;
+   }
+
+   bench_add_time(&counters->time[BENCH_GLSL_TO_NIR], &start);
+
+   if (bench_profile_nir)
+      nir_profile_enable(true);
+
+   int next = last;
+   for (int i = last - 1; i >= 0; i--) {
+      if (!nir[i])
+         continue;
+
+      bench_nir_link_shaders(nir[i], nir[next]);
+      next = i;
+   }
+
+   if (num_stages == 1)
+      bench_nir_opts(nir[last]);
+
+   if (bench_profile_nir)
+      nir_profile_enable(false);
+
+   bench_add_time(&counters->time[BENCH_NIR_OPTS], &start);
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (nir[i]) {
+         counters->nir_instrs += bench_count_instrs(nir[i]);
+         ralloc_free(nir[i]);
+      }
+   }
+}
+
+static void
+bench_run_test(void *data, int thread_index)
+{
+   struct bench_test *test = (struct bench_test *) data;
+   struct gl_context *ctx = &test->threads[thread_index].ctx;
+   struct bench_counters *counters = &test->threads[thread_index].counters;
+   void *mem_ctx = options->slab_ralloc ? ralloc_slab_context(NULL) : NULL;
+
+   struct gl_shader_program *prog = create_shader_program(mem_ctx);
+   bench_run_program(test, ctx, counters, prog);
+   destroy_shader_program(prog);
+
+   if (mem_ctx) {
+      struct ralloc_slab_stats stats;
+      ralloc_slab_get_stats(mem_ctx, &stats);
+      counters->slab.slab_allocs += stats.slab_allocs;
+      counters->slab.freelist_reuses += stats.freelist_reuses;
+      counters->slab.malloc_allocs += stats.malloc_allocs;
+      counters->slab.peak_slab_bytes =
+         MAX2(counters->slab.peak_slab_bytes, stats.peak_slab_bytes);
+      counters->slab.page_bytes += stats.page_bytes;
+      ralloc_free(mem_ctx);
+   }
+}
+
+static int
+bench_compare_self_time(const void *_a, const void *_b)
+{
+   const nir_pass_profile *a = (const nir_pass_profile *) _a;
+   const nir_pass_profile *b = (const nir_pass_profile *) _b;
+
+   if (a->self_time_ns != b->self_time_ns)
+      return a->self_time_ns < b->self_time_ns ? 1 : -1;
+   return strcmp(a->pass, b->pass);
+}
+
+/* Prints what the NIR_PASS profiler recorded, summed over the stages. */
+static void
+bench_print_nir_passes(void)
+{
+   unsigned count = nir_profile_get_passes(NULL, 0);
+   nir_pass_profile *passes =
+      (nir_pass_profile *) calloc(MAX2(count, 1), sizeof(*passes));
+   if (!passes)
+      return;
+
+   count = nir_profile_get_passes(passes, count);
+
+   unsigned num_passes = 0;
+   uint64_t total_ns = 0;
+   for (unsigned i = 0; i < count; i++) {
+      const nir_pass_profile *p = &passes[i];
+      unsigned j;
+
+      total_ns += p->self_time_ns;
+
+      for (j = 0; j < num_passes; j++) {
+         if (strcmp(passes[j].pass, p->pass) == 0)
+            break;
+      }
+
+      if (j == num_passes) {
+         passes[num_passes++] = *p;
+      } else {
+         passes[j].calls += p->calls;
+         passes[j].progress += p->progress;
+         passes[j].time_ns += p->time_ns;
+         passes[j].self_time_ns += p->self_time_ns;
+         passes[j].instrs_before += p->instrs_before;
+         passes[j].instrs_after += p->instrs_after;
+      }
+   }
+
+   qsort(passes, num_passes, sizeof(*passes), bench_compare_self_time);
+
+   printf("%-32s %8s %8s %10s %7s %10s\n", "NIR pass", "calls", "progress",
+          "ms", "%", "instrs");
+   for (unsigned i = 0; i < num_passes; i++) {
+      const nir_pass_profile *p = &passes[i];
+      printf("%-32s %8" PRIu64 " %8" PRIu64 " %10.2f %6.1f%% %+10" PRId64 "\n",
+             p->pass, p->calls, p->progress, p->self_time_ns / 1000000.0,
+             total_ns ? p->self_time_ns * 100.0 / total_ns : 0.0,
+             (int64_t) (p->instrs_after - p->instrs_before));
+   }
+   printf("%-32s %8s %8s %10.2f\n\n", "total", "", "",
+          total_ns / 1000000.0);
+
+   free(passes);
+}
+
+static int
+bench_compare_paths(const void *a, const void *b)
+{
+   return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+static void
+bench_add_path(void *mem_ctx, char ***paths, unsigned *num_paths,
+               const char *path)
+{
+   *paths = reralloc(mem_ctx, *paths, char *, *num_paths + 1);
+   (*paths)[(*num_paths)++] = ralloc_strdup(mem_ctx, path);
+}
+
+/* Collects the shader_test files under path. */
+static void
+bench_find_tests(void *mem_ctx, char ***paths, unsigned *num_paths,
+                 const char *path)
+{
+#ifndef _WIN32
+   struct stat st;
+   if (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+      DIR *dir = opendir(path);
+      if (!dir)
+         return;
+
+      struct dirent *entry;
+      while ((entry = readdir(dir)) != NULL) {
+         if (entry->d_name[0] == '.')
+            continue;
+
+         char *child = ralloc_asprintf(mem_ctx, "%s/%s", path, entry->d_name);
+         size_t len = strlen(child);
+
+         if (stat(child, &st) != 0)
+            continue;
+
+         if (S_ISDIR(st.st_mode))
+            bench_find_tests(mem_ctx, paths, num_paths, child);
+         else if (len > 12 && strcmp(child + len - 12, ".shader_test") == 0)
+            bench_add_path(mem_ctx, paths, num_paths, child);
+      }
+
+      closedir(dir);
+      return;
+   }
+#endif
+
+   bench_add_path(mem_ctx, paths, num_paths, path);
+}
+
+extern "C" int
+standalone_bench(const struct standalone_options *_options,
+                 unsigned num_paths, char* const* paths)
+{
+   static struct standalone_options bench_options;
+
+   bench_options = *_options;
+   if (!bench_options.glsl_version)
+      bench_options.glsl_version = 460;
+   options = &bench_options;
+
+   unsigned num_threads = MAX2(_options->jobs, 1);
+
+   void *mem_ctx = ralloc_context(NULL);
+   char **tests = NULL;
+   unsigned num_tests = 0;
+   for (unsigned i = 0; i < num_paths; i++)
+      bench_find_tests(mem_ctx, &tests, &num_tests, paths[i]);
+
+   if (num_tests == 0) {
+      fprintf(stderr, "No shader_test files found.\n");
+      ralloc_free(mem_ctx);
+      return EXIT_FAILURE;
+   }
+
+   qsort(tests, num_tests, sizeof(*tests), bench_compare_paths);
+
+   init_bench_nir_options(&bench_nir_options);
+
+   /* With several threads the profiler would also see the passes run by
+    * glsl_to_nir on the other threads.  If NIR_PROFILE is set, it already
+    * covers everything.
+    */
+   if (options->profile_nir && num_threads > 1)
+      fprintf(stderr, "--profile-nir is ignored with --jobs.\n");
+   bench_profile_nir = options->profile_nir && num_threads == 1 &&
+                       !nir_profile_enabled();
+   if (bench_profile_nir)
+      nir_profile_reset();
+
+   struct bench_thread *threads =
+      (struct bench_thread *) calloc(num_threads, sizeof(*threads));
+   for (unsigned i = 0; i < num_threads; i++)
+      init_bench_context(&threads[i].ctx);
+
+   struct bench_test *jobs = rzalloc_array(mem_ctx, struct bench_test,
+                                           num_tests);
+   for (unsigned i = 0; i < num_tests; i++) {
+      jobs[i].path = tests[i];
+      jobs[i].threads = threads;
+   }
+
+   int64_t start = os_time_get_nano();
+
+   if (num_threads == 1) {
+      for (unsigned i = 0; i < num_tests; i++)
+         bench_run_test(&jobs[i], 0);
+   } else {
+      struct util_queue queue;
+      if (!util_queue_init(&queue, "glsl_bench", num_tests, num_threads,
+                           UTIL_QUEUE_INIT_RESIZE_IF_FULL)) {
+         fprintf(stderr, "Failed to create the compile threads.\n");
+         exit(EXIT_FAILURE);
+      }
+
+      for (unsigned i = 0; i < num_tests; i++) {
+         util_queue_fence_init(&jobs[i].fence);
+         util_queue_add_job(&queue, &jobs[i], &jobs[i].fence,
+                            bench_run_test, NULL, 0);
+      }
+
+      for (unsigned i = 0; i < num_tests; i++) {
+         util_queue_fence_wait(&jobs[i].fence);
+         util_queue_fence_destroy(&jobs[i].fence);
+      }
+
+      util_queue_destroy(&queue);
+   }
+
+   int64_t wall = os_time_get_nano() - start;
+
+   struct bench_counters total = { };
+   for (unsigned i = 0; i < num_threads; i++) {
+      const struct bench_counters *counters = &threads[i].counters;
+      for (unsigned p = 0; p < BENCH_NUM_PHASES; p++)
+         total.time[p] += counters->time[p];
+      total.num_shaders += counters->num_shaders;
+      total.nir_instrs += counters->nir_instrs;
+      total.active_uniforms += counters->active_uniforms;
+      total.compile_failures += counters->compile_failures;
+      total.link_failures += counters->link_failures;
+      total.slab.slab_allocs += counters->slab.slab_allocs;
+      total.slab.freelist_reuses += counters->slab.freelist_reuses;
+      total.slab.malloc_allocs += counters->slab.malloc_allocs;
+      total.slab.peak_slab_bytes =
+         MAX2(total.slab.peak_slab_bytes, counters->slab.peak_slab_bytes);
+      total.slab.page_bytes += counters->slab.page_bytes;
+   }
+
+   int64_t cpu = 0;
+   for (unsigned p = 0; p < BENCH_NUM_PHASES; p++)
+      cpu += total.time[p];
+
+   printf("%u shader tests, %u shaders, %u failed to compile, "
+          "%u failed to link\n\n",
+          num_tests, total.num_shaders, total.compile_failures,
+          total.link_failures);
+
+   printf("%-12s %12s %7s\n", "phase", "ms", "%");
+   for (unsigned p = 0; p < BENCH_NUM_PHASES; p++) {
+      printf("%-12s %12.2f %6.1f%%\n", bench_phase_names[p],
+             total.time[p] / 1000000.0,
+             cpu ? total.time[p] * 100.0 / cpu : 0.0);
+   }
+   printf("%-12s %12.2f\n\n", "total", cpu / 1000000.0);
+
+   if (bench_profile_nir)
+      bench_print_nir_passes();
+
+   printf("IR opts:     %s\n", options->minimal_ir_opts ? "minimal" : "full");
+   printf("NIR instrs:  %u\n", total.nir_instrs);
+   printf("uniforms:    %u active\n\n", total.active_uniforms);
+
+   if (options->slab_ralloc) {
+      size_t allocs = total.slab.slab_allocs + total.slab.malloc_allocs;
+      printf("slab ralloc: %zu allocations, %.1f%% from the slabs, "
+             "%.1f%% reused from free lists\n", allocs,
+             allocs ? total.slab.slab_allocs * 100.0 / allocs : 0.0,
+             total.slab.slab_allocs ?
+             total.slab.freelist_reuses * 100.0 / total.slab.slab_allocs :
+             0.0);
+      printf("             %.1f kB of pages per shader test, "
+             "%.1f kB peak in use\n\n",
+             total.slab.page_bytes / 1024.0 / num_tests,
+             total.slab.peak_slab_bytes / 1024.0);
+   }
+
+   printf("wall time:   %.2f ms on %u thread%s\n", wall / 1000000.0,
+          num_threads, num_threads == 1 ? "" : "s");
+   printf("throughput:  %.1f shader tests/s\n",
+          wall ? num_tests * 1000000000.0 / wall : 0.0);
+
+#ifndef _WIN32
+   struct rusage usage;
+   if (getrusage(RUSAGE_SELF, &usage) == 0)
+      printf("peak memory: %ld kB\n", usage.ru_maxrss);
+#endif
+
+   for (unsigned i = 0; i < num_threads; i++)
+      _mesa_glsl_builtin_functions_decref();
+   free(threads);
+   ralloc_free(mem_ctx);
+
+   return total.compile_failures || total.link_failures ? EXIT_FAILURE :
+                                                          EXIT_SUCCESS;
 }
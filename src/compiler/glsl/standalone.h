@@ -36,6 +36,11 @@ struct standalone_options {
    int dump_builder;
    int do_link;
    int just_log;
+   int bench;
+   int jobs;
+   int minimal_ir_opts;
+   int profile_nir;
+   int slab_ralloc;
 };
 
 struct gl_shader_program;
@@ -47,6 +52,9 @@ struct gl_shader_program * standalone_compile_shader(
 
 void standalone_compiler_cleanup(struct gl_shader_program *prog);
 
+int standalone_bench(const struct standalone_options *options,
+                     unsigned num_paths, char* const* paths);
+
 #ifdef __cplusplus
 }
 #endif
@@ -67,9 +67,46 @@ nir_shader_create(void *mem_ctx,
    shader->num_uniforms = 0;
    shader->num_shared = 0;
 
+   if (options && options->use_instr_arena)
+      nir_shader_use_instr_arena(shader);
+
    return shader;
 }
 
+/**
+ * Makes the instructions of \p shader come from an arena.
+ *
+ * Instructions, along with their sources, SSA defs and anything else that
+ * hangs off of them, are then carved out of a slab-backed ralloc context
+ * instead of being malloc'ed one by one.  Instructions created one after the
+ * other end up next to each other in memory, and nir_shader_clone() builds
+ * its copy in block order, so walking the shader touches fewer cache lines.
+ * Freeing the shader releases the whole arena at once, and nir_sweep() puts
+ * dead instructions back in the arena for reuse.
+ *
+ * Instructions created before the call keep their memory.  Like any slab
+ * context, the arena isn't thread-safe, so the shader must not be modified
+ * from several threads at once, which NIR doesn't allow anyway.
+ */
+void
+nir_shader_use_instr_arena(nir_shader *shader)
+{
+   if (shader->instr_arena)
+      return;
+
+   /* The instructions are children of a plain context inside the arena
+    * rather than of the arena itself, so that nir_sweep() can free the dead
+    * ones without giving up the arena's pages.
+    */
+   shader->instr_arena = ralloc_context(ralloc_slab_context(shader));
+}
+
+static inline void *
+instr_mem_ctx(nir_shader *shader)
+{
+   return shader->instr_arena ? shader->instr_arena : shader;
+}
+
 static nir_register *
 reg_create(void *mem_ctx, struct exec_list *list)
 {
@@ -428,7 +465,7 @@ nir_alu_instr_create(nir_shader *shader, nir_op op)
    unsigned num_srcs = nir_op_infos[op].num_inputs;
    /* TODO: don't use rzalloc */
    nir_alu_instr *instr =
-      rzalloc_size(shader,
+      rzalloc_size(instr_mem_ctx(shader),
                    sizeof(nir_alu_instr) + num_srcs * sizeof(nir_alu_src));
 
    instr_init(&instr->instr, nir_instr_type_alu);
@@ -444,7 +481,7 @@ nir_deref_instr *
 nir_deref_instr_create(nir_shader *shader, nir_deref_type deref_type)
 {
    nir_deref_instr *instr =
-      rzalloc_size(shader, sizeof(nir_deref_instr));
+      rzalloc_size(instr_mem_ctx(shader), sizeof(nir_deref_instr));
 
    instr_init(&instr->instr, nir_instr_type_deref);
 
@@ -464,7 +501,7 @@ nir_deref_instr_create(nir_shader *shader, nir_deref_type deref_type)
 nir_jump_instr *
 nir_jump_instr_create(nir_shader *shader, nir_jump_type type)
 {
-   nir_jump_instr *instr = ralloc(shader, nir_jump_instr);
+   nir_jump_instr *instr = ralloc(instr_mem_ctx(shader), nir_jump_instr);
    instr_init(&instr->instr, nir_instr_type_jump);
    instr->type = type;
    return instr;
@@ -475,7 +512,8 @@ nir_load_const_instr_create(nir_shader *shader, unsigned num_components,
                             unsigned bit_size)
 {
    nir_load_const_instr *instr =
-      rzalloc_size(shader, sizeof(*instr) + num_components * sizeof(*instr->value));
+      rzalloc_size(instr_mem_ctx(shader),
+                   sizeof(*instr) + num_components * sizeof(*instr->value));
    instr_init(&instr->instr, nir_instr_type_load_const);
 
    nir_ssa_def_init(&instr->instr, &instr->def, num_components, bit_size, NULL);
@@ -489,7 +527,7 @@ nir_intrinsic_instr_create(nir_shader *shader, nir_intrinsic_op op)
    unsigned num_srcs = nir_intrinsic_infos[op].num_srcs;
    /* TODO: don't use rzalloc */
    nir_intrinsic_instr *instr =
-      rzalloc_size(shader,
+      rzalloc_size(instr_mem_ctx(shader),
                   sizeof(nir_intrinsic_instr) + num_srcs * sizeof(nir_src));
 
    instr_init(&instr->instr, nir_instr_type_intrinsic);
@@ -509,7 +547,7 @@ nir_call_instr_create(nir_shader *shader, nir_function *callee)
 {
    const unsigned num_params = callee->num_params;
    nir_call_instr *instr =
-      rzalloc_size(shader, sizeof(*instr) +
+      rzalloc_size(instr_mem_ctx(shader), sizeof(*instr) +
                    num_params * sizeof(instr->params[0]));
 
    instr_init(&instr->instr, nir_instr_type_call);
@@ -532,7 +570,7 @@ static int8_t default_tg4_offsets[4][2] =
 nir_tex_instr *
 nir_tex_instr_create(nir_shader *shader, unsigned num_srcs)
 {
-   nir_tex_instr *instr = rzalloc(shader, nir_tex_instr);
+   nir_tex_instr *instr = rzalloc(instr_mem_ctx(shader), nir_tex_instr);
    instr_init(&instr->instr, nir_instr_type_tex);
 
    dest_init(&instr->dest);
@@ -600,7 +638,7 @@ nir_tex_instr_has_explicit_tg4_offsets(nir_tex_instr *tex)
 nir_phi_instr *
 nir_phi_instr_create(nir_shader *shader)
 {
-   nir_phi_instr *instr = ralloc(shader, nir_phi_instr);
+   nir_phi_instr *instr = ralloc(instr_mem_ctx(shader), nir_phi_instr);
    instr_init(&instr->instr, nir_instr_type_phi);
 
    dest_init(&instr->dest);
@@ -611,7 +649,8 @@ nir_phi_instr_create(nir_shader *shader)
 nir_parallel_copy_instr *
 nir_parallel_copy_instr_create(nir_shader *shader)
 {
-   nir_parallel_copy_instr *instr = ralloc(shader, nir_parallel_copy_instr);
+   nir_parallel_copy_instr *instr =
+      ralloc(instr_mem_ctx(shader), nir_parallel_copy_instr);
    instr_init(&instr->instr, nir_instr_type_parallel_copy);
 
    exec_list_make_empty(&instr->entries);
@@ -624,7 +663,7 @@ nir_ssa_undef_instr_create(nir_shader *shader,
                            unsigned num_components,
                            unsigned bit_size)
 {
-   nir_ssa_undef_instr *instr = ralloc(shader, nir_ssa_undef_instr);
+   nir_ssa_undef_instr *instr = ralloc(instr_mem_ctx(shader), nir_ssa_undef_instr);
    instr_init(&instr->instr, nir_instr_type_ssa_undef);
 
    nir_ssa_def_init(&instr->instr, &instr->def, num_components, bit_size, NULL);
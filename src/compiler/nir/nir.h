@@ -2638,6 +2638,9 @@ typedef enum {
    nir_divergence_view_index_uniform = (1 << 3),
 } nir_divergence_options;
 
+/* New fields must also be added to hash_nir_options() in the GLSL shader
+ * cache, which hashes these field by field.
+ */
 typedef struct nir_shader_compiler_options {
    bool lower_fdiv;
    bool lower_ffma;
@@ -2821,6 +2824,11 @@ typedef struct nir_shader_compiler_options {
 
    unsigned max_unroll_iterations;
 
+   /** Whether shaders created with these options allocate their
+    * instructions from an arena, see nir_shader_use_instr_arena().
+    */
+   bool use_instr_arena;
+
    nir_lower_int64_options lower_int64_options;
    nir_lower_doubles_options lower_doubles_options;
 } nir_shader_compiler_options;
@@ -2872,6 +2880,12 @@ typedef struct nir_shader {
     */
    void *constant_data;
    unsigned constant_data_size;
+
+   /** Context instructions are allocated from, if not the shader itself.
+    *
+    * See nir_shader_use_instr_arena().
+    */
+   void *instr_arena;
 } nir_shader;
 
 #define nir_foreach_function(func, shader) \
@@ -2905,6 +2919,8 @@ nir_shader *nir_shader_create(void *mem_ctx,
                               const nir_shader_compiler_options *options,
                               shader_info *si);
 
+void nir_shader_use_instr_arena(nir_shader *shader);
+
 nir_register *nir_local_reg_create(nir_function_impl *impl);
 
 void nir_reg_remove(nir_register *reg);
@@ -3417,6 +3433,92 @@ static inline bool should_serialize_deserialize_nir(void) { return false; }
 static inline bool should_print_nir(void) { return false; }
 #endif /* NDEBUG */
 
+/** Per-pass compile-time profiling
+ *
+ * When enabled, every NIR_PASS and NIR_PASS_V records how long the pass ran
+ * and the number of instructions in the shader before and after it.  The
+ * numbers are aggregated per process, per pass name and per shader stage.
+ *
+ * Profiling is enabled by setting NIR_PROFILE=true, in which case the
+ * results are written as JSON to stderr at exit, or to the file named by
+ * NIR_PROFILE_FILE if it is set.  Tools and drivers can also turn it on with
+ * nir_profile_enable() and query the results directly.
+ *
+ * time_ns is inclusive: a pass that itself uses NIR_PASS is also charged for
+ * the passes it runs.  self_time_ns leaves those out, so summing it over all
+ * passes gives the total time spent in NIR passes.  NIR_PASS_V does not
+ * know whether the pass made progress, so it never counts towards
+ * nir_pass_profile::progress.
+ */
+typedef struct nir_pass_profile {
+   const char *pass;
+   gl_shader_stage stage;
+
+   /** Number of times the pass was run */
+   uint64_t calls;
+
+   /** Number of those runs that reported progress */
+   uint64_t progress;
+
+   uint64_t time_ns;
+
+   /** time_ns minus the time spent in nested NIR_PASS invocations */
+   uint64_t self_time_ns;
+
+   /** Instruction counts summed over all of the runs */
+   uint64_t instrs_before;
+   uint64_t instrs_after;
+} nir_pass_profile;
+
+typedef struct nir_profile_scope {
+   bool active;
+   unsigned instrs;
+   int64_t start_ns;
+
+   /** Time spent in the passes run from this one */
+   int64_t child_ns;
+   struct nir_profile_scope *parent;
+} nir_profile_scope;
+
+/* -1 until the environment has been checked, then 0 or 1. */
+extern int nir_profile_state;
+
+bool nir_profile_init(void);
+void nir_profile_enable(bool enable);
+void nir_profile_begin_pass_slow(nir_profile_scope *scope,
+                                 const nir_shader *shader);
+void nir_profile_end_pass_slow(const nir_profile_scope *scope,
+                               const char *pass, const nir_shader *shader,
+                               bool progress);
+unsigned nir_profile_get_passes(nir_pass_profile *passes, unsigned max);
+void nir_profile_reset(void);
+void nir_profile_print_json(FILE *fp);
+
+static inline bool
+nir_profile_enabled(void)
+{
+   if (likely(nir_profile_state == 0))
+      return false;
+
+   return nir_profile_state > 0 || nir_profile_init();
+}
+
+static inline void
+nir_profile_begin_pass(nir_profile_scope *scope, const nir_shader *shader)
+{
+   scope->active = nir_profile_enabled();
+   if (unlikely(scope->active))
+      nir_profile_begin_pass_slow(scope, shader);
+}
+
+static inline void
+nir_profile_end_pass(const nir_profile_scope *scope, const char *pass,
+                     const nir_shader *shader, bool progress)
+{
+   if (unlikely(scope->active))
+      nir_profile_end_pass_slow(scope, pass, shader, progress);
+}
+
 #define _PASS(pass, nir, do_pass) do {                               \
    if (should_skip_nir(#pass)) {                                     \
       printf("skipping %s\n", #pass);                                \
@@ -3437,7 +3539,11 @@ static inline bool should_print_nir(void) { return false; }
    nir_metadata_set_validation_flag(nir);                            \
    if (should_print_nir())                                           \
       printf("%s\n", #pass);                                         \
-   if (pass(nir, ##__VA_ARGS__)) {                                   \
+   nir_profile_scope _profile;                                       \
+   nir_profile_begin_pass(&_profile, nir);                           \
+   bool _progress = pass(nir, ##__VA_ARGS__);                        \
+   nir_profile_end_pass(&_profile, #pass, nir, _progress);           \
+   if (_progress) {                                                  \
       progress = true;                                               \
       if (should_print_nir())                                        \
          nir_print_shader(nir, stdout);                              \
@@ -3448,7 +3554,10 @@ static inline bool should_print_nir(void) { return false; }
 #define NIR_PASS_V(nir, pass, ...) _PASS(pass, nir,                  \
    if (should_print_nir())                                           \
       printf("%s\n", #pass);                                         \
+   nir_profile_scope _profile;                                       \
+   nir_profile_begin_pass(&_profile, nir);                           \
    pass(nir, ##__VA_ARGS__);                                         \
+   nir_profile_end_pass(&_profile, #pass, nir, false);               \
    if (should_print_nir())                                           \
       nir_print_shader(nir, stdout);                                 \
 )
@@ -4148,6 +4257,24 @@ bool nir_opt_large_constants(nir_shader *shader,
                              glsl_type_size_align_func size_align,
                              unsigned threshold);
 
+typedef struct nir_opt_licm_options {
+   /**
+    * Maximum number of components hoisted values may keep live across a
+    * loop, or 0 for no limit.
+    */
+   unsigned max_live_components;
+
+   /**
+    * Whether uniform values are left out of max_live_components, for
+    * hardware which keeps them in separate scalar registers.  Requires the
+    * shader to be in LCSSA form.
+    */
+   bool uniform_values_are_free;
+   nir_divergence_options divergence_options;
+} nir_opt_licm_options;
+
+bool nir_opt_licm(nir_shader *shader, const nir_opt_licm_options *options);
+
 bool nir_opt_loop_unroll(nir_shader *shader, nir_variable_mode indirect_mask);
 
 typedef enum {
@@ -4179,6 +4306,15 @@ bool nir_opt_undef(nir_shader *shader);
 
 bool nir_opt_vectorize(nir_shader *shader);
 
+typedef bool (*nir_should_vectorize_mem_func)(unsigned align, unsigned bit_size,
+                                              unsigned num_components,
+                                              unsigned high_offset,
+                                              nir_intrinsic_instr *low,
+                                              nir_intrinsic_instr *high);
+
+bool nir_opt_load_store_vectorize(nir_shader *shader, nir_variable_mode modes,
+                                  nir_should_vectorize_mem_func callback);
+
 bool nir_opt_conditional_discard(nir_shader *shader);
 
 void nir_strip(nir_shader *shader);
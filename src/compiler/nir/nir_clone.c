@@ -728,6 +728,12 @@ nir_shader_clone(void *mem_ctx, const nir_shader *s)
    nir_shader *ns = nir_shader_create(mem_ctx, s->info.stage, s->options, NULL);
    state.ns = ns;
 
+   /* The clone is built in block order, so its instructions are laid out in
+    * that order in its arena.
+    */
+   if (s->instr_arena)
+      nir_shader_use_instr_arena(ns);
+
    clone_var_list(&state, &ns->uniforms, &s->uniforms);
    clone_var_list(&state, &ns->inputs,   &s->inputs);
    clone_var_list(&state, &ns->outputs,  &s->outputs);
@@ -0,0 +1,415 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir.h"
+
+#include "util/u_dynarray.h"
+
+/* Loop-invariant code motion.
+ *
+ * An instruction in a loop is invariant if all of its sources are defined
+ * outside of the loop or by other invariant instructions.  Invariant ALU
+ * instructions, constants, undefs and reorderable intrinsics such as UBO,
+ * uniform and push constant loads are moved to the block right before the
+ * loop.  Loops are processed innermost first, so values can move out of
+ * several levels of loops.  Instructions inside nested loops are left to
+ * the nested loop.
+ *
+ * ALU instructions have no side effects, so they are hoisted from anywhere
+ * in the loop, even from blocks which aren't run on every iteration.  Loads
+ * are only hoisted from blocks which are run at least once whenever the loop
+ * is entered, i.e. blocks at the top level of the loop body which come
+ * before any control flow containing a jump, so that no load is executed
+ * that the original program wouldn't have executed.
+ *
+ * Every hoisted value that is still used inside the loop stays live across
+ * the whole loop.  nir_opt_licm_options::max_live_components bounds the
+ * number of such components per loop; when the limit would be exceeded, the
+ * remaining instructions are left in place.  Values that are only used by
+ * other hoisted instructions and constants don't count.  With
+ * uniform_values_are_free, divergence analysis is run first and uniform
+ * values don't count either, for hardware where they live in separate
+ * scalar registers.  Divergence analysis expects the shader to be in LCSSA
+ * form.
+ *
+ * Loops which loop analysis finds to run at most once are skipped.
+ */
+
+struct licm_state {
+   const nir_opt_licm_options *options;
+
+   /* Per-SSA def divergence, or NULL. */
+   bool *divergent;
+
+   /* Candidates of the loop being processed, in program order. */
+   struct util_dynarray candidates;
+
+   /* Per-SSA def state, indexed by SSA index. */
+   uint8_t *def_state;
+
+   /* Per-SSA def number of uses of hoisted defs that haven't been hoisted
+    * (yet), indexed by SSA index.
+    */
+   unsigned *remaining_uses;
+
+   /* Components given back by the candidate being considered. */
+   unsigned freed;
+};
+
+enum def_state {
+   DEF_OUTSIDE = 0,
+   DEF_INSIDE,
+   DEF_INVARIANT,
+   DEF_HOISTED,
+};
+
+static bool
+src_is_invariant(nir_src *src, void *_state)
+{
+   struct licm_state *state = _state;
+
+   if (!src->is_ssa)
+      return false;
+
+   uint8_t s = state->def_state[src->ssa->index];
+   return s == DEF_OUTSIDE || s == DEF_INVARIANT;
+}
+
+static bool
+mark_def_inside(nir_ssa_def *def, void *_state)
+{
+   struct licm_state *state = _state;
+   state->def_state[def->index] = DEF_INSIDE;
+   return true;
+}
+
+static bool
+instr_can_hoist(nir_instr *instr, bool always_executed)
+{
+   switch (instr->type) {
+   case nir_instr_type_alu:
+      return nir_instr_as_alu(instr)->dest.dest.is_ssa;
+
+   case nir_instr_type_load_const:
+   case nir_instr_type_ssa_undef:
+      return true;
+
+   case nir_instr_type_intrinsic: {
+      nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
+      if (!always_executed ||
+          !nir_intrinsic_infos[intrin->intrinsic].has_dest ||
+          !intrin->dest.is_ssa)
+         return false;
+
+      /* Derefs have to stay close to their uses. */
+      if (intrin->intrinsic == nir_intrinsic_load_deref)
+         return false;
+
+      return nir_intrinsic_can_reorder(intrin);
+   }
+
+   default:
+      return false;
+   }
+}
+
+static bool
+cf_node_has_jump(nir_cf_node *node)
+{
+   nir_foreach_block_in_cf_node(block, node) {
+      nir_instr *last = nir_block_last_instr(block);
+      if (last && last->type == nir_instr_type_jump)
+         return true;
+   }
+   return false;
+}
+
+static void
+mark_loop_defs(struct licm_state *state, nir_loop *loop)
+{
+   nir_foreach_block_in_cf_node(block, &loop->cf_node) {
+      nir_foreach_instr(instr, block)
+         nir_foreach_ssa_def(instr, mark_def_inside, state);
+   }
+}
+
+/* Collects the invariant instructions of the loop, not counting nested
+ * loops, in program order.
+ */
+static void
+collect_invariants(struct licm_state *state, struct exec_list *cf_list,
+                   bool *always_executed)
+{
+   foreach_list_typed(nir_cf_node, node, node, cf_list) {
+      switch (node->type) {
+      case nir_cf_node_block: {
+         nir_block *block = nir_cf_node_as_block(node);
+         nir_foreach_instr(instr, block) {
+            if (!instr_can_hoist(instr, *always_executed) ||
+                !nir_foreach_src(instr, src_is_invariant, state))
+               continue;
+
+            nir_ssa_def *def = nir_instr_ssa_def(instr);
+            state->def_state[def->index] = DEF_INVARIANT;
+            util_dynarray_append(&state->candidates, nir_instr *, instr);
+         }
+
+         nir_instr *last = nir_block_last_instr(block);
+         if (last && last->type == nir_instr_type_jump)
+            *always_executed = false;
+         break;
+      }
+
+      case nir_cf_node_if: {
+         nir_if *nif = nir_cf_node_as_if(node);
+         bool branch_executed = false;
+         if (cf_node_has_jump(node))
+            *always_executed = false;
+         collect_invariants(state, &nif->then_list, &branch_executed);
+         collect_invariants(state, &nif->else_list, &branch_executed);
+         break;
+      }
+
+      case nir_cf_node_loop:
+         /* Whatever is invariant in the nested loop has already been moved
+          * out of it.
+          */
+         *always_executed = false;
+         break;
+
+      default:
+         unreachable("Invalid CF node type");
+      }
+   }
+}
+
+static bool
+src_is_hoisted_or_outside(nir_src *src, void *_state)
+{
+   struct licm_state *state = _state;
+   uint8_t s = state->def_state[src->ssa->index];
+   return s == DEF_OUTSIDE || s == DEF_HOISTED;
+}
+
+/* Registers (components) a hoisted def costs while it is live across the
+ * loop.
+ */
+static unsigned
+def_cost(struct licm_state *state, nir_ssa_def *def)
+{
+   if (def->parent_instr->type == nir_instr_type_load_const)
+      return 0;
+
+   if (state->divergent && !state->divergent[def->index])
+      return 0;
+
+   return def->num_components;
+}
+
+static bool
+release_use(nir_src *src, void *_state)
+{
+   struct licm_state *state = _state;
+
+   if (state->def_state[src->ssa->index] == DEF_HOISTED &&
+       --state->remaining_uses[src->ssa->index] == 0)
+      state->freed += def_cost(state, src->ssa);
+   return true;
+}
+
+static bool
+restore_use(nir_src *src, void *_state)
+{
+   struct licm_state *state = _state;
+
+   if (state->def_state[src->ssa->index] == DEF_HOISTED)
+      state->remaining_uses[src->ssa->index]++;
+   return true;
+}
+
+static bool
+reset_def(nir_ssa_def *def, void *_state)
+{
+   struct licm_state *state = _state;
+   state->def_state[def->index] = DEF_OUTSIDE;
+   state->remaining_uses[def->index] = 0;
+   return true;
+}
+
+static bool
+hoist_from_loop(struct licm_state *state, nir_loop *loop)
+{
+   util_dynarray_clear(&state->candidates);
+
+   mark_loop_defs(state, loop);
+
+   bool always_executed = true;
+   collect_invariants(state, &loop->body, &always_executed);
+
+   /* Greedily pick the candidates in program order.  A hoisted def is
+    * charged for its components as long as it has a use that hasn't been
+    * hoisted after it; hoisting the last such use gives them back.  A
+    * candidate is only hoisted if all of its sources have been.
+    */
+   nir_block *preheader =
+      nir_cf_node_as_block(nir_cf_node_prev(&loop->cf_node));
+   unsigned limit = state->options->max_live_components;
+   unsigned live = 0;
+   bool progress = false;
+
+   util_dynarray_foreach(&state->candidates, nir_instr *, instr_ptr) {
+      nir_instr *instr = *instr_ptr;
+      nir_ssa_def *def = nir_instr_ssa_def(instr);
+
+      if (!nir_foreach_src(instr, src_is_hoisted_or_outside, state)) {
+         state->def_state[def->index] = DEF_INSIDE;
+         continue;
+      }
+
+      unsigned added = list_is_empty(&def->uses) && list_is_empty(&def->if_uses) ?
+                       0 : def_cost(state, def);
+      state->freed = 0;
+      nir_foreach_src(instr, release_use, state);
+
+      if (limit && live + added > limit + state->freed) {
+         nir_foreach_src(instr, restore_use, state);
+         state->def_state[def->index] = DEF_INSIDE;
+         continue;
+      }
+
+      live = live + added - state->freed;
+      state->def_state[def->index] = DEF_HOISTED;
+      state->remaining_uses[def->index] =
+         list_length(&def->uses) + list_length(&def->if_uses);
+
+      nir_instr_remove(instr);
+      nir_instr_insert(nir_after_block(preheader), instr);
+      progress = true;
+   }
+
+   /* As far as the next loop out is concerned, everything in this loop and
+    * everything hoisted out of it is defined outside of it.
+    */
+   nir_foreach_block_in_cf_node(block, &loop->cf_node) {
+      nir_foreach_instr(instr, block)
+         nir_foreach_ssa_def(instr, reset_def, state);
+   }
+   util_dynarray_foreach(&state->candidates, nir_instr *, instr)
+      nir_foreach_ssa_def(*instr, reset_def, state);
+
+   return progress;
+}
+
+static bool
+visit_cf_list(struct licm_state *state, struct exec_list *cf_list)
+{
+   bool progress = false;
+
+   foreach_list_typed(nir_cf_node, node, node, cf_list) {
+      switch (node->type) {
+      case nir_cf_node_block:
+         break;
+
+      case nir_cf_node_if: {
+         nir_if *nif = nir_cf_node_as_if(node);
+         progress |= visit_cf_list(state, &nif->then_list);
+         progress |= visit_cf_list(state, &nif->else_list);
+         break;
+      }
+
+      case nir_cf_node_loop: {
+         nir_loop *loop = nir_cf_node_as_loop(node);
+         progress |= visit_cf_list(state, &loop->body);
+
+         if (loop->info && loop->info->exact_trip_count_known &&
+             loop->info->max_trip_count <= 1)
+            break;
+
+         progress |= hoist_from_loop(state, loop);
+         break;
+      }
+
+      default:
+         unreachable("Invalid CF node type");
+      }
+   }
+
+   return progress;
+}
+
+static bool
+opt_licm_impl(nir_function_impl *impl, struct licm_state *state)
+{
+   nir_metadata_require(impl, nir_metadata_loop_analysis, 0);
+
+   state->def_state = calloc(impl->ssa_alloc, sizeof(*state->def_state));
+   state->remaining_uses = calloc(impl->ssa_alloc,
+                                  sizeof(*state->remaining_uses));
+
+   bool progress = visit_cf_list(state, &impl->body);
+
+   free(state->def_state);
+   free(state->remaining_uses);
+
+   if (progress) {
+      nir_metadata_preserve(impl, nir_metadata_block_index |
+                                  nir_metadata_dominance);
+   }
+
+   return progress;
+}
+
+/**
+ * Moves loop-invariant instructions out of loops.
+ */
+bool
+nir_opt_licm(nir_shader *shader, const nir_opt_licm_options *options)
+{
+   struct licm_state state = {
+      .options = options,
+   };
+   bool progress = false;
+
+   util_dynarray_init(&state.candidates, NULL);
+
+   nir_foreach_function(function, shader) {
+      if (!function->impl)
+         continue;
+
+      state.divergent = NULL;
+      if (options->uniform_values_are_free &&
+          function->impl == nir_shader_get_entrypoint(shader)) {
+         nir_index_ssa_defs(function->impl);
+         state.divergent =
+            nir_divergence_analysis(shader, options->divergence_options);
+      }
+
+      progress |= opt_licm_impl(function->impl, &state);
+
+      ralloc_free(state.divergent);
+   }
+
+   util_dynarray_fini(&state.candidates);
+
+   return progress;
+}
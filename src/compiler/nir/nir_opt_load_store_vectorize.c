@@ -0,0 +1,632 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir.h"
+#include "nir_builder.h"
+
+#include "util/u_dynarray.h"
+#include "util/u_math.h"
+
+/* Combine adjacent explicit-offset memory accesses into wider ones.
+ *
+ * This per-block pass looks at load_ubo, load_ssbo/store_ssbo,
+ * load_shared/store_shared and load_global/store_global.  Every access gets
+ * its offset split into a variable part (an SSA value, or nothing for
+ * constant offsets) and a constant byte offset, by looking through iadd of
+ * constants.  Two accesses of the same kind with the same resource, the same
+ * variable part and the same bit size whose constant ranges touch are
+ * candidates for combining, and the driver callback decides whether the
+ * combined access is legal and profitable.
+ *
+ * Loads are combined at the position of the first one and stores at the
+ * position of the last one, so the access that moves must not be reordered
+ * with anything that may touch the same memory in between: other accesses
+ * of an aliasing mode that can't be proven disjoint, barriers, atomics,
+ * calls and intrinsics the pass doesn't know about.  SSBO and global memory
+ * are assumed to alias each other, UBOs are never written.
+ *
+ * Volatile accesses are never combined, and accesses are only combined with
+ * accesses with the same ACCESS_* qualifiers.
+ */
+
+#define MAX_SEARCH_DISTANCE 64
+
+#define WRITABLE_MODES (nir_var_mem_ssbo | nir_var_mem_shared | \
+                        nir_var_mem_global)
+
+struct intrinsic_info {
+   nir_variable_mode mode;
+   nir_intrinsic_op op;
+   bool is_store;
+   int resource_src;
+   int offset_src;
+   int value_src;
+};
+
+static const struct intrinsic_info infos[] = {
+   { nir_var_mem_ubo,    nir_intrinsic_load_ubo,     false,  0, 1, -1 },
+   { nir_var_mem_ssbo,   nir_intrinsic_load_ssbo,    false,  0, 1, -1 },
+   { nir_var_mem_ssbo,   nir_intrinsic_store_ssbo,   true,   1, 2,  0 },
+   { nir_var_mem_shared, nir_intrinsic_load_shared,  false, -1, 0, -1 },
+   { nir_var_mem_shared, nir_intrinsic_store_shared, true,  -1, 1,  0 },
+   { nir_var_mem_global, nir_intrinsic_load_global,  false, -1, 0, -1 },
+   { nir_var_mem_global, nir_intrinsic_store_global, true,  -1, 1,  0 },
+};
+
+static const struct intrinsic_info *
+get_info(nir_intrinsic_op op)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(infos); i++) {
+      if (infos[i].op == op)
+         return &infos[i];
+   }
+   return NULL;
+}
+
+/* Something in a block which touches memory. */
+struct mem_access {
+   nir_instr *instr;
+
+   /* Memory that may be read or written, for reordering purposes. */
+   nir_variable_mode read_modes;
+   nir_variable_mode write_modes;
+
+   /* Set for the accesses this pass knows how to combine, NULL otherwise.
+    * The fields below are only valid when it is set.
+    */
+   const struct intrinsic_info *info;
+
+   nir_ssa_def *resource;
+   nir_ssa_def *base;
+   int64_t offset;
+   unsigned bit_size;
+   unsigned num_components;
+   enum gl_access_qualifier access;
+
+   /* Whether the access can be combined at all. */
+   bool candidate;
+
+   /* Set once the access has been combined into another one. */
+   bool removed;
+};
+
+static nir_variable_mode
+aliasing_modes(nir_variable_mode mode)
+{
+   if (mode & (nir_var_mem_ssbo | nir_var_mem_global))
+      mode |= nir_var_mem_ssbo | nir_var_mem_global;
+   return mode;
+}
+
+static unsigned
+get_bytes(const struct mem_access *access)
+{
+   return access->num_components * (access->bit_size / 8);
+}
+
+/* Splits an offset into a variable part and a constant, looking through
+ * chains of scalar iadd with a constant source.  Returns NULL if the whole
+ * offset is constant.
+ */
+static nir_ssa_def *
+parse_offset(nir_ssa_def *def, int64_t *offset)
+{
+   *offset = 0;
+
+   while (true) {
+      if (def->parent_instr->type == nir_instr_type_load_const) {
+         *offset += nir_src_comp_as_int(nir_src_for_ssa(def), 0);
+         return NULL;
+      }
+
+      if (def->parent_instr->type != nir_instr_type_alu)
+         return def;
+
+      nir_alu_instr *alu = nir_instr_as_alu(def->parent_instr);
+      if (alu->op != nir_op_iadd || alu->dest.dest.ssa.num_components != 1)
+         return def;
+
+      nir_ssa_def *next = NULL;
+      for (unsigned i = 0; i < 2; i++) {
+         nir_alu_src *cnst = &alu->src[i];
+         nir_alu_src *other = &alu->src[1 - i];
+         if (nir_src_is_const(cnst->src) && other->src.is_ssa &&
+             other->src.ssa->num_components == 1) {
+            *offset += nir_src_comp_as_int(cnst->src, cnst->swizzle[0]);
+            next = other->src.ssa;
+            break;
+         }
+      }
+
+      if (!next)
+         return def;
+      def = next;
+   }
+}
+
+/* Known power-of-two alignment of a variable offset part, in bytes. */
+static unsigned
+guess_base_align(nir_ssa_def *base, unsigned bit_size)
+{
+   unsigned align = bit_size / 8;
+
+   if (base->parent_instr->type != nir_instr_type_alu)
+      return align;
+
+   nir_alu_instr *alu = nir_instr_as_alu(base->parent_instr);
+   if ((alu->op != nir_op_imul && alu->op != nir_op_ishl) ||
+       !nir_src_is_const(alu->src[1].src))
+      return align;
+
+   uint64_t c = nir_src_comp_as_uint(alu->src[1].src, alu->src[1].swizzle[0]);
+   if (alu->op == nir_op_imul && c)
+      return MAX2(align, 1u << MIN2(ffsll(c) - 1, 31));
+   if (alu->op == nir_op_ishl && c < 31)
+      return MAX2(align, 1u << c);
+
+   return align;
+}
+
+/* Alignment in bytes of the address of a combinable access. */
+static unsigned
+get_align(const struct mem_access *access)
+{
+   nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(access->instr);
+
+   if (nir_intrinsic_align_mul(intrin))
+      return nir_intrinsic_align(intrin);
+
+   unsigned align = access->base ?
+      guess_base_align(access->base, access->bit_size) : 1u << 31;
+   if (access->offset)
+      align = MIN2(align, 1u << (ffsll(access->offset) - 1));
+   return align;
+}
+
+static void
+init_access(struct mem_access *access, nir_instr *instr)
+{
+   memset(access, 0, sizeof(*access));
+   access->instr = instr;
+
+   if (instr->type == nir_instr_type_call) {
+      access->read_modes = access->write_modes = WRITABLE_MODES;
+      return;
+   }
+
+   if (instr->type != nir_instr_type_intrinsic)
+      return;
+
+   nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
+   const nir_intrinsic_info *intrin_info = &nir_intrinsic_infos[intrin->intrinsic];
+   const struct intrinsic_info *info = get_info(intrin->intrinsic);
+
+   if (!info) {
+      switch (intrin->intrinsic) {
+      case nir_intrinsic_store_output:
+      case nir_intrinsic_store_per_vertex_output:
+         return;
+
+      /* Stores before a discard have to happen and loads after it must not
+       * be moved above it, so these are barriers for all memory.
+       */
+      case nir_intrinsic_discard:
+      case nir_intrinsic_discard_if:
+      case nir_intrinsic_demote:
+      case nir_intrinsic_demote_if:
+         access->read_modes = access->write_modes = WRITABLE_MODES;
+         return;
+
+      case nir_intrinsic_memory_barrier_shared:
+         access->read_modes = access->write_modes = nir_var_mem_shared;
+         return;
+
+      case nir_intrinsic_memory_barrier_buffer:
+         access->read_modes = access->write_modes =
+            nir_var_mem_ssbo | nir_var_mem_global;
+         return;
+
+      case nir_intrinsic_scoped_memory_barrier:
+         access->read_modes = access->write_modes =
+            aliasing_modes(nir_intrinsic_memory_modes(intrin)) & WRITABLE_MODES;
+         return;
+
+      default:
+         break;
+      }
+
+      if (intrin_info->flags & NIR_INTRINSIC_CAN_REORDER)
+         return;
+
+      /* Anything else that can be eliminated has no side effect but might
+       * read memory, everything else might also write it.
+       */
+      access->read_modes = WRITABLE_MODES;
+      if (!(intrin_info->flags & NIR_INTRINSIC_CAN_ELIMINATE))
+         access->write_modes = WRITABLE_MODES;
+      return;
+   }
+
+   if (info->is_store)
+      access->write_modes = aliasing_modes(info->mode);
+   else
+      access->read_modes = aliasing_modes(info->mode);
+
+   access->info = info;
+   access->resource =
+      info->resource_src >= 0 ? intrin->src[info->resource_src].ssa : NULL;
+   access->base = parse_offset(intrin->src[info->offset_src].ssa,
+                               &access->offset);
+   if (intrin_info->index_map[NIR_INTRINSIC_BASE])
+      access->offset += nir_intrinsic_base(intrin);
+
+   if (info->is_store) {
+      nir_ssa_def *value = intrin->src[info->value_src].ssa;
+      access->bit_size = value->bit_size;
+      access->num_components = value->num_components;
+   } else {
+      access->bit_size = intrin->dest.ssa.bit_size;
+      access->num_components = intrin->dest.ssa.num_components;
+   }
+
+   if (intrin_info->index_map[NIR_INTRINSIC_ACCESS])
+      access->access = nir_intrinsic_access(intrin);
+
+   access->candidate = access->bit_size >= 8 &&
+                       !(access->access & ACCESS_VOLATILE);
+   if (info->is_store) {
+      nir_component_mask_t full = (1 << access->num_components) - 1;
+      access->candidate &= nir_intrinsic_write_mask(intrin) == full;
+   }
+}
+
+/* Resources are often constant block indices, which may come from separate
+ * load_const instructions if CSE didn't run.
+ */
+static bool
+same_resource(nir_ssa_def *a, nir_ssa_def *b)
+{
+   if (a == b)
+      return true;
+
+   if (!a || !b ||
+       a->parent_instr->type != nir_instr_type_load_const ||
+       b->parent_instr->type != nir_instr_type_load_const ||
+       a->num_components != b->num_components ||
+       a->bit_size != b->bit_size)
+      return false;
+
+   for (unsigned i = 0; i < a->num_components; i++) {
+      if (nir_src_comp_as_uint(nir_src_for_ssa(a), i) !=
+          nir_src_comp_as_uint(nir_src_for_ssa(b), i))
+         return false;
+   }
+   return true;
+}
+
+/* Whether two tracked accesses of the same memory provably don't overlap. */
+static bool
+disjoint(const struct mem_access *a, const struct mem_access *b)
+{
+   if (!a->info || !b->info || a->info->mode != b->info->mode ||
+       !same_resource(a->resource, b->resource) || a->base != b->base)
+      return false;
+
+   return a->offset + get_bytes(a) <= b->offset ||
+          b->offset + get_bytes(b) <= a->offset;
+}
+
+/* Whether a and b have to stay in order. */
+static bool
+may_conflict(const struct mem_access *a, const struct mem_access *b)
+{
+   if (!(a->write_modes & (b->read_modes | b->write_modes)) &&
+       !(a->read_modes & b->write_modes))
+      return false;
+
+   return !disjoint(a, b);
+}
+
+static bool
+can_combine(const struct mem_access *a, const struct mem_access *b)
+{
+   return a->candidate && b->candidate &&
+          a->info == b->info &&
+          same_resource(a->resource, b->resource) &&
+          a->base == b->base &&
+          a->bit_size == b->bit_size &&
+          a->access == b->access &&
+          a->num_components + b->num_components <= NIR_MAX_VEC_COMPONENTS;
+}
+
+/* Offset source for an access at the given constant offset, built from the
+ * offset of another access of the same group.
+ */
+static nir_ssa_def *
+build_offset(nir_builder *b, const struct mem_access *ref, int64_t offset)
+{
+   nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(ref->instr);
+   nir_ssa_def *old = intrin->src[ref->info->offset_src].ssa;
+
+   if (offset == ref->offset)
+      return old;
+
+   if (ref->base)
+      return nir_iadd_imm(b, ref->base, offset);
+   else
+      return nir_imm_intN_t(b, offset, old->bit_size);
+}
+
+static nir_intrinsic_instr *
+create_combined(nir_builder *b, const struct mem_access *ref,
+                const struct mem_access *low, unsigned num_components)
+{
+   nir_intrinsic_instr *ref_intrin = nir_instr_as_intrinsic(ref->instr);
+   nir_intrinsic_instr *low_intrin = nir_instr_as_intrinsic(low->instr);
+   const nir_intrinsic_info *intrin_info = &nir_intrinsic_infos[ref->info->op];
+
+   nir_intrinsic_instr *intrin =
+      nir_intrinsic_instr_create(b->shader, ref->info->op);
+   intrin->num_components = num_components;
+   memcpy(intrin->const_index, ref_intrin->const_index,
+          sizeof(intrin->const_index));
+
+   if (ref->info->resource_src >= 0) {
+      intrin->src[ref->info->resource_src] =
+         nir_src_for_ssa(ref->resource);
+   }
+
+   /* Where there is a base index, prefer adjusting it over adding to the
+    * offset.  The base index can't be negative.
+    */
+   nir_ssa_def *offset;
+   if (intrin_info->index_map[NIR_INTRINSIC_BASE]) {
+      int64_t base_index = nir_intrinsic_base(ref_intrin);
+      int64_t delta = low->offset - ref->offset;
+      if (base_index + delta >= 0) {
+         nir_intrinsic_set_base(intrin, base_index + delta);
+         offset = ref_intrin->src[ref->info->offset_src].ssa;
+      } else {
+         nir_intrinsic_set_base(intrin, 0);
+         offset = build_offset(b, ref, low->offset);
+      }
+   } else {
+      offset = build_offset(b, ref, low->offset);
+   }
+   intrin->src[ref->info->offset_src] = nir_src_for_ssa(offset);
+
+   if (intrin_info->index_map[NIR_INTRINSIC_ALIGN_MUL]) {
+      nir_intrinsic_set_align_mul(intrin, nir_intrinsic_align_mul(low_intrin));
+      nir_intrinsic_set_align_offset(intrin,
+                                     nir_intrinsic_align_offset(low_intrin));
+   }
+
+   return intrin;
+}
+
+static void
+combine_loads(nir_builder *b, struct mem_access *first,
+              struct mem_access *low, struct mem_access *high)
+{
+   unsigned num_components = low->num_components + high->num_components;
+   nir_intrinsic_instr *low_intrin = nir_instr_as_intrinsic(low->instr);
+   nir_intrinsic_instr *high_intrin = nir_instr_as_intrinsic(high->instr);
+
+   b->cursor = nir_before_instr(first->instr);
+
+   nir_intrinsic_instr *load = create_combined(b, first, low, num_components);
+   nir_ssa_dest_init(&load->instr, &load->dest, num_components,
+                     low->bit_size, NULL);
+   nir_builder_instr_insert(b, &load->instr);
+
+   nir_component_mask_t low_mask = (1 << low->num_components) - 1;
+   nir_component_mask_t high_mask =
+      ((1 << high->num_components) - 1) << low->num_components;
+   nir_ssa_def_rewrite_uses(&low_intrin->dest.ssa,
+      nir_src_for_ssa(nir_channels(b, &load->dest.ssa, low_mask)));
+   nir_ssa_def_rewrite_uses(&high_intrin->dest.ssa,
+      nir_src_for_ssa(nir_channels(b, &load->dest.ssa, high_mask)));
+
+   nir_instr_remove(low->instr);
+   nir_instr_remove(high->instr);
+
+   /* The combined load takes over the entry of the first one. */
+   int64_t offset = low->offset;
+   first->instr = &load->instr;
+   first->offset = offset;
+   first->num_components = num_components;
+}
+
+static void
+combine_stores(nir_builder *b, struct mem_access *last,
+               struct mem_access *low, struct mem_access *high)
+{
+   unsigned num_components = low->num_components + high->num_components;
+   nir_intrinsic_instr *low_intrin = nir_instr_as_intrinsic(low->instr);
+   nir_intrinsic_instr *high_intrin = nir_instr_as_intrinsic(high->instr);
+   int value_src = low->info->value_src;
+
+   b->cursor = nir_before_instr(last->instr);
+
+   nir_ssa_def *comps[NIR_MAX_VEC_COMPONENTS];
+   for (unsigned i = 0; i < low->num_components; i++)
+      comps[i] = nir_channel(b, low_intrin->src[value_src].ssa, i);
+   for (unsigned i = 0; i < high->num_components; i++) {
+      comps[low->num_components + i] =
+         nir_channel(b, high_intrin->src[value_src].ssa, i);
+   }
+
+   nir_intrinsic_instr *store = create_combined(b, last, low, num_components);
+   store->src[value_src] = nir_src_for_ssa(nir_vec(b, comps, num_components));
+   nir_intrinsic_set_write_mask(store, (1 << num_components) - 1);
+   nir_builder_instr_insert(b, &store->instr);
+
+   nir_instr_remove(low->instr);
+   nir_instr_remove(high->instr);
+
+   int64_t offset = low->offset;
+   last->instr = &store->instr;
+   last->offset = offset;
+   last->num_components = num_components;
+}
+
+struct vectorize_ctx {
+   nir_builder b;
+   nir_variable_mode modes;
+   nir_should_vectorize_mem_func callback;
+   struct util_dynarray accesses;
+};
+
+/* Tries to combine accesses[i] and accesses[j], with i < j. */
+static bool
+try_combine(struct vectorize_ctx *ctx, struct mem_access *accesses,
+            unsigned i, unsigned j)
+{
+   struct mem_access *first = &accesses[i], *second = &accesses[j];
+   struct mem_access *low, *high;
+
+   if (first->offset + get_bytes(first) == second->offset) {
+      low = first;
+      high = second;
+   } else if (second->offset + get_bytes(second) == first->offset) {
+      low = second;
+      high = first;
+   } else {
+      return false;
+   }
+
+   if (!ctx->callback(get_align(low), low->bit_size,
+                      low->num_components + high->num_components,
+                      high->offset - low->offset,
+                      nir_instr_as_intrinsic(low->instr),
+                      nir_instr_as_intrinsic(high->instr)))
+      return false;
+
+   /* Loads move up to the first one and stores down to the last one. */
+   struct mem_access *moved = first->info->is_store ? first : second;
+   for (unsigned k = i + 1; k < j; k++) {
+      if (!accesses[k].removed && may_conflict(moved, &accesses[k]))
+         return false;
+   }
+
+   if (first->info->is_store) {
+      combine_stores(&ctx->b, second, low, high);
+      first->removed = true;
+   } else {
+      combine_loads(&ctx->b, first, low, high);
+      second->removed = true;
+   }
+
+   return true;
+}
+
+static bool
+vectorize_block(struct vectorize_ctx *ctx, nir_block *block)
+{
+   util_dynarray_clear(&ctx->accesses);
+
+   nir_foreach_instr(instr, block) {
+      struct mem_access access;
+      init_access(&access, instr);
+      if (access.read_modes || access.write_modes)
+         util_dynarray_append(&ctx->accesses, struct mem_access, access);
+   }
+
+   struct mem_access *accesses = ctx->accesses.data;
+   unsigned count = util_dynarray_num_elements(&ctx->accesses,
+                                               struct mem_access);
+   bool progress = false;
+
+   for (unsigned i = 0; i < count; i++) {
+      struct mem_access *first = &accesses[i];
+      if (first->removed || !first->candidate ||
+          !(first->info->mode & ctx->modes))
+         continue;
+
+      unsigned end = MIN2(count, i + 1 + MAX_SEARCH_DISTANCE);
+      for (unsigned j = i + 1; j < end; j++) {
+         struct mem_access *second = &accesses[j];
+         if (second->removed)
+            continue;
+
+         if (can_combine(first, second) && try_combine(ctx, accesses, i, j)) {
+            progress = true;
+
+            /* A combined store lives on in the later entry, which the outer
+             * loop will get to.  A combined load can keep growing.
+             */
+            if (first->removed)
+               break;
+            continue;
+         }
+
+         /* Nothing after a conflicting store can be combined with it. */
+         if (first->info->is_store && may_conflict(first, second))
+            break;
+      }
+   }
+
+   return progress;
+}
+
+/**
+ * Combines adjacent loads and stores of the given modes into vector ones.
+ *
+ * The callback is given the alignment in bytes of the combined access, its
+ * bit size and number of components, the distance in bytes between the two
+ * accesses being combined and the two intrinsics, and returns whether the
+ * combined access should be emitted.
+ */
+bool
+nir_opt_load_store_vectorize(nir_shader *shader, nir_variable_mode modes,
+                             nir_should_vectorize_mem_func callback)
+{
+   struct vectorize_ctx ctx = {
+      .modes = modes,
+      .callback = callback,
+   };
+   bool progress = false;
+
+   util_dynarray_init(&ctx.accesses, NULL);
+
+   nir_foreach_function(function, shader) {
+      if (!function->impl)
+         continue;
+
+      bool impl_progress = false;
+      nir_builder_init(&ctx.b, function->impl);
+
+      nir_foreach_block(block, function->impl)
+         impl_progress |= vectorize_block(&ctx, block);
+
+      if (impl_progress) {
+         nir_metadata_preserve(function->impl, nir_metadata_block_index |
+                                               nir_metadata_dominance);
+         progress = true;
+      }
+   }
+
+   util_dynarray_fini(&ctx.accesses);
+
+   return progress;
+}
@@ -0,0 +1,245 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "nir_pass_pipeline.h"
+
+/* See the comment above nir_pass_pipeline in nir_pass_pipeline.h.
+ *
+ * Every change reported to the pipeline bumps its generation and records
+ * it as the last change of each part of the IR that was written.  A pass
+ * remembers the generation at which it was last known to have nothing to
+ * do, and only runs again once something it reads changed after that.
+ */
+
+#define ALU        nir_pass_ir_alu
+#define VARS       nir_pass_ir_vars
+#define INTRINSICS nir_pass_ir_intrinsics
+#define PHIS       nir_pass_ir_phis
+#define CF         nir_pass_ir_cf
+#define ALL        nir_pass_ir_all
+
+/* What the common optimization loop passes read and write.
+ *
+ * Anything that rewrites SSA uses or removes instructions changes the use
+ * lists of values of any kind and therefore writes ALL; the same goes for
+ * the readers of use lists, such as DCE and the is_used_once conditions of
+ * nir_opt_algebraic.  An idempotent pass runs until it has nothing left to
+ * do, so its own progress doesn't make it run again.
+ */
+static const struct {
+   const char *name;
+   nir_pass_ir reads;
+   nir_pass_ir writes;
+   bool idempotent;
+} known_passes[] = {
+   { "nir_copy_prop",                ALL,                        ALL,        true  },
+   { "nir_lower_alu",                ALU,                        ALL,        true  },
+   { "nir_lower_alu_to_scalar",      ALU,                        ALL,        true  },
+   { "nir_lower_flrp",               ALU,                        ALL,        true  },
+   { "nir_lower_pack",               ALU,                        ALL,        true  },
+   { "nir_lower_phis_to_scalar",     ALL,                        ALL,        false },
+   { "nir_lower_vars_to_ssa",        VARS | CF,                  ALL,        true  },
+   { "nir_opt_algebraic",            ALL,                        ALL,        false },
+   { "nir_opt_combine_stores",       VARS | INTRINSICS | CF,     ALU | VARS, false },
+   { "nir_opt_conditional_discard",  ALU | INTRINSICS | CF,      ALL,        false },
+   { "nir_opt_constant_folding",     ALU | INTRINSICS,           ALL,        true  },
+   { "nir_opt_copy_prop_vars",       VARS | INTRINSICS | CF,     ALL,        false },
+   { "nir_opt_cse",                  ALL,                        ALL,        false },
+   { "nir_opt_dce",                  ALL,                        ALL,        true  },
+   { "nir_opt_dead_cf",              ALL,                        ALL,        false },
+   { "nir_opt_dead_write_vars",      VARS | INTRINSICS | CF,     VARS,       false },
+   { "nir_opt_deref",                ALU | VARS,                 ALL,        false },
+   { "nir_opt_find_array_copies",    VARS | CF,                  VARS,       false },
+   { "nir_opt_idiv_const",           ALU,                        ALL,        true  },
+   { "nir_opt_if",                   ALL,                        ALL,        false },
+   { "nir_opt_intrinsics",           ALU | INTRINSICS,           ALL,        false },
+   { "nir_opt_loop_unroll",          ALL,                        ALL,        false },
+   { "nir_opt_peephole_select",      ALL,                        ALL,        false },
+   { "nir_opt_remove_phis",          PHIS,                       ALL,        false },
+   { "nir_opt_trivial_continues",    CF,                         PHIS | CF,  false },
+   { "nir_opt_undef",                ALL,                        ALL,        false },
+   { "nir_remove_dead_variables",    VARS,                       VARS,       true  },
+   { "nir_shrink_vec_array_vars",    ALU | VARS,                 ALL,        false },
+   { "nir_split_array_vars",         ALU | VARS,                 ALL,        false },
+};
+
+#undef ALU
+#undef VARS
+#undef INTRINSICS
+#undef PHIS
+#undef CF
+#undef ALL
+
+void
+nir_pass_pipeline_init(nir_pass_pipeline *pipeline)
+{
+   memset(pipeline, 0, sizeof(*pipeline));
+}
+
+static nir_pass_pipeline_pass *
+add_pass(nir_pass_pipeline *pipeline, const char *name, unsigned line)
+{
+   if (pipeline->num_passes >= ARRAY_SIZE(pipeline->passes))
+      return NULL;
+
+   nir_pass_pipeline_pass *pass = &pipeline->passes[pipeline->num_passes++];
+   memset(pass, 0, sizeof(*pass));
+   pass->name = name;
+   pass->line = line;
+   pass->reads = nir_pass_ir_all;
+   pass->writes = nir_pass_ir_all;
+   return pass;
+}
+
+static nir_pass_pipeline_pass *
+find_pass(nir_pass_pipeline *pipeline, const char *name, unsigned line)
+{
+   for (unsigned i = 0; i < pipeline->num_passes; i++) {
+      nir_pass_pipeline_pass *pass = &pipeline->passes[i];
+      if (pass->line == line && strcmp(pass->name, name) == 0)
+         return pass;
+   }
+   return NULL;
+}
+
+/**
+ * Describes a pass the pipeline doesn't know about, or overrides what it
+ * knows.  Applies to every place the pass is run from.
+ */
+void
+nir_pass_pipeline_declare(nir_pass_pipeline *pipeline, const char *name,
+                          nir_pass_ir reads, nir_pass_ir writes,
+                          bool idempotent)
+{
+   /* Declarations are kept as passes on line 0, which __LINE__ never is. */
+   nir_pass_pipeline_pass *decl = find_pass(pipeline, name, 0);
+   if (!decl)
+      decl = add_pass(pipeline, name, 0);
+   if (!decl)
+      return;
+
+   decl->reads = reads;
+   decl->writes = writes;
+   decl->idempotent = idempotent;
+}
+
+/**
+ * Records that the shader was changed outside of the pipeline.
+ */
+void
+nir_pass_pipeline_invalidate(nir_pass_pipeline *pipeline, nir_pass_ir writes)
+{
+   pipeline->generation++;
+   for (unsigned i = 0; i < NIR_PASS_IR_COUNT; i++) {
+      if (writes & (1 << i))
+         pipeline->changed[i] = pipeline->generation;
+   }
+}
+
+static bool
+pass_has_work(const nir_pass_pipeline *pipeline,
+              const nir_pass_pipeline_pass *pass)
+{
+   if (pass->runs == 0)
+      return true;
+
+   for (unsigned i = 0; i < NIR_PASS_IR_COUNT; i++) {
+      if ((pass->reads & (1 << i)) &&
+          pipeline->changed[i] > pass->clean_generation)
+         return true;
+   }
+
+   return false;
+}
+
+/**
+ * Returns the state of the pass if it needs to run, or NULL if it can be
+ * skipped.
+ */
+nir_pass_pipeline_pass *
+nir_pass_pipeline_begin_pass(nir_pass_pipeline *pipeline,
+                             const char *name, unsigned line)
+{
+   nir_pass_pipeline_pass *pass = find_pass(pipeline, name, line);
+
+   if (!pass) {
+      pass = add_pass(pipeline, name, line);
+      if (!pass) {
+         /* Out of room.  The pass always runs and its progress still
+          * invalidates everything.
+          */
+         pipeline->untracked.writes = nir_pass_ir_all;
+         return &pipeline->untracked;
+      }
+
+      nir_pass_pipeline_pass *decl = find_pass(pipeline, name, 0);
+      if (decl) {
+         pass->reads = decl->reads;
+         pass->writes = decl->writes;
+         pass->idempotent = decl->idempotent;
+      } else {
+         for (unsigned i = 0; i < ARRAY_SIZE(known_passes); i++) {
+            if (strcmp(known_passes[i].name, name) == 0) {
+               pass->reads = known_passes[i].reads;
+               pass->writes = known_passes[i].writes;
+               pass->idempotent = known_passes[i].idempotent;
+               break;
+            }
+         }
+      }
+   }
+
+   if (!pass_has_work(pipeline, pass)) {
+      pass->skips++;
+      return NULL;
+   }
+
+   pass->runs++;
+   return pass;
+}
+
+void
+nir_pass_pipeline_end_pass(nir_pass_pipeline *pipeline,
+                           nir_pass_pipeline_pass *pass, bool progress)
+{
+   if (progress) {
+      nir_pass_pipeline_invalidate(pipeline, pass->writes);
+      pass->clean_generation = pass->idempotent ? pipeline->generation :
+                                                  pipeline->generation - 1;
+   } else {
+      pass->clean_generation = pipeline->generation;
+   }
+}
+
+void
+nir_pass_pipeline_print_stats(const nir_pass_pipeline *pipeline, FILE *fp)
+{
+   for (unsigned i = 0; i < pipeline->num_passes; i++) {
+      const nir_pass_pipeline_pass *pass = &pipeline->passes[i];
+      if (pass->line == 0)
+         continue;
+
+      fprintf(fp, "%-32s line %5u: %3u runs, %3u skipped\n",
+              pass->name, pass->line, pass->runs, pass->skips);
+   }
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef NIR_PASS_PIPELINE_H
+#define NIR_PASS_PIPELINE_H
+
+#include "nir.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Parts of the IR a pass looks at or changes
+ *
+ * A pass that rewrites the uses of an SSA value potentially changes every
+ * kind of instruction, since the users can be anything.
+ */
+typedef enum {
+   /** ALU instructions, constants and undefs */
+   nir_pass_ir_alu         = (1 << 0),
+   /** Variables, derefs and the intrinsics that take derefs */
+   nir_pass_ir_vars        = (1 << 1),
+   /** All other intrinsics and texture instructions */
+   nir_pass_ir_intrinsics  = (1 << 2),
+   nir_pass_ir_phis        = (1 << 3),
+   /** Control flow and jumps */
+   nir_pass_ir_cf          = (1 << 4),
+
+   nir_pass_ir_all         = (1 << 5) - 1,
+} nir_pass_ir;
+
+#define NIR_PASS_IR_COUNT 5
+#define NIR_PASS_PIPELINE_MAX_PASSES 64
+
+typedef struct {
+   const char *name;
+   unsigned line;
+
+   /** What the pass looks at and what it may change when it makes progress */
+   nir_pass_ir reads;
+   nir_pass_ir writes;
+
+   /** Whether the pass leaves nothing for itself to do when it's done. */
+   bool idempotent;
+
+   /** Generation up to which the pass is known to have nothing to do. */
+   unsigned clean_generation;
+
+   unsigned runs;
+   unsigned skips;
+} nir_pass_pipeline_pass;
+
+/** A driver optimization loop that skips passes with nothing to do
+ *
+ * Drivers run their optimizations in a loop until none of the passes makes
+ * progress.  Most passes only look at some parts of the shader, so once a
+ * pass has run without progress, it can't make progress again until
+ * another pass changes one of those parts.  The pipeline keeps track of
+ * what changed when and skips the passes that would have been no-ops.
+ *
+ * The loop stays as it is, with NIR_PIPELINE_PASS in place of NIR_PASS:
+ *
+ *    nir_pass_pipeline pipeline;
+ *    nir_pass_pipeline_init(&pipeline);
+ *    do {
+ *       progress = false;
+ *       NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_copy_prop);
+ *       NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_dce);
+ *       ...
+ *    } while (progress);
+ *
+ * Passes are identified by their name and the line they're run from, so
+ * the same pass can be run from several places in the loop with different
+ * arguments.  What a pass reads and writes comes from a table of the common
+ * NIR passes; passes that aren't in the table, such as driver passes, are
+ * assumed to read and write everything.  nir_pass_pipeline_declare() can
+ * describe them better.  If the shader is changed in the loop without going
+ * through the pipeline, nir_pass_pipeline_invalidate() must be called.
+ */
+typedef struct {
+   unsigned generation;
+   unsigned changed[NIR_PASS_IR_COUNT];
+
+   unsigned num_passes;
+   nir_pass_pipeline_pass passes[NIR_PASS_PIPELINE_MAX_PASSES];
+
+   /** Stands in for passes that don't fit in passes[] */
+   nir_pass_pipeline_pass untracked;
+} nir_pass_pipeline;
+
+void nir_pass_pipeline_init(nir_pass_pipeline *pipeline);
+
+void nir_pass_pipeline_declare(nir_pass_pipeline *pipeline,
+                               const char *name,
+                               nir_pass_ir reads, nir_pass_ir writes,
+                               bool idempotent);
+
+void nir_pass_pipeline_invalidate(nir_pass_pipeline *pipeline,
+                                  nir_pass_ir writes);
+
+nir_pass_pipeline_pass *
+nir_pass_pipeline_begin_pass(nir_pass_pipeline *pipeline,
+                             const char *name, unsigned line);
+
+void nir_pass_pipeline_end_pass(nir_pass_pipeline *pipeline,
+                                nir_pass_pipeline_pass *pass,
+                                bool progress);
+
+void nir_pass_pipeline_print_stats(const nir_pass_pipeline *pipeline,
+                                   FILE *fp);
+
+/* Runs the pass through NIR_PASS unless the pipeline knows it has nothing
+ * to do.
+ */
+#define NIR_PIPELINE_PASS(progress, pipeline, nir, pass, ...) do {     \
+   nir_pass_pipeline_pass *_pipeline_pass =                            \
+      nir_pass_pipeline_begin_pass(pipeline, #pass, __LINE__);         \
+   if (_pipeline_pass) {                                               \
+      bool _pipeline_progress = false;                                 \
+      NIR_PASS(_pipeline_progress, nir, pass, ##__VA_ARGS__);          \
+      nir_pass_pipeline_end_pass(pipeline, _pipeline_pass,             \
+                                 _pipeline_progress);                  \
+      if (_pipeline_progress)                                          \
+         progress = true;                                              \
+   }                                                                   \
+} while (0)
+
+/* Like NIR_PIPELINE_PASS, for passes whose progress shouldn't keep the loop
+ * going.  The pipeline still needs to know about it.
+ */
+#define NIR_PIPELINE_PASS_V(pipeline, nir, pass, ...) do {             \
+   bool _pipeline_unused = false;                                      \
+   NIR_PIPELINE_PASS(_pipeline_unused, pipeline, nir, pass,            \
+                     ##__VA_ARGS__);                                   \
+   (void)_pipeline_unused;                                             \
+} while (0)
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* NIR_PASS_PIPELINE_H */
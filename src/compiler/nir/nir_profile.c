@@ -0,0 +1,308 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+
+#include "c11/threads.h"
+#include "nir.h"
+#include "util/debug.h"
+#include "util/hash_table.h"
+#include "util/os_time.h"
+#include "util/simple_mtx.h"
+#include "util/u_dynarray.h"
+
+/*
+ * Per-pass profiling for NIR_PASS, see the comment above nir_pass_profile in
+ * nir.h.
+ *
+ * Each pass name gets one entry holding a nir_pass_profile per stage.  The
+ * entries live in a dynarray, in the order the passes were first seen, and
+ * a hash table maps pass names to their index.  Pass names are compared as
+ * strings since the same pass is run from many translation units.
+ *
+ * Passes run from other passes are found through a per-thread pointer to
+ * the innermost active scope, which they charge their time to.
+ */
+
+struct profile_entry {
+   nir_pass_profile stages[MESA_ALL_SHADER_STAGES];
+};
+
+int nir_profile_state = -1;
+
+static simple_mtx_t profile_mutex = _SIMPLE_MTX_INITIALIZER_NP;
+static struct hash_table *profile_ht;
+static struct util_dynarray profile_entries;
+static bool profile_atexit_registered;
+
+static once_flag profile_tsd_once = ONCE_FLAG_INIT;
+static tss_t profile_scope_tsd;
+
+static void
+profile_tsd_init(void)
+{
+   tss_create(&profile_scope_tsd, NULL);
+}
+
+static void
+profile_atexit(void)
+{
+   const char *filename = getenv("NIR_PROFILE_FILE");
+   FILE *fp = filename ? fopen(filename, "w") : stderr;
+
+   if (!fp) {
+      fprintf(stderr, "NIR_PROFILE: failed to open %s\n", filename);
+      return;
+   }
+
+   nir_profile_print_json(fp);
+
+   if (fp != stderr)
+      fclose(fp);
+}
+
+/**
+ * Reads NIR_PROFILE the first time profiling state is needed and returns
+ * whether profiling is enabled.
+ */
+bool
+nir_profile_init(void)
+{
+   simple_mtx_lock(&profile_mutex);
+   if (nir_profile_state < 0) {
+      nir_profile_state = env_var_as_boolean("NIR_PROFILE", false);
+      if (nir_profile_state && !profile_atexit_registered) {
+         atexit(profile_atexit);
+         profile_atexit_registered = true;
+      }
+   }
+   simple_mtx_unlock(&profile_mutex);
+
+   return nir_profile_state > 0;
+}
+
+/**
+ * Turns profiling on or off regardless of NIR_PROFILE.
+ *
+ * Unlike the environment variable, this does not print anything at exit;
+ * the caller is expected to use nir_profile_get_passes() or
+ * nir_profile_print_json() itself.
+ */
+void
+nir_profile_enable(bool enable)
+{
+   simple_mtx_lock(&profile_mutex);
+   nir_profile_state = enable;
+   simple_mtx_unlock(&profile_mutex);
+}
+
+static unsigned
+count_instrs(const nir_shader *shader)
+{
+   unsigned count = 0;
+
+   nir_foreach_function(function, shader) {
+      if (!function->impl)
+         continue;
+
+      nir_foreach_block(block, function->impl)
+         count += exec_list_length(&block->instr_list);
+   }
+
+   return count;
+}
+
+void
+nir_profile_begin_pass_slow(nir_profile_scope *scope,
+                            const nir_shader *shader)
+{
+   call_once(&profile_tsd_once, profile_tsd_init);
+
+   scope->parent = tss_get(profile_scope_tsd);
+   scope->child_ns = 0;
+   tss_set(profile_scope_tsd, scope);
+
+   scope->instrs = count_instrs(shader);
+   scope->start_ns = os_time_get_nano();
+}
+
+void
+nir_profile_end_pass_slow(const nir_profile_scope *scope,
+                          const char *pass, const nir_shader *shader,
+                          bool progress)
+{
+   int64_t time_ns = os_time_get_nano() - scope->start_ns;
+   unsigned instrs = count_instrs(shader);
+   gl_shader_stage stage = shader->info.stage;
+
+   assert(stage < MESA_ALL_SHADER_STAGES);
+
+   tss_set(profile_scope_tsd, scope->parent);
+   if (scope->parent)
+      scope->parent->child_ns += time_ns;
+
+   simple_mtx_lock(&profile_mutex);
+
+   if (!profile_ht) {
+      profile_ht = _mesa_hash_table_create(NULL, _mesa_hash_string,
+                                           _mesa_key_string_equal);
+      util_dynarray_init(&profile_entries, NULL);
+   }
+
+   struct hash_entry *he = _mesa_hash_table_search(profile_ht, pass);
+   unsigned idx;
+   if (he) {
+      idx = (uintptr_t)he->data;
+   } else {
+      idx = util_dynarray_num_elements(&profile_entries,
+                                       struct profile_entry);
+      struct profile_entry *entry =
+         util_dynarray_grow(&profile_entries, struct profile_entry, 1);
+      memset(entry, 0, sizeof(*entry));
+      for (unsigned s = 0; s < MESA_ALL_SHADER_STAGES; s++) {
+         entry->stages[s].pass = pass;
+         entry->stages[s].stage = s;
+      }
+      _mesa_hash_table_insert(profile_ht, pass, (void *)(uintptr_t)idx);
+   }
+
+   struct profile_entry *entry =
+      util_dynarray_element(&profile_entries, struct profile_entry, idx);
+   nir_pass_profile *prof = &entry->stages[stage];
+   prof->calls++;
+   prof->progress += progress;
+   prof->time_ns += time_ns;
+   prof->self_time_ns += time_ns - scope->child_ns;
+   prof->instrs_before += scope->instrs;
+   prof->instrs_after += instrs;
+
+   simple_mtx_unlock(&profile_mutex);
+}
+
+/**
+ * Copies up to \p max of the recorded (pass, stage) pairs into \p passes
+ * and returns the total number of pairs.  Only pairs that were run at least
+ * once are reported, in the order the passes were first run.
+ */
+unsigned
+nir_profile_get_passes(nir_pass_profile *passes, unsigned max)
+{
+   unsigned count = 0;
+
+   simple_mtx_lock(&profile_mutex);
+
+   if (profile_ht) {
+      util_dynarray_foreach(&profile_entries, struct profile_entry, entry) {
+         for (unsigned s = 0; s < MESA_ALL_SHADER_STAGES; s++) {
+            if (!entry->stages[s].calls)
+               continue;
+
+            if (count < max)
+               passes[count] = entry->stages[s];
+            count++;
+         }
+      }
+   }
+
+   simple_mtx_unlock(&profile_mutex);
+
+   return count;
+}
+
+/** Throws away everything recorded so far. */
+void
+nir_profile_reset(void)
+{
+   simple_mtx_lock(&profile_mutex);
+
+   if (profile_ht) {
+      _mesa_hash_table_destroy(profile_ht, NULL);
+      util_dynarray_fini(&profile_entries);
+      profile_ht = NULL;
+   }
+
+   simple_mtx_unlock(&profile_mutex);
+}
+
+static int
+compare_time(const void *_a, const void *_b)
+{
+   const nir_pass_profile *a = _a, *b = _b;
+
+   if (a->time_ns != b->time_ns)
+      return a->time_ns < b->time_ns ? 1 : -1;
+   return a->stage - b->stage;
+}
+
+/**
+ * Prints the recorded profile as a JSON object with one element of "passes"
+ * per (pass, stage) pair, most expensive first, plus the totals per stage.
+ * The stage totals add up the exclusive time of each pass, so that nested
+ * passes are only counted once.
+ */
+void
+nir_profile_print_json(FILE *fp)
+{
+   unsigned count = nir_profile_get_passes(NULL, 0);
+   nir_pass_profile *passes = malloc(MAX2(count, 1) * sizeof(*passes));
+   if (!passes)
+      return;
+
+   count = nir_profile_get_passes(passes, count);
+   qsort(passes, count, sizeof(*passes), compare_time);
+
+   uint64_t stage_time_ns[MESA_ALL_SHADER_STAGES] = { 0 };
+   uint64_t stage_calls[MESA_ALL_SHADER_STAGES] = { 0 };
+
+   fprintf(fp, "{\n  \"passes\": [");
+   for (unsigned i = 0; i < count; i++) {
+      const nir_pass_profile *p = &passes[i];
+
+      fprintf(fp, "%s\n    { \"pass\": \"%s\", \"stage\": \"%s\", "
+                  "\"calls\": %"PRIu64", \"progress\": %"PRIu64", "
+                  "\"time_ns\": %"PRIu64", \"self_time_ns\": %"PRIu64", "
+                  "\"instrs_before\": %"PRIu64", \"instrs_after\": %"PRIu64" }",
+              i ? "," : "", p->pass, _mesa_shader_stage_to_abbrev(p->stage),
+              p->calls, p->progress, p->time_ns, p->self_time_ns,
+              p->instrs_before, p->instrs_after);
+
+      stage_time_ns[p->stage] += p->self_time_ns;
+      stage_calls[p->stage] += p->calls;
+   }
+   fprintf(fp, "\n  ],\n  \"stages\": {");
+
+   bool first = true;
+   for (unsigned s = 0; s < MESA_ALL_SHADER_STAGES; s++) {
+      if (!stage_calls[s])
+         continue;
+
+      fprintf(fp, "%s\n    \"%s\": { \"calls\": %"PRIu64", "
+                  "\"time_ns\": %"PRIu64" }",
+              first ? "" : ",", _mesa_shader_stage_to_abbrev(s),
+              stage_calls[s], stage_time_ns[s]);
+      first = false;
+   }
+   fprintf(fp, "\n  }\n}\n");
+
+   free(passes);
+}
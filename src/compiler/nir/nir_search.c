@@ -621,11 +621,118 @@ UNUSED static void dump_value(const nir_search_value *val)
       fprintf(stderr, "@%d", val->bit_size);
 }
 
+static void
+algebraic_worklist_push(nir_instr_worklist *worklist, nir_instr *instr)
+{
+   /* pass_flags is set while the instruction is in the worklist, so that it
+    * isn't added again each time one of its sources is rewritten.
+    */
+   if (instr->type == nir_instr_type_alu && !instr->pass_flags) {
+      instr->pass_flags = 1;
+      nir_instr_worklist_push_tail(worklist, instr);
+   }
+}
+
+static void
+grow_states(struct util_dynarray *states, unsigned ssa_alloc)
+{
+   unsigned num_states = util_dynarray_num_elements(states, uint16_t);
+   if (ssa_alloc > num_states) {
+      uint16_t *new_states =
+         util_dynarray_grow(states, uint16_t, ssa_alloc - num_states);
+      memset(new_states, 0, (ssa_alloc - num_states) * sizeof(*new_states));
+   }
+}
+
+/* Computes the automaton state of an instruction from the states of its
+ * sources and returns whether it changed.
+ */
+static bool
+nir_algebraic_automaton(nir_instr *instr, struct util_dynarray *states,
+                        const struct per_op_table *pass_op_table)
+{
+   uint16_t *state_array = states->data;
+
+   switch (instr->type) {
+   case nir_instr_type_alu: {
+      nir_alu_instr *alu = nir_instr_as_alu(instr);
+      nir_op op = alu->op;
+      uint16_t search_op = nir_search_op_for_nir_op(op);
+      const struct per_op_table *tbl = &pass_op_table[search_op];
+      if (tbl->num_filtered_states == 0)
+         return false;
+
+      /* Calculate the index into the transition table. Note the index
+       * calculated must match the iteration order of Python's
+       * itertools.product(), which was used to emit the transition
+       * table.
+       */
+      uint16_t index = 0;
+      for (unsigned i = 0; i < nir_op_infos[op].num_inputs; i++) {
+         index *= tbl->num_filtered_states;
+         index += tbl->filter[state_array[alu->src[i].src.ssa->index]];
+      }
+
+      uint16_t *state = &state_array[alu->dest.dest.ssa.index];
+      if (*state == tbl->table[index])
+         return false;
+
+      *state = tbl->table[index];
+      return true;
+   }
+
+   case nir_instr_type_load_const: {
+      nir_load_const_instr *load_const = nir_instr_as_load_const(instr);
+      uint16_t *state = &state_array[load_const->def.index];
+      if (*state == CONST_STATE)
+         return false;
+
+      *state = CONST_STATE;
+      return true;
+   }
+
+   default:
+      return false;
+   }
+}
+
+/* Propagates the automaton state of a rewritten value to its users, and on
+ * through the users whose state changed.  Those users may now match
+ * different transforms, so they are queued for another look.
+ */
+static void
+nir_algebraic_update_automaton(nir_ssa_def *def,
+                               nir_instr_worklist *algebraic_worklist,
+                               struct util_dynarray *states,
+                               const struct per_op_table *pass_op_table)
+{
+   nir_instr_worklist *automaton_worklist = nir_instr_worklist_create();
+
+   nir_foreach_use(use_src, def)
+      nir_instr_worklist_push_tail(automaton_worklist, use_src->parent_instr);
+
+   nir_foreach_instr_in_worklist(instr, automaton_worklist) {
+      if (!nir_algebraic_automaton(instr, states, pass_op_table))
+         continue;
+
+      algebraic_worklist_push(algebraic_worklist, instr);
+
+      nir_ssa_def *dest = nir_instr_ssa_def(instr);
+      nir_foreach_use(use_src, dest)
+         nir_instr_worklist_push_tail(automaton_worklist, use_src->parent_instr);
+   }
+
+   nir_instr_worklist_destroy(automaton_worklist);
+}
+
 nir_ssa_def *
 nir_replace_instr(nir_builder *build, nir_alu_instr *instr,
                   struct hash_table *range_ht,
+                  struct util_dynarray *states,
+                  const struct per_op_table *pass_op_table,
                   const nir_search_expression *search,
-                  const nir_search_value *replace)
+                  const nir_search_value *replace,
+                  nir_instr_worklist *algebraic_worklist)
 {
    uint8_t swizzle[NIR_MAX_VEC_COMPONENTS] = { 0 };
 
@@ -672,6 +779,9 @@ nir_replace_instr(nir_builder *build, nir_alu_instr *instr,
 
    build->cursor = nir_before_instr(&instr->instr);
 
+   /* Everything construct_value() builds goes right before instr. */
+   nir_instr *prev = nir_instr_prev(&instr->instr);
+
    nir_alu_src val = construct_value(build, replace,
                                      instr->dest.dest.ssa.num_components,
                                      instr->dest.dest.ssa.bit_size,
@@ -682,98 +792,88 @@ nir_replace_instr(nir_builder *build, nir_alu_instr *instr,
     */
    nir_ssa_def *ssa_val =
       nir_mov_alu(build, val, instr->dest.dest.ssa.num_components);
+
+   /* Compute the automaton state of the new instructions, which come in
+    * order, and give them a chance to be optimized themselves.
+    */
+   grow_states(states, build->impl->ssa_alloc);
+   nir_instr *new_instr = prev ? nir_instr_next(prev) :
+                                 nir_block_first_instr(instr->instr.block);
+   for (; new_instr != &instr->instr; new_instr = nir_instr_next(new_instr)) {
+      nir_algebraic_automaton(new_instr, states, pass_op_table);
+      new_instr->pass_flags = 0;
+      algebraic_worklist_push(algebraic_worklist, new_instr);
+   }
+
    nir_ssa_def_rewrite_uses(&instr->dest.dest.ssa, nir_src_for_ssa(ssa_val));
+   nir_algebraic_update_automaton(ssa_val, algebraic_worklist,
+                                  states, pass_op_table);
+
+   /* The sources of instr lose a use, which conditions such as
+    * is_used_once care about.
+    */
+   for (unsigned i = 0; i < nir_op_infos[instr->op].num_inputs; i++) {
+      algebraic_worklist_push(algebraic_worklist,
+                              instr->src[i].src.ssa->parent_instr);
+   }
 
    /* We know this one has no more uses because we just rewrote them all,
     * so we can remove it.  The rest of the matched expression, however, we
     * don't know so much about.  We'll just let dead code clean them up.
+    * The instruction may still be in the worklist, so it can't be freed.
     */
    nir_instr_remove(&instr->instr);
 
    return ssa_val;
 }
 
-static void
-nir_algebraic_automaton(nir_block *block, uint16_t *states,
-                        const struct per_op_table *pass_op_table)
-{
-   nir_foreach_instr(instr, block) {
-      switch (instr->type) {
-      case nir_instr_type_alu: {
-         nir_alu_instr *alu = nir_instr_as_alu(instr);
-         nir_op op = alu->op;
-         uint16_t search_op = nir_search_op_for_nir_op(op);
-         const struct per_op_table *tbl = &pass_op_table[search_op];
-         if (tbl->num_filtered_states == 0)
-            continue;
-
-         /* Calculate the index into the transition table. Note the index
-          * calculated must match the iteration order of Python's
-          * itertools.product(), which was used to emit the transition
-          * table.
-          */
-         uint16_t index = 0;
-         for (unsigned i = 0; i < nir_op_infos[op].num_inputs; i++) {
-            index *= tbl->num_filtered_states;
-            index += tbl->filter[states[alu->src[i].src.ssa->index]];
-         }
-         states[alu->dest.dest.ssa.index] = tbl->table[index];
-         break;
-      }
-
-      case nir_instr_type_load_const: {
-         nir_load_const_instr *load_const = nir_instr_as_load_const(instr);
-         states[load_const->def.index] = CONST_STATE;
-         break;
-      }
-
-      default:
-         break;
-      }
-   }
-}
-
 static bool
-nir_algebraic_block(nir_builder *build, nir_block *block,
+nir_algebraic_instr(nir_builder *build, nir_instr *instr,
                     struct hash_table *range_ht,
                     const bool *condition_flags,
                     const struct transform **transforms,
                     const uint16_t *transform_counts,
-                    const uint16_t *states)
+                    struct util_dynarray *states,
+                    const struct per_op_table *pass_op_table,
+                    nir_instr_worklist *worklist)
 {
-   bool progress = false;
-   const unsigned execution_mode = build->shader->info.float_controls_execution_mode;
-
-   nir_foreach_instr_reverse_safe(instr, block) {
-      if (instr->type != nir_instr_type_alu)
-         continue;
-
-      nir_alu_instr *alu = nir_instr_as_alu(instr);
-      if (!alu->dest.dest.is_ssa)
-         continue;
+   nir_alu_instr *alu = nir_instr_as_alu(instr);
+   if (!alu->dest.dest.is_ssa)
+      return false;
 
-      unsigned bit_size = alu->dest.dest.ssa.bit_size;
-      const bool ignore_inexact =
-         nir_is_float_control_signed_zero_inf_nan_preserve(execution_mode, bit_size) ||
-         nir_is_denorm_flush_to_zero(execution_mode, bit_size);
-
-      int xform_idx = states[alu->dest.dest.ssa.index];
-      for (uint16_t i = 0; i < transform_counts[xform_idx]; i++) {
-         const struct transform *xform = &transforms[xform_idx][i];
-         if (condition_flags[xform->condition_offset] &&
-             !(xform->search->inexact && ignore_inexact) &&
-             nir_replace_instr(build, alu, range_ht,
-                               xform->search, xform->replace)) {
-            _mesa_hash_table_clear(range_ht, NULL);
-            progress = true;
-            break;
-         }
+   const unsigned execution_mode =
+      build->shader->info.float_controls_execution_mode;
+   unsigned bit_size = alu->dest.dest.ssa.bit_size;
+   const bool ignore_inexact =
+      nir_is_float_control_signed_zero_inf_nan_preserve(execution_mode, bit_size) ||
+      nir_is_denorm_flush_to_zero(execution_mode, bit_size);
+
+   int xform_idx = *util_dynarray_element(states, uint16_t,
+                                          alu->dest.dest.ssa.index);
+   for (uint16_t i = 0; i < transform_counts[xform_idx]; i++) {
+      const struct transform *xform = &transforms[xform_idx][i];
+      if (condition_flags[xform->condition_offset] &&
+          !(xform->search->inexact && ignore_inexact) &&
+          nir_replace_instr(build, alu, range_ht, states, pass_op_table,
+                            xform->search, xform->replace, worklist)) {
+         _mesa_hash_table_clear(range_ht, NULL);
+         return true;
       }
    }
 
-   return progress;
+   return false;
 }
 
+/**
+ * Runs the transforms of an algebraic pass until none of them applies.
+ *
+ * Every ALU instruction is looked at once, bottom-up.  After a rewrite,
+ * only the instructions it can affect are looked at again: the newly built
+ * ones, the users of the replaced value whose automaton state changed, and
+ * the sources of the removed instruction.  A single call therefore leaves
+ * nothing for the next call to do unless something else changed the
+ * shader in between.
+ */
 bool
 nir_algebraic_impl(nir_function_impl *impl,
                    const bool *condition_flags,
@@ -790,22 +890,45 @@ nir_algebraic_impl(nir_function_impl *impl,
     * state 0 is the default state, which means we don't have to visit
     * anything other than constants and ALU instructions.
     */
-   uint16_t *states = calloc(impl->ssa_alloc, sizeof(*states));
+   struct util_dynarray states;
+   util_dynarray_init(&states, NULL);
+   grow_states(&states, impl->ssa_alloc);
 
    struct hash_table *range_ht = _mesa_pointer_hash_table_create(NULL);
 
+   nir_instr_worklist *worklist = nir_instr_worklist_create();
+
    nir_foreach_block(block, impl) {
-      nir_algebraic_automaton(block, states, pass_op_table);
+      nir_foreach_instr(instr, block) {
+         instr->pass_flags = 0;
+         nir_algebraic_automaton(instr, &states, pass_op_table);
+      }
    }
 
+   /* Pop the last instruction first, so that whole expression trees are
+    * matched before their leaves are.
+    */
    nir_foreach_block_reverse(block, impl) {
-      progress |= nir_algebraic_block(&build, block, range_ht, condition_flags,
-                                      transforms, transform_counts,
-                                      states);
+      nir_foreach_instr_reverse(instr, block)
+         algebraic_worklist_push(worklist, instr);
+   }
+
+   nir_foreach_instr_in_worklist(instr, worklist) {
+      instr->pass_flags = 0;
+
+      /* Skip instructions that were replaced while in the worklist. */
+      if (instr->node.next == NULL)
+         continue;
+
+      progress |= nir_algebraic_instr(&build, instr, range_ht,
+                                      condition_flags, transforms,
+                                      transform_counts, &states,
+                                      pass_op_table, worklist);
    }
 
+   nir_instr_worklist_destroy(worklist);
    ralloc_free(range_ht);
-   free(states);
+   util_dynarray_fini(&states);
 
    if (progress) {
       nir_metadata_preserve(impl, nir_metadata_block_index |
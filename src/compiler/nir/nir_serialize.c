@@ -24,9 +24,13 @@
 #include "nir_serialize.h"
 #include "nir_control_flow.h"
 #include "util/u_dynarray.h"
+#include "util/u_math.h"
 
 #define MAX_OBJECT_IDS (1 << 30)
 
+/* Bump this whenever the format below changes. */
+#define NIR_SERIALIZE_VERSION 2
+
 typedef struct {
    size_t blob_offset;
    nir_ssa_def *src;
@@ -85,12 +89,6 @@ write_lookup_object(write_ctx *ctx, const void *obj)
    return (uint32_t)(uintptr_t) entry->data;
 }
 
-static void
-write_object(write_ctx *ctx, const void *obj)
-{
-   blob_write_uint32(ctx->blob, write_lookup_object(ctx, obj));
-}
-
 static void
 read_add_object(read_ctx *ctx, void *obj)
 {
@@ -105,17 +103,11 @@ read_lookup_object(read_ctx *ctx, uint32_t idx)
    return ctx->idx_table[idx];
 }
 
-static void *
-read_object(read_ctx *ctx)
-{
-   return read_lookup_object(ctx, blob_read_uint32(ctx->blob));
-}
-
 static void
 write_constant(write_ctx *ctx, const nir_constant *c)
 {
    blob_write_bytes(ctx->blob, c->values, sizeof(c->values));
-   blob_write_uint32(ctx->blob, c->num_elements);
+   blob_write_varint(ctx->blob, c->num_elements);
    for (unsigned i = 0; i < c->num_elements; i++)
       write_constant(ctx, c->elements[i]);
 }
@@ -126,7 +118,7 @@ read_constant(read_ctx *ctx, nir_variable *nvar)
    nir_constant *c = ralloc(nvar, nir_constant);
 
    blob_copy_bytes(ctx->blob, (uint8_t *)c->values, sizeof(c->values));
-   c->num_elements = blob_read_uint32(ctx->blob);
+   c->num_elements = blob_read_varint(ctx->blob);
    c->elements = ralloc_array(nvar, nir_constant *, c->num_elements);
    for (unsigned i = 0; i < c->num_elements; i++)
       c->elements[i] = read_constant(ctx, nvar);
@@ -232,7 +224,7 @@ read_variable(read_ctx *ctx)
 static void
 write_var_list(write_ctx *ctx, const struct exec_list *src)
 {
-   blob_write_uint32(ctx->blob, exec_list_length(src));
+   blob_write_varint(ctx->blob, exec_list_length(src));
    foreach_list_typed(nir_variable, var, node, src) {
       write_variable(ctx, var);
    }
@@ -242,7 +234,7 @@ static void
 read_var_list(read_ctx *ctx, struct exec_list *dst)
 {
    exec_list_make_empty(dst);
-   unsigned num_vars = blob_read_uint32(ctx->blob);
+   unsigned num_vars = blob_read_varint(ctx->blob);
    for (unsigned i = 0; i < num_vars; i++) {
       nir_variable *var = read_variable(ctx);
       exec_list_push_tail(dst, &var->node);
@@ -253,11 +245,11 @@ static void
 write_register(write_ctx *ctx, const nir_register *reg)
 {
    write_add_object(ctx, reg);
-   blob_write_uint32(ctx->blob, reg->num_components);
-   blob_write_uint32(ctx->blob, reg->bit_size);
-   blob_write_uint32(ctx->blob, reg->num_array_elems);
-   blob_write_uint32(ctx->blob, reg->index);
-   blob_write_uint32(ctx->blob, !!(reg->name));
+   blob_write_varint(ctx->blob, reg->num_components);
+   blob_write_varint(ctx->blob, reg->bit_size);
+   blob_write_varint(ctx->blob, reg->num_array_elems);
+   blob_write_varint(ctx->blob, reg->index);
+   blob_write_uint8(ctx->blob, !!(reg->name));
    if (reg->name)
       blob_write_string(ctx->blob, reg->name);
 }
@@ -267,11 +259,11 @@ read_register(read_ctx *ctx)
 {
    nir_register *reg = ralloc(ctx->nir, nir_register);
    read_add_object(ctx, reg);
-   reg->num_components = blob_read_uint32(ctx->blob);
-   reg->bit_size = blob_read_uint32(ctx->blob);
-   reg->num_array_elems = blob_read_uint32(ctx->blob);
-   reg->index = blob_read_uint32(ctx->blob);
-   bool has_name = blob_read_uint32(ctx->blob);
+   reg->num_components = blob_read_varint(ctx->blob);
+   reg->bit_size = blob_read_varint(ctx->blob);
+   reg->num_array_elems = blob_read_varint(ctx->blob);
+   reg->index = blob_read_varint(ctx->blob);
+   bool has_name = blob_read_uint8(ctx->blob);
    if (has_name) {
       const char *name = blob_read_string(ctx->blob);
       reg->name = ralloc_strdup(reg, name);
@@ -289,7 +281,7 @@ read_register(read_ctx *ctx)
 static void
 write_reg_list(write_ctx *ctx, const struct exec_list *src)
 {
-   blob_write_uint32(ctx->blob, exec_list_length(src));
+   blob_write_varint(ctx->blob, exec_list_length(src));
    foreach_list_typed(nir_register, reg, node, src)
       write_register(ctx, reg);
 }
@@ -298,32 +290,45 @@ static void
 read_reg_list(read_ctx *ctx, struct exec_list *dst)
 {
    exec_list_make_empty(dst);
-   unsigned num_regs = blob_read_uint32(ctx->blob);
+   unsigned num_regs = blob_read_varint(ctx->blob);
    for (unsigned i = 0; i < num_regs; i++) {
       nir_register *reg = read_register(ctx);
       exec_list_push_tail(dst, &reg->node);
    }
 }
 
+/* Sources and register destinations refer to an object by its distance to
+ * the most recently added one, which is small for almost all uses since
+ * values tend to be consumed soon after they are defined.
+ */
+static void
+write_object_delta(write_ctx *ctx, const void *obj)
+{
+   blob_write_varint(ctx->blob, ctx->next_idx - write_lookup_object(ctx, obj));
+}
+
+static void *
+read_object_delta(read_ctx *ctx)
+{
+   uint32_t delta = blob_read_varint(ctx->blob);
+   return read_lookup_object(ctx, ctx->next_idx - delta);
+}
+
 static void
 write_src(write_ctx *ctx, const nir_src *src)
 {
    /* Since sources are very frequent, we try to save some space when storing
     * them. In particular, we store whether the source is a register and
-    * whether the register has an indirect index in the low two bits. We can
-    * assume that the high two bits of the index are zero, since otherwise our
-    * address space would've been exhausted allocating the remap table!
+    * whether the register has an indirect index in the low two bits of the
+    * object delta.
     */
    if (src->is_ssa) {
-      uint32_t idx = write_lookup_object(ctx, src->ssa) << 2;
-      idx |= 1;
-      blob_write_uint32(ctx->blob, idx);
+      uint32_t delta = ctx->next_idx - write_lookup_object(ctx, src->ssa);
+      blob_write_varint(ctx->blob, (delta << 2) | 1);
    } else {
-      uint32_t idx = write_lookup_object(ctx, src->reg.reg) << 2;
-      if (src->reg.indirect)
-         idx |= 2;
-      blob_write_uint32(ctx->blob, idx);
-      blob_write_uint32(ctx->blob, src->reg.base_offset);
+      uint32_t delta = ctx->next_idx - write_lookup_object(ctx, src->reg.reg);
+      blob_write_varint(ctx->blob, (delta << 2) | (!!src->reg.indirect << 1));
+      blob_write_varint(ctx->blob, src->reg.base_offset);
       if (src->reg.indirect) {
          write_src(ctx, src->reg.indirect);
       }
@@ -333,15 +338,15 @@ write_src(write_ctx *ctx, const nir_src *src)
 static void
 read_src(read_ctx *ctx, nir_src *src, void *mem_ctx)
 {
-   uint32_t val = blob_read_uint32(ctx->blob);
-   uint32_t idx = val >> 2;
+   uint32_t val = blob_read_varint(ctx->blob);
+   uint32_t idx = ctx->next_idx - (val >> 2);
    src->is_ssa = val & 0x1;
    if (src->is_ssa) {
       src->ssa = read_lookup_object(ctx, idx);
    } else {
       bool is_indirect = val & 0x2;
       src->reg.reg = read_lookup_object(ctx, idx);
-      src->reg.base_offset = blob_read_uint32(ctx->blob);
+      src->reg.base_offset = blob_read_varint(ctx->blob);
       if (is_indirect) {
          src->reg.indirect = ralloc(mem_ctx, nir_src);
          read_src(ctx, src->reg.indirect, mem_ctx);
@@ -351,115 +356,346 @@ read_src(read_ctx *ctx, nir_src *src, void *mem_ctx)
    }
 }
 
+/* Destinations are packed into the top byte of the instruction header. */
+union packed_dest {
+   uint8_t u8;
+   struct {
+      uint8_t is_ssa:1;
+      uint8_t has_name:1;
+      uint8_t num_components:3;
+      uint8_t bit_size:3;
+   } ssa;
+   struct {
+      uint8_t is_ssa:1;
+      uint8_t is_indirect:1;
+      uint8_t _pad:6;
+   } reg;
+};
+
+/* Bit sizes are powers of two from 1 to 64, stored as their log2. */
+static unsigned
+encode_bit_size_3bits(uint8_t bit_size)
+{
+   assert(util_is_power_of_two_nonzero(bit_size) && bit_size <= 64);
+   return util_logbase2(bit_size);
+}
+
+static uint8_t
+decode_bit_size_3bits(unsigned bit_size)
+{
+   return 1 << bit_size;
+}
+
+/* Each instruction starts with a 32-bit header holding its type and the
+ * fields of the common cases, so that a typical ALU or intrinsic instruction
+ * takes four bytes plus a byte or so per source. The header is written
+ * unaligned to avoid padding between variable-length fields.
+ */
+union packed_instr {
+   uint32_t u32;
+   struct {
+      unsigned instr_type:4;
+      unsigned _pad:20;
+      unsigned dest:8;
+   } any;
+   struct {
+      unsigned instr_type:4;
+      unsigned exact:1;
+      unsigned no_signed_wrap:1;
+      unsigned no_unsigned_wrap:1;
+      unsigned saturate:1;
+      unsigned writemask:4;
+      /* Whether any source has a swizzle other than .xyzw. */
+      unsigned has_swizzles:1;
+      /* Whether any source has the negate or abs modifier. */
+      unsigned has_modifiers:1;
+      unsigned op:9;
+      unsigned _pad:1;
+      unsigned dest:8;
+   } alu;
+   struct {
+      unsigned instr_type:4;
+      unsigned deref_type:3;
+      unsigned mode:10;
+      /* Whether the type can be computed from the variable or parent. */
+      unsigned type_derived:1;
+      /* Whether the mode is that of the variable or parent. */
+      unsigned mode_derived:1;
+      unsigned _pad:5;
+      unsigned dest:8;
+   } deref;
+   struct {
+      unsigned instr_type:4;
+      unsigned intrinsic:9;
+      unsigned num_components:3;
+      unsigned _pad:8;
+      unsigned dest:8;
+   } intrinsic;
+   struct {
+      unsigned instr_type:4;
+      unsigned num_components:3;
+      unsigned bit_size:3;
+      /* One of the load_const_packing values. */
+      unsigned packing:2;
+      unsigned data:20;
+   } load_const;
+   struct {
+      unsigned instr_type:4;
+      unsigned num_components:3;
+      unsigned bit_size:3;
+      unsigned _pad:22;
+   } undef;
+   struct {
+      unsigned instr_type:4;
+      unsigned num_srcs:4;
+      unsigned op:4;
+      unsigned has_tg4_offsets:1;
+      unsigned _pad:11;
+      unsigned dest:8;
+   } tex;
+   struct {
+      unsigned instr_type:4;
+      unsigned _pad:20;
+      unsigned dest:8;
+   } phi;
+   struct {
+      unsigned instr_type:4;
+      unsigned type:2;
+      unsigned _pad:26;
+   } jump;
+};
+
 static void
-write_dest(write_ctx *ctx, const nir_dest *dst)
+write_instr_header(write_ctx *ctx, union packed_instr header)
+{
+   blob_write_bytes(ctx->blob, &header.u32, sizeof(header.u32));
+}
+
+static union packed_instr
+read_instr_header(read_ctx *ctx)
+{
+   union packed_instr header;
+   header.u32 = 0;
+   blob_copy_bytes(ctx->blob, &header.u32, sizeof(header.u32));
+   return header;
+}
+
+static uint8_t
+pack_dest(const nir_dest *dst)
 {
-   uint32_t val = dst->is_ssa;
+   union packed_dest dest;
+   dest.u8 = 0;
+
+   dest.ssa.is_ssa = dst->is_ssa;
    if (dst->is_ssa) {
-      val |= !!(dst->ssa.name) << 1;
-      val |= dst->ssa.num_components << 2;
-      val |= dst->ssa.bit_size << 5;
+      dest.ssa.has_name = !!(dst->ssa.name);
+      dest.ssa.num_components = dst->ssa.num_components;
+      dest.ssa.bit_size = encode_bit_size_3bits(dst->ssa.bit_size);
    } else {
-      val |= !!(dst->reg.indirect) << 1;
+      dest.reg.is_indirect = !!(dst->reg.indirect);
    }
-   blob_write_uint32(ctx->blob, val);
+
+   return dest.u8;
+}
+
+/* Writes the part of the destination that doesn't fit in the header. */
+static void
+write_dest(write_ctx *ctx, const nir_dest *dst)
+{
    if (dst->is_ssa) {
       write_add_object(ctx, &dst->ssa);
       if (dst->ssa.name)
          blob_write_string(ctx->blob, dst->ssa.name);
    } else {
-      blob_write_uint32(ctx->blob, write_lookup_object(ctx, dst->reg.reg));
-      blob_write_uint32(ctx->blob, dst->reg.base_offset);
+      write_object_delta(ctx, dst->reg.reg);
+      blob_write_varint(ctx->blob, dst->reg.base_offset);
       if (dst->reg.indirect)
          write_src(ctx, dst->reg.indirect);
    }
 }
 
 static void
-read_dest(read_ctx *ctx, nir_dest *dst, nir_instr *instr)
-{
-   uint32_t val = blob_read_uint32(ctx->blob);
-   bool is_ssa = val & 0x1;
-   if (is_ssa) {
-      bool has_name = val & 0x2;
-      unsigned num_components = (val >> 2) & 0x7;
-      unsigned bit_size = val >> 5;
-      char *name = has_name ? blob_read_string(ctx->blob) : NULL;
-      nir_ssa_dest_init(instr, dst, num_components, bit_size, name);
+read_dest(read_ctx *ctx, nir_dest *dst, nir_instr *instr, uint8_t packed)
+{
+   union packed_dest dest;
+   dest.u8 = packed;
+
+   if (dest.ssa.is_ssa) {
+      unsigned bit_size = decode_bit_size_3bits(dest.ssa.bit_size);
+      char *name = dest.ssa.has_name ? blob_read_string(ctx->blob) : NULL;
+      nir_ssa_dest_init(instr, dst, dest.ssa.num_components, bit_size, name);
       read_add_object(ctx, &dst->ssa);
    } else {
-      bool is_indirect = val & 0x2;
-      dst->reg.reg = read_object(ctx);
-      dst->reg.base_offset = blob_read_uint32(ctx->blob);
-      if (is_indirect) {
+      dst->reg.reg = read_object_delta(ctx);
+      dst->reg.base_offset = blob_read_varint(ctx->blob);
+      if (dest.reg.is_indirect) {
          dst->reg.indirect = ralloc(instr, nir_src);
          read_src(ctx, dst->reg.indirect, instr);
       }
    }
 }
 
+/* Only the channels actually read by the instruction matter; the builder
+ * fills the others with whatever it likes.
+ */
+static bool
+alu_src_has_swizzle(const nir_alu_instr *alu, unsigned src)
+{
+   for (unsigned i = 0; i < nir_ssa_alu_instr_src_components(alu, src); i++) {
+      if (alu->src[src].swizzle[i] != i)
+         return true;
+   }
+   return false;
+}
+
 static void
 write_alu(write_ctx *ctx, const nir_alu_instr *alu)
 {
-   blob_write_uint32(ctx->blob, alu->op);
-   uint32_t flags = alu->exact;
-   flags |= alu->no_signed_wrap << 1;
-   flags |= alu->no_unsigned_wrap << 2;
-   flags |= alu->dest.saturate << 3;
-   flags |= alu->dest.write_mask << 4;
-   blob_write_uint32(ctx->blob, flags);
+   STATIC_ASSERT(nir_num_opcodes <= (1 << 9));
+   unsigned num_srcs = nir_op_infos[alu->op].num_inputs;
+   union packed_instr header;
+   header.u32 = 0;
+
+   header.alu.instr_type = alu->instr.type;
+   header.alu.exact = alu->exact;
+   header.alu.no_signed_wrap = alu->no_signed_wrap;
+   header.alu.no_unsigned_wrap = alu->no_unsigned_wrap;
+   header.alu.saturate = alu->dest.saturate;
+   header.alu.writemask = alu->dest.write_mask;
+   header.alu.op = alu->op;
+   header.alu.dest = pack_dest(&alu->dest.dest);
+
+   for (unsigned i = 0; i < num_srcs; i++) {
+      if (alu_src_has_swizzle(alu, i))
+         header.alu.has_swizzles = 1;
+      if (alu->src[i].negate || alu->src[i].abs)
+         header.alu.has_modifiers = 1;
+   }
 
+   write_instr_header(ctx, header);
    write_dest(ctx, &alu->dest.dest);
 
-   for (unsigned i = 0; i < nir_op_infos[alu->op].num_inputs; i++) {
+   for (unsigned i = 0; i < num_srcs; i++) {
       write_src(ctx, &alu->src[i].src);
-      flags = alu->src[i].negate;
-      flags |= alu->src[i].abs << 1;
-      for (unsigned j = 0; j < 4; j++)
-         flags |= alu->src[i].swizzle[j] << (2 + 2 * j);
-      blob_write_uint32(ctx->blob, flags);
+
+      if (header.alu.has_swizzles) {
+         uint8_t swizzle = 0;
+         for (unsigned j = 0; j < NIR_MAX_VEC_COMPONENTS; j++)
+            swizzle |= alu->src[i].swizzle[j] << (2 * j);
+         blob_write_uint8(ctx->blob, swizzle);
+      }
+
+      if (header.alu.has_modifiers)
+         blob_write_uint8(ctx->blob, alu->src[i].negate | alu->src[i].abs << 1);
    }
 }
 
 static nir_alu_instr *
-read_alu(read_ctx *ctx)
+read_alu(read_ctx *ctx, union packed_instr header)
 {
-   nir_op op = blob_read_uint32(ctx->blob);
+   nir_op op = header.alu.op;
    nir_alu_instr *alu = nir_alu_instr_create(ctx->nir, op);
 
-   uint32_t flags = blob_read_uint32(ctx->blob);
-   alu->exact = flags & 1;
-   alu->no_signed_wrap = flags & 2;
-   alu->no_unsigned_wrap = flags & 4;
-   alu->dest.saturate = flags & 8;
-   alu->dest.write_mask = flags >> 4;
+   alu->exact = header.alu.exact;
+   alu->no_signed_wrap = header.alu.no_signed_wrap;
+   alu->no_unsigned_wrap = header.alu.no_unsigned_wrap;
+   alu->dest.saturate = header.alu.saturate;
+   alu->dest.write_mask = header.alu.writemask;
 
-   read_dest(ctx, &alu->dest.dest, &alu->instr);
+   read_dest(ctx, &alu->dest.dest, &alu->instr, header.alu.dest);
 
    for (unsigned i = 0; i < nir_op_infos[op].num_inputs; i++) {
       read_src(ctx, &alu->src[i].src, &alu->instr);
-      flags = blob_read_uint32(ctx->blob);
-      alu->src[i].negate = flags & 1;
-      alu->src[i].abs = flags & 2;
-      for (unsigned j = 0; j < 4; j++)
-         alu->src[i].swizzle[j] = (flags >> (2 * j + 2)) & 3;
+
+      if (header.alu.has_swizzles) {
+         uint8_t swizzle = blob_read_uint8(ctx->blob);
+         for (unsigned j = 0; j < NIR_MAX_VEC_COMPONENTS; j++)
+            alu->src[i].swizzle[j] = (swizzle >> (2 * j)) & 3;
+      } else {
+         for (unsigned j = 0; j < NIR_MAX_VEC_COMPONENTS; j++)
+            alu->src[i].swizzle[j] = j;
+      }
+
+      if (header.alu.has_modifiers) {
+         uint8_t modifiers = blob_read_uint8(ctx->blob);
+         alu->src[i].negate = modifiers & 1;
+         alu->src[i].abs = modifiers & 2;
+      }
    }
 
    return alu;
 }
 
+/* The type and mode a deref would get from nir_builder, computed from the
+ * variable or the parent deref. Returns false if there is nothing to derive
+ * them from.
+ */
+static bool
+get_derived_deref_type(const nir_deref_instr *deref,
+                       const struct glsl_type **type, nir_variable_mode *mode)
+{
+   if (deref->deref_type == nir_deref_type_var) {
+      *type = deref->var->type;
+      *mode = deref->var->data.mode;
+      return true;
+   }
+
+   nir_deref_instr *parent = nir_src_as_deref(deref->parent);
+   if (!parent)
+      return false;
+
+   *mode = parent->mode;
+
+   switch (deref->deref_type) {
+   case nir_deref_type_struct:
+      if (!glsl_type_is_struct_or_ifc(parent->type))
+         return false;
+      *type = glsl_get_struct_field(parent->type, deref->strct.index);
+      return true;
+
+   case nir_deref_type_array:
+   case nir_deref_type_array_wildcard:
+      *type = glsl_get_array_element(parent->type);
+      return true;
+
+   case nir_deref_type_ptr_as_array:
+      *type = parent->type;
+      return true;
+
+   default:
+      return false;
+   }
+}
+
 static void
 write_deref(write_ctx *ctx, const nir_deref_instr *deref)
 {
-   blob_write_uint32(ctx->blob, deref->deref_type);
+   const struct glsl_type *type = NULL;
+   nir_variable_mode mode = 0;
+   union packed_instr header;
+   header.u32 = 0;
+
+   assert(deref->mode < (1 << 10));
+
+   header.deref.instr_type = deref->instr.type;
+   header.deref.deref_type = deref->deref_type;
+   header.deref.mode = deref->mode;
+   header.deref.dest = pack_dest(&deref->dest);
+
+   if (get_derived_deref_type(deref, &type, &mode)) {
+      header.deref.type_derived = type == deref->type;
+      header.deref.mode_derived = mode == deref->mode;
+   }
 
-   blob_write_uint32(ctx->blob, deref->mode);
-   encode_type_to_blob(ctx->blob, deref->type);
+   write_instr_header(ctx, header);
+
+   if (!header.deref.type_derived)
+      encode_type_to_blob(ctx->blob, deref->type);
 
    write_dest(ctx, &deref->dest);
 
    if (deref->deref_type == nir_deref_type_var) {
-      write_object(ctx, deref->var);
+      blob_write_varint(ctx->blob, write_lookup_object(ctx, deref->var));
       return;
    }
 
@@ -467,7 +703,7 @@ write_deref(write_ctx *ctx, const nir_deref_instr *deref)
 
    switch (deref->deref_type) {
    case nir_deref_type_struct:
-      blob_write_uint32(ctx->blob, deref->strct.index);
+      blob_write_varint(ctx->blob, deref->strct.index);
       break;
 
    case nir_deref_type_array:
@@ -476,7 +712,7 @@ write_deref(write_ctx *ctx, const nir_deref_instr *deref)
       break;
 
    case nir_deref_type_cast:
-      blob_write_uint32(ctx->blob, deref->cast.ptr_stride);
+      blob_write_varint(ctx->blob, deref->cast.ptr_stride);
       break;
 
    case nir_deref_type_array_wildcard:
@@ -489,43 +725,55 @@ write_deref(write_ctx *ctx, const nir_deref_instr *deref)
 }
 
 static nir_deref_instr *
-read_deref(read_ctx *ctx)
+read_deref(read_ctx *ctx, union packed_instr header)
 {
-   nir_deref_type deref_type = blob_read_uint32(ctx->blob);
+   nir_deref_type deref_type = header.deref.deref_type;
    nir_deref_instr *deref = nir_deref_instr_create(ctx->nir, deref_type);
 
-   deref->mode = blob_read_uint32(ctx->blob);
-   deref->type = decode_type_from_blob(ctx->blob);
+   deref->mode = header.deref.mode;
+   if (!header.deref.type_derived)
+      deref->type = decode_type_from_blob(ctx->blob);
 
-   read_dest(ctx, &deref->dest, &deref->instr);
+   read_dest(ctx, &deref->dest, &deref->instr, header.deref.dest);
 
    if (deref_type == nir_deref_type_var) {
-      deref->var = read_object(ctx);
-      return deref;
-   }
+      deref->var = read_lookup_object(ctx, blob_read_varint(ctx->blob));
+   } else {
+      read_src(ctx, &deref->parent, &deref->instr);
 
-   read_src(ctx, &deref->parent, &deref->instr);
+      switch (deref->deref_type) {
+      case nir_deref_type_struct:
+         deref->strct.index = blob_read_varint(ctx->blob);
+         break;
 
-   switch (deref->deref_type) {
-   case nir_deref_type_struct:
-      deref->strct.index = blob_read_uint32(ctx->blob);
-      break;
+      case nir_deref_type_array:
+      case nir_deref_type_ptr_as_array:
+         read_src(ctx, &deref->arr.index, &deref->instr);
+         break;
 
-   case nir_deref_type_array:
-   case nir_deref_type_ptr_as_array:
-      read_src(ctx, &deref->arr.index, &deref->instr);
-      break;
+      case nir_deref_type_cast:
+         deref->cast.ptr_stride = blob_read_varint(ctx->blob);
+         break;
 
-   case nir_deref_type_cast:
-      deref->cast.ptr_stride = blob_read_uint32(ctx->blob);
-      break;
+      case nir_deref_type_array_wildcard:
+         /* Nothing to do */
+         break;
 
-   case nir_deref_type_array_wildcard:
-      /* Nothing to do */
-      break;
+      default:
+         unreachable("Invalid deref type");
+      }
+   }
 
-   default:
-      unreachable("Invalid deref type");
+   if (header.deref.type_derived || header.deref.mode_derived) {
+      const struct glsl_type *type = NULL;
+      nir_variable_mode mode = 0;
+      ASSERTED bool derived = get_derived_deref_type(deref, &type, &mode);
+      assert(derived);
+
+      if (header.deref.type_derived)
+         deref->type = type;
+      if (header.deref.mode_derived)
+         deref->mode = mode;
    }
 
    return deref;
@@ -534,12 +782,21 @@ read_deref(read_ctx *ctx)
 static void
 write_intrinsic(write_ctx *ctx, const nir_intrinsic_instr *intrin)
 {
-   blob_write_uint32(ctx->blob, intrin->intrinsic);
-
+   STATIC_ASSERT(nir_num_intrinsics <= (1 << 9));
+   STATIC_ASSERT(NIR_MAX_VEC_COMPONENTS < (1 << 3));
    unsigned num_srcs = nir_intrinsic_infos[intrin->intrinsic].num_srcs;
    unsigned num_indices = nir_intrinsic_infos[intrin->intrinsic].num_indices;
+   union packed_instr header;
+   header.u32 = 0;
+
+   header.intrinsic.instr_type = intrin->instr.type;
+   header.intrinsic.intrinsic = intrin->intrinsic;
+   header.intrinsic.num_components = intrin->num_components;
+
+   if (nir_intrinsic_infos[intrin->intrinsic].has_dest)
+      header.intrinsic.dest = pack_dest(&intrin->dest);
 
-   blob_write_uint32(ctx->blob, intrin->num_components);
+   write_instr_header(ctx, header);
 
    if (nir_intrinsic_infos[intrin->intrinsic].has_dest)
       write_dest(ctx, &intrin->dest);
@@ -548,52 +805,159 @@ write_intrinsic(write_ctx *ctx, const nir_intrinsic_instr *intrin)
       write_src(ctx, &intrin->src[i]);
 
    for (unsigned i = 0; i < num_indices; i++)
-      blob_write_uint32(ctx->blob, intrin->const_index[i]);
+      blob_write_varint(ctx->blob, intrin->const_index[i]);
 }
 
 static nir_intrinsic_instr *
-read_intrinsic(read_ctx *ctx)
+read_intrinsic(read_ctx *ctx, union packed_instr header)
 {
-   nir_intrinsic_op op = blob_read_uint32(ctx->blob);
-
+   nir_intrinsic_op op = header.intrinsic.intrinsic;
    nir_intrinsic_instr *intrin = nir_intrinsic_instr_create(ctx->nir, op);
 
    unsigned num_srcs = nir_intrinsic_infos[op].num_srcs;
    unsigned num_indices = nir_intrinsic_infos[op].num_indices;
 
-   intrin->num_components = blob_read_uint32(ctx->blob);
+   intrin->num_components = header.intrinsic.num_components;
 
    if (nir_intrinsic_infos[op].has_dest)
-      read_dest(ctx, &intrin->dest, &intrin->instr);
+      read_dest(ctx, &intrin->dest, &intrin->instr, header.intrinsic.dest);
 
    for (unsigned i = 0; i < num_srcs; i++)
       read_src(ctx, &intrin->src[i], &intrin->instr);
 
    for (unsigned i = 0; i < num_indices; i++)
-      intrin->const_index[i] = blob_read_uint32(ctx->blob);
+      intrin->const_index[i] = blob_read_varint(ctx->blob);
 
    return intrin;
 }
 
+/* How the value of a load_const is stored. */
+enum load_const_packing {
+   /* Each component in a field of its bit size after the header. */
+   load_const_full,
+
+   /* A single component that is a sign-extended 20-bit integer, stored in
+    * the header. This covers most integer constants.
+    */
+   load_const_scalar_int_20bits,
+
+   /* A single 32-bit component with the low 12 bits cleared, whose top bits
+    * are stored in the header. This covers the float constants that have
+    * few mantissa bits, like 1.0 or 0.5.
+    */
+   load_const_scalar_hi_20bits_32,
+
+   /* Like the previous one, for a 64-bit component with the low 44 bits
+    * cleared.
+    */
+   load_const_scalar_hi_20bits_64,
+};
+
 static void
 write_load_const(write_ctx *ctx, const nir_load_const_instr *lc)
 {
-   uint32_t val = lc->def.num_components;
-   val |= lc->def.bit_size << 3;
-   blob_write_uint32(ctx->blob, val);
-   blob_write_bytes(ctx->blob, lc->value, sizeof(*lc->value) * lc->def.num_components);
+   union packed_instr header;
+   header.u32 = 0;
+
+   header.load_const.instr_type = lc->instr.type;
+   header.load_const.num_components = lc->def.num_components;
+   header.load_const.bit_size = encode_bit_size_3bits(lc->def.bit_size);
+   header.load_const.packing = load_const_full;
+
+   if (lc->def.num_components == 1) {
+      int64_t value = nir_const_value_as_int(lc->value[0], lc->def.bit_size);
+      uint64_t bits = nir_const_value_as_uint(lc->value[0], lc->def.bit_size);
+
+      if (lc->def.bit_size > 1 && value >= -(1 << 19) && value < (1 << 19)) {
+         header.load_const.packing = load_const_scalar_int_20bits;
+         header.load_const.data = value & 0xfffff;
+      } else if (lc->def.bit_size == 32 && !(bits & 0xfff)) {
+         header.load_const.packing = load_const_scalar_hi_20bits_32;
+         header.load_const.data = bits >> 12;
+      } else if (lc->def.bit_size == 64 && !(bits & 0xfffffffffffull)) {
+         header.load_const.packing = load_const_scalar_hi_20bits_64;
+         header.load_const.data = bits >> 44;
+      }
+   }
+
+   write_instr_header(ctx, header);
+
+   if (header.load_const.packing == load_const_full) {
+      for (unsigned i = 0; i < lc->def.num_components; i++) {
+         switch (lc->def.bit_size) {
+         case 1:
+            blob_write_uint8(ctx->blob, lc->value[i].b);
+            break;
+         case 8:
+            blob_write_uint8(ctx->blob, lc->value[i].u8);
+            break;
+         case 16:
+            blob_write_bytes(ctx->blob, &lc->value[i].u16, sizeof(uint16_t));
+            break;
+         case 32:
+            blob_write_bytes(ctx->blob, &lc->value[i].u32, sizeof(uint32_t));
+            break;
+         case 64:
+            blob_write_bytes(ctx->blob, &lc->value[i].u64, sizeof(uint64_t));
+            break;
+         default:
+            unreachable("Invalid bit size");
+         }
+      }
+   }
+
    write_add_object(ctx, &lc->def);
 }
 
 static nir_load_const_instr *
-read_load_const(read_ctx *ctx)
+read_load_const(read_ctx *ctx, union packed_instr header)
 {
-   uint32_t val = blob_read_uint32(ctx->blob);
-
+   unsigned bit_size = decode_bit_size_3bits(header.load_const.bit_size);
    nir_load_const_instr *lc =
-      nir_load_const_instr_create(ctx->nir, val & 0x7, val >> 3);
+      nir_load_const_instr_create(ctx->nir, header.load_const.num_components,
+                                  bit_size);
+
+   switch (header.load_const.packing) {
+   case load_const_scalar_int_20bits: {
+      /* Sign-extend the 20-bit value. */
+      int64_t value = ((int64_t)header.load_const.data << 44) >> 44;
+      lc->value[0] = nir_const_value_for_int(value, bit_size);
+      break;
+   }
+
+   case load_const_scalar_hi_20bits_32:
+      lc->value[0].u32 = (uint32_t)header.load_const.data << 12;
+      break;
+
+   case load_const_scalar_hi_20bits_64:
+      lc->value[0].u64 = (uint64_t)header.load_const.data << 44;
+      break;
+
+   case load_const_full:
+      for (unsigned i = 0; i < lc->def.num_components; i++) {
+         switch (bit_size) {
+         case 1:
+            lc->value[i].b = blob_read_uint8(ctx->blob);
+            break;
+         case 8:
+            lc->value[i].u8 = blob_read_uint8(ctx->blob);
+            break;
+         case 16:
+            blob_copy_bytes(ctx->blob, &lc->value[i].u16, sizeof(uint16_t));
+            break;
+         case 32:
+            blob_copy_bytes(ctx->blob, &lc->value[i].u32, sizeof(uint32_t));
+            break;
+         case 64:
+            blob_copy_bytes(ctx->blob, &lc->value[i].u64, sizeof(uint64_t));
+            break;
+         default:
+            unreachable("Invalid bit size");
+         }
+      }
+      break;
+   }
 
-   blob_copy_bytes(ctx->blob, lc->value, sizeof(*lc->value) * lc->def.num_components);
    read_add_object(ctx, &lc->def);
    return lc;
 }
@@ -601,19 +965,23 @@ read_load_const(read_ctx *ctx)
 static void
 write_ssa_undef(write_ctx *ctx, const nir_ssa_undef_instr *undef)
 {
-   uint32_t val = undef->def.num_components;
-   val |= undef->def.bit_size << 3;
-   blob_write_uint32(ctx->blob, val);
+   union packed_instr header;
+   header.u32 = 0;
+
+   header.undef.instr_type = undef->instr.type;
+   header.undef.num_components = undef->def.num_components;
+   header.undef.bit_size = encode_bit_size_3bits(undef->def.bit_size);
+
+   write_instr_header(ctx, header);
    write_add_object(ctx, &undef->def);
 }
 
 static nir_ssa_undef_instr *
-read_ssa_undef(read_ctx *ctx)
+read_ssa_undef(read_ctx *ctx, union packed_instr header)
 {
-   uint32_t val = blob_read_uint32(ctx->blob);
-
    nir_ssa_undef_instr *undef =
-      nir_ssa_undef_instr_create(ctx->nir, val & 0x7, val >> 3);
+      nir_ssa_undef_instr_create(ctx->nir, header.undef.num_components,
+                                 decode_bit_size_3bits(header.undef.bit_size));
 
    read_add_object(ctx, &undef->def);
    return undef;
@@ -629,6 +997,8 @@ union packed_tex_data {
       unsigned is_shadow:1;
       unsigned is_new_style_shadow:1;
       unsigned component:2;
+      unsigned texture_non_uniform:1;
+      unsigned sampler_non_uniform:1;
       unsigned unused:10; /* Mark unused for valgrind. */
    } u;
 };
@@ -636,12 +1006,26 @@ union packed_tex_data {
 static void
 write_tex(write_ctx *ctx, const nir_tex_instr *tex)
 {
-   blob_write_uint32(ctx->blob, tex->num_srcs);
-   blob_write_uint32(ctx->blob, tex->op);
-   blob_write_uint32(ctx->blob, tex->texture_index);
-   blob_write_uint32(ctx->blob, tex->texture_array_size);
-   blob_write_uint32(ctx->blob, tex->sampler_index);
-   blob_write_bytes(ctx->blob, tex->tg4_offsets, sizeof(tex->tg4_offsets));
+   union packed_instr header;
+   header.u32 = 0;
+
+   assert(tex->num_srcs < (1 << 4));
+   assert(tex->op < (1 << 4));
+
+   header.tex.instr_type = tex->instr.type;
+   header.tex.num_srcs = tex->num_srcs;
+   header.tex.op = tex->op;
+   header.tex.has_tg4_offsets = nir_tex_instr_has_explicit_tg4_offsets(
+      (nir_tex_instr *)tex);
+   header.tex.dest = pack_dest(&tex->dest);
+
+   write_instr_header(ctx, header);
+
+   blob_write_varint(ctx->blob, tex->texture_index);
+   blob_write_varint(ctx->blob, tex->texture_array_size);
+   blob_write_varint(ctx->blob, tex->sampler_index);
+   if (header.tex.has_tg4_offsets)
+      blob_write_bytes(ctx->blob, tex->tg4_offsets, sizeof(tex->tg4_offsets));
 
    STATIC_ASSERT(sizeof(union packed_tex_data) == sizeof(uint32_t));
    union packed_tex_data packed = {
@@ -652,30 +1036,33 @@ write_tex(write_ctx *ctx, const nir_tex_instr *tex)
       .u.is_shadow = tex->is_shadow,
       .u.is_new_style_shadow = tex->is_new_style_shadow,
       .u.component = tex->component,
+      .u.texture_non_uniform = tex->texture_non_uniform,
+      .u.sampler_non_uniform = tex->sampler_non_uniform,
    };
-   blob_write_uint32(ctx->blob, packed.u32);
+   blob_write_bytes(ctx->blob, &packed.u32, sizeof(packed.u32));
 
    write_dest(ctx, &tex->dest);
    for (unsigned i = 0; i < tex->num_srcs; i++) {
-      blob_write_uint32(ctx->blob, tex->src[i].src_type);
+      blob_write_uint8(ctx->blob, tex->src[i].src_type);
       write_src(ctx, &tex->src[i].src);
    }
 }
 
 static nir_tex_instr *
-read_tex(read_ctx *ctx)
+read_tex(read_ctx *ctx, union packed_instr header)
 {
-   unsigned num_srcs = blob_read_uint32(ctx->blob);
-   nir_tex_instr *tex = nir_tex_instr_create(ctx->nir, num_srcs);
+   nir_tex_instr *tex = nir_tex_instr_create(ctx->nir, header.tex.num_srcs);
 
-   tex->op = blob_read_uint32(ctx->blob);
-   tex->texture_index = blob_read_uint32(ctx->blob);
-   tex->texture_array_size = blob_read_uint32(ctx->blob);
-   tex->sampler_index = blob_read_uint32(ctx->blob);
-   blob_copy_bytes(ctx->blob, tex->tg4_offsets, sizeof(tex->tg4_offsets));
+   tex->op = header.tex.op;
+   tex->texture_index = blob_read_varint(ctx->blob);
+   tex->texture_array_size = blob_read_varint(ctx->blob);
+   tex->sampler_index = blob_read_varint(ctx->blob);
+   if (header.tex.has_tg4_offsets)
+      blob_copy_bytes(ctx->blob, tex->tg4_offsets, sizeof(tex->tg4_offsets));
 
    union packed_tex_data packed;
-   packed.u32 = blob_read_uint32(ctx->blob);
+   packed.u32 = 0;
+   blob_copy_bytes(ctx->blob, &packed.u32, sizeof(packed.u32));
    tex->sampler_dim = packed.u.sampler_dim;
    tex->dest_type = packed.u.dest_type;
    tex->coord_components = packed.u.coord_components;
@@ -683,10 +1070,12 @@ read_tex(read_ctx *ctx)
    tex->is_shadow = packed.u.is_shadow;
    tex->is_new_style_shadow = packed.u.is_new_style_shadow;
    tex->component = packed.u.component;
+   tex->texture_non_uniform = packed.u.texture_non_uniform;
+   tex->sampler_non_uniform = packed.u.sampler_non_uniform;
 
-   read_dest(ctx, &tex->dest, &tex->instr);
+   read_dest(ctx, &tex->dest, &tex->instr, header.tex.dest);
    for (unsigned i = 0; i < tex->num_srcs; i++) {
-      tex->src[i].src_type = blob_read_uint32(ctx->blob);
+      tex->src[i].src_type = blob_read_uint8(ctx->blob);
       read_src(ctx, &tex->src[i].src, &tex->instr);
    }
 
@@ -696,17 +1085,41 @@ read_tex(read_ctx *ctx)
 static void
 write_phi(write_ctx *ctx, const nir_phi_instr *phi)
 {
-   /* Phi nodes are special, since they may reference SSA definitions and
-    * basic blocks that don't exist yet. We leave two empty uint32_t's here,
-    * and then store enough information so that a later fixup pass can fill
-    * them in correctly.
-    */
+   union packed_instr header;
+   header.u32 = 0;
+
+   header.phi.instr_type = phi->instr.type;
+   header.phi.dest = pack_dest(&phi->dest);
+
+   write_instr_header(ctx, header);
    write_dest(ctx, &phi->dest);
 
-   blob_write_uint32(ctx->blob, exec_list_length(&phi->srcs));
+   blob_write_varint(ctx->blob, exec_list_length(&phi->srcs));
 
    nir_foreach_phi_src(src, phi) {
       assert(src->src.is_ssa);
+
+      /* Phi nodes are special, since they may reference SSA definitions and
+       * basic blocks that don't exist yet (on loop back-edges). Sources
+       * that are already known are written as deltas, like other sources.
+       * For the others, we leave two empty uint32_t's here, and then store
+       * enough information so that a later fixup pass can fill them in
+       * correctly.
+       */
+      struct hash_entry *src_entry =
+         _mesa_hash_table_search(ctx->remap_table, src->src.ssa);
+      struct hash_entry *pred_entry =
+         _mesa_hash_table_search(ctx->remap_table, src->pred);
+
+      if (src_entry && pred_entry) {
+         uint32_t src_idx = (uintptr_t)src_entry->data;
+         uint32_t pred_idx = (uintptr_t)pred_entry->data;
+         blob_write_varint(ctx->blob, (ctx->next_idx - src_idx) << 1);
+         blob_write_varint(ctx->blob, ctx->next_idx - pred_idx);
+         continue;
+      }
+
+      blob_write_varint(ctx->blob, 1);
       size_t blob_offset = blob_reserve_uint32(ctx->blob);
       ASSERTED size_t blob_offset2 = blob_reserve_uint32(ctx->blob);
       assert(blob_offset + sizeof(uint32_t) == blob_offset2);
@@ -732,13 +1145,13 @@ write_fixup_phis(write_ctx *ctx)
 }
 
 static nir_phi_instr *
-read_phi(read_ctx *ctx, nir_block *blk)
+read_phi(read_ctx *ctx, nir_block *blk, union packed_instr header)
 {
    nir_phi_instr *phi = nir_phi_instr_create(ctx->nir);
 
-   read_dest(ctx, &phi->dest, &phi->instr);
+   read_dest(ctx, &phi->dest, &phi->instr, header.phi.dest);
 
-   unsigned num_srcs = blob_read_uint32(ctx->blob);
+   unsigned num_srcs = blob_read_varint(ctx->blob);
 
    /* For similar reasons as before, we just store the index directly into the
     * pointer, and let a later pass resolve the phi sources.
@@ -752,10 +1165,20 @@ read_phi(read_ctx *ctx, nir_block *blk)
 
    for (unsigned i = 0; i < num_srcs; i++) {
       nir_phi_src *src = ralloc(phi, nir_phi_src);
+      uint32_t val = blob_read_varint(ctx->blob);
+      uint32_t src_idx, pred_idx;
+
+      if (val & 1) {
+         src_idx = blob_read_uint32(ctx->blob);
+         pred_idx = blob_read_uint32(ctx->blob);
+      } else {
+         src_idx = ctx->next_idx - (val >> 1);
+         pred_idx = ctx->next_idx - blob_read_varint(ctx->blob);
+      }
 
       src->src.is_ssa = true;
-      src->src.ssa = (nir_ssa_def *)(uintptr_t) blob_read_uint32(ctx->blob);
-      src->pred = (nir_block *)(uintptr_t) blob_read_uint32(ctx->blob);
+      src->src.ssa = (nir_ssa_def *)(uintptr_t) src_idx;
+      src->pred = (nir_block *)(uintptr_t) pred_idx;
 
       /* Since we're not letting nir_insert_instr handle use/def stuff for us,
        * we have to set the parent_instr manually.  It doesn't really matter
@@ -792,21 +1215,32 @@ read_fixup_phis(read_ctx *ctx)
 static void
 write_jump(write_ctx *ctx, const nir_jump_instr *jmp)
 {
-   blob_write_uint32(ctx->blob, jmp->type);
+   union packed_instr header;
+   header.u32 = 0;
+
+   header.jump.instr_type = jmp->instr.type;
+   header.jump.type = jmp->type;
+
+   write_instr_header(ctx, header);
 }
 
 static nir_jump_instr *
-read_jump(read_ctx *ctx)
+read_jump(read_ctx *ctx, union packed_instr header)
 {
-   nir_jump_type type = blob_read_uint32(ctx->blob);
-   nir_jump_instr *jmp = nir_jump_instr_create(ctx->nir, type);
+   nir_jump_instr *jmp = nir_jump_instr_create(ctx->nir, header.jump.type);
    return jmp;
 }
 
 static void
 write_call(write_ctx *ctx, const nir_call_instr *call)
 {
-   blob_write_uint32(ctx->blob, write_lookup_object(ctx, call->callee));
+   union packed_instr header;
+   header.u32 = 0;
+
+   header.any.instr_type = call->instr.type;
+
+   write_instr_header(ctx, header);
+   blob_write_varint(ctx->blob, write_lookup_object(ctx, call->callee));
 
    for (unsigned i = 0; i < call->num_params; i++)
       write_src(ctx, &call->params[i]);
@@ -815,7 +1249,7 @@ write_call(write_ctx *ctx, const nir_call_instr *call)
 static nir_call_instr *
 read_call(read_ctx *ctx)
 {
-   nir_function *callee = read_object(ctx);
+   nir_function *callee = read_lookup_object(ctx, blob_read_varint(ctx->blob));
    nir_call_instr *call = nir_call_instr_create(ctx->nir, callee);
 
    for (unsigned i = 0; i < call->num_params; i++)
@@ -827,7 +1261,9 @@ read_call(read_ctx *ctx)
 static void
 write_instr(write_ctx *ctx, const nir_instr *instr)
 {
-   blob_write_uint32(ctx->blob, instr->type);
+   /* We have only 4 bits for the instruction type. */
+   assert(instr->type < 16);
+
    switch (instr->type) {
    case nir_instr_type_alu:
       write_alu(ctx, nir_instr_as_alu(instr));
@@ -866,26 +1302,28 @@ write_instr(write_ctx *ctx, const nir_instr *instr)
 static void
 read_instr(read_ctx *ctx, nir_block *block)
 {
-   nir_instr_type type = blob_read_uint32(ctx->blob);
+   STATIC_ASSERT(sizeof(union packed_instr) == 4);
+   union packed_instr header = read_instr_header(ctx);
    nir_instr *instr;
-   switch (type) {
+
+   switch (header.any.instr_type) {
    case nir_instr_type_alu:
-      instr = &read_alu(ctx)->instr;
+      instr = &read_alu(ctx, header)->instr;
       break;
    case nir_instr_type_deref:
-      instr = &read_deref(ctx)->instr;
+      instr = &read_deref(ctx, header)->instr;
       break;
    case nir_instr_type_intrinsic:
-      instr = &read_intrinsic(ctx)->instr;
+      instr = &read_intrinsic(ctx, header)->instr;
       break;
    case nir_instr_type_load_const:
-      instr = &read_load_const(ctx)->instr;
+      instr = &read_load_const(ctx, header)->instr;
       break;
    case nir_instr_type_ssa_undef:
-      instr = &read_ssa_undef(ctx)->instr;
+      instr = &read_ssa_undef(ctx, header)->instr;
       break;
    case nir_instr_type_tex:
-      instr = &read_tex(ctx)->instr;
+      instr = &read_tex(ctx, header)->instr;
       break;
    case nir_instr_type_phi:
       /* Phi instructions are a bit of a special case when reading because we
@@ -893,10 +1331,10 @@ read_instr(read_ctx *ctx, nir_block *block)
        * for us.  Instead, we need to wait until all the blocks/instructions
        * are read so that we can set their sources up.
        */
-      read_phi(ctx, block);
+      read_phi(ctx, block, header);
       return;
    case nir_instr_type_jump:
-      instr = &read_jump(ctx)->instr;
+      instr = &read_jump(ctx, header)->instr;
       break;
    case nir_instr_type_call:
       instr = &read_call(ctx)->instr;
@@ -914,7 +1352,7 @@ static void
 write_block(write_ctx *ctx, const nir_block *block)
 {
    write_add_object(ctx, block);
-   blob_write_uint32(ctx->blob, exec_list_length(&block->instr_list));
+   blob_write_varint(ctx->blob, exec_list_length(&block->instr_list));
    nir_foreach_instr(instr, block)
       write_instr(ctx, instr);
 }
@@ -930,7 +1368,7 @@ read_block(read_ctx *ctx, struct exec_list *cf_list)
       exec_node_data(nir_block, exec_list_get_tail(cf_list), cf_node.node);
 
    read_add_object(ctx, block);
-   unsigned num_instrs = blob_read_uint32(ctx->blob);
+   unsigned num_instrs = blob_read_varint(ctx->blob);
    for (unsigned i = 0; i < num_instrs; i++) {
       read_instr(ctx, block);
    }
@@ -983,7 +1421,7 @@ read_loop(read_ctx *ctx, struct exec_list *cf_list)
 static void
 write_cf_node(write_ctx *ctx, nir_cf_node *cf)
 {
-   blob_write_uint32(ctx->blob, cf->type);
+   blob_write_uint8(ctx->blob, cf->type);
 
    switch (cf->type) {
    case nir_cf_node_block:
@@ -1003,7 +1441,7 @@ write_cf_node(write_ctx *ctx, nir_cf_node *cf)
 static void
 read_cf_node(read_ctx *ctx, struct exec_list *list)
 {
-   nir_cf_node_type type = blob_read_uint32(ctx->blob);
+   nir_cf_node_type type = blob_read_uint8(ctx->blob);
 
    switch (type) {
    case nir_cf_node_block:
@@ -1023,7 +1461,7 @@ read_cf_node(read_ctx *ctx, struct exec_list *list)
 static void
 write_cf_list(write_ctx *ctx, const struct exec_list *cf_list)
 {
-   blob_write_uint32(ctx->blob, exec_list_length(cf_list));
+   blob_write_varint(ctx->blob, exec_list_length(cf_list));
    foreach_list_typed(nir_cf_node, cf, node, cf_list) {
       write_cf_node(ctx, cf);
    }
@@ -1032,7 +1470,7 @@ write_cf_list(write_ctx *ctx, const struct exec_list *cf_list)
 static void
 read_cf_list(read_ctx *ctx, struct exec_list *cf_list)
 {
-   uint32_t num_cf_nodes = blob_read_uint32(ctx->blob);
+   uint32_t num_cf_nodes = blob_read_varint(ctx->blob);
    for (unsigned i = 0; i < num_cf_nodes; i++)
       read_cf_node(ctx, cf_list);
 }
@@ -1042,7 +1480,7 @@ write_function_impl(write_ctx *ctx, const nir_function_impl *fi)
 {
    write_var_list(ctx, &fi->locals);
    write_reg_list(ctx, &fi->registers);
-   blob_write_uint32(ctx->blob, fi->reg_alloc);
+   blob_write_varint(ctx->blob, fi->reg_alloc);
 
    write_cf_list(ctx, &fi->body);
    write_fixup_phis(ctx);
@@ -1056,7 +1494,7 @@ read_function_impl(read_ctx *ctx, nir_function *fxn)
 
    read_var_list(ctx, &fi->locals);
    read_reg_list(ctx, &fi->registers);
-   fi->reg_alloc = blob_read_uint32(ctx->blob);
+   fi->reg_alloc = blob_read_varint(ctx->blob);
 
    read_cf_list(ctx, &fi->body);
    read_fixup_phis(ctx);
@@ -1069,21 +1507,21 @@ read_function_impl(read_ctx *ctx, nir_function *fxn)
 static void
 write_function(write_ctx *ctx, const nir_function *fxn)
 {
-   blob_write_uint32(ctx->blob, !!(fxn->name));
+   blob_write_uint8(ctx->blob, !!(fxn->name));
    if (fxn->name)
       blob_write_string(ctx->blob, fxn->name);
 
    write_add_object(ctx, fxn);
 
-   blob_write_uint32(ctx->blob, fxn->num_params);
+   blob_write_varint(ctx->blob, fxn->num_params);
    for (unsigned i = 0; i < fxn->num_params; i++) {
       uint32_t val =
          ((uint32_t)fxn->params[i].num_components) |
          ((uint32_t)fxn->params[i].bit_size) << 8;
-      blob_write_uint32(ctx->blob, val);
+      blob_write_varint(ctx->blob, val);
    }
 
-   blob_write_uint32(ctx->blob, fxn->is_entrypoint);
+   blob_write_uint8(ctx->blob, fxn->is_entrypoint);
 
    /* At first glance, it looks like we should write the function_impl here.
     * However, call instructions need to be able to reference at least the
@@ -1095,22 +1533,22 @@ write_function(write_ctx *ctx, const nir_function *fxn)
 static void
 read_function(read_ctx *ctx)
 {
-   bool has_name = blob_read_uint32(ctx->blob);
+   bool has_name = blob_read_uint8(ctx->blob);
    char *name = has_name ? blob_read_string(ctx->blob) : NULL;
 
    nir_function *fxn = nir_function_create(ctx->nir, name);
 
    read_add_object(ctx, fxn);
 
-   fxn->num_params = blob_read_uint32(ctx->blob);
+   fxn->num_params = blob_read_varint(ctx->blob);
    fxn->params = ralloc_array(fxn, nir_parameter, fxn->num_params);
    for (unsigned i = 0; i < fxn->num_params; i++) {
-      uint32_t val = blob_read_uint32(ctx->blob);
+      uint32_t val = blob_read_varint(ctx->blob);
       fxn->params[i].num_components = val & 0xff;
       fxn->params[i].bit_size = (val >> 8) & 0xff;
    }
 
-   fxn->is_entrypoint = blob_read_uint32(ctx->blob);
+   fxn->is_entrypoint = blob_read_uint8(ctx->blob);
 }
 
 void
@@ -1135,6 +1573,7 @@ nir_serialize(struct blob *blob, const nir_shader *nir, bool strip)
    ctx.nir = nir;
    util_dynarray_init(&ctx.phi_fixups, NULL);
 
+   blob_write_uint32(blob, NIR_SERIALIZE_VERSION);
    size_t idx_size_offset = blob_reserve_uint32(blob);
 
    struct shader_info info = nir->info;
@@ -1158,13 +1597,13 @@ nir_serialize(struct blob *blob, const nir_shader *nir, bool strip)
    write_var_list(&ctx, &nir->globals);
    write_var_list(&ctx, &nir->system_values);
 
-   blob_write_uint32(blob, nir->num_inputs);
-   blob_write_uint32(blob, nir->num_uniforms);
-   blob_write_uint32(blob, nir->num_outputs);
-   blob_write_uint32(blob, nir->num_shared);
-   blob_write_uint32(blob, nir->scratch_size);
+   blob_write_varint(blob, nir->num_inputs);
+   blob_write_varint(blob, nir->num_uniforms);
+   blob_write_varint(blob, nir->num_outputs);
+   blob_write_varint(blob, nir->num_shared);
+   blob_write_varint(blob, nir->scratch_size);
 
-   blob_write_uint32(blob, exec_list_length(&nir->functions));
+   blob_write_varint(blob, exec_list_length(&nir->functions));
    nir_foreach_function(fxn, nir) {
       write_function(&ctx, fxn);
    }
@@ -1173,7 +1612,7 @@ nir_serialize(struct blob *blob, const nir_shader *nir, bool strip)
       write_function_impl(&ctx, fxn->impl);
    }
 
-   blob_write_uint32(blob, nir->constant_data_size);
+   blob_write_varint(blob, nir->constant_data_size);
    if (nir->constant_data_size > 0)
       blob_write_bytes(blob, nir->constant_data, nir->constant_data_size);
 
@@ -1193,6 +1632,16 @@ nir_deserialize(void *mem_ctx,
 {
    read_ctx ctx;
    ctx.blob = blob;
+
+   /* Blobs are expected to come from the same build, e.g. through a cache
+    * keyed on the build id, so this is only a safety net.  Flag the reader
+    * as overrun so that callers treat it like any other unreadable blob.
+    */
+   if (blob_read_uint32(blob) != NIR_SERIALIZE_VERSION) {
+      blob->overrun = true;
+      return NULL;
+   }
+
    list_inithead(&ctx.phi_srcs);
    ctx.idx_table_len = blob_read_uint32(blob);
    ctx.idx_table = calloc(ctx.idx_table_len, sizeof(uintptr_t));
@@ -1219,20 +1668,20 @@ nir_deserialize(void *mem_ctx,
    read_var_list(&ctx, &ctx.nir->globals);
    read_var_list(&ctx, &ctx.nir->system_values);
 
-   ctx.nir->num_inputs = blob_read_uint32(blob);
-   ctx.nir->num_uniforms = blob_read_uint32(blob);
-   ctx.nir->num_outputs = blob_read_uint32(blob);
-   ctx.nir->num_shared = blob_read_uint32(blob);
-   ctx.nir->scratch_size = blob_read_uint32(blob);
+   ctx.nir->num_inputs = blob_read_varint(blob);
+   ctx.nir->num_uniforms = blob_read_varint(blob);
+   ctx.nir->num_outputs = blob_read_varint(blob);
+   ctx.nir->num_shared = blob_read_varint(blob);
+   ctx.nir->scratch_size = blob_read_varint(blob);
 
-   unsigned num_functions = blob_read_uint32(blob);
+   unsigned num_functions = blob_read_varint(blob);
    for (unsigned i = 0; i < num_functions; i++)
       read_function(&ctx);
 
    nir_foreach_function(fxn, ctx.nir)
       fxn->impl = read_function_impl(&ctx, fxn);
 
-   ctx.nir->constant_data_size = blob_read_uint32(blob);
+   ctx.nir->constant_data_size = blob_read_varint(blob);
    if (ctx.nir->constant_data_size > 0) {
       ctx.nir->constant_data =
          ralloc_size(ctx.nir, ctx.nir->constant_data_size);
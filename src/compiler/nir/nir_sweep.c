@@ -33,6 +33,10 @@
  * The expectation is that drivers should call this when finished compiling the shader
  * (after any optimization, lowering, and so on).  However, it's also fine to call it
  * earlier, and even many times, trading CPU cycles for memory savings.
+ *
+ * If the shader has an instruction arena, the live instructions are moved to
+ * a new context inside of it, and the dead ones go back to the arena to be
+ * reused by later instructions instead of being returned to malloc.
  */
 
 #define steal_list(mem_ctx, type, list) \
@@ -61,6 +65,8 @@ sweep_dest_indirect(nir_dest *dest, void *nir)
 static void
 sweep_block(nir_shader *nir, nir_block *block)
 {
+   void *instr_ctx = nir->instr_arena ? nir->instr_arena : nir;
+
    ralloc_steal(nir, block);
 
    /* sweep_impl will mark all metadata invalid.  We can safely release all of
@@ -73,10 +79,10 @@ sweep_block(nir_shader *nir, nir_block *block)
    block->live_out = NULL;
 
    nir_foreach_instr(instr, block) {
-      ralloc_steal(nir, instr);
+      ralloc_steal(instr_ctx, instr);
 
-      nir_foreach_src(instr, sweep_src_indirect, nir);
-      nir_foreach_dest(instr, sweep_dest_indirect, nir);
+      nir_foreach_src(instr, sweep_src_indirect, instr_ctx);
+      nir_foreach_dest(instr, sweep_dest_indirect, instr_ctx);
    }
 }
 
@@ -158,6 +164,16 @@ nir_sweep(nir_shader *nir)
    /* First, move ownership of all the memory to a temporary context; assume dead. */
    ralloc_adopt(rubbish, nir);
 
+   /* Keep the arena, but leave the context holding its instructions behind
+    * and give the arena a fresh one for the live instructions.
+    */
+   if (nir->instr_arena) {
+      void *arena = ralloc_parent(nir->instr_arena);
+      ralloc_steal(nir, arena);
+      ralloc_steal(rubbish, nir->instr_arena);
+      nir->instr_arena = ralloc_context(arena);
+   }
+
    ralloc_steal(nir, (char *)nir->info.name);
    if (nir->info.label)
       ralloc_steal(nir, (char *)nir->info.label);
@@ -0,0 +1,191 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Compile time of a typical driver optimization loop around
+ * nir_opt_algebraic on large compute shaders.
+ *
+ * Usage: nir_algebraic_bench [chunks ...]
+ *
+ * Each argument is the size of a synthetic compute shader, in chunks of
+ * SSBO address math and arithmetic that nir_opt_algebraic can simplify in
+ * several steps.  For every shader the number of trips through the loop,
+ * the time spent in nir_opt_algebraic and in the whole loop, and the final
+ * instruction count are printed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "nir.h"
+#include "nir_builder.h"
+#include "util/os_time.h"
+
+#define ITERATIONS 5
+
+static const nir_shader_compiler_options options = {
+   .lower_fsat = true,
+   .lower_sub = true,
+};
+
+static nir_ssa_def *
+load_ssbo(nir_builder *b, nir_ssa_def *offset)
+{
+   nir_intrinsic_instr *load =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_load_ssbo);
+   load->num_components = 1;
+   load->src[0] = nir_src_for_ssa(nir_imm_int(b, 0));
+   load->src[1] = nir_src_for_ssa(offset);
+   nir_intrinsic_set_align(load, 4, 0);
+   nir_ssa_dest_init(&load->instr, &load->dest, 1, 32, NULL);
+   nir_builder_instr_insert(b, &load->instr);
+   return &load->dest.ssa;
+}
+
+static void
+store_ssbo(nir_builder *b, nir_ssa_def *value, nir_ssa_def *offset)
+{
+   nir_intrinsic_instr *store =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_store_ssbo);
+   store->num_components = 1;
+   store->src[0] = nir_src_for_ssa(value);
+   store->src[1] = nir_src_for_ssa(nir_imm_int(b, 1));
+   store->src[2] = nir_src_for_ssa(offset);
+   nir_intrinsic_set_write_mask(store, 0x1);
+   nir_intrinsic_set_align(store, 4, 0);
+   nir_builder_instr_insert(b, &store->instr);
+}
+
+/* Address math and arithmetic of the kind frontends emit before any
+ * optimization: multiplications by powers of two, adds of zero, chains of
+ * constant offsets, double negations, comparisons against constants and
+ * selects between them.
+ */
+static nir_shader *
+build_shader(unsigned num_chunks)
+{
+   nir_builder b;
+   nir_builder_init_simple_shader(&b, NULL, MESA_SHADER_COMPUTE, &options);
+
+   nir_ssa_def *id = nir_channel(&b, nir_load_local_invocation_id(&b), 0);
+   nir_ssa_def *row = nir_imul(&b, id, nir_imm_int(&b, 64));
+   nir_ssa_def *acc = nir_imm_float(&b, 0.0);
+
+   for (unsigned c = 0; c < num_chunks; c++) {
+      nir_ssa_def *idx = nir_iadd(&b, row, nir_imm_int(&b, c % 16));
+      nir_ssa_def *offset = nir_imul(&b, idx, nir_imm_int(&b, 4));
+      offset = nir_iadd(&b, offset, nir_imm_int(&b, 0));
+      offset = nir_iadd(&b, nir_iadd(&b, offset, nir_imm_int(&b, 4)),
+                        nir_imm_int(&b, 8 * (c % 4)));
+
+      nir_ssa_def *v = load_ssbo(&b, offset);
+      v = nir_fmul(&b, v, nir_imm_float(&b, 1.0));
+      v = nir_fneg(&b, nir_fneg(&b, v));
+      v = nir_fadd(&b, v, nir_fsub(&b, v, v));
+
+      nir_ssa_def *big = nir_flt(&b, nir_imm_float(&b, 0.5), v);
+      nir_ssa_def *sel = nir_bcsel(&b, nir_inot(&b, nir_inot(&b, big)),
+                                   nir_fmax(&b, v, v), nir_imm_float(&b, 0.0));
+      sel = nir_fmin(&b, nir_fmax(&b, sel, nir_imm_float(&b, 0.0)),
+                     nir_imm_float(&b, 1.0));
+      acc = nir_fadd(&b, acc, nir_fmul(&b, sel, nir_imm_float(&b, 2.0)));
+
+      nir_ssa_def *mask = nir_iand(&b, nir_ishl(&b, idx, nir_imm_int(&b, 2)),
+                                   nir_imm_int(&b, ~0));
+      store_ssbo(&b, nir_fmul(&b, acc, nir_imm_float(&b, 1.0)),
+                 nir_ior(&b, mask, nir_imm_int(&b, 0)));
+   }
+
+   return b.shader;
+}
+
+static unsigned
+count_instrs(nir_shader *nir)
+{
+   unsigned count = 0;
+   nir_foreach_function(function, nir) {
+      if (function->impl) {
+         nir_foreach_block(block, function->impl)
+            count += exec_list_length(&block->instr_list);
+      }
+   }
+   return count;
+}
+
+int
+main(int argc, char **argv)
+{
+   static const unsigned default_sizes[] = { 256, 1024, 4096 };
+   unsigned sizes[16];
+   unsigned num_sizes = 0;
+
+   for (int a = 1; a < argc && num_sizes < ARRAY_SIZE(sizes); a++)
+      sizes[num_sizes++] = atoi(argv[a]);
+   if (num_sizes == 0) {
+      for (unsigned i = 0; i < ARRAY_SIZE(default_sizes); i++)
+         sizes[num_sizes++] = default_sizes[i];
+   }
+
+   glsl_type_singleton_init_or_ref();
+
+   printf("%8s %8s %6s %14s %14s %8s\n",
+          "chunks", "instrs", "loops", "algebraic us", "total us", "final");
+
+   for (unsigned s = 0; s < num_sizes; s++) {
+      int64_t algebraic_ns = 0, total_ns = 0;
+      unsigned loops = 0, instrs = 0, final_instrs = 0;
+
+      for (unsigned it = 0; it < ITERATIONS; it++) {
+         nir_shader *nir = build_shader(sizes[s]);
+         instrs = count_instrs(nir);
+         loops = 0;
+
+         int64_t start = os_time_get_nano();
+         bool progress;
+         do {
+            progress = false;
+            loops++;
+
+            progress |= nir_copy_prop(nir);
+            progress |= nir_opt_dce(nir);
+            progress |= nir_opt_cse(nir);
+
+            int64_t algebraic_start = os_time_get_nano();
+            progress |= nir_opt_algebraic(nir);
+            algebraic_ns += os_time_get_nano() - algebraic_start;
+
+            progress |= nir_opt_constant_folding(nir);
+         } while (progress);
+         total_ns += os_time_get_nano() - start;
+
+         final_instrs = count_instrs(nir);
+         ralloc_free(nir);
+      }
+
+      printf("%8u %8u %6u %14.1f %14.1f %8u\n", sizes[s], instrs, loops,
+             algebraic_ns / 1000.0 / ITERATIONS,
+             total_ns / 1000.0 / ITERATIONS, final_instrs);
+   }
+
+   glsl_type_singleton_decref();
+   return 0;
+}
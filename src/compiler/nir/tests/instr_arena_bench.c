@@ -0,0 +1,254 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Compile time with and without an instruction arena.
+ *
+ * Usage: nir_instr_arena_bench [chunks ...]
+ *
+ * Each argument is the size of a synthetic compute shader, in chunks of
+ * SSBO loads, arithmetic and control flow.  Every shader is built, run
+ * through a typical optimization loop, swept, cloned, walked a few times the
+ * way a backend would, and freed, once with each allocation scheme.  The
+ * time spent in each phase is printed, in microseconds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "nir.h"
+#include "nir_builder.h"
+#include "util/os_time.h"
+
+#define ITERATIONS 5
+#define WALKS 10
+
+static const nir_shader_compiler_options malloc_options = {
+   .lower_fsat = true,
+   .lower_sub = true,
+};
+
+static const nir_shader_compiler_options arena_options = {
+   .lower_fsat = true,
+   .lower_sub = true,
+   .use_instr_arena = true,
+};
+
+static nir_ssa_def *
+load_ssbo(nir_builder *b, nir_ssa_def *offset)
+{
+   nir_intrinsic_instr *load =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_load_ssbo);
+   load->num_components = 1;
+   load->src[0] = nir_src_for_ssa(nir_imm_int(b, 0));
+   load->src[1] = nir_src_for_ssa(offset);
+   nir_intrinsic_set_align(load, 4, 0);
+   nir_ssa_dest_init(&load->instr, &load->dest, 1, 32, NULL);
+   nir_builder_instr_insert(b, &load->instr);
+   return &load->dest.ssa;
+}
+
+static void
+store_ssbo(nir_builder *b, nir_ssa_def *value, nir_ssa_def *offset)
+{
+   nir_intrinsic_instr *store =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_store_ssbo);
+   store->num_components = 1;
+   store->src[0] = nir_src_for_ssa(value);
+   store->src[1] = nir_src_for_ssa(nir_imm_int(b, 1));
+   store->src[2] = nir_src_for_ssa(offset);
+   nir_intrinsic_set_write_mask(store, 0x1);
+   nir_intrinsic_set_align(store, 4, 0);
+   nir_builder_instr_insert(b, &store->instr);
+}
+
+/* Straight-line arithmetic with some redundancy for the optimizer to chew
+ * on, and an if in every chunk so that phis and blocks get created and
+ * removed as well.
+ */
+static nir_shader *
+build_shader(const nir_shader_compiler_options *options, unsigned num_chunks)
+{
+   nir_builder b;
+   nir_builder_init_simple_shader(&b, NULL, MESA_SHADER_COMPUTE, options);
+
+   nir_ssa_def *id = nir_channel(&b, nir_load_local_invocation_id(&b), 0);
+   nir_ssa_def *row = nir_imul(&b, id, nir_imm_int(&b, 64));
+   nir_ssa_def *acc = nir_imm_float(&b, 0.0);
+
+   for (unsigned c = 0; c < num_chunks; c++) {
+      nir_ssa_def *idx = nir_iadd(&b, row, nir_imm_int(&b, c % 16));
+      nir_ssa_def *offset = nir_imul(&b, idx, nir_imm_int(&b, 4));
+      offset = nir_iadd(&b, offset, nir_imm_int(&b, 0));
+
+      nir_ssa_def *v = load_ssbo(&b, offset);
+      v = nir_fmul(&b, v, nir_imm_float(&b, 1.0));
+      v = nir_fneg(&b, nir_fneg(&b, v));
+      v = nir_fadd(&b, v, nir_fmul(&b, v, nir_imm_float(&b, 0.5)));
+
+      nir_push_if(&b, nir_flt(&b, nir_imm_float(&b, 0.5), v));
+      nir_ssa_def *then_val = nir_fmul(&b, nir_fadd(&b, acc, v),
+                                       nir_imm_float(&b, 2.0));
+      nir_push_else(&b, NULL);
+      nir_ssa_def *else_val = nir_fadd(&b, acc, nir_imm_float(&b, 0.0));
+      nir_pop_if(&b, NULL);
+      acc = nir_if_phi(&b, then_val, else_val);
+
+      store_ssbo(&b, nir_fmax(&b, acc, acc),
+                 nir_ior(&b, nir_ishl(&b, idx, nir_imm_int(&b, 2)),
+                         nir_imm_int(&b, 0)));
+   }
+
+   return b.shader;
+}
+
+static void
+optimize(nir_shader *nir)
+{
+   bool progress;
+   do {
+      progress = false;
+      progress |= nir_copy_prop(nir);
+      progress |= nir_opt_dce(nir);
+      progress |= nir_opt_cse(nir);
+      progress |= nir_opt_peephole_select(nir, 8, true, true);
+      progress |= nir_opt_algebraic(nir);
+      progress |= nir_opt_constant_folding(nir);
+      progress |= nir_opt_dead_cf(nir);
+   } while (progress);
+}
+
+/* What a backend does over and over: look at every instruction and its
+ * sources.
+ */
+static unsigned
+walk_shader(nir_shader *nir)
+{
+   unsigned sum = 0;
+   nir_foreach_function(function, nir) {
+      if (!function->impl)
+         continue;
+
+      nir_foreach_block(block, function->impl) {
+         nir_foreach_instr(instr, block) {
+            sum += instr->type;
+            if (instr->type == nir_instr_type_alu) {
+               nir_alu_instr *alu = nir_instr_as_alu(instr);
+               for (unsigned i = 0; i < nir_op_infos[alu->op].num_inputs; i++)
+                  sum += alu->src[i].src.ssa->num_components;
+            }
+         }
+      }
+   }
+   return sum;
+}
+
+struct timings {
+   int64_t build, opt, sweep, clone, walk, free;
+};
+
+static unsigned
+run(const nir_shader_compiler_options *options, unsigned num_chunks,
+    struct timings *t)
+{
+   unsigned sum = 0;
+
+   for (unsigned it = 0; it < ITERATIONS; it++) {
+      int64_t start = os_time_get_nano();
+      nir_shader *nir = build_shader(options, num_chunks);
+      int64_t built = os_time_get_nano();
+      optimize(nir);
+      int64_t optimized = os_time_get_nano();
+      nir_sweep(nir);
+      int64_t swept = os_time_get_nano();
+      nir_shader *clone = nir_shader_clone(NULL, nir);
+      int64_t cloned = os_time_get_nano();
+      for (unsigned w = 0; w < WALKS; w++)
+         sum += walk_shader(clone);
+      int64_t walked = os_time_get_nano();
+      ralloc_free(clone);
+      ralloc_free(nir);
+      int64_t freed = os_time_get_nano();
+
+      t->build += built - start;
+      t->opt += optimized - built;
+      t->sweep += swept - optimized;
+      t->clone += cloned - swept;
+      t->walk += walked - cloned;
+      t->free += freed - walked;
+   }
+
+   return sum;
+}
+
+static void
+print_timings(unsigned num_chunks, const char *mode, const struct timings *t)
+{
+   int64_t total = t->build + t->opt + t->sweep + t->clone + t->walk + t->free;
+   printf("%8u %6s %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+          num_chunks, mode,
+          t->build / 1000.0 / ITERATIONS, t->opt / 1000.0 / ITERATIONS,
+          t->sweep / 1000.0 / ITERATIONS, t->clone / 1000.0 / ITERATIONS,
+          t->walk / 1000.0 / ITERATIONS, t->free / 1000.0 / ITERATIONS,
+          total / 1000.0 / ITERATIONS);
+}
+
+int
+main(int argc, char **argv)
+{
+   static const unsigned default_sizes[] = { 256, 1024, 2048 };
+   unsigned sizes[16];
+   unsigned num_sizes = 0;
+
+   for (int a = 1; a < argc && num_sizes < ARRAY_SIZE(sizes); a++)
+      sizes[num_sizes++] = atoi(argv[a]);
+   if (num_sizes == 0) {
+      for (unsigned i = 0; i < ARRAY_SIZE(default_sizes); i++)
+         sizes[num_sizes++] = default_sizes[i];
+   }
+
+   glsl_type_singleton_init_or_ref();
+
+   printf("%8s %6s %10s %10s %10s %10s %10s %10s %10s\n",
+          "chunks", "alloc", "build", "opt", "sweep", "clone", "walk",
+          "free", "total");
+
+   for (unsigned s = 0; s < num_sizes; s++) {
+      struct timings malloc_t = { 0 }, arena_t = { 0 };
+
+      /* Warm up the allocator and the type singletons. */
+      run(&malloc_options, sizes[s], &(struct timings) { 0 });
+
+      unsigned malloc_sum = run(&malloc_options, sizes[s], &malloc_t);
+      unsigned arena_sum = run(&arena_options, sizes[s], &arena_t);
+      if (malloc_sum != arena_sum) {
+         fprintf(stderr, "shaders differ with %u chunks\n", sizes[s]);
+         return 1;
+      }
+
+      print_timings(sizes[s], "malloc", &malloc_t);
+      print_timings(sizes[s], "arena", &arena_t);
+   }
+
+   glsl_type_singleton_decref();
+   return 0;
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include "nir.h"
+#include "nir_builder.h"
+
+namespace {
+
+class nir_instr_arena_test : public ::testing::Test {
+protected:
+   nir_instr_arena_test()
+   {
+      glsl_type_singleton_init_or_ref();
+
+      memset(&options, 0, sizeof(options));
+      options.use_instr_arena = true;
+      nir_builder_init_simple_shader(&b, NULL, MESA_SHADER_COMPUTE, &options);
+   }
+
+   ~nir_instr_arena_test()
+   {
+      ralloc_free(b.shader);
+      glsl_type_singleton_decref();
+   }
+
+   /* A few instructions, some of which end up dead. */
+   void
+   build()
+   {
+      nir_ssa_def *x = nir_channel(&b, nir_load_local_invocation_id(&b), 0);
+      nir_push_if(&b, nir_ieq(&b, x, nir_imm_int(&b, 0)));
+      nir_ssa_def *then_val = nir_iadd(&b, x, nir_imm_int(&b, 1));
+      nir_push_else(&b, NULL);
+      nir_ssa_def *else_val = nir_imul(&b, x, nir_imm_int(&b, 3));
+      nir_pop_if(&b, NULL);
+      nir_ssa_def *phi = nir_if_phi(&b, then_val, else_val);
+
+      for (unsigned i = 0; i < 32; i++)
+         nir_iadd(&b, phi, nir_imm_int(&b, i));
+   }
+
+   nir_shader_compiler_options options;
+   nir_builder b;
+};
+
+} /* namespace */
+
+TEST_F(nir_instr_arena_test, instructions_come_from_arena)
+{
+   build();
+
+   nir_foreach_block(block, b.impl) {
+      nir_foreach_instr(instr, block) {
+         struct ralloc_slab_stats stats;
+         EXPECT_TRUE(ralloc_slab_get_stats(instr, &stats));
+      }
+   }
+
+   static const nir_shader_compiler_options plain_options = { };
+   nir_shader *plain = nir_shader_create(NULL, MESA_SHADER_COMPUTE,
+                                         &plain_options, NULL);
+   nir_ssa_undef_instr *undef = nir_ssa_undef_instr_create(plain, 1, 32);
+   struct ralloc_slab_stats stats;
+   EXPECT_FALSE(ralloc_slab_get_stats(undef, &stats));
+   ralloc_free(plain);
+}
+
+TEST_F(nir_instr_arena_test, sweep_recycles_dead_instructions)
+{
+   build();
+
+   struct ralloc_slab_stats before;
+   ASSERT_TRUE(ralloc_slab_get_stats(b.shader->instr_arena, &before));
+
+   nir_opt_dce(b.shader);
+   nir_sweep(b.shader);
+   nir_validate_shader(b.shader, "after nir_sweep");
+
+   struct ralloc_slab_stats after;
+   ASSERT_TRUE(ralloc_slab_get_stats(b.shader->instr_arena, &after));
+   EXPECT_LT(after.live_slab_bytes, before.live_slab_bytes);
+   EXPECT_EQ(before.page_count, after.page_count);
+
+   /* New instructions take the place of the dead ones. */
+   b.cursor = nir_after_cf_list(&b.impl->body);
+   nir_imm_int(&b, 42);
+
+   struct ralloc_slab_stats reused;
+   ASSERT_TRUE(ralloc_slab_get_stats(b.shader->instr_arena, &reused));
+   EXPECT_GT(reused.freelist_reuses, after.freelist_reuses);
+}
+
+TEST_F(nir_instr_arena_test, clone_has_arena)
+{
+   build();
+
+   nir_shader *clone = nir_shader_clone(NULL, b.shader);
+   nir_validate_shader(clone, "after nir_shader_clone");
+   ASSERT_NE(nullptr, clone->instr_arena);
+
+   unsigned num_instrs = 0;
+   nir_foreach_block(block, nir_shader_get_entrypoint(clone)) {
+      nir_foreach_instr(instr, block) {
+         struct ralloc_slab_stats stats;
+         EXPECT_TRUE(ralloc_slab_get_stats(instr, &stats));
+         num_instrs++;
+      }
+   }
+   EXPECT_GT(num_instrs, 32u);
+
+   /* The two shaders don't share their arenas. */
+   struct ralloc_slab_stats stats;
+   ASSERT_TRUE(ralloc_slab_get_stats(b.shader->instr_arena, &stats));
+   size_t live = stats.live_slab_bytes;
+   ralloc_free(clone);
+   ASSERT_TRUE(ralloc_slab_get_stats(b.shader->instr_arena, &stats));
+   EXPECT_EQ(live, stats.live_slab_bytes);
+}
@@ -0,0 +1,341 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include "nir.h"
+#include "nir_builder.h"
+
+namespace {
+
+class nir_licm_test : public ::testing::Test {
+protected:
+   nir_licm_test();
+   ~nir_licm_test();
+
+   bool run_licm();
+
+   nir_ssa_def *load_ubo(unsigned offset, unsigned components = 1);
+   nir_ssa_def *load_ssbo(unsigned offset, unsigned components = 1);
+   void store(nir_ssa_def *value);
+   void break_if_ssbo();
+
+   bool is_in_block(nir_ssa_def *def, nir_block *block);
+   bool is_in_loop(nir_ssa_def *def, nir_loop *loop);
+
+   void *mem_ctx;
+   nir_builder *b;
+   nir_opt_licm_options options;
+};
+
+nir_licm_test::nir_licm_test()
+{
+   glsl_type_singleton_init_or_ref();
+
+   mem_ctx = ralloc_context(NULL);
+   static const nir_shader_compiler_options compiler_options = { };
+   b = rzalloc(mem_ctx, nir_builder);
+   nir_builder_init_simple_shader(b, mem_ctx, MESA_SHADER_COMPUTE,
+                                  &compiler_options);
+
+   memset(&options, 0, sizeof(options));
+}
+
+nir_licm_test::~nir_licm_test()
+{
+   if (HasFailure()) {
+      printf("\nShader from the failed test:\n\n");
+      nir_print_shader(b->shader, stdout);
+   }
+
+   ralloc_free(mem_ctx);
+
+   glsl_type_singleton_decref();
+}
+
+bool
+nir_licm_test::run_licm()
+{
+   nir_validate_shader(b->shader, NULL);
+   bool progress = nir_opt_licm(b->shader, &options);
+   nir_validate_shader(b->shader, NULL);
+   return progress;
+}
+
+nir_ssa_def *
+nir_licm_test::load_ubo(unsigned offset, unsigned components)
+{
+   nir_intrinsic_instr *load =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_load_ubo);
+   load->num_components = components;
+   load->src[0] = nir_src_for_ssa(nir_imm_int(b, 0));
+   load->src[1] = nir_src_for_ssa(nir_imm_int(b, offset));
+   nir_intrinsic_set_align(load, 4, 0);
+   nir_ssa_dest_init(&load->instr, &load->dest, components, 32, NULL);
+   nir_builder_instr_insert(b, &load->instr);
+   return &load->dest.ssa;
+}
+
+nir_ssa_def *
+nir_licm_test::load_ssbo(unsigned offset, unsigned components)
+{
+   nir_intrinsic_instr *load =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_load_ssbo);
+   load->num_components = components;
+   load->src[0] = nir_src_for_ssa(nir_imm_int(b, 0));
+   load->src[1] = nir_src_for_ssa(nir_imm_int(b, offset));
+   nir_intrinsic_set_align(load, 4, 0);
+   nir_ssa_dest_init(&load->instr, &load->dest, components, 32, NULL);
+   nir_builder_instr_insert(b, &load->instr);
+   return &load->dest.ssa;
+}
+
+void
+nir_licm_test::store(nir_ssa_def *value)
+{
+   nir_intrinsic_instr *store =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_store_ssbo);
+   store->num_components = value->num_components;
+   store->src[0] = nir_src_for_ssa(value);
+   store->src[1] = nir_src_for_ssa(nir_imm_int(b, 1));
+   store->src[2] = nir_src_for_ssa(nir_imm_int(b, 0));
+   nir_intrinsic_set_write_mask(store, (1 << value->num_components) - 1);
+   nir_intrinsic_set_align(store, 4, 0);
+   nir_builder_instr_insert(b, &store->instr);
+}
+
+void
+nir_licm_test::break_if_ssbo()
+{
+   nir_push_if(b, nir_ine(b, load_ssbo(64), nir_imm_int(b, 0)));
+   nir_jump(b, nir_jump_break);
+   nir_pop_if(b, NULL);
+}
+
+bool
+nir_licm_test::is_in_block(nir_ssa_def *def, nir_block *block)
+{
+   return def->parent_instr->block == block;
+}
+
+bool
+nir_licm_test::is_in_loop(nir_ssa_def *def, nir_loop *loop)
+{
+   nir_cf_node *node = &def->parent_instr->block->cf_node;
+   for (; node; node = node->parent) {
+      if (node == &loop->cf_node)
+         return true;
+   }
+   return false;
+}
+
+} /* namespace */
+
+TEST_F(nir_licm_test, invariant_alu)
+{
+   nir_ssa_def *a = load_ubo(0);
+   nir_loop *loop = nir_push_loop(b);
+   nir_ssa_def *x = nir_fmul(b, a, nir_imm_float(b, 2.0));
+   nir_ssa_def *y = nir_fadd(b, x, a);
+   store(y);
+   break_if_ssbo();
+   nir_pop_loop(b, loop);
+
+   EXPECT_TRUE(run_licm());
+
+   EXPECT_TRUE(is_in_block(x, nir_start_block(b->impl)));
+   EXPECT_TRUE(is_in_block(y, nir_start_block(b->impl)));
+   EXPECT_FALSE(run_licm());
+}
+
+TEST_F(nir_licm_test, variant_alu)
+{
+   nir_ssa_def *a = load_ubo(0);
+   nir_loop *loop = nir_push_loop(b);
+   nir_ssa_def *v = load_ssbo(0);
+   nir_ssa_def *x = nir_fmul(b, v, a);
+   nir_ssa_def *y = nir_fadd(b, x, a);
+   store(y);
+   break_if_ssbo();
+   nir_pop_loop(b, loop);
+
+   /* Only the constants move. */
+   EXPECT_TRUE(run_licm());
+
+   EXPECT_TRUE(is_in_loop(v, loop));
+   EXPECT_TRUE(is_in_loop(x, loop));
+   EXPECT_TRUE(is_in_loop(y, loop));
+}
+
+TEST_F(nir_licm_test, phi)
+{
+   nir_ssa_def *zero = nir_imm_int(b, 0);
+   nir_loop *loop = nir_push_loop(b);
+   nir_ssa_def *one = nir_imm_int(b, 1);
+
+   nir_phi_instr *phi = nir_phi_instr_create(b->shader);
+   nir_ssa_dest_init(&phi->instr, &phi->dest, 1, 32, NULL);
+
+   nir_ssa_def *next = nir_iadd(b, &phi->dest.ssa, one);
+   store(next);
+   break_if_ssbo();
+   nir_pop_loop(b, loop);
+
+   nir_phi_src *src = ralloc(phi, nir_phi_src);
+   src->pred = nir_start_block(b->impl);
+   src->src = nir_src_for_ssa(zero);
+   exec_list_push_tail(&phi->srcs, &src->node);
+   src = ralloc(phi, nir_phi_src);
+   src->pred = nir_loop_last_block(loop);
+   src->src = nir_src_for_ssa(next);
+   exec_list_push_tail(&phi->srcs, &src->node);
+   nir_instr_insert(nir_before_block(nir_loop_first_block(loop)),
+                    &phi->instr);
+
+   EXPECT_TRUE(run_licm());
+
+   /* Only the constant moves. */
+   EXPECT_TRUE(is_in_block(one, nir_start_block(b->impl)));
+   EXPECT_TRUE(is_in_loop(next, loop));
+}
+
+TEST_F(nir_licm_test, load_ubo)
+{
+   nir_loop *loop = nir_push_loop(b);
+   nir_ssa_def *a = load_ubo(0);
+   store(a);
+   break_if_ssbo();
+   nir_ssa_def *c = load_ubo(16);
+   store(c);
+   nir_pop_loop(b, loop);
+
+   EXPECT_TRUE(run_licm());
+
+   /* The second load isn't reached if the loop breaks in the first
+    * iteration.
+    */
+   EXPECT_TRUE(is_in_block(a, nir_start_block(b->impl)));
+   EXPECT_TRUE(is_in_loop(c, loop));
+}
+
+TEST_F(nir_licm_test, load_ubo_in_if)
+{
+   nir_ssa_def *a = load_ubo(0);
+   nir_loop *loop = nir_push_loop(b);
+   nir_push_if(b, nir_ine(b, load_ssbo(0), nir_imm_int(b, 0)));
+   nir_ssa_def *c = load_ubo(16);
+   nir_ssa_def *x = nir_iadd(b, a, a);
+   store(nir_iadd(b, c, x));
+   nir_pop_if(b, NULL);
+   break_if_ssbo();
+   nir_pop_loop(b, loop);
+
+   EXPECT_TRUE(run_licm());
+
+   EXPECT_TRUE(is_in_loop(c, loop));
+   EXPECT_TRUE(is_in_block(x, nir_start_block(b->impl)));
+}
+
+TEST_F(nir_licm_test, reorderable_ssbo)
+{
+   nir_loop *loop = nir_push_loop(b);
+   nir_ssa_def *a = load_ssbo(0);
+   nir_ssa_def *c = load_ssbo(16);
+   nir_intrinsic_set_access(nir_instr_as_intrinsic(c->parent_instr),
+                            ACCESS_CAN_REORDER);
+   store(nir_iadd(b, a, c));
+   break_if_ssbo();
+   nir_pop_loop(b, loop);
+
+   EXPECT_TRUE(run_licm());
+
+   EXPECT_TRUE(is_in_loop(a, loop));
+   EXPECT_TRUE(is_in_block(c, nir_start_block(b->impl)));
+}
+
+TEST_F(nir_licm_test, nested_loops)
+{
+   nir_ssa_def *a = load_ubo(0);
+   nir_loop *outer = nir_push_loop(b);
+   nir_ssa_def *v = load_ssbo(0);
+   nir_loop *inner = nir_push_loop(b);
+   nir_ssa_def *x = nir_fmul(b, a, a);
+   nir_ssa_def *y = nir_fmul(b, v, a);
+   store(nir_fadd(b, x, y));
+   break_if_ssbo();
+   nir_pop_loop(b, inner);
+   break_if_ssbo();
+   nir_pop_loop(b, outer);
+
+   EXPECT_TRUE(run_licm());
+
+   /* x is invariant in both loops, y only in the inner one. */
+   EXPECT_TRUE(is_in_block(x, nir_start_block(b->impl)));
+   EXPECT_TRUE(is_in_loop(y, outer));
+   EXPECT_FALSE(is_in_loop(y, inner));
+}
+
+TEST_F(nir_licm_test, component_limit)
+{
+   options.max_live_components = 4;
+
+   nir_ssa_def *a = load_ubo(0, 4);
+   nir_loop *loop = nir_push_loop(b);
+   /* x is only needed for y, so hoisting both only keeps y live. */
+   nir_ssa_def *x = nir_fmul(b, a, a);
+   nir_ssa_def *y = nir_fdot4(b, x, a);
+   store(y);
+   nir_ssa_def *z = nir_fadd(b, a, a);
+   store(z);
+   break_if_ssbo();
+   nir_pop_loop(b, loop);
+
+   EXPECT_TRUE(run_licm());
+
+   EXPECT_TRUE(is_in_block(x, nir_start_block(b->impl)));
+   EXPECT_TRUE(is_in_block(y, nir_start_block(b->impl)));
+   EXPECT_TRUE(is_in_loop(z, loop));
+}
+
+TEST_F(nir_licm_test, uniform_values_are_free)
+{
+   options.max_live_components = 4;
+   options.uniform_values_are_free = true;
+
+   nir_ssa_def *a = load_ubo(0, 4);
+   nir_ssa_def *id = nir_u2f32(b, nir_load_local_invocation_id(b));
+   nir_loop *loop = nir_push_loop(b);
+   nir_ssa_def *x = nir_fadd(b, a, a);
+   store(x);
+   nir_ssa_def *y = nir_fmul(b, id, nir_channels(b, a, 0x7));
+   store(y);
+   nir_ssa_def *z = nir_fadd(b, id, nir_channels(b, a, 0x7));
+   store(z);
+   break_if_ssbo();
+   nir_pop_loop(b, loop);
+
+   EXPECT_TRUE(run_licm());
+
+   /* x is uniform, y and z are divergent and only one fits. */
+   EXPECT_TRUE(is_in_block(x, nir_start_block(b->impl)));
+   EXPECT_TRUE(is_in_block(y, nir_start_block(b->impl)));
+   EXPECT_TRUE(is_in_loop(z, loop));
+}
@@ -0,0 +1,491 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include "nir.h"
+#include "nir_builder.h"
+
+namespace {
+
+class nir_load_store_vectorize_test : public ::testing::Test {
+protected:
+   nir_load_store_vectorize_test();
+   ~nir_load_store_vectorize_test();
+
+   bool run_vectorizer(nir_variable_mode modes);
+
+   nir_intrinsic_instr *get_intrinsic(nir_intrinsic_op op, unsigned index);
+   unsigned count_intrinsics(nir_intrinsic_op op);
+
+   nir_ssa_def *create_load(nir_intrinsic_op op, nir_ssa_def *resource,
+                            nir_ssa_def *offset, unsigned components = 1,
+                            unsigned bit_size = 32);
+   void create_store(nir_intrinsic_op op, nir_ssa_def *resource,
+                     nir_ssa_def *offset, nir_ssa_def *value);
+
+   static bool mem_vectorize_callback(unsigned align, unsigned bit_size,
+                                      unsigned num_components,
+                                      unsigned high_offset,
+                                      nir_intrinsic_instr *low,
+                                      nir_intrinsic_instr *high);
+
+   void *mem_ctx;
+   nir_builder *b;
+
+   /* Set by the callback. */
+   static unsigned last_align;
+   static bool allow;
+};
+
+unsigned nir_load_store_vectorize_test::last_align;
+bool nir_load_store_vectorize_test::allow;
+
+nir_load_store_vectorize_test::nir_load_store_vectorize_test()
+{
+   glsl_type_singleton_init_or_ref();
+
+   mem_ctx = ralloc_context(NULL);
+   static const nir_shader_compiler_options options = { };
+   b = rzalloc(mem_ctx, nir_builder);
+   nir_builder_init_simple_shader(b, mem_ctx, MESA_SHADER_COMPUTE, &options);
+
+   last_align = 0;
+   allow = true;
+}
+
+nir_load_store_vectorize_test::~nir_load_store_vectorize_test()
+{
+   if (HasFailure()) {
+      printf("\nShader from the failed test:\n\n");
+      nir_print_shader(b->shader, stdout);
+   }
+
+   ralloc_free(mem_ctx);
+
+   glsl_type_singleton_decref();
+}
+
+bool
+nir_load_store_vectorize_test::mem_vectorize_callback(
+   unsigned align, unsigned bit_size, unsigned num_components,
+   unsigned high_offset, nir_intrinsic_instr *low, nir_intrinsic_instr *high)
+{
+   last_align = align;
+   return allow && align >= 4;
+}
+
+bool
+nir_load_store_vectorize_test::run_vectorizer(nir_variable_mode modes)
+{
+   bool progress = nir_opt_load_store_vectorize(b->shader, modes,
+                                                mem_vectorize_callback);
+   if (progress) {
+      nir_validate_shader(b->shader, NULL);
+      nir_opt_constant_folding(b->shader);
+      nir_copy_prop(b->shader);
+   }
+   return progress;
+}
+
+nir_intrinsic_instr *
+nir_load_store_vectorize_test::get_intrinsic(nir_intrinsic_op op,
+                                             unsigned index)
+{
+   nir_foreach_block(block, b->impl) {
+      nir_foreach_instr(instr, block) {
+         if (instr->type != nir_instr_type_intrinsic)
+            continue;
+         nir_intrinsic_instr *intrin = nir_instr_as_intrinsic(instr);
+         if (intrin->intrinsic == op) {
+            if (index == 0)
+               return intrin;
+            index--;
+         }
+      }
+   }
+   return NULL;
+}
+
+unsigned
+nir_load_store_vectorize_test::count_intrinsics(nir_intrinsic_op op)
+{
+   unsigned count = 0;
+   while (get_intrinsic(op, count))
+      count++;
+   return count;
+}
+
+nir_ssa_def *
+nir_load_store_vectorize_test::create_load(nir_intrinsic_op op,
+                                           nir_ssa_def *resource,
+                                           nir_ssa_def *offset,
+                                           unsigned components,
+                                           unsigned bit_size)
+{
+   nir_intrinsic_instr *load = nir_intrinsic_instr_create(b->shader, op);
+   load->num_components = components;
+   if (resource) {
+      load->src[0] = nir_src_for_ssa(resource);
+      load->src[1] = nir_src_for_ssa(offset);
+   } else {
+      load->src[0] = nir_src_for_ssa(offset);
+   }
+   nir_ssa_dest_init(&load->instr, &load->dest, components, bit_size, NULL);
+   nir_builder_instr_insert(b, &load->instr);
+   return &load->dest.ssa;
+}
+
+void
+nir_load_store_vectorize_test::create_store(nir_intrinsic_op op,
+                                            nir_ssa_def *resource,
+                                            nir_ssa_def *offset,
+                                            nir_ssa_def *value)
+{
+   nir_intrinsic_instr *store = nir_intrinsic_instr_create(b->shader, op);
+   store->num_components = value->num_components;
+   store->src[0] = nir_src_for_ssa(value);
+   if (resource) {
+      store->src[1] = nir_src_for_ssa(resource);
+      store->src[2] = nir_src_for_ssa(offset);
+   } else {
+      store->src[1] = nir_src_for_ssa(offset);
+   }
+   nir_intrinsic_set_write_mask(store, (1 << value->num_components) - 1);
+   nir_builder_instr_insert(b, &store->instr);
+}
+
+} /* namespace */
+
+TEST_F(nir_load_store_vectorize_test, ubo_load_adjacent)
+{
+   nir_ssa_def *x = create_load(nir_intrinsic_load_ubo, nir_imm_int(b, 0),
+                                nir_imm_int(b, 0));
+   nir_ssa_def *y = create_load(nir_intrinsic_load_ubo, nir_imm_int(b, 0),
+                                nir_imm_int(b, 4));
+   nir_ssa_def *zw = create_load(nir_intrinsic_load_ubo, nir_imm_int(b, 0),
+                                 nir_imm_int(b, 8), 2);
+   create_store(nir_intrinsic_store_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 0),
+                nir_vec4(b, x, y, nir_channel(b, zw, 0),
+                         nir_channel(b, zw, 1)));
+
+   ASSERT_TRUE(run_vectorizer(nir_var_mem_ubo));
+
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_ubo), 1);
+   nir_intrinsic_instr *load = get_intrinsic(nir_intrinsic_load_ubo, 0);
+   EXPECT_EQ(load->dest.ssa.num_components, 4);
+   EXPECT_EQ(nir_src_as_uint(load->src[1]), 0);
+}
+
+TEST_F(nir_load_store_vectorize_test, ubo_load_reverse_order)
+{
+   nir_ssa_def *y = create_load(nir_intrinsic_load_ubo, nir_imm_int(b, 0),
+                                nir_imm_int(b, 20));
+   nir_ssa_def *x = create_load(nir_intrinsic_load_ubo, nir_imm_int(b, 0),
+                                nir_imm_int(b, 16));
+   create_store(nir_intrinsic_store_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 0),
+                nir_vec2(b, x, y));
+
+   ASSERT_TRUE(run_vectorizer(nir_var_mem_ubo));
+
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_ubo), 1);
+   nir_intrinsic_instr *load = get_intrinsic(nir_intrinsic_load_ubo, 0);
+   EXPECT_EQ(load->dest.ssa.num_components, 2);
+   EXPECT_EQ(nir_src_as_uint(load->src[1]), 16);
+
+   /* x comes from the first component, so vec2(x, y) folds away. */
+   nir_intrinsic_instr *store = get_intrinsic(nir_intrinsic_store_ssbo, 0);
+   EXPECT_EQ(store->src[0].ssa, &load->dest.ssa);
+}
+
+TEST_F(nir_load_store_vectorize_test, ubo_load_different_resource)
+{
+   create_load(nir_intrinsic_load_ubo, nir_imm_int(b, 0), nir_imm_int(b, 0));
+   create_load(nir_intrinsic_load_ubo, nir_imm_int(b, 1), nir_imm_int(b, 4));
+
+   EXPECT_FALSE(run_vectorizer(nir_var_mem_ubo));
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ubo), 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, ubo_load_not_adjacent)
+{
+   create_load(nir_intrinsic_load_ubo, nir_imm_int(b, 0), nir_imm_int(b, 0));
+   create_load(nir_intrinsic_load_ubo, nir_imm_int(b, 0), nir_imm_int(b, 8));
+
+   EXPECT_FALSE(run_vectorizer(nir_var_mem_ubo));
+}
+
+TEST_F(nir_load_store_vectorize_test, ubo_load_mode_not_requested)
+{
+   create_load(nir_intrinsic_load_ubo, nir_imm_int(b, 0), nir_imm_int(b, 0));
+   create_load(nir_intrinsic_load_ubo, nir_imm_int(b, 0), nir_imm_int(b, 4));
+
+   EXPECT_FALSE(run_vectorizer(nir_var_mem_ssbo));
+}
+
+TEST_F(nir_load_store_vectorize_test, callback_refuses)
+{
+   create_load(nir_intrinsic_load_ubo, nir_imm_int(b, 0), nir_imm_int(b, 0));
+   create_load(nir_intrinsic_load_ubo, nir_imm_int(b, 0), nir_imm_int(b, 4));
+
+   allow = false;
+   EXPECT_FALSE(run_vectorizer(nir_var_mem_ubo));
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_indirect)
+{
+   nir_ssa_def *index = nir_load_local_invocation_index(b);
+   nir_ssa_def *base = nir_imul_imm(b, index, 16);
+   create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0),
+               nir_iadd_imm(b, base, 4));
+   create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0),
+               nir_iadd_imm(b, base, 8));
+
+   ASSERT_TRUE(run_vectorizer(nir_var_mem_ssbo));
+
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 1);
+   /* 16 * index + 4 is 4-byte aligned. */
+   EXPECT_EQ(last_align, 4);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_unknown_alignment)
+{
+   nir_ssa_def *index = nir_load_local_invocation_index(b);
+   create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0), index, 1, 16);
+   create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0),
+               nir_iadd_imm(b, index, 2), 1, 16);
+
+   /* Only the element size is known, which the callback refuses. */
+   EXPECT_FALSE(run_vectorizer(nir_var_mem_ssbo));
+   EXPECT_EQ(last_align, 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_store_between)
+{
+   create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 0));
+   create_store(nir_intrinsic_store_ssbo, nir_imm_int(b, 1), nir_imm_int(b, 0),
+                nir_imm_int(b, 7));
+   create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 4));
+
+   /* The store may alias the second load through another binding. */
+   EXPECT_FALSE(run_vectorizer(nir_var_mem_ssbo));
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_disjoint_store_between)
+{
+   create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 0));
+   create_store(nir_intrinsic_store_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 16),
+                nir_imm_int(b, 7));
+   create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 4));
+
+   EXPECT_TRUE(run_vectorizer(nir_var_mem_ssbo));
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 1);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_barrier_between)
+{
+   create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 0));
+   nir_intrinsic_instr *barrier =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_memory_barrier_buffer);
+   nir_builder_instr_insert(b, &barrier->instr);
+   create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 4));
+
+   EXPECT_FALSE(run_vectorizer(nir_var_mem_ssbo));
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_shared_barrier_between)
+{
+   create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 0));
+   nir_intrinsic_instr *barrier =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_memory_barrier_shared);
+   nir_builder_instr_insert(b, &barrier->instr);
+   create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 4));
+
+   EXPECT_TRUE(run_vectorizer(nir_var_mem_ssbo));
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_discard_if_between)
+{
+   b->shader->info.stage = MESA_SHADER_FRAGMENT;
+   create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 0));
+   nir_intrinsic_instr *discard =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_discard_if);
+   discard->src[0] = nir_src_for_ssa(nir_imm_false(b));
+   nir_builder_instr_insert(b, &discard->instr);
+   create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 4));
+
+   /* The second load must not be hoisted above the discard guarding it. */
+   EXPECT_FALSE(run_vectorizer(nir_var_mem_ssbo));
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_load_ssbo), 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_volatile)
+{
+   create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 0));
+   create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 4));
+   nir_intrinsic_set_access(get_intrinsic(nir_intrinsic_load_ssbo, 1),
+                            ACCESS_VOLATILE);
+
+   EXPECT_FALSE(run_vectorizer(nir_var_mem_ssbo));
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_load_different_access)
+{
+   create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 0));
+   create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 4));
+   nir_intrinsic_set_access(get_intrinsic(nir_intrinsic_load_ssbo, 1),
+                            ACCESS_COHERENT);
+
+   EXPECT_FALSE(run_vectorizer(nir_var_mem_ssbo));
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_store_adjacent)
+{
+   create_store(nir_intrinsic_store_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 4),
+                nir_imm_int(b, 2));
+   create_store(nir_intrinsic_store_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 0),
+                nir_imm_int(b, 1));
+   create_store(nir_intrinsic_store_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 8),
+                nir_imm_ivec2(b, 3, 4));
+
+   ASSERT_TRUE(run_vectorizer(nir_var_mem_ssbo));
+
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_store_ssbo), 1);
+   nir_intrinsic_instr *store = get_intrinsic(nir_intrinsic_store_ssbo, 0);
+   EXPECT_EQ(nir_src_as_uint(store->src[2]), 0);
+   EXPECT_EQ(nir_intrinsic_write_mask(store), 0xf);
+   ASSERT_TRUE(nir_src_is_const(store->src[0]));
+   for (unsigned i = 0; i < 4; i++)
+      EXPECT_EQ(nir_src_comp_as_uint(store->src[0], i), i + 1);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_store_load_between)
+{
+   create_store(nir_intrinsic_store_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 0),
+                nir_imm_int(b, 1));
+   create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 0));
+   create_store(nir_intrinsic_store_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 4),
+                nir_imm_int(b, 2));
+
+   /* Delaying the first store past the load would change what it reads. */
+   EXPECT_FALSE(run_vectorizer(nir_var_mem_ssbo));
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_store_ssbo), 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_store_discard_if_between)
+{
+   b->shader->info.stage = MESA_SHADER_FRAGMENT;
+   create_store(nir_intrinsic_store_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 0),
+                nir_imm_int(b, 1));
+   nir_intrinsic_instr *discard =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_discard_if);
+   discard->src[0] = nir_src_for_ssa(nir_imm_false(b));
+   nir_builder_instr_insert(b, &discard->instr);
+   create_store(nir_intrinsic_store_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 4),
+                nir_imm_int(b, 2));
+
+   /* The first store has to happen even if the fragment is discarded. */
+   EXPECT_FALSE(run_vectorizer(nir_var_mem_ssbo));
+   EXPECT_EQ(count_intrinsics(nir_intrinsic_store_ssbo), 2);
+}
+
+TEST_F(nir_load_store_vectorize_test, ssbo_store_partial_write_mask)
+{
+   create_store(nir_intrinsic_store_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 0),
+                nir_imm_ivec2(b, 1, 2));
+   nir_intrinsic_set_write_mask(get_intrinsic(nir_intrinsic_store_ssbo, 0),
+                                0x1);
+   create_store(nir_intrinsic_store_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 8),
+                nir_imm_int(b, 3));
+
+   EXPECT_FALSE(run_vectorizer(nir_var_mem_ssbo));
+}
+
+TEST_F(nir_load_store_vectorize_test, shared_load_base)
+{
+   nir_ssa_def *index = nir_load_local_invocation_index(b);
+   nir_ssa_def *offset = nir_imul_imm(b, index, 8);
+   create_load(nir_intrinsic_load_shared, NULL, offset);
+   nir_intrinsic_set_base(get_intrinsic(nir_intrinsic_load_shared, 0), 4);
+   create_load(nir_intrinsic_load_shared, NULL, offset);
+
+   ASSERT_TRUE(run_vectorizer(nir_var_mem_shared));
+
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_shared), 1);
+   nir_intrinsic_instr *load = get_intrinsic(nir_intrinsic_load_shared, 0);
+   EXPECT_EQ(load->dest.ssa.num_components, 2);
+
+   /* The combined load starts at the second one, with no base. */
+   EXPECT_EQ(nir_intrinsic_base(load), 0);
+   EXPECT_EQ(load->src[0].ssa, offset);
+}
+
+TEST_F(nir_load_store_vectorize_test, shared_store_atomic_between)
+{
+   create_store(nir_intrinsic_store_shared, NULL, nir_imm_int(b, 0),
+                nir_imm_int(b, 1));
+   nir_intrinsic_instr *atomic =
+      nir_intrinsic_instr_create(b->shader, nir_intrinsic_shared_atomic_add);
+   atomic->src[0] = nir_src_for_ssa(nir_imm_int(b, 64));
+   atomic->src[1] = nir_src_for_ssa(nir_imm_int(b, 1));
+   nir_ssa_dest_init(&atomic->instr, &atomic->dest, 1, 32, NULL);
+   nir_builder_instr_insert(b, &atomic->instr);
+   create_store(nir_intrinsic_store_shared, NULL, nir_imm_int(b, 4),
+                nir_imm_int(b, 2));
+
+   EXPECT_FALSE(run_vectorizer(nir_var_mem_shared));
+}
+
+TEST_F(nir_load_store_vectorize_test, global_load_64bit_address)
+{
+   nir_ssa_def *addr = nir_pack_64_2x32(b, nir_load_local_invocation_id(b));
+   addr = nir_iand(b, addr, nir_imm_int64(b, ~0xfull));
+   create_load(nir_intrinsic_load_global, NULL, addr, 2);
+   create_load(nir_intrinsic_load_global, NULL, nir_iadd_imm(b, addr, 8), 2);
+
+   ASSERT_TRUE(run_vectorizer(nir_var_mem_global));
+
+   ASSERT_EQ(count_intrinsics(nir_intrinsic_load_global), 1);
+   nir_intrinsic_instr *load = get_intrinsic(nir_intrinsic_load_global, 0);
+   EXPECT_EQ(load->dest.ssa.num_components, 4);
+   EXPECT_EQ(load->src[0].ssa, addr);
+}
+
+TEST_F(nir_load_store_vectorize_test, global_store_ssbo_load_between)
+{
+   create_store(nir_intrinsic_store_global, NULL, nir_imm_int64(b, 0x1000),
+                nir_imm_int(b, 1));
+   create_load(nir_intrinsic_load_ssbo, nir_imm_int(b, 0), nir_imm_int(b, 0));
+   create_store(nir_intrinsic_store_global, NULL, nir_imm_int64(b, 0x1004),
+                nir_imm_int(b, 2));
+
+   /* SSBOs and global memory may alias. */
+   EXPECT_FALSE(run_vectorizer(nir_var_mem_global));
+}
+
+TEST_F(nir_load_store_vectorize_test, too_many_components)
+{
+   create_load(nir_intrinsic_load_ubo, nir_imm_int(b, 0), nir_imm_int(b, 0), 3);
+   create_load(nir_intrinsic_load_ubo, nir_imm_int(b, 0), nir_imm_int(b, 12), 2);
+
+   EXPECT_FALSE(run_vectorizer(nir_var_mem_ubo));
+}
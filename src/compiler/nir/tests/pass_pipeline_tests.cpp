@@ -0,0 +1,201 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include "nir.h"
+#include "nir_builder.h"
+#include "nir_pass_pipeline.h"
+
+namespace {
+
+/* Fake passes that make progress a given number of times. */
+struct fake_pass {
+   unsigned calls;
+   unsigned progress_left;
+};
+
+static fake_pass alu_pass, vars_pass, other_pass;
+
+static bool
+run_fake_pass(nir_shader *shader, fake_pass *pass)
+{
+   pass->calls++;
+   if (!pass->progress_left)
+      return false;
+
+   pass->progress_left--;
+   nir_metadata_preserve(nir_shader_get_entrypoint(shader), nir_metadata_none);
+   return true;
+}
+
+static bool
+fake_alu_pass(nir_shader *shader)
+{
+   return run_fake_pass(shader, &alu_pass);
+}
+
+static bool
+fake_vars_pass(nir_shader *shader)
+{
+   return run_fake_pass(shader, &vars_pass);
+}
+
+static bool
+fake_other_pass(nir_shader *shader)
+{
+   return run_fake_pass(shader, &other_pass);
+}
+
+class nir_pass_pipeline_test : public ::testing::Test {
+protected:
+   nir_pass_pipeline_test()
+   {
+      glsl_type_singleton_init_or_ref();
+
+      static const nir_shader_compiler_options options = { };
+      nir_builder b;
+      nir_builder_init_simple_shader(&b, NULL, MESA_SHADER_COMPUTE, &options);
+      shader = b.shader;
+
+      memset(&alu_pass, 0, sizeof(alu_pass));
+      memset(&vars_pass, 0, sizeof(vars_pass));
+      memset(&other_pass, 0, sizeof(other_pass));
+
+      nir_pass_pipeline_init(&pipeline);
+      nir_pass_pipeline_declare(&pipeline, "fake_alu_pass",
+                                nir_pass_ir_alu, nir_pass_ir_alu, false);
+      nir_pass_pipeline_declare(&pipeline, "fake_vars_pass",
+                                nir_pass_ir_vars, nir_pass_ir_vars, true);
+   }
+
+   ~nir_pass_pipeline_test()
+   {
+      ralloc_free(shader);
+      glsl_type_singleton_decref();
+   }
+
+   unsigned
+   run_loop()
+   {
+      unsigned iterations = 0;
+      bool progress;
+      do {
+         progress = false;
+         iterations++;
+         NIR_PIPELINE_PASS(progress, &pipeline, shader, fake_alu_pass);
+         NIR_PIPELINE_PASS(progress, &pipeline, shader, fake_vars_pass);
+         NIR_PIPELINE_PASS(progress, &pipeline, shader, fake_other_pass);
+      } while (progress);
+      return iterations;
+   }
+
+   nir_shader *shader;
+   nir_pass_pipeline pipeline;
+};
+
+} /* namespace */
+
+TEST_F(nir_pass_pipeline_test, no_progress)
+{
+   EXPECT_EQ(1u, run_loop());
+   EXPECT_EQ(1u, alu_pass.calls);
+   EXPECT_EQ(1u, vars_pass.calls);
+   EXPECT_EQ(1u, other_pass.calls);
+}
+
+TEST_F(nir_pass_pipeline_test, unrelated_progress)
+{
+   alu_pass.progress_left = 3;
+
+   /* The ALU pass makes progress three times and has to run again each
+    * time.  The undeclared pass, which reads everything, runs after each of
+    * those, but not in the last trip where nothing changed.  The vars pass
+    * doesn't care about ALU changes at all.
+    */
+   EXPECT_EQ(4u, run_loop());
+   EXPECT_EQ(4u, alu_pass.calls);
+   EXPECT_EQ(1u, vars_pass.calls);
+   EXPECT_EQ(3u, other_pass.calls);
+}
+
+TEST_F(nir_pass_pipeline_test, idempotent)
+{
+   vars_pass.progress_left = 1;
+
+   /* The vars pass doesn't run again after its own progress, and nothing
+    * else reacts to it except the undeclared pass.
+    */
+   EXPECT_EQ(2u, run_loop());
+   EXPECT_EQ(1u, alu_pass.calls);
+   EXPECT_EQ(1u, vars_pass.calls);
+   EXPECT_EQ(1u, other_pass.calls);
+}
+
+TEST_F(nir_pass_pipeline_test, everything_reacts_to_undeclared)
+{
+   other_pass.progress_left = 1;
+
+   EXPECT_EQ(2u, run_loop());
+   EXPECT_EQ(2u, alu_pass.calls);
+   EXPECT_EQ(2u, vars_pass.calls);
+   EXPECT_EQ(2u, other_pass.calls);
+}
+
+TEST_F(nir_pass_pipeline_test, invalidate)
+{
+   run_loop();
+   nir_pass_pipeline_invalidate(&pipeline, nir_pass_ir_vars);
+   run_loop();
+
+   EXPECT_EQ(1u, alu_pass.calls);
+   EXPECT_EQ(2u, vars_pass.calls);
+   EXPECT_EQ(2u, other_pass.calls);
+}
+
+TEST_F(nir_pass_pipeline_test, known_passes)
+{
+   nir_pass_pipeline_pass *pass =
+      nir_pass_pipeline_begin_pass(&pipeline, "nir_lower_vars_to_ssa", 1);
+   ASSERT_NE(nullptr, pass);
+   nir_pass_pipeline_end_pass(&pipeline, pass, false);
+
+   /* Nothing changed. */
+   EXPECT_EQ(nullptr,
+             nir_pass_pipeline_begin_pass(&pipeline,
+                                          "nir_lower_vars_to_ssa", 1));
+
+   /* Same pass, different call site. */
+   pass = nir_pass_pipeline_begin_pass(&pipeline, "nir_lower_vars_to_ssa", 2);
+   ASSERT_NE(nullptr, pass);
+   nir_pass_pipeline_end_pass(&pipeline, pass, false);
+
+   /* ALU changes don't make vars_to_ssa do anything. */
+   nir_pass_pipeline_invalidate(&pipeline, nir_pass_ir_alu);
+   EXPECT_EQ(nullptr,
+             nir_pass_pipeline_begin_pass(&pipeline,
+                                          "nir_lower_vars_to_ssa", 1));
+
+   nir_pass_pipeline_invalidate(&pipeline, nir_pass_ir_cf);
+   EXPECT_NE(nullptr,
+             nir_pass_pipeline_begin_pass(&pipeline,
+                                          "nir_lower_vars_to_ssa", 1));
+}
@@ -0,0 +1,175 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include <string>
+#include "nir.h"
+#include "nir_builder.h"
+
+namespace {
+
+class nir_profile_test : public ::testing::Test {
+protected:
+   nir_profile_test()
+   {
+      glsl_type_singleton_init_or_ref();
+      nir_profile_enable(true);
+      nir_profile_reset();
+   }
+
+   ~nir_profile_test()
+   {
+      nir_profile_enable(false);
+      nir_profile_reset();
+      glsl_type_singleton_decref();
+   }
+
+   nir_shader *
+   create_shader(gl_shader_stage stage)
+   {
+      static const nir_shader_compiler_options options = { };
+      nir_builder b;
+      nir_builder_init_simple_shader(&b, NULL, stage, &options);
+
+      /* Three dead instructions. */
+      nir_fadd(&b, nir_imm_float(&b, 1.0), nir_imm_float(&b, 2.0));
+
+      return b.shader;
+   }
+
+   const nir_pass_profile *
+   find(const char *pass, gl_shader_stage stage)
+   {
+      unsigned count = nir_profile_get_passes(passes, ARRAY_SIZE(passes));
+      for (unsigned i = 0; i < MIN2(count, ARRAY_SIZE(passes)); i++) {
+         if (strcmp(passes[i].pass, pass) == 0 && passes[i].stage == stage)
+            return &passes[i];
+      }
+      return NULL;
+   }
+
+   nir_pass_profile passes[16];
+};
+
+} /* namespace */
+
+static bool
+nested_dce(nir_shader *shader)
+{
+   bool progress = false;
+   NIR_PASS(progress, shader, nir_opt_dce);
+   return progress;
+}
+
+TEST_F(nir_profile_test, counts_per_pass_and_stage)
+{
+   nir_shader *fs = create_shader(MESA_SHADER_FRAGMENT);
+   nir_shader *vs = create_shader(MESA_SHADER_VERTEX);
+
+   bool progress = false;
+   NIR_PASS(progress, fs, nir_opt_dce);
+   EXPECT_TRUE(progress);
+   progress = false;
+   NIR_PASS(progress, fs, nir_opt_dce);
+   EXPECT_FALSE(progress);
+   NIR_PASS_V(vs, nir_opt_dce);
+
+   const nir_pass_profile *p = find("nir_opt_dce", MESA_SHADER_FRAGMENT);
+   ASSERT_NE(p, nullptr);
+   EXPECT_EQ(2u, p->calls);
+   EXPECT_EQ(1u, p->progress);
+   EXPECT_EQ(3u, p->instrs_before);
+   EXPECT_EQ(0u, p->instrs_after);
+
+   p = find("nir_opt_dce", MESA_SHADER_VERTEX);
+   ASSERT_NE(p, nullptr);
+   EXPECT_EQ(1u, p->calls);
+   EXPECT_EQ(0u, p->progress);
+   EXPECT_EQ(3u, p->instrs_before);
+   EXPECT_EQ(0u, p->instrs_after);
+
+   EXPECT_EQ(nullptr, find("nir_opt_dce", MESA_SHADER_COMPUTE));
+
+   ralloc_free(fs);
+   ralloc_free(vs);
+}
+
+TEST_F(nir_profile_test, disabled)
+{
+   nir_profile_enable(false);
+
+   nir_shader *fs = create_shader(MESA_SHADER_FRAGMENT);
+   NIR_PASS_V(fs, nir_opt_dce);
+   EXPECT_EQ(0u, nir_profile_get_passes(NULL, 0));
+
+   ralloc_free(fs);
+}
+
+TEST_F(nir_profile_test, nested)
+{
+   nir_shader *fs = create_shader(MESA_SHADER_FRAGMENT);
+   NIR_PASS_V(fs, nested_dce);
+
+   const nir_pass_profile *outer = find("nested_dce", MESA_SHADER_FRAGMENT);
+   ASSERT_NE(outer, nullptr);
+   const nir_pass_profile inner = *find("nir_opt_dce", MESA_SHADER_FRAGMENT);
+
+   EXPECT_EQ(1u, inner.calls);
+   EXPECT_EQ(inner.time_ns, inner.self_time_ns);
+   EXPECT_EQ(outer->time_ns, outer->self_time_ns + inner.time_ns);
+
+   /* The stage total only counts the time once. */
+   FILE *fp = tmpfile();
+   nir_profile_print_json(fp);
+   std::string json(ftell(fp), '\0');
+   rewind(fp);
+   EXPECT_EQ(json.size(), fread(&json[0], 1, json.size(), fp));
+   fclose(fp);
+
+   EXPECT_NE(std::string::npos,
+             json.find("\"FS\": { \"calls\": 2, \"time_ns\": " +
+                       std::to_string(outer->time_ns) + " }"));
+
+   ralloc_free(fs);
+}
+
+TEST_F(nir_profile_test, json)
+{
+   nir_shader *fs = create_shader(MESA_SHADER_FRAGMENT);
+   NIR_PASS_V(fs, nir_opt_dce);
+
+   FILE *fp = tmpfile();
+   nir_profile_print_json(fp);
+   std::string json(ftell(fp), '\0');
+   rewind(fp);
+   EXPECT_EQ(json.size(), fread(&json[0], 1, json.size(), fp));
+   fclose(fp);
+
+   EXPECT_NE(std::string::npos,
+             json.find("\"pass\": \"nir_opt_dce\", \"stage\": \"FS\", "
+                       "\"calls\": 1, \"progress\": 0"));
+   EXPECT_NE(std::string::npos, json.find("\"instrs_before\": 3, "
+                                          "\"instrs_after\": 0"));
+   EXPECT_NE(std::string::npos, json.find("\"FS\": { \"calls\": 1"));
+
+   ralloc_free(fs);
+}
@@ -0,0 +1,277 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Size and speed of nir_serialize/nir_deserialize over a set of shaders.
+ *
+ * Usage: nir_serialize_bench [file.spv ...]
+ *
+ * Each argument is a SPIR-V module with a "main" entry point; the stage is
+ * taken from the file name (foo.vert.spv, foo.comp.spv, ...) and defaults to
+ * fragment.  The shaders go through the usual early NIR lowering so that
+ * what gets serialized looks like what drivers put in the disk cache.  With
+ * no arguments a built-in set of synthetic shaders is used instead.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "nir.h"
+#include "nir_builder.h"
+#include "nir_serialize.h"
+#include "spirv/nir_spirv.h"
+#include "util/os_time.h"
+
+#define ITERATIONS 200
+
+static const nir_shader_compiler_options options = {
+   .lower_fpow = true,
+   .lower_fsat = true,
+   .lower_fdiv = true,
+};
+
+static gl_shader_stage
+stage_from_filename(const char *filename)
+{
+   static const struct {
+      const char *ext;
+      gl_shader_stage stage;
+   } exts[] = {
+      { ".vert", MESA_SHADER_VERTEX },
+      { ".tesc", MESA_SHADER_TESS_CTRL },
+      { ".tese", MESA_SHADER_TESS_EVAL },
+      { ".geom", MESA_SHADER_GEOMETRY },
+      { ".frag", MESA_SHADER_FRAGMENT },
+      { ".comp", MESA_SHADER_COMPUTE },
+   };
+
+   for (unsigned i = 0; i < ARRAY_SIZE(exts); i++) {
+      if (strstr(filename, exts[i].ext))
+         return exts[i].stage;
+   }
+   return MESA_SHADER_FRAGMENT;
+}
+
+static nir_shader *
+load_spirv(const char *filename)
+{
+   int fd = open(filename, O_RDONLY);
+   if (fd < 0) {
+      fprintf(stderr, "Failed to open %s: %s\n", filename, strerror(errno));
+      return NULL;
+   }
+
+   off_t len = lseek(fd, 0, SEEK_END);
+   const void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+   if (map == MAP_FAILED || len % 4 != 0) {
+      fprintf(stderr, "%s is not a SPIR-V module\n", filename);
+      return NULL;
+   }
+
+   const struct spirv_to_nir_options spirv_opts = { 0 };
+   nir_shader *nir =
+      spirv_to_nir(map, len / 4, NULL, 0, stage_from_filename(filename),
+                   "main", &spirv_opts, &options);
+   munmap((void *)map, len);
+   if (!nir)
+      return NULL;
+
+   NIR_PASS_V(nir, nir_lower_constant_initializers, nir_var_function_temp);
+   NIR_PASS_V(nir, nir_lower_returns);
+   NIR_PASS_V(nir, nir_inline_functions);
+   NIR_PASS_V(nir, nir_opt_deref);
+   foreach_list_typed_safe(nir_function, func, node, &nir->functions) {
+      if (!func->is_entrypoint)
+         exec_node_remove(&func->node);
+   }
+   NIR_PASS_V(nir, nir_lower_vars_to_ssa);
+   NIR_PASS_V(nir, nir_copy_prop);
+   NIR_PASS_V(nir, nir_opt_dce);
+
+   return nir;
+}
+
+/* A fragment shader of roughly the shape of a forward lighting pass: a loop
+ * over a uniform array of lights, some texturing and a fair amount of
+ * swizzled vector math.
+ */
+static nir_shader *
+build_synthetic(unsigned num_lights, unsigned num_textures)
+{
+   const struct glsl_type *vec4 = glsl_vec4_type();
+   nir_builder b;
+
+   nir_builder_init_simple_shader(&b, NULL, MESA_SHADER_FRAGMENT, &options);
+
+   nir_variable *lights =
+      nir_variable_create(b.shader, nir_var_uniform,
+                          glsl_array_type(vec4, num_lights * 2, 0), "lights");
+   nir_variable *in_pos =
+      nir_variable_create(b.shader, nir_var_shader_in, vec4, "in_pos");
+   nir_variable *in_uv =
+      nir_variable_create(b.shader, nir_var_shader_in, vec4, "in_uv");
+   nir_variable *out_color =
+      nir_variable_create(b.shader, nir_var_shader_out, vec4, "out_color");
+   nir_variable *color = nir_local_variable_create(b.impl, vec4, "color");
+   nir_variable *i = nir_local_variable_create(b.impl, glsl_int_type(), "i");
+
+   nir_ssa_def *pos = nir_load_var(&b, in_pos);
+   nir_ssa_def *uv = nir_load_var(&b, in_uv);
+
+   nir_ssa_def *albedo = nir_imm_vec4(&b, 0, 0, 0, 0);
+   for (unsigned t = 0; t < num_textures; t++) {
+      nir_tex_instr *tex = nir_tex_instr_create(b.shader, 1);
+      tex->op = nir_texop_tex;
+      tex->sampler_dim = GLSL_SAMPLER_DIM_2D;
+      tex->dest_type = nir_type_float;
+      tex->coord_components = 2;
+      tex->texture_index = t;
+      tex->sampler_index = t;
+      tex->src[0].src_type = nir_tex_src_coord;
+      tex->src[0].src = nir_src_for_ssa(nir_channels(&b, uv, 0x3));
+      nir_ssa_dest_init(&tex->instr, &tex->dest, 4, 32, NULL);
+      nir_builder_instr_insert(&b, &tex->instr);
+      albedo = nir_ffma(&b, &tex->dest.ssa, nir_imm_float(&b, 0.5), albedo);
+   }
+
+   nir_store_var(&b, color, nir_fmul_imm(&b, albedo, 0.1), 0xf);
+   nir_store_var(&b, i, nir_imm_int(&b, 0), 0x1);
+
+   nir_loop *loop = nir_push_loop(&b);
+   {
+      nir_ssa_def *idx = nir_load_var(&b, i);
+      nir_push_if(&b, nir_ige(&b, idx, nir_imm_int(&b, num_lights)));
+      nir_jump(&b, nir_jump_break);
+      nir_pop_if(&b, NULL);
+
+      nir_ssa_def *base = nir_imul_imm(&b, idx, 2);
+      nir_ssa_def *light_pos =
+         nir_load_deref(&b, nir_build_deref_array(&b,
+            nir_build_deref_var(&b, lights), base));
+      nir_ssa_def *light_color =
+         nir_load_deref(&b, nir_build_deref_array(&b,
+            nir_build_deref_var(&b, lights), nir_iadd_imm(&b, base, 1)));
+
+      nir_ssa_def *l = nir_fsub(&b, nir_channels(&b, light_pos, 0x7),
+                                    nir_channels(&b, pos, 0x7));
+      nir_ssa_def *dist2 = nir_fdot3(&b, l, l);
+      nir_ssa_def *n = nir_fmul(&b, l, nir_frsq(&b, dist2));
+      nir_ssa_def *ndotl = nir_fmax(&b, nir_channel(&b, n, 2),
+                                    nir_imm_float(&b, 0));
+      nir_ssa_def *atten = nir_frcp(&b, nir_fadd_imm(&b, dist2, 1.0));
+      nir_ssa_def *scale = nir_fmul(&b, ndotl, atten);
+
+      nir_push_if(&b, nir_flt(&b, nir_imm_float(&b, 0.001), scale));
+      {
+         nir_ssa_def *c = nir_load_var(&b, color);
+         nir_ssa_def *lit = nir_fmul(&b, light_color, albedo);
+         nir_store_var(&b, color,
+                       nir_ffma(&b, lit, nir_fsat(&b, scale), c), 0x7);
+      }
+      nir_pop_if(&b, NULL);
+
+      nir_store_var(&b, i, nir_iadd_imm(&b, idx, 1), 0x1);
+   }
+   nir_pop_loop(&b, loop);
+
+   nir_store_var(&b, out_color, nir_load_var(&b, color), 0xf);
+
+   nir_shader *nir = b.shader;
+   NIR_PASS_V(nir, nir_lower_vars_to_ssa);
+   NIR_PASS_V(nir, nir_copy_prop);
+   NIR_PASS_V(nir, nir_opt_algebraic);
+   NIR_PASS_V(nir, nir_opt_dce);
+
+   return nir;
+}
+
+int
+main(int argc, char **argv)
+{
+   nir_shader *shaders[64];
+   unsigned num_shaders = 0;
+
+   glsl_type_singleton_init_or_ref();
+
+   if (argc > 1) {
+      for (int a = 1; a < argc && num_shaders < ARRAY_SIZE(shaders); a++) {
+         nir_shader *nir = load_spirv(argv[a]);
+         if (nir)
+            shaders[num_shaders++] = nir;
+      }
+   } else {
+      for (unsigned l = 1; l <= 8; l++) {
+         for (unsigned t = 0; t < 4; t++)
+            shaders[num_shaders++] = build_synthetic(l * l, t);
+      }
+   }
+
+   if (num_shaders == 0) {
+      fprintf(stderr, "No shaders to benchmark\n");
+      return 1;
+   }
+
+   size_t total_size = 0;
+   int64_t write_ns = 0, read_ns = 0;
+
+   for (unsigned s = 0; s < num_shaders; s++) {
+      struct blob blob;
+      blob_init(&blob);
+      nir_serialize(&blob, shaders[s], true);
+      total_size += blob.size;
+
+      int64_t start = os_time_get_nano();
+      for (unsigned it = 0; it < ITERATIONS; it++) {
+         struct blob tmp;
+         blob_init(&tmp);
+         nir_serialize(&tmp, shaders[s], true);
+         blob_finish(&tmp);
+      }
+      write_ns += os_time_get_nano() - start;
+
+      start = os_time_get_nano();
+      for (unsigned it = 0; it < ITERATIONS; it++) {
+         struct blob_reader reader;
+         blob_reader_init(&reader, blob.data, blob.size);
+         ralloc_free(nir_deserialize(NULL, &options, &reader));
+      }
+      read_ns += os_time_get_nano() - start;
+
+      blob_finish(&blob);
+      ralloc_free(shaders[s]);
+   }
+
+   printf("shaders:           %u\n", num_shaders);
+   printf("serialized bytes:  %zu\n", total_size);
+   printf("serialize us:      %.2f per shader\n",
+          write_ns / 1000.0 / (num_shaders * ITERATIONS));
+   printf("deserialize us:    %.2f per shader\n",
+          read_ns / 1000.0 / (num_shaders * ITERATIONS));
+
+   glsl_type_singleton_decref();
+   return 0;
+}
@@ -0,0 +1,329 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include <string>
+#include "nir.h"
+#include "nir_builder.h"
+#include "nir_serialize.h"
+
+namespace {
+
+class nir_serialize_test : public ::testing::Test {
+protected:
+   nir_serialize_test()
+   {
+      glsl_type_singleton_init_or_ref();
+
+      static const nir_shader_compiler_options options = { };
+      nir_builder_init_simple_shader(&b, NULL, MESA_SHADER_FRAGMENT, &options);
+   }
+
+   ~nir_serialize_test()
+   {
+      ralloc_free(b.shader);
+      glsl_type_singleton_decref();
+   }
+
+   static std::string
+   print(nir_shader *shader)
+   {
+      FILE *fp = tmpfile();
+      nir_print_shader(shader, fp);
+
+      std::string str(ftell(fp), '\0');
+      rewind(fp);
+      EXPECT_EQ(str.size(), fread(&str[0], 1, str.size(), fp));
+      fclose(fp);
+
+      return str;
+   }
+
+   /* Serializes the shader, reads it back and checks that the copy prints
+    * the same, validates, and serializes to the exact same bytes.
+    */
+   void
+   round_trip()
+   {
+      nir_validate_shader(b.shader, "before serialization");
+      nir_index_ssa_defs(b.impl);
+
+      struct blob blob;
+      blob_init(&blob);
+      nir_serialize(&blob, b.shader, false);
+
+      struct blob_reader reader;
+      blob_reader_init(&reader, blob.data, blob.size);
+      nir_shader *copy = nir_deserialize(NULL, b.shader->options, &reader);
+      ASSERT_NE(copy, nullptr);
+      EXPECT_FALSE(reader.overrun);
+      EXPECT_EQ(reader.current, reader.end);
+
+      nir_validate_shader(copy, "after deserialization");
+      EXPECT_EQ(print(b.shader), print(copy));
+
+      struct blob blob2;
+      blob_init(&blob2);
+      nir_serialize(&blob2, copy, false);
+      ASSERT_EQ(blob.size, blob2.size);
+      EXPECT_EQ(0, memcmp(blob.data, blob2.data, blob.size));
+
+      size = blob.size;
+
+      blob_finish(&blob2);
+      blob_finish(&blob);
+      ralloc_free(copy);
+   }
+
+   nir_variable *
+   create_var(nir_variable_mode mode, const glsl_type *type, const char *name)
+   {
+      if (mode == nir_var_function_temp)
+         return nir_local_variable_create(b.impl, type, name);
+      else
+         return nir_variable_create(b.shader, mode, type, name);
+   }
+
+   nir_builder b;
+   size_t size = 0;
+};
+
+} /* namespace */
+
+TEST_F(nir_serialize_test, alu_swizzles_and_modifiers)
+{
+   nir_ssa_def *v = nir_imm_vec4(&b, 1.0, 2.0, 3.0, 4.0);
+   nir_ssa_def *x = nir_channel(&b, v, 2);
+   nir_ssa_def *sum = nir_fadd(&b, v, v);
+
+   nir_alu_instr *alu = nir_instr_as_alu(sum->parent_instr);
+   for (unsigned i = 0; i < 4; i++)
+      alu->src[1].swizzle[i] = 3 - i;
+   alu->src[0].negate = true;
+   alu->src[1].abs = true;
+   alu->dest.saturate = true;
+   alu->exact = true;
+
+   nir_ssa_def *i = nir_iadd(&b, nir_f2i32(&b, x), nir_imm_int(&b, 7));
+   nir_instr_as_alu(i->parent_instr)->no_signed_wrap = true;
+   nir_fmul(&b, sum, nir_i2f32(&b, i));
+
+   round_trip();
+}
+
+TEST_F(nir_serialize_test, load_const_packings)
+{
+   nir_imm_int(&b, 0);
+   nir_imm_int(&b, -1);
+   nir_imm_int(&b, (1 << 19) - 1);
+   nir_imm_int(&b, -(1 << 19));
+   nir_imm_int(&b, 1 << 19);
+   nir_imm_int(&b, 0x12345678);
+   nir_imm_float(&b, 1.0);
+   nir_imm_float(&b, 0.1);
+   nir_imm_double(&b, 0.5);
+   nir_imm_double(&b, 0.1);
+   nir_imm_int64(&b, -5);
+   nir_imm_int64(&b, 0x123456789abcdefll);
+   nir_imm_intN_t(&b, 200, 8);
+   nir_imm_intN_t(&b, 0xbeef, 16);
+   nir_imm_true(&b);
+   nir_imm_false(&b);
+   nir_imm_ivec4(&b, 1, -2, 3, 0x7fffffff);
+   nir_ssa_undef(&b, 3, 16);
+
+   round_trip();
+}
+
+TEST_F(nir_serialize_test, derefs_and_intrinsics)
+{
+   glsl_struct_field fields[2] = {
+      glsl_struct_field(glsl_vec4_type(), "a"),
+      glsl_struct_field(glsl_array_type(glsl_float_type(), 4, 0), "b"),
+   };
+   const glsl_type *s_type = glsl_struct_type(fields, 2, "S", false);
+   const glsl_type *arr_type = glsl_array_type(s_type, 8, 0);
+
+   nir_variable *in = create_var(nir_var_shader_in, glsl_vec4_type(), "in");
+   nir_variable *out = create_var(nir_var_shader_out, glsl_vec4_type(), "out");
+   nir_variable *temp = create_var(nir_var_function_temp, arr_type, "temp");
+   nir_variable *ssbo = create_var(nir_var_mem_ssbo, arr_type, "ssbo");
+
+   nir_ssa_def *idx = nir_f2i32(&b, nir_channel(&b, nir_load_var(&b, in), 0));
+
+   nir_deref_instr *elem = nir_build_deref_array(&b, nir_build_deref_var(&b, temp), idx);
+   nir_deref_instr *field = nir_build_deref_struct(&b, elem, 1);
+   nir_deref_instr *scalar = nir_build_deref_array_imm(&b, field, 2);
+   nir_store_deref(&b, scalar, nir_imm_float(&b, 3.0), 0x1);
+
+   nir_deref_instr *ssbo_elem =
+      nir_build_deref_array(&b, nir_build_deref_var(&b, ssbo), idx);
+   nir_ssa_def *val = nir_load_deref(&b, nir_build_deref_struct(&b, ssbo_elem, 0));
+
+   /* A cast has no type to derive. */
+   nir_deref_instr *cast =
+      nir_build_deref_cast(&b, &ssbo_elem->dest.ssa, nir_var_mem_ssbo, s_type, 0);
+   val = nir_fadd(&b, val, nir_load_deref(&b, nir_build_deref_struct(&b, cast, 0)));
+
+   nir_store_var(&b, out, val, 0xf);
+
+   nir_intrinsic_instr *load =
+      nir_intrinsic_instr_create(b.shader, nir_intrinsic_load_ubo);
+   load->num_components = 2;
+   load->src[0] = nir_src_for_ssa(nir_imm_int(&b, 1));
+   load->src[1] = nir_src_for_ssa(nir_imm_int(&b, 64));
+   nir_ssa_dest_init(&load->instr, &load->dest, 2, 32, "ubo");
+   nir_builder_instr_insert(&b, &load->instr);
+
+   round_trip();
+}
+
+TEST_F(nir_serialize_test, tex)
+{
+   nir_tex_instr *tex = nir_tex_instr_create(b.shader, 3);
+   tex->op = nir_texop_tg4;
+   tex->sampler_dim = GLSL_SAMPLER_DIM_2D;
+   tex->dest_type = nir_type_float;
+   tex->coord_components = 3;
+   tex->is_array = true;
+   tex->is_shadow = true;
+   tex->component = 2;
+   tex->texture_index = 5;
+   tex->sampler_index = 200;
+   tex->texture_non_uniform = true;
+   tex->tg4_offsets[1][0] = -3;
+   tex->tg4_offsets[3][1] = 7;
+   tex->src[0].src_type = nir_tex_src_coord;
+   tex->src[0].src = nir_src_for_ssa(nir_vec3(&b, nir_imm_float(&b, 0.5),
+                                                 nir_imm_float(&b, 0.5),
+                                                 nir_imm_float(&b, 1.0)));
+   tex->src[1].src_type = nir_tex_src_comparator;
+   tex->src[1].src = nir_src_for_ssa(nir_imm_float(&b, 0.25));
+   tex->src[2].src_type = nir_tex_src_texture_offset;
+   tex->src[2].src = nir_src_for_ssa(nir_imm_int(&b, 1));
+   nir_ssa_dest_init(&tex->instr, &tex->dest, 4, 32, NULL);
+   nir_builder_instr_insert(&b, &tex->instr);
+
+   round_trip();
+}
+
+TEST_F(nir_serialize_test, control_flow_and_phis)
+{
+   nir_variable *out = create_var(nir_var_shader_out, glsl_int_type(), "out");
+   nir_ssa_def *zero = nir_imm_int(&b, 0);
+   nir_ssa_def *one = nir_imm_int(&b, 1);
+
+   /* A loop whose header phis refer to values defined later in the body. */
+   nir_block *preheader = nir_cursor_current_block(b.cursor);
+   nir_loop *loop = nir_push_loop(&b);
+   nir_phi_instr *phi = nir_phi_instr_create(b.shader);
+   nir_ssa_dest_init(&phi->instr, &phi->dest, 1, 32, NULL);
+   nir_builder_instr_insert(&b, &phi->instr);
+
+   nir_push_if(&b, nir_ige(&b, &phi->dest.ssa, nir_imm_int(&b, 10)));
+   nir_jump(&b, nir_jump_break);
+   nir_pop_if(&b, NULL);
+
+   nir_ssa_def *next = nir_iadd(&b, &phi->dest.ssa, one);
+
+   nir_if *nif = nir_push_if(&b, nir_ieq(&b, next, nir_imm_int(&b, 5)));
+   nir_ssa_def *a = nir_imul(&b, next, nir_imm_int(&b, 3));
+   nir_push_else(&b, nif);
+   nir_ssa_def *c = nir_isub(&b, next, one);
+   nir_pop_if(&b, nif);
+   nir_ssa_def *merged = nir_if_phi(&b, a, c);
+
+   nir_block *continue_block = nir_cursor_current_block(b.cursor);
+   nir_pop_loop(&b, loop);
+
+   nir_phi_src *src = ralloc(phi, nir_phi_src);
+   src->pred = preheader;
+   src->src = nir_src_for_ssa(zero);
+   exec_list_push_tail(&phi->srcs, &src->node);
+   list_addtail(&src->src.use_link, &zero->uses);
+   src->src.parent_instr = &phi->instr;
+
+   src = ralloc(phi, nir_phi_src);
+   src->pred = continue_block;
+   src->src = nir_src_for_ssa(merged);
+   exec_list_push_tail(&phi->srcs, &src->node);
+   list_addtail(&src->src.use_link, &merged->uses);
+   src->src.parent_instr = &phi->instr;
+
+   nir_store_var(&b, out, &phi->dest.ssa, 0x1);
+
+   round_trip();
+}
+
+TEST_F(nir_serialize_test, registers)
+{
+   nir_register *reg = nir_local_reg_create(b.impl);
+   reg->num_components = 2;
+   reg->bit_size = 16;
+   reg->num_array_elems = 4;
+   reg->name = ralloc_strdup(reg, "r");
+
+   nir_alu_instr *mov = nir_alu_instr_create(b.shader, nir_op_mov);
+   mov->src[0].src = nir_src_for_ssa(nir_imm_vec2(&b, 1.0, 2.0));
+   mov->src[0].src = nir_src_for_ssa(nir_f2f16(&b, mov->src[0].src.ssa));
+   mov->dest.dest = nir_dest_for_reg(reg);
+   mov->dest.dest.reg.base_offset = 1;
+   mov->dest.dest.reg.indirect = ralloc(mov, nir_src);
+   *mov->dest.dest.reg.indirect = nir_src_for_ssa(nir_imm_int(&b, 2));
+   mov->dest.write_mask = 0x2;
+   nir_builder_instr_insert(&b, &mov->instr);
+
+   nir_fadd(&b, nir_load_reg(&b, reg), nir_imm_float16(&b, 0.5));
+
+   round_trip();
+}
+
+TEST_F(nir_serialize_test, ssa_deltas_are_compact)
+{
+   /* A long chain of dependent instructions: every source refers to the
+    * previous value, which should take a single byte.
+    */
+   nir_ssa_def *v = nir_imm_float(&b, 1.0);
+   for (unsigned i = 0; i < 1000; i++)
+      v = nir_fadd(&b, v, v);
+
+   round_trip();
+
+   /* 4 bytes of header and 2 bytes of sources per fadd. */
+   EXPECT_LT(size, 1000 * 7);
+}
+
+TEST_F(nir_serialize_test, version_mismatch)
+{
+   struct blob blob;
+   blob_init(&blob);
+   nir_serialize(&blob, b.shader, false);
+
+   *(uint32_t *)blob.data += 1;
+
+   struct blob_reader reader;
+   blob_reader_init(&reader, blob.data, blob.size);
+   EXPECT_EQ(nullptr, nir_deserialize(NULL, b.shader->options, &reader));
+   EXPECT_TRUE(reader.overrun);
+
+   blob_finish(&blob);
+}
@@ -34,6 +34,7 @@
 #include "pipe/p_shader_tokens.h"
 #include "gallivm/lp_bld_const.h"
 #include "gallivm/lp_bld_debug.h"
+#include "gallivm/lp_bld_flow.h"
 #include "gallivm/lp_bld_type.h"
 #include "gallivm/lp_bld_sample.h"
 #include "gallivm/lp_bld_tgsi.h"
@@ -122,7 +123,7 @@ draw_llvm_texture_member(const struct lp_sampler_dynamic_state *base,
    ptr = LLVMBuildGEP(builder, context_ptr, indices, ARRAY_SIZE(indices), "");
 
    if (emit_load)
-      res = LLVMBuildLoad(builder, ptr, "");
+      res = lp_build_invariant_load(gallivm, ptr, "");
    else
       res = ptr;
 
@@ -168,7 +169,7 @@ draw_llvm_sampler_member(const struct lp_sampler_dynamic_state *base,
    ptr = LLVMBuildGEP(builder, context_ptr, indices, ARRAY_SIZE(indices), "");
 
    if (emit_load)
-      res = LLVMBuildLoad(builder, ptr, "");
+      res = lp_build_invariant_load(gallivm, ptr, "");
    else
       res = ptr;
 
@@ -213,7 +214,7 @@ draw_llvm_image_member(const struct lp_sampler_dynamic_state *base,
    ptr = LLVMBuildGEP(builder, context_ptr, indices, ARRAY_SIZE(indices), "");
 
    if (emit_load)
-      res = LLVMBuildLoad(builder, ptr, "");
+      res = lp_build_invariant_load(gallivm, ptr, "");
    else
       res = ptr;
 
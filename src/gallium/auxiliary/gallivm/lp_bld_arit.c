@@ -1956,6 +1956,21 @@ lp_build_iround_nearest_sse2(struct lp_build_context *bld,
       if (type.width* type.length == 128) {
          intrinsic = "llvm.x86.sse2.cvtps2dq";
       }
+      else if (type.width*type.length == 512) {
+         LLVMValueRef args[4];
+
+         assert(util_cpu_caps.has_avx512f);
+
+         /* masked variant only, with all lanes on and the current mode */
+         args[0] = a;
+         args[1] = LLVMGetUndef(ret_type);
+         args[2] = LLVMConstInt(LLVMInt16TypeInContext(bld->gallivm->context),
+                                0xffff, 0);
+         args[3] = LLVMConstInt(i32t, 4, 0);
+         return lp_build_intrinsic(builder,
+                                   "llvm.x86.avx512.mask.cvtps2dq.512",
+                                   ret_type, args, 4, 0);
+      }
       else {
          assert(type.width*type.length == 256);
          assert(util_cpu_caps.has_avx);
@@ -2380,7 +2395,8 @@ lp_build_iround(struct lp_build_context *bld,
 
    if ((util_cpu_caps.has_sse2 &&
        ((type.width == 32) && (type.length == 1 || type.length == 4))) ||
-       (util_cpu_caps.has_avx && type.width == 32 && type.length == 8)) {
+       (util_cpu_caps.has_avx && type.width == 32 && type.length == 8) ||
+       (util_cpu_caps.has_avx512f && type.width == 32 && type.length == 16)) {
       return lp_build_iround_nearest_sse2(bld, a);
    }
    if (arch_rounding_available(type)) {
@@ -2786,7 +2802,8 @@ lp_build_fast_rsqrt_available(struct lp_type type)
    assert(type.floating);
 
    if ((util_cpu_caps.has_sse && type.width == 32 && type.length == 4) ||
-       (util_cpu_caps.has_avx && type.width == 32 && type.length == 8)) {
+       (util_cpu_caps.has_avx && type.width == 32 && type.length == 8) ||
+       (util_cpu_caps.has_avx512f && type.width == 32 && type.length == 16)) {
       return true;
    }
    return false;
@@ -2814,9 +2831,19 @@ lp_build_fast_rsqrt(struct lp_build_context *bld,
       if (type.length == 4) {
          intrinsic = "llvm.x86.sse.rsqrt.ps";
       }
-      else {
+      else if (type.length == 8) {
          intrinsic = "llvm.x86.avx.rsqrt.ps.256";
       }
+      else {
+         /* rsqrt14 is the only one at 512bit, and only comes masked */
+         LLVMValueRef args[3];
+         args[0] = a;
+         args[1] = bld->undef;
+         args[2] = LLVMConstInt(LLVMInt16TypeInContext(bld->gallivm->context),
+                                0xffff, 0);
+         return lp_build_intrinsic(builder, "llvm.x86.avx512.rsqrt14.ps.512",
+                                   bld->vec_type, args, 3, 0);
+      }
       return lp_build_intrinsic_unary(builder, intrinsic, bld->vec_type, a);
    }
    else {
@@ -2833,11 +2860,15 @@ lp_build_fast_rsqrt(struct lp_build_context *bld,
  * would be way cheaper than calculating (nearly) everything twice...
  * Not sure it's common enough to be worth bothering however, scs
  * opcode could also benefit from calculating both though.
+ *
+ * With GALLIVM_PRECISION_MEDIUM the range reduction is kept as is, but
+ * both polynomials lose their highest order term.
  */
 static LLVMValueRef
 lp_build_sin_or_cos(struct lp_build_context *bld,
                     LLVMValueRef a,
-                    boolean cos)
+                    boolean cos,
+                    enum gallivm_precision precision)
 {
    struct gallivm_state *gallivm = bld->gallivm;
    LLVMBuilderRef b = gallivm->builder;
@@ -2958,9 +2989,17 @@ lp_build_sin_or_cos(struct lp_build_context *bld,
    /*
     * y = *(v4sf*)_ps_coscof_p0;
     * y = _mm_mul_ps(y, z);
+    *
+    * The medium precision variant only keeps a (refitted) z^2 term,
+    * for ~14 bits of relative error in [0, Pi/4].
     */
-   LLVMValueRef y_4 = lp_build_fmuladd(b, z, coscof_p0, coscof_p1);
-   LLVMValueRef y_6 = lp_build_fmuladd(b, y_4, z, coscof_p2);
+   LLVMValueRef y_6;
+   if (precision == GALLIVM_PRECISION_MEDIUM) {
+      y_6 = lp_build_const_vec(gallivm, bld->type, 4.089930542043979E-002);
+   } else {
+      LLVMValueRef y_4 = lp_build_fmuladd(b, z, coscof_p0, coscof_p1);
+      y_6 = lp_build_fmuladd(b, y_4, z, coscof_p2);
+   }
    LLVMValueRef y_7 = LLVMBuildFMul(b, y_6, z, "y_7");
    LLVMValueRef y_8 = LLVMBuildFMul(b, y_7, z, "y_8");
 
@@ -2998,8 +3037,16 @@ lp_build_sin_or_cos(struct lp_build_context *bld,
     * y2 = _mm_add_ps(y2, x);
     */
 
-   LLVMValueRef y2_4 = lp_build_fmuladd(b, z, sincof_p0, sincof_p1);
-   LLVMValueRef y2_6 = lp_build_fmuladd(b, y2_4, z, sincof_p2);
+   LLVMValueRef y2_6;
+   if (precision == GALLIVM_PRECISION_MEDIUM) {
+      /* refitted x^3 and x^5 terms, ~19 bits of relative error */
+      LLVMValueRef sincof_m0 = lp_build_const_vec(gallivm, bld->type, 8.16343451480751E-3);
+      LLVMValueRef sincof_m1 = lp_build_const_vec(gallivm, bld->type, -1.6663396289082716E-1);
+      y2_6 = lp_build_fmuladd(b, z, sincof_m0, sincof_m1);
+   } else {
+      LLVMValueRef y2_4 = lp_build_fmuladd(b, z, sincof_p0, sincof_p1);
+      y2_6 = lp_build_fmuladd(b, y2_4, z, sincof_p2);
+   }
    LLVMValueRef y2_7 = LLVMBuildFMul(b, y2_6, z, "y2_7");
    LLVMValueRef y2_9 = lp_build_fmuladd(b, y2_7, x_3, x_3);
 
@@ -3044,7 +3091,16 @@ LLVMValueRef
 lp_build_sin(struct lp_build_context *bld,
              LLVMValueRef a)
 {
-   return lp_build_sin_or_cos(bld, a, FALSE);
+   return lp_build_sin_or_cos(bld, a, FALSE, GALLIVM_PRECISION_FULL);
+}
+
+
+LLVMValueRef
+lp_build_sin_prec(struct lp_build_context *bld,
+                  LLVMValueRef a,
+                  enum gallivm_precision precision)
+{
+   return lp_build_sin_or_cos(bld, a, FALSE, precision);
 }
 
 
@@ -3055,7 +3111,16 @@ LLVMValueRef
 lp_build_cos(struct lp_build_context *bld,
              LLVMValueRef a)
 {
-   return lp_build_sin_or_cos(bld, a, TRUE);
+   return lp_build_sin_or_cos(bld, a, TRUE, GALLIVM_PRECISION_FULL);
+}
+
+
+LLVMValueRef
+lp_build_cos_prec(struct lp_build_context *bld,
+                  LLVMValueRef a,
+                  enum gallivm_precision precision)
+{
+   return lp_build_sin_or_cos(bld, a, TRUE, precision);
 }
 
 
@@ -3066,6 +3131,16 @@ LLVMValueRef
 lp_build_pow(struct lp_build_context *bld,
              LLVMValueRef x,
              LLVMValueRef y)
+{
+   return lp_build_pow_prec(bld, x, y, GALLIVM_PRECISION_FULL);
+}
+
+
+LLVMValueRef
+lp_build_pow_prec(struct lp_build_context *bld,
+                  LLVMValueRef x,
+                  LLVMValueRef y,
+                  enum gallivm_precision precision)
 {
    /* TODO: optimize the constant case */
    if (gallivm_debug & GALLIVM_DEBUG_PERF &&
@@ -3074,7 +3149,11 @@ lp_build_pow(struct lp_build_context *bld,
                    __FUNCTION__);
    }
 
-   return lp_build_exp2(bld, lp_build_mul(bld, lp_build_log2(bld, x), y));
+   return lp_build_exp2_prec(bld,
+                             lp_build_mul(bld,
+                                          lp_build_log2_prec(bld, x, precision),
+                                          y),
+                             precision);
 }
 
 
@@ -3220,9 +3299,29 @@ const double lp_build_exp2_polynomial[] = {
 };
 
 
+/**
+ * Degree 3 fit of 2**x used for GALLIVM_PRECISION_MEDIUM, ~13.7 bits.
+ */
+static const double lp_build_exp2_polynomial_medium[] = {
+   0.999925218562710312959,
+   0.695833540494823811697,
+   0.226067155427249155588,
+   0.0780245226406372992967
+};
+
+
 LLVMValueRef
 lp_build_exp2(struct lp_build_context *bld,
               LLVMValueRef x)
+{
+   return lp_build_exp2_prec(bld, x, GALLIVM_PRECISION_FULL);
+}
+
+
+LLVMValueRef
+lp_build_exp2_prec(struct lp_build_context *bld,
+                   LLVMValueRef x,
+                   enum gallivm_precision precision)
 {
    LLVMBuilderRef builder = bld->gallivm->builder;
    const struct lp_type type = bld->type;
@@ -3262,8 +3361,13 @@ lp_build_exp2(struct lp_build_context *bld,
                            lp_build_const_int_vec(bld->gallivm, type, 23), "");
    expipart = LLVMBuildBitCast(builder, expipart, vec_type, "");
 
-   expfpart = lp_build_polynomial(bld, fpart, lp_build_exp2_polynomial,
-                                  ARRAY_SIZE(lp_build_exp2_polynomial));
+   if (precision == GALLIVM_PRECISION_MEDIUM) {
+      expfpart = lp_build_polynomial(bld, fpart, lp_build_exp2_polynomial_medium,
+                                     ARRAY_SIZE(lp_build_exp2_polynomial_medium));
+   } else {
+      expfpart = lp_build_polynomial(bld, fpart, lp_build_exp2_polynomial,
+                                     ARRAY_SIZE(lp_build_exp2_polynomial));
+   }
 
    res = LLVMBuildFMul(builder, expipart, expfpart, "");
 
@@ -3372,6 +3476,16 @@ const double lp_build_log2_polynomial[] = {
 #endif
 };
 
+/**
+ * Degree 2 fit of the same function used for GALLIVM_PRECISION_MEDIUM,
+ * ~18 bits of absolute error.
+ */
+static const double lp_build_log2_polynomial_medium[] = {
+   2.88546492881501048799L,
+   0.956552719157011122064L,
+   0.667489456986028018015L,
+};
+
 /**
  * See http://www.devmaster.net/forums/showthread.php?p=43580
  * http://en.wikipedia.org/wiki/Logarithm#Calculation
@@ -3388,13 +3502,14 @@ const double lp_build_log2_polynomial[] = {
  * Those checks are fairly expensive so if you don't need them make sure
  * handle_edge_cases is false.
  */
-void
-lp_build_log2_approx(struct lp_build_context *bld,
-                     LLVMValueRef x,
-                     LLVMValueRef *p_exp,
-                     LLVMValueRef *p_floor_log2,
-                     LLVMValueRef *p_log2,
-                     boolean handle_edge_cases)
+static void
+lp_build_log2_approx_prec(struct lp_build_context *bld,
+                          LLVMValueRef x,
+                          LLVMValueRef *p_exp,
+                          LLVMValueRef *p_floor_log2,
+                          LLVMValueRef *p_log2,
+                          boolean handle_edge_cases,
+                          enum gallivm_precision precision)
 {
    LLVMBuilderRef builder = bld->gallivm->builder;
    const struct lp_type type = bld->type;
@@ -3460,8 +3575,13 @@ lp_build_log2_approx(struct lp_build_context *bld,
       z = lp_build_mul(bld, y, y);
 
       /* compute P(z) */
-      p_z = lp_build_polynomial(bld, z, lp_build_log2_polynomial,
-                                ARRAY_SIZE(lp_build_log2_polynomial));
+      if (precision == GALLIVM_PRECISION_MEDIUM) {
+         p_z = lp_build_polynomial(bld, z, lp_build_log2_polynomial_medium,
+                                   ARRAY_SIZE(lp_build_log2_polynomial_medium));
+      } else {
+         p_z = lp_build_polynomial(bld, z, lp_build_log2_polynomial,
+                                   ARRAY_SIZE(lp_build_log2_polynomial));
+      }
 
       /* y * P(z) + logexp */
       res = lp_build_mad(bld, y, p_z, logexp);
@@ -3503,6 +3623,19 @@ lp_build_log2_approx(struct lp_build_context *bld,
 }
 
 
+void
+lp_build_log2_approx(struct lp_build_context *bld,
+                     LLVMValueRef x,
+                     LLVMValueRef *p_exp,
+                     LLVMValueRef *p_floor_log2,
+                     LLVMValueRef *p_log2,
+                     boolean handle_edge_cases)
+{
+   lp_build_log2_approx_prec(bld, x, p_exp, p_floor_log2, p_log2,
+                             handle_edge_cases, GALLIVM_PRECISION_FULL);
+}
+
+
 /*
  * log2 implementation which doesn't have special code to
  * handle edge cases (-inf, 0, inf, NaN). It's faster but
@@ -3511,9 +3644,18 @@ lp_build_log2_approx(struct lp_build_context *bld,
 LLVMValueRef
 lp_build_log2(struct lp_build_context *bld,
               LLVMValueRef x)
+{
+   return lp_build_log2_prec(bld, x, GALLIVM_PRECISION_FULL);
+}
+
+
+LLVMValueRef
+lp_build_log2_prec(struct lp_build_context *bld,
+                   LLVMValueRef x,
+                   enum gallivm_precision precision)
 {
    LLVMValueRef res;
-   lp_build_log2_approx(bld, x, NULL, NULL, &res, FALSE);
+   lp_build_log2_approx_prec(bld, x, NULL, NULL, &res, FALSE, precision);
    return res;
 }
 
@@ -3525,9 +3667,18 @@ lp_build_log2(struct lp_build_context *bld,
 LLVMValueRef
 lp_build_log2_safe(struct lp_build_context *bld,
                    LLVMValueRef x)
+{
+   return lp_build_log2_safe_prec(bld, x, GALLIVM_PRECISION_FULL);
+}
+
+
+LLVMValueRef
+lp_build_log2_safe_prec(struct lp_build_context *bld,
+                        LLVMValueRef x,
+                        enum gallivm_precision precision)
 {
    LLVMValueRef res;
-   lp_build_log2_approx(bld, x, NULL, NULL, &res, TRUE);
+   lp_build_log2_approx_prec(bld, x, NULL, NULL, &res, TRUE, precision);
    return res;
 }
 
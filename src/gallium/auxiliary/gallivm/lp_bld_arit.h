@@ -189,6 +189,17 @@ enum gallivm_nan_behavior {
 
 };
 
+/**
+ * Specifies the accuracy required from transcendental functions.
+ */
+enum gallivm_precision {
+   /* Close to full single precision (~20 bits or better) */
+   GALLIVM_PRECISION_FULL,
+   /* Enough for mediump / half float results (~11 bits), using shorter
+    * polynomials. */
+   GALLIVM_PRECISION_MEDIUM,
+};
+
 LLVMValueRef
 lp_build_min(struct lp_build_context *bld,
              LLVMValueRef a,
@@ -321,15 +332,31 @@ LLVMValueRef
 lp_build_cos(struct lp_build_context *bld,
              LLVMValueRef a);
 
+LLVMValueRef
+lp_build_cos_prec(struct lp_build_context *bld,
+                  LLVMValueRef a,
+                  enum gallivm_precision precision);
+
 LLVMValueRef
 lp_build_sin(struct lp_build_context *bld,
              LLVMValueRef a);
 
+LLVMValueRef
+lp_build_sin_prec(struct lp_build_context *bld,
+                  LLVMValueRef a,
+                  enum gallivm_precision precision);
+
 LLVMValueRef
 lp_build_pow(struct lp_build_context *bld,
              LLVMValueRef a,
              LLVMValueRef b);
 
+LLVMValueRef
+lp_build_pow_prec(struct lp_build_context *bld,
+                  LLVMValueRef a,
+                  LLVMValueRef b,
+                  enum gallivm_precision precision);
+
 LLVMValueRef
 lp_build_exp(struct lp_build_context *bld,
              LLVMValueRef a);
@@ -346,6 +373,11 @@ LLVMValueRef
 lp_build_exp2(struct lp_build_context *bld,
               LLVMValueRef a);
 
+LLVMValueRef
+lp_build_exp2_prec(struct lp_build_context *bld,
+                   LLVMValueRef a,
+                   enum gallivm_precision precision);
+
 LLVMValueRef
 lp_build_extract_exponent(struct lp_build_context *bld,
                           LLVMValueRef x,
@@ -359,10 +391,20 @@ LLVMValueRef
 lp_build_log2(struct lp_build_context *bld,
               LLVMValueRef a);
 
+LLVMValueRef
+lp_build_log2_prec(struct lp_build_context *bld,
+                   LLVMValueRef a,
+                   enum gallivm_precision precision);
+
 LLVMValueRef
 lp_build_log2_safe(struct lp_build_context *bld,
                    LLVMValueRef a);
 
+LLVMValueRef
+lp_build_log2_safe_prec(struct lp_build_context *bld,
+                        LLVMValueRef a,
+                        enum gallivm_precision precision);
+
 LLVMValueRef
 lp_build_fast_log2(struct lp_build_context *bld,
                    LLVMValueRef a);
@@ -491,6 +491,26 @@ int lp_build_conv_auto(struct gallivm_state *gallivm,
          lp_build_conv(gallivm, src_type, *dst_type, src, num_srcs, dst, num_dsts);
          return num_dsts;
       }
+
+      /* Special case 1x16x32 --> 1x16x8, by way of the 2x8x32 one */
+      if (src_type.length == 16 &&
+          util_cpu_caps.has_avx512f &&
+          num_srcs <= LP_MAX_VECTOR_LENGTH / 2)
+      {
+         struct lp_type half_type = src_type;
+         LLVMValueRef halves[LP_MAX_VECTOR_LENGTH];
+
+         half_type.length = 8;
+         for (i = 0; i < num_srcs; i++) {
+            halves[2*i + 0] = lp_build_extract_range(gallivm, src[i], 0, 8);
+            halves[2*i + 1] = lp_build_extract_range(gallivm, src[i], 8, 8);
+         }
+         dst_type->length = 16;
+
+         lp_build_conv(gallivm, half_type, *dst_type, halves, 2 * num_srcs,
+                       dst, num_srcs);
+         return num_srcs;
+      }
    }
 
    /* lp_build_resize does not support M:N */
@@ -42,12 +42,18 @@
 #define GALLIVM_DEBUG_PERF          (1 << 3)
 #define GALLIVM_DEBUG_GC            (1 << 4)
 #define GALLIVM_DEBUG_DUMP_BC       (1 << 5)
+#define GALLIVM_DEBUG_CACHE         (1 << 6)
 
 #define GALLIVM_PERF_NO_BRILINEAR    (1 << 0)
 #define GALLIVM_PERF_NO_RHO_APPROX   (1 << 1)
 #define GALLIVM_PERF_NO_QUAD_LOD     (1 << 2)
 #define GALLIVM_PERF_NO_OPT          (1 << 3)
 #define GALLIVM_PERF_NO_AOS_SAMPLING (1 << 4)
+#define GALLIVM_PERF_AVX2_AMD        (1 << 5)
+#define GALLIVM_PERF_AVX512          (1 << 6)
+#define GALLIVM_PERF_NO_IPO          (1 << 7)
+#define GALLIVM_PERF_NO_HOIST        (1 << 8)
+#define GALLIVM_PERF_MEDIUMP         (1 << 9)
 
 #ifdef __cplusplus
 extern "C" {
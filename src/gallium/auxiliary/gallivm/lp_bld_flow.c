@@ -33,7 +33,9 @@
 
 #include "util/u_debug.h"
 #include "util/u_memory.h"
+#include "util/set.h"
 
+#include "lp_bld_debug.h"
 #include "lp_bld_init.h"
 #include "lp_bld_type.h"
 #include "lp_bld_flow.h"
@@ -213,6 +215,194 @@ lp_build_mask_end(struct lp_build_mask_context *mask)
 
 
 
+/**
+ * Functions with more blocks than this don't get anything hoisted, to keep
+ * the cost of starting a loop bounded.
+ */
+#define LP_MAX_HOIST_BLOCKS 4096
+
+/**
+ * Every hoisted value stays live across the whole loop, past some point
+ * the spills cost more than the loads saved.
+ */
+#define LP_MAX_HOISTED_LOADS 32
+
+/**
+ * Address computation instructions moved along with a single load.
+ */
+#define LP_MAX_HOISTED_ADDRESS 8
+
+
+/**
+ * Start hoisting in front of the loop whose entry branch was just emitted.
+ */
+void
+lp_build_hoist_begin(struct lp_build_hoist_state *hoist,
+                     struct gallivm_state *gallivm)
+{
+   LLVMBasicBlockRef block = LLVMGetInsertBlock(gallivm->builder);
+   LLVMBasicBlockRef loop_block;
+   unsigned num_blocks = 0;
+
+   memset(hoist, 0, sizeof *hoist);
+   hoist->gallivm = gallivm;
+
+   if (gallivm->opt_level == GALLIVM_OPT_NONE ||
+       (gallivm_perf & GALLIVM_PERF_NO_HOIST))
+      return;
+
+   hoist->insert_before = LLVMGetBasicBlockTerminator(block);
+   assert(hoist->insert_before);
+   loop_block = LLVMGetSuccessor(hoist->insert_before, 0);
+   hoist->function = LLVMGetBasicBlockParent(block);
+
+   /*
+    * Nothing in the loop exists yet, so any block but the loop entry is
+    * outside of it.  A definition there which is usable in the loop must
+    * dominate the entry branch too.
+    */
+   hoist->outside_blocks = _mesa_pointer_set_create(NULL);
+   for (block = LLVMGetFirstBasicBlock(hoist->function); block;
+        block = LLVMGetNextBasicBlock(block)) {
+      if (++num_blocks > LP_MAX_HOIST_BLOCKS) {
+         _mesa_set_destroy(hoist->outside_blocks, NULL);
+         hoist->outside_blocks = NULL;
+         return;
+      }
+      if (block != loop_block)
+         _mesa_set_add(hoist->outside_blocks, block);
+   }
+
+   hoist->outer = gallivm->hoist;
+   gallivm->hoist = hoist;
+}
+
+
+void
+lp_build_hoist_end(struct lp_build_hoist_state *hoist)
+{
+   struct gallivm_state *gallivm = hoist->gallivm;
+
+   if (gallivm->hoist != hoist)
+      return;
+
+   if (gallivm_debug & GALLIVM_DEBUG_PERF && hoist->num_loads) {
+      debug_printf("%s: hoisted %u loads out of a loop\n",
+                   gallivm->module_name, hoist->num_loads);
+   }
+
+   _mesa_set_destroy(hoist->outside_blocks, NULL);
+   gallivm->hoist = hoist->outer;
+}
+
+
+/**
+ * Append to \p chain, operands first, the instructions computing \p value
+ * which need to move for \p value to be available in front of the loop.
+ * Only address arithmetic is moved, anything else computed in the loop
+ * makes the value variant.
+ */
+static boolean
+hoist_collect(const struct lp_build_hoist_state *hoist,
+              LLVMValueRef value,
+              LLVMValueRef *chain,
+              unsigned *num_chain)
+{
+   unsigned num_operands;
+   unsigned i;
+
+   if (LLVMIsAArgument(value))
+      return LLVMGetParamParent(value) == hoist->function;
+
+   if (!LLVMIsAInstruction(value))
+      return LLVMIsConstant(value);
+
+   if (_mesa_set_search(hoist->outside_blocks,
+                        LLVMGetInstructionParent(value)))
+      return TRUE;
+
+   for (i = 0; i < *num_chain; i++) {
+      if (chain[i] == value)
+         return TRUE;
+   }
+
+   if (*num_chain >= LP_MAX_HOISTED_ADDRESS ||
+       (!LLVMIsAGetElementPtrInst(value) && !LLVMIsABitCastInst(value)))
+      return FALSE;
+
+   num_operands = LLVMGetNumOperands(value);
+   for (i = 0; i < num_operands; i++) {
+      if (!hoist_collect(hoist, LLVMGetOperand(value, i), chain, num_chain))
+         return FALSE;
+   }
+
+   if (*num_chain >= LP_MAX_HOISTED_ADDRESS)
+      return FALSE;
+
+   chain[(*num_chain)++] = value;
+   return TRUE;
+}
+
+
+/**
+ * Load from memory which doesn't change while the function runs, such as
+ * constant buffers and the jit context.
+ *
+ * The load is emitted in front of the outermost loop being built that the
+ * address doesn't depend on, or in place if there's none.  Loops must run
+ * at least once, as lp_build_loop and TGSI loops do.
+ */
+LLVMValueRef
+lp_build_invariant_load(struct gallivm_state *gallivm,
+                        LLVMValueRef ptr,
+                        const char *name)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef function =
+      LLVMGetBasicBlockParent(LLVMGetInsertBlock(builder));
+   struct lp_build_hoist_state *hoist;
+   struct lp_build_hoist_state *target = NULL;
+   LLVMValueRef chain[LP_MAX_HOISTED_ADDRESS];
+   unsigned num_chain = 0;
+   LLVMBuilderRef hoist_builder;
+   LLVMValueRef res;
+   unsigned i;
+
+   /*
+    * Availability in front of a loop implies availability in front of all
+    * the loops it contains, so stop at the first one it fails for.
+    */
+   for (hoist = gallivm->hoist; hoist; hoist = hoist->outer) {
+      num_chain = 0;
+      if (hoist->function != function ||
+          !hoist_collect(hoist, ptr, chain, &num_chain))
+         break;
+      if (hoist->num_loads < LP_MAX_HOISTED_LOADS)
+         target = hoist;
+   }
+
+   if (!target)
+      return LLVMBuildLoad(builder, ptr, name);
+
+   num_chain = 0;
+   hoist_collect(target, ptr, chain, &num_chain);
+
+   hoist_builder = LLVMCreateBuilderInContext(gallivm->context);
+   LLVMPositionBuilderBefore(hoist_builder, target->insert_before);
+
+   for (i = 0; i < num_chain; i++) {
+      LLVMInstructionRemoveFromParent(chain[i]);
+      LLVMInsertIntoBuilder(hoist_builder, chain[i]);
+   }
+   res = LLVMBuildLoad(hoist_builder, ptr, name);
+
+   LLVMDisposeBuilder(hoist_builder);
+
+   target->num_loads++;
+
+   return res;
+}
+
 void
 lp_build_loop_begin(struct lp_build_loop_state *state,
                     struct gallivm_state *gallivm,
@@ -230,6 +420,8 @@ lp_build_loop_begin(struct lp_build_loop_state *state,
 
    LLVMBuildBr(builder, state->block);
 
+   lp_build_hoist_begin(&state->hoist, gallivm);
+
    LLVMPositionBuilderAtEnd(builder, state->block);
 
    state->counter = LLVMBuildLoad(builder, state->counter_var, "");
@@ -260,6 +452,8 @@ lp_build_loop_end_cond(struct lp_build_loop_state *state,
 
    LLVMBuildCondBr(builder, cond, after_block, state->block);
 
+   lp_build_hoist_end(&state->hoist);
+
    LLVMPositionBuilderAtEnd(builder, after_block);
 
    state->counter = LLVMBuildLoad(builder, state->counter_var, "");
@@ -42,6 +42,7 @@ extern "C" {
 #endif
 
 struct lp_type;
+struct set;
 
 
 /**
@@ -101,6 +102,45 @@ LLVMValueRef
 lp_build_mask_end(struct lp_build_mask_context *mask);
 
 
+/**
+ * Hoisting of loop invariant loads.
+ *
+ * LLVM's LICM pass is too expensive to run on shaders (see
+ * add_optimization_passes()), so instead loads the caller knows to be
+ * invariant get moved, together with their address computation, in front
+ * of the outermost enclosing loop they don't depend on, as they are emitted.
+ */
+struct lp_build_hoist_state
+{
+   struct gallivm_state *gallivm;
+
+   /** Enclosing loop's state, if hoisting out of it too */
+   struct lp_build_hoist_state *outer;
+
+   LLVMValueRef function;
+
+   /** The branch into the loop, hoisted code is inserted before it */
+   LLVMValueRef insert_before;
+
+   /** Blocks which existed before the loop, ie. dominate its entry */
+   struct set *outside_blocks;
+
+   unsigned num_loads;
+};
+
+void
+lp_build_hoist_begin(struct lp_build_hoist_state *hoist,
+                     struct gallivm_state *gallivm);
+
+void
+lp_build_hoist_end(struct lp_build_hoist_state *hoist);
+
+LLVMValueRef
+lp_build_invariant_load(struct gallivm_state *gallivm,
+                        LLVMValueRef ptr,
+                        const char *name);
+
+
 /**
  * LLVM's IR doesn't represent for-loops directly. Furthermore it
  * it requires creating code blocks, branches, phi variables, so it
@@ -114,6 +154,7 @@ struct lp_build_loop_state
    LLVMValueRef counter_var;
    LLVMValueRef counter;
    struct gallivm_state *gallivm;
+   struct lp_build_hoist_state hoist;
 };
 
 
@@ -44,37 +44,42 @@ struct lp_type;
 struct lp_build_context;
 
 
-#define LP_BUILD_FORMAT_CACHE_DEBUG 0
 /*
  * Block cache
  *
  * Optional block cache to be used when unpacking big pixel blocks.
+ * Blocks are decoded to rgba8 once and then looked up per texel.
+ * The cache is set associative, a block hashes to one set and may live
+ * in any of its ways, with a round-robin victim per set.
  * Must be a power of 2
  */
 
 #define LP_BUILD_FORMAT_CACHE_SIZE 128
+#define LP_BUILD_FORMAT_CACHE_WAYS 2
+#define LP_BUILD_FORMAT_CACHE_SETS (LP_BUILD_FORMAT_CACHE_SIZE / \
+                                    LP_BUILD_FORMAT_CACHE_WAYS)
 
 /*
  * Note: cache_data needs 16 byte alignment.
+ * Entry e of set s lives at index s * LP_BUILD_FORMAT_CACHE_WAYS + e.
+ * The access counters are only updated with GALLIVM_DEBUG=cache.
  */
 struct lp_build_format_cache
 {
    PIPE_ALIGN_VAR(16) uint32_t cache_data[LP_BUILD_FORMAT_CACHE_SIZE][4][4];
    uint64_t cache_tags[LP_BUILD_FORMAT_CACHE_SIZE];
-#if LP_BUILD_FORMAT_CACHE_DEBUG
+   uint32_t cache_victim[LP_BUILD_FORMAT_CACHE_SETS];
    uint64_t cache_access_total;
    uint64_t cache_access_miss;
-#endif
 };
 
 
 enum {
    LP_BUILD_FORMAT_CACHE_MEMBER_DATA = 0,
    LP_BUILD_FORMAT_CACHE_MEMBER_TAGS,
-#if LP_BUILD_FORMAT_CACHE_DEBUG
+   LP_BUILD_FORMAT_CACHE_MEMBER_VICTIM,
    LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_TOTAL,
    LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_MISS,
-#endif
    LP_BUILD_FORMAT_CACHE_MEMBER_COUNT
 };
 
@@ -189,6 +194,19 @@ lp_build_fetch_s3tc_rgba_aos(struct gallivm_state *gallivm,
                              LLVMValueRef j,
                              LLVMValueRef cache);
 
+boolean
+lp_build_format_cache_supported(const struct util_format_description *format_desc);
+
+LLVMValueRef
+lp_build_fetch_cached_texels(struct gallivm_state *gallivm,
+                             const struct util_format_description *format_desc,
+                             unsigned n,
+                             LLVMValueRef base_ptr,
+                             LLVMValueRef offset,
+                             LLVMValueRef i,
+                             LLVMValueRef j,
+                             LLVMValueRef cache);
+
 
 /*
  * special float formats
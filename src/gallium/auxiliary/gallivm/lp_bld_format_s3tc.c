@@ -28,7 +28,8 @@
 
 /**
  * @file
- * s3tc pixel format manipulation.
+ * s3tc pixel format manipulation, and the block cache shared by
+ * the compressed formats.
  *
  * @author Roland Scheidegger <sroland@vmware.com>
  */
@@ -38,6 +39,7 @@
 
 #include "util/u_format.h"
 #include "util/u_math.h"
+#include "util/u_pointer.h"
 #include "util/u_string.h"
 #include "util/u_cpu_detect.h"
 #include "util/u_debug.h"
@@ -1139,7 +1141,6 @@ s3tc_lookup_tag_data(struct gallivm_state *gallivm,
    return LLVMBuildLoad(builder, member_ptr, "tag_data");
 }
 
-#if LP_BUILD_FORMAT_CACHE_DEBUG
 static void
 s3tc_update_cache_access(struct gallivm_state *gallivm,
                          LLVMValueRef ptr,
@@ -1159,7 +1160,6 @@ s3tc_update_cache_access(struct gallivm_state *gallivm,
                                                                    count, 0), "");
    LLVMBuildStore(builder, cache_access, member_ptr);
 }
-#endif
 
 /** 
  * Calculate 1/3(v1-v0) + v0 and 2*1/3(v1-v0) + v0.
@@ -1866,6 +1866,213 @@ s3tc_decode_block_dxt5(struct gallivm_state *gallivm,
 }
 
 
+static LLVMValueRef
+rgtc_const_vec8(struct gallivm_state *gallivm,
+                const unsigned *vals)
+{
+   LLVMValueRef elems[8];
+   unsigned k;
+
+   for (k = 0; k < 8; k++) {
+      elems[k] = lp_build_const_int32(gallivm, vals[k]);
+   }
+   return LLVMConstVector(elems, 8);
+}
+
+
+/*
+ * Decode the 16 codes of one rgtc channel (the low 64 bits of block) the
+ * same way util_format_unsigned_fetch_texel_rgtc does, so unlike the dxt5
+ * alpha decode this is exact.
+ * Returns the 8bit values in 32bit scalars, in cache order
+ * (val[i*4 + j] for texel x = i, y = j).
+ * Only used on cache misses so this doesn't need to be terribly fast.
+ */
+static void
+rgtc_decode_channel(struct gallivm_state *gallivm,
+                    LLVMValueRef block,
+                    LLVMValueRef *val)
+{
+   static const unsigned w0_7[8] = {1, 0, 6, 5, 4, 3, 2, 1};
+   static const unsigned w1_7[8] = {0, 1, 1, 2, 3, 4, 5, 6};
+   static const unsigned div_7[8] = {1, 1, 7, 7, 7, 7, 7, 7};
+   static const unsigned w0_5[8] = {1, 0, 4, 3, 2, 1, 0, 0};
+   static const unsigned w1_5[8] = {0, 1, 1, 2, 3, 4, 0, 0};
+   static const unsigned div_5[8] = {1, 1, 5, 5, 5, 5, 1, 1};
+   static const unsigned max_5[8] = {0, 0, 0, 0, 0, 0, 0, 255};
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef i32t = LLVMInt32TypeInContext(gallivm->context);
+   LLVMTypeRef i64t = LLVMInt64TypeInContext(gallivm->context);
+   LLVMValueRef a0, a1, pal7, pal5, pal, sel, code, tmp;
+   struct lp_build_context bld;
+   unsigned k;
+
+   lp_build_context_init(&bld, gallivm, lp_type_uint_vec(32, 256));
+
+   a0 = LLVMBuildTrunc(builder, block, i32t, "");
+   a0 = LLVMBuildAnd(builder, a0, lp_build_const_int32(gallivm, 0xff), "");
+   a1 = LLVMBuildLShr(builder, block, LLVMConstInt(i64t, 8, 0), "");
+   a1 = LLVMBuildTrunc(builder, a1, i32t, "");
+   a1 = LLVMBuildAnd(builder, a1, lp_build_const_int32(gallivm, 0xff), "");
+   sel = LLVMBuildICmp(builder, LLVMIntUGT, a0, a1, "");
+   a0 = lp_build_broadcast_scalar(&bld, a0);
+   a1 = lp_build_broadcast_scalar(&bld, a1);
+
+   /* the full 8 entry palette, for both a0 > a1 and a0 <= a1 */
+   pal7 = LLVMBuildMul(builder, a0, rgtc_const_vec8(gallivm, w0_7), "");
+   tmp = LLVMBuildMul(builder, a1, rgtc_const_vec8(gallivm, w1_7), "");
+   pal7 = LLVMBuildAdd(builder, pal7, tmp, "");
+   pal7 = LLVMBuildUDiv(builder, pal7, rgtc_const_vec8(gallivm, div_7), "");
+
+   pal5 = LLVMBuildMul(builder, a0, rgtc_const_vec8(gallivm, w0_5), "");
+   tmp = LLVMBuildMul(builder, a1, rgtc_const_vec8(gallivm, w1_5), "");
+   pal5 = LLVMBuildAdd(builder, pal5, tmp, "");
+   pal5 = LLVMBuildUDiv(builder, pal5, rgtc_const_vec8(gallivm, div_5), "");
+   pal5 = LLVMBuildOr(builder, pal5, rgtc_const_vec8(gallivm, max_5), "");
+
+   pal = LLVMBuildSelect(builder, sel, pal7, pal5, "");
+
+   for (k = 0; k < 16; k++) {
+      code = LLVMBuildLShr(builder, block, LLVMConstInt(i64t, 16 + 3 * k, 0), "");
+      code = LLVMBuildTrunc(builder, code, i32t, "");
+      code = LLVMBuildAnd(builder, code, lp_build_const_int32(gallivm, 7), "");
+      /* codes are stored y major */
+      val[(k % 4) * 4 + k / 4] = LLVMBuildExtractElement(builder, pal, code, "");
+   }
+}
+
+
+/*
+ * decode one rgtc/latc unorm block.
+ * The channels are placed the same way as fetch_rgba_8unorm does.
+ */
+static void
+rgtc_decode_block(struct gallivm_state *gallivm,
+                  enum pipe_format format,
+                  LLVMValueRef dxt_block,
+                  LLVMValueRef *col)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef i64t = LLVMInt64TypeInContext(gallivm->context);
+   struct lp_type type32 = lp_type_uint_vec(32, 128);
+   LLVMValueRef block, r[16], g[16], rv, gv;
+   boolean two_channels = format == PIPE_FORMAT_RGTC2_UNORM ||
+                          format == PIPE_FORMAT_LATC2_UNORM;
+   boolean luminance = format == PIPE_FORMAT_LATC1_UNORM ||
+                       format == PIPE_FORMAT_LATC2_UNORM;
+   unsigned k, n;
+
+   dxt_block = LLVMBuildBitCast(builder, dxt_block,
+                                LLVMVectorType(i64t, 2), "");
+   block = LLVMBuildExtractElement(builder, dxt_block,
+                                   lp_build_const_int32(gallivm, 0), "");
+   rgtc_decode_channel(gallivm, block, r);
+   if (two_channels) {
+      block = LLVMBuildExtractElement(builder, dxt_block,
+                                      lp_build_const_int32(gallivm, 1), "");
+      rgtc_decode_channel(gallivm, block, g);
+   }
+
+   for (k = 0; k < 4; k++) {
+      rv = gv = LLVMGetUndef(lp_build_vec_type(gallivm, type32));
+      for (n = 0; n < 4; n++) {
+         LLVMValueRef index = lp_build_const_int32(gallivm, n);
+         rv = LLVMBuildInsertElement(builder, rv, r[k * 4 + n], index, "");
+         if (two_channels) {
+            gv = LLVMBuildInsertElement(builder, gv, g[k * 4 + n], index, "");
+         }
+      }
+      if (luminance) {
+         rv = LLVMBuildMul(builder, rv,
+                           lp_build_const_int_vec(gallivm, type32, 0x010101), "");
+      }
+      if (two_channels) {
+         /* second channel is green for rgtc, alpha for latc */
+         gv = LLVMBuildShl(builder, gv,
+                           lp_build_const_int_vec(gallivm, type32,
+                                                  luminance ? 24 : 8), "");
+         rv = LLVMBuildOr(builder, rv, gv, "");
+      }
+      if (format != PIPE_FORMAT_LATC2_UNORM) {
+         rv = LLVMBuildOr(builder, rv,
+                          lp_build_const_int_vec(gallivm, type32, 0xff000000), "");
+      }
+      col[k] = rv;
+   }
+}
+
+
+/*
+ * decode one block of any other format by calling
+ * util_format_description::unpack_rgba_8unorm(), transposing the
+ * result to cache order.
+ */
+static void
+unpack_block_8unorm(struct gallivm_state *gallivm,
+                    const struct util_format_description *format_desc,
+                    LLVMValueRef ptr_addr,
+                    LLVMValueRef *col)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef i8t = LLVMInt8TypeInContext(gallivm->context);
+   LLVMTypeRef pi8t = LLVMPointerType(i8t, 0);
+   LLVMTypeRef i32t = LLVMInt32TypeInContext(gallivm->context);
+   LLVMTypeRef vec4x32t = LLVMVectorType(i32t, 4);
+   LLVMValueRef function, tmp_ptr, rows[4], args[6];
+   unsigned k;
+
+   {
+      /*
+       * Function to call looks like:
+       *   unpack(uint8_t *dst, unsigned dst_stride,
+       *          const uint8_t *src, unsigned src_stride,
+       *          unsigned width, unsigned height)
+       */
+      LLVMTypeRef ret_type;
+      LLVMTypeRef arg_types[6];
+      LLVMTypeRef function_type;
+
+      ret_type = LLVMVoidTypeInContext(gallivm->context);
+      arg_types[0] = pi8t;
+      arg_types[1] = i32t;
+      arg_types[2] = pi8t;
+      arg_types[3] = i32t;
+      arg_types[4] = i32t;
+      arg_types[5] = i32t;
+      function_type = LLVMFunctionType(ret_type, arg_types,
+                                       ARRAY_SIZE(arg_types), 0);
+
+      /* make const pointer for the C unpack_rgba_8unorm function */
+      function = lp_build_const_int_pointer(gallivm,
+         func_to_pointer((func_pointer) format_desc->unpack_rgba_8unorm));
+
+      /* cast the callee pointer to the function's type */
+      function = LLVMBuildBitCast(builder, function,
+                                  LLVMPointerType(function_type, 0),
+                                  "cast callee");
+   }
+
+   tmp_ptr = lp_build_array_alloca(gallivm, vec4x32t,
+                                   lp_build_const_int32(gallivm, 4), "");
+
+   args[0] = LLVMBuildBitCast(builder, tmp_ptr, pi8t, "");
+   args[1] = lp_build_const_int32(gallivm, 16);
+   args[2] = ptr_addr;
+   args[3] = lp_build_const_int32(gallivm, format_desc->block.bits / 8);
+   args[4] = lp_build_const_int32(gallivm, 4);
+   args[5] = lp_build_const_int32(gallivm, 4);
+   LLVMBuildCall(builder, function, args, ARRAY_SIZE(args), "");
+
+   for (k = 0; k < 4; k++) {
+      LLVMValueRef index = lp_build_const_int32(gallivm, k);
+      LLVMValueRef row_ptr = LLVMBuildGEP(builder, tmp_ptr, &index, 1, "");
+      rows[k] = LLVMBuildLoad(builder, row_ptr, "");
+   }
+
+   lp_build_transpose_aos(gallivm, lp_type_uint_vec(32, 128), rows, col);
+}
+
+
 static void
 generate_update_cache_one_block(struct gallivm_state *gallivm,
                                 LLVMValueRef function,
@@ -1874,17 +2081,17 @@ generate_update_cache_one_block(struct gallivm_state *gallivm,
    LLVMBasicBlockRef block;
    LLVMBuilderRef old_builder;
    LLVMValueRef ptr_addr;
-   LLVMValueRef hash_index;
+   LLVMValueRef entry;
    LLVMValueRef cache;
    LLVMValueRef dxt_block, tag_value;
    LLVMValueRef col[LP_MAX_VECTOR_LENGTH];
 
    ptr_addr     = LLVMGetParam(function, 0);
-   hash_index   = LLVMGetParam(function, 1);
+   entry        = LLVMGetParam(function, 1);
    cache        = LLVMGetParam(function, 2);
 
    lp_build_name(ptr_addr,   "ptr_addr"  );
-   lp_build_name(hash_index, "hash_index");
+   lp_build_name(entry,      "entry"     );
    lp_build_name(cache,      "cache_addr");
 
    /*
@@ -1896,33 +2103,43 @@ generate_update_cache_one_block(struct gallivm_state *gallivm,
    gallivm->builder = LLVMCreateBuilderInContext(gallivm->context);
    LLVMPositionBuilderAtEnd(gallivm->builder, block);
 
-   lp_build_gather_s3tc_simple_scalar(gallivm, format_desc, &dxt_block,
-                                      ptr_addr);
-
-   switch (format_desc->format) {
-   case PIPE_FORMAT_DXT1_RGB:
-   case PIPE_FORMAT_DXT1_RGBA:
-   case PIPE_FORMAT_DXT1_SRGB:
-   case PIPE_FORMAT_DXT1_SRGBA:
-      s3tc_decode_block_dxt1(gallivm, format_desc->format, dxt_block, col);
-      break;
-   case PIPE_FORMAT_DXT3_RGBA:
-   case PIPE_FORMAT_DXT3_SRGBA:
-      s3tc_decode_block_dxt3(gallivm, format_desc->format, dxt_block, col);
-      break;
-   case PIPE_FORMAT_DXT5_RGBA:
-   case PIPE_FORMAT_DXT5_SRGBA:
-      s3tc_decode_block_dxt5(gallivm, format_desc->format, dxt_block, col);
-      break;
-   default:
-      assert(0);
-      s3tc_decode_block_dxt1(gallivm, format_desc->format, dxt_block, col);
-      break;
+   if (format_desc->layout == UTIL_FORMAT_LAYOUT_S3TC) {
+      lp_build_gather_s3tc_simple_scalar(gallivm, format_desc, &dxt_block,
+                                         ptr_addr);
+
+      switch (format_desc->format) {
+      case PIPE_FORMAT_DXT1_RGB:
+      case PIPE_FORMAT_DXT1_RGBA:
+      case PIPE_FORMAT_DXT1_SRGB:
+      case PIPE_FORMAT_DXT1_SRGBA:
+         s3tc_decode_block_dxt1(gallivm, format_desc->format, dxt_block, col);
+         break;
+      case PIPE_FORMAT_DXT3_RGBA:
+      case PIPE_FORMAT_DXT3_SRGBA:
+         s3tc_decode_block_dxt3(gallivm, format_desc->format, dxt_block, col);
+         break;
+      case PIPE_FORMAT_DXT5_RGBA:
+      case PIPE_FORMAT_DXT5_SRGBA:
+         s3tc_decode_block_dxt5(gallivm, format_desc->format, dxt_block, col);
+         break;
+      default:
+         assert(0);
+         s3tc_decode_block_dxt1(gallivm, format_desc->format, dxt_block, col);
+         break;
+      }
+   }
+   else if (format_desc->layout == UTIL_FORMAT_LAYOUT_RGTC) {
+      lp_build_gather_s3tc_simple_scalar(gallivm, format_desc, &dxt_block,
+                                         ptr_addr);
+      rgtc_decode_block(gallivm, format_desc->format, dxt_block, col);
+   }
+   else {
+      unpack_block_8unorm(gallivm, format_desc, ptr_addr, col);
    }
 
    tag_value = LLVMBuildPtrToInt(gallivm->builder, ptr_addr,
                                  LLVMInt64TypeInContext(gallivm->context), "");
-   s3tc_store_cached_block(gallivm, col, tag_value, hash_index, cache);
+   s3tc_store_cached_block(gallivm, col, tag_value, entry, cache);
 
    LLVMBuildRetVoid(gallivm->builder);
 
@@ -1937,7 +2154,7 @@ static void
 update_cached_block(struct gallivm_state *gallivm,
                     const struct util_format_description *format_desc,
                     LLVMValueRef ptr_addr,
-                    LLVMValueRef hash_index,
+                    LLVMValueRef entry,
                     LLVMValueRef cache)
 
 {
@@ -1981,38 +2198,143 @@ update_cached_block(struct gallivm_state *gallivm,
    }
 
    args[0] = ptr_addr;
-   args[1] = hash_index;
+   args[1] = entry;
    args[2] = cache;
- 
+
    LLVMBuildCall(builder, function, args, ARRAY_SIZE(args), "");
    bb = LLVMGetInsertBlock(builder);
    inst = LLVMGetLastInstruction(bb);
    LLVMSetInstructionCallConv(inst, LLVMFastCallConv);
 }
 
+
 /*
- * cached lookup
+ * Find the cache entry holding the block at addr (a i64 scalar) in the
+ * given set, decoding the block into the set's victim way on a miss.
+ * Returns the (i32) entry index.
  */
 static LLVMValueRef
-compressed_fetch_cached(struct gallivm_state *gallivm,
-                        const struct util_format_description *format_desc,
-                        unsigned n,
-                        LLVMValueRef base_ptr,
-                        LLVMValueRef offset,
-                        LLVMValueRef i,
-                        LLVMValueRef j,
-                        LLVMValueRef cache)
+cache_lookup_entry(struct gallivm_state *gallivm,
+                   const struct util_format_description *format_desc,
+                   LLVMValueRef cache,
+                   LLVMValueRef addr,
+                   LLVMValueRef set_index,
+                   LLVMValueRef entry_var)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef i8t = LLVMInt8TypeInContext(gallivm->context);
+   LLVMValueRef first, entry, entryx, hit, cond, tag_stored;
+   LLVMValueRef victim_ptr, victim, ptr_addr, indices[3];
+   struct lp_build_if_state if_ctx;
+   unsigned way;
+
+   first = LLVMBuildMul(builder, set_index,
+                        lp_build_const_int32(gallivm, LP_BUILD_FORMAT_CACHE_WAYS), "");
+   entry = first;
+   hit = LLVMConstNull(LLVMInt1TypeInContext(gallivm->context));
+   for (way = 0; way < LP_BUILD_FORMAT_CACHE_WAYS; way++) {
+      entryx = LLVMBuildAdd(builder, first,
+                            lp_build_const_int32(gallivm, way), "");
+      tag_stored = s3tc_lookup_tag_data(gallivm, cache, entryx);
+      cond = LLVMBuildICmp(builder, LLVMIntEQ, tag_stored, addr, "");
+      entry = LLVMBuildSelect(builder, cond, entryx, entry, "");
+      hit = LLVMBuildOr(builder, hit, cond, "");
+   }
+   LLVMBuildStore(builder, entry, entry_var);
+
+   lp_build_if(&if_ctx, gallivm, LLVMBuildNot(builder, hit, ""));
+   {
+      /* round-robin replacement within the set */
+      indices[0] = lp_build_const_int32(gallivm, 0);
+      indices[1] = lp_build_const_int32(gallivm, LP_BUILD_FORMAT_CACHE_MEMBER_VICTIM);
+      indices[2] = set_index;
+      victim_ptr = LLVMBuildGEP(builder, cache, indices, ARRAY_SIZE(indices), "");
+      victim = LLVMBuildLoad(builder, victim_ptr, "victim");
+      entry = LLVMBuildAnd(builder, victim,
+                           lp_build_const_int32(gallivm, LP_BUILD_FORMAT_CACHE_WAYS - 1), "");
+      entry = LLVMBuildAdd(builder, first, entry, "");
+      victim = LLVMBuildAdd(builder, victim, lp_build_const_int32(gallivm, 1), "");
+      LLVMBuildStore(builder, victim, victim_ptr);
+      LLVMBuildStore(builder, entry, entry_var);
+
+      ptr_addr = LLVMBuildIntToPtr(builder, addr, LLVMPointerType(i8t, 0), "");
+      update_cached_block(gallivm, format_desc, ptr_addr, entry, cache);
+      if (gallivm_debug & GALLIVM_DEBUG_CACHE) {
+         s3tc_update_cache_access(gallivm, cache, 1,
+                                  LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_MISS);
+      }
+   }
+   lp_build_endif(&if_ctx);
+
+   return LLVMBuildLoad(builder, entry_var, "");
+}
+
+
+/**
+ * Whether texels of this format can be fetched through the block cache.
+ * s3tc and rgtc/latc unorm blocks are decoded by generated code, the other
+ * 8unorm-compatible compressed formats by their util unpack function
+ * (which is still much cheaper than calling fetch_rgba_8unorm per texel).
+ */
+boolean
+lp_build_format_cache_supported(const struct util_format_description *format_desc)
+{
+   if (format_desc->block.width != 4 || format_desc->block.height != 4) {
+      return FALSE;
+   }
+
+   switch (format_desc->layout) {
+   case UTIL_FORMAT_LAYOUT_S3TC:
+      return TRUE;
+   case UTIL_FORMAT_LAYOUT_RGTC:
+      return format_desc->format == PIPE_FORMAT_RGTC1_UNORM ||
+             format_desc->format == PIPE_FORMAT_RGTC2_UNORM ||
+             format_desc->format == PIPE_FORMAT_LATC1_UNORM ||
+             format_desc->format == PIPE_FORMAT_LATC2_UNORM;
+   case UTIL_FORMAT_LAYOUT_BPTC:
+   case UTIL_FORMAT_LAYOUT_ETC:
+      return util_format_fits_8unorm(format_desc) &&
+             format_desc->unpack_rgba_8unorm != NULL;
+   default:
+      return FALSE;
+   }
+}
+
+
+/**
+ * Cached lookup of texels of a block compressed format.
+ *
+ * @param n  number of pixels processed
+ * @param base_ptr  base pointer (32bit or 64bit pointer depending on the architecture)
+ * @param offset <n x i32> vector with the relative offsets of the blocks
+ * @param i  is a <n x i32> vector with the x subpixel coordinate (0..3)
+ * @param j  is a <n x i32> vector with the y subpixel coordinate (0..3)
+ * @param cache  pointer to a struct lp_build_format_cache
+ * @return  a <4*n x i8> vector with the pixel RGBA values in AoS
+ */
+LLVMValueRef
+lp_build_fetch_cached_texels(struct gallivm_state *gallivm,
+                             const struct util_format_description *format_desc,
+                             unsigned n,
+                             LLVMValueRef base_ptr,
+                             LLVMValueRef offset,
+                             LLVMValueRef i,
+                             LLVMValueRef j,
+                             LLVMValueRef cache)
 
 {
    LLVMBuilderRef builder = gallivm->builder;
    unsigned count, low_bit, log2size;
-   LLVMValueRef color, offset_stored, addr, ptr_addrtrunc, tmp;
+   LLVMValueRef color, addr, ptr_addrtrunc, tmp, entry, entry_var;
    LLVMValueRef ij_index, hash_index, hash_mask, block_index;
    LLVMTypeRef i8t = LLVMInt8TypeInContext(gallivm->context);
    LLVMTypeRef i32t = LLVMInt32TypeInContext(gallivm->context);
    LLVMTypeRef i64t = LLVMInt64TypeInContext(gallivm->context);
    struct lp_type type;
    struct lp_build_context bld32;
+
+   assert(lp_build_format_cache_supported(format_desc));
+
    memset(&type, 0, sizeof type);
    type.width = 32;
    type.length = n;
@@ -2020,17 +2342,17 @@ compressed_fetch_cached(struct gallivm_state *gallivm,
    lp_build_context_init(&bld32, gallivm, type);
 
    /*
-    * compute hash - we use direct mapped cache, the hash function could
+    * compute hash - this picks the set, the hash function could
     *                be better but it needs to be simple
     * per-element:
-    *    compare offset with offset stored at tag (hash)
-    *    if not equal extract block, store block, update tag
+    *    compare offset with offsets stored at the tags of all ways of the set
+    *    if none is equal extract block, store block in victim way, update tag
     *    extract color from cache
     *    assemble colors
     */
 
    low_bit = util_logbase2(format_desc->block.bits / 8);
-   log2size = util_logbase2(LP_BUILD_FORMAT_CACHE_SIZE);
+   log2size = util_logbase2(LP_BUILD_FORMAT_CACHE_SETS);
    addr = LLVMBuildPtrToInt(builder, base_ptr, i64t, "");
    ptr_addrtrunc = LLVMBuildPtrToInt(builder, base_ptr, i32t, "");
    ptr_addrtrunc = lp_build_broadcast_scalar(&bld32, ptr_addrtrunc);
@@ -2048,79 +2370,57 @@ compressed_fetch_cached(struct gallivm_state *gallivm,
                        lp_build_const_int_vec(gallivm, type, log2size), "");
    hash_index = LLVMBuildXor(builder, hash_index, tmp, "");
 
-   hash_mask = lp_build_const_int_vec(gallivm, type, LP_BUILD_FORMAT_CACHE_SIZE - 1);
+   hash_mask = lp_build_const_int_vec(gallivm, type, LP_BUILD_FORMAT_CACHE_SETS - 1);
    hash_index = LLVMBuildAnd(builder, hash_index, hash_mask, "");
    ij_index = LLVMBuildShl(builder, i, lp_build_const_int_vec(gallivm, type, 2), "");
    ij_index = LLVMBuildAdd(builder, ij_index, j, "");
-   block_index = LLVMBuildShl(builder, hash_index,
-                              lp_build_const_int_vec(gallivm, type, 4), "");
-   block_index = LLVMBuildAdd(builder, ij_index, block_index, "");
+
+   entry_var = lp_build_alloca(gallivm, i32t, "cache_entry");
 
    if (n > 1) {
       color = bld32.undef;
       for (count = 0; count < n; count++) {
-         LLVMValueRef index, cond, colorx;
-         LLVMValueRef block_indexx, hash_indexx, addrx, offsetx, ptr_addrx;
-         struct lp_build_if_state if_ctx;
+         LLVMValueRef index, colorx;
+         LLVMValueRef ij_indexx, hash_indexx, addrx, offsetx;
 
          index = lp_build_const_int32(gallivm, count);
          offsetx = LLVMBuildExtractElement(builder, offset, index, "");
          addrx = LLVMBuildZExt(builder, offsetx, i64t, "");
          addrx = LLVMBuildAdd(builder, addrx, addr, "");
-         block_indexx = LLVMBuildExtractElement(builder, block_index, index, "");
-         hash_indexx = LLVMBuildLShr(builder, block_indexx,
-                                     lp_build_const_int32(gallivm, 4), "");
-         offset_stored = s3tc_lookup_tag_data(gallivm, cache, hash_indexx);
-         cond = LLVMBuildICmp(builder, LLVMIntNE, offset_stored, addrx, "");
-
-         lp_build_if(&if_ctx, gallivm, cond);
-         {
-            ptr_addrx = LLVMBuildIntToPtr(builder, addrx,
-                                          LLVMPointerType(i8t, 0), "");
-            update_cached_block(gallivm, format_desc, ptr_addrx, hash_indexx, cache);
-#if LP_BUILD_FORMAT_CACHE_DEBUG
-            s3tc_update_cache_access(gallivm, cache, 1,
-                                     LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_MISS);
-#endif
-         }
-         lp_build_endif(&if_ctx);
+         hash_indexx = LLVMBuildExtractElement(builder, hash_index, index, "");
+         ij_indexx = LLVMBuildExtractElement(builder, ij_index, index, "");
 
-         colorx = s3tc_lookup_cached_pixel(gallivm, cache, block_indexx);
+         entry = cache_lookup_entry(gallivm, format_desc, cache,
+                                    addrx, hash_indexx, entry_var);
+         block_index = LLVMBuildShl(builder, entry,
+                                    lp_build_const_int32(gallivm, 4), "");
+         block_index = LLVMBuildAdd(builder, ij_indexx, block_index, "");
+
+         colorx = s3tc_lookup_cached_pixel(gallivm, cache, block_index);
 
          color = LLVMBuildInsertElement(builder, color, colorx,
                                         lp_build_const_int32(gallivm, count), "");
       }
    }
    else {
-      LLVMValueRef cond;
-      struct lp_build_if_state if_ctx;
-
       tmp = LLVMBuildZExt(builder, offset, i64t, "");
       addr = LLVMBuildAdd(builder, tmp, addr, "");
-      offset_stored = s3tc_lookup_tag_data(gallivm, cache, hash_index);
-      cond = LLVMBuildICmp(builder, LLVMIntNE, offset_stored, addr, "");
-
-      lp_build_if(&if_ctx, gallivm, cond);
-      {
-         tmp = LLVMBuildIntToPtr(builder, addr, LLVMPointerType(i8t, 0), "");
-         update_cached_block(gallivm, format_desc, tmp, hash_index, cache);
-#if LP_BUILD_FORMAT_CACHE_DEBUG
-         s3tc_update_cache_access(gallivm, cache, 1,
-                                  LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_MISS);
-#endif
-      }
-      lp_build_endif(&if_ctx);
+
+      entry = cache_lookup_entry(gallivm, format_desc, cache,
+                                 addr, hash_index, entry_var);
+      block_index = LLVMBuildShl(builder, entry,
+                                 lp_build_const_int32(gallivm, 4), "");
+      block_index = LLVMBuildAdd(builder, ij_index, block_index, "");
 
       color = s3tc_lookup_cached_pixel(gallivm, cache, block_index);
    }
-#if LP_BUILD_FORMAT_CACHE_DEBUG
-   s3tc_update_cache_access(gallivm, cache, n,
-                            LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_TOTAL);
-#endif
+   if (gallivm_debug & GALLIVM_DEBUG_CACHE) {
+      s3tc_update_cache_access(gallivm, cache, n,
+                               LP_BUILD_FORMAT_CACHE_MEMBER_ACCESS_TOTAL);
+   }
    return LLVMBuildBitCast(builder, color, LLVMVectorType(i8t, n * 4), "");
 }
 
-
 static LLVMValueRef
 s3tc_dxt5_to_rgba_aos(struct gallivm_state *gallivm,
                       unsigned n,
@@ -2168,8 +2468,8 @@ lp_build_fetch_s3tc_rgba_aos(struct gallivm_state *gallivm,
 
 /*   debug_printf("format = %d\n", format_desc->format);*/
    if (cache) {
-      rgba = compressed_fetch_cached(gallivm, format_desc, n,
-                                     base_ptr, offset, i, j, cache);
+      rgba = lp_build_fetch_cached_texels(gallivm, format_desc, n,
+                                          base_ptr, offset, i, j, cache);
       return rgba;
    }
 
@@ -36,22 +36,29 @@
 #include "lp_bld.h"
 #include "lp_bld_debug.h"
 #include "lp_bld_misc.h"
+#include "lp_bld_type.h"
+#include "lp_bld_intr.h"
 #include "lp_bld_init.h"
 
 #include <llvm/Config/llvm-config.h>
 #include <llvm-c/Analysis.h>
 #include <llvm-c/Transforms/Scalar.h>
+#include <llvm-c/Transforms/IPO.h>
 #if LLVM_VERSION_MAJOR >= 7
 #include <llvm-c/Transforms/Utils.h>
 #endif
 #include <llvm-c/BitWriter.h>
 #if GALLIVM_HAVE_CORO
-#if LLVM_VERSION_MAJOR <= 8 && defined(PIPE_ARCH_AARCH64)
-#include <llvm-c/Transforms/IPO.h>
-#endif
 #include <llvm-c/Transforms/Coroutines.h>
 #endif
 
+/**
+ * Modules with more instructions than this skip the module level passes,
+ * as inlining makes the per-function passes (GVN in particular) slower
+ * than the calls would have cost.
+ */
+#define GALLIVM_IPO_MAX_MODULE_INSTRS 40000
+
 unsigned gallivm_perf = 0;
 
 static const struct debug_named_value lp_bld_perf_flags[] = {
@@ -60,6 +67,11 @@ static const struct debug_named_value lp_bld_perf_flags[] = {
    { "no_quad_lod", GALLIVM_PERF_NO_QUAD_LOD, "disable quad_lod optimization" },
    { "no_aos_sampling", GALLIVM_PERF_NO_AOS_SAMPLING, "disable aos sampling optimization" },
    { "nopt",   GALLIVM_PERF_NO_OPT, "disable optimization passes to speed up shader compilation" },
+   { "avx2_amd", GALLIVM_PERF_AVX2_AMD, "use 256bit vectors on AMD Zen CPUs with AVX2" },
+   { "avx512", GALLIVM_PERF_AVX512, "use 512bit vectors on CPUs with AVX-512" },
+   { "no_ipo", GALLIVM_PERF_NO_IPO, "disable inlining of texture functions" },
+   { "no_hoist", GALLIVM_PERF_NO_HOIST, "disable hoisting of invariant loads out of loops" },
+   { "mediump", GALLIVM_PERF_MEDIUMP, "use medium precision exp2/log2/pow/sin/cos unless the instruction is precise" },
    { "no_filter_hacks", GALLIVM_PERF_NO_BRILINEAR | GALLIVM_PERF_NO_RHO_APPROX |
      GALLIVM_PERF_NO_QUAD_LOD, "disable filter optimization hacks" },
    DEBUG_NAMED_VALUE_END
@@ -75,6 +87,7 @@ static const struct debug_named_value lp_bld_debug_flags[] = {
    { "perf",   GALLIVM_DEBUG_PERF, NULL },
    { "gc",     GALLIVM_DEBUG_GC, NULL },
    { "dumpbc", GALLIVM_DEBUG_DUMP_BC, NULL },
+   { "cache",  GALLIVM_DEBUG_CACHE, NULL },
    DEBUG_NAMED_VALUE_END
 };
 
@@ -122,12 +135,6 @@ create_pass_manager(struct gallivm_state *gallivm)
 #if GALLIVM_HAVE_CORO
    gallivm->cgpassmgr = LLVMCreatePassManager();
 #endif
-   /*
-    * TODO: some per module pass manager with IPO passes might be helpful -
-    * the generated texture functions may benefit from inlining if they are
-    * simple, or constant propagation into them, etc.
-    */
-
    {
       char *td_str;
       // New ones from the Module.
@@ -145,7 +152,17 @@ create_pass_manager(struct gallivm_state *gallivm)
    LLVMAddCoroElidePass(gallivm->cgpassmgr);
 #endif
 
-   if ((gallivm_perf & GALLIVM_PERF_NO_OPT) == 0) {
+   return TRUE;
+}
+
+
+/**
+ * Install the optimization passes for the module's optimization level.
+ */
+static void
+add_optimization_passes(struct gallivm_state *gallivm)
+{
+   if (gallivm->opt_level != GALLIVM_OPT_NONE) {
       /*
        * TODO: Evaluate passes some more - keeping in mind
        * both quality of generated code and compile times.
@@ -164,6 +181,8 @@ create_pass_manager(struct gallivm_state *gallivm)
        * Even for sane shaders, the cost of licm is rather high (and not just
        * due to lcssa, licm itself too), though mostly only in cases when it
        * can actually move things, so having to disable it is a pity.
+       * Loads known to be invariant get hoisted while building the loops
+       * instead, see lp_build_invariant_load().
        * LLVMAddLICMPass(gallivm->passmgr);
        */
       LLVMAddReassociatePass(gallivm->passmgr);
@@ -181,8 +200,95 @@ create_pass_manager(struct gallivm_state *gallivm)
        */
       LLVMAddPromoteMemoryToRegisterPass(gallivm->passmgr);
    }
+}
 
-   return TRUE;
+
+static unsigned
+count_function_instrs(LLVMValueRef func)
+{
+   LLVMBasicBlockRef block;
+   LLVMValueRef inst;
+   unsigned count = 0;
+
+   for (block = LLVMGetFirstBasicBlock(func); block;
+        block = LLVMGetNextBasicBlock(block)) {
+      for (inst = LLVMGetFirstInstruction(block); inst;
+           inst = LLVMGetNextInstruction(inst)) {
+         count++;
+      }
+   }
+   return count;
+}
+
+
+/**
+ * Decide which internal functions (the texture functions) get inlined into
+ * their callers, by marking them alwaysinline.  This is what lets constant
+ * arguments (explicit lods, offsets, ...) and the loads from the jit context
+ * be folded and shared with the rest of the shader.
+ *
+ * Only functions with a single caller are inlined, and huge modules are left
+ * alone altogether.  Inlining a texture function into several callers never
+ * made lp_test_texfunc draw faster, but it made the compile up to ten times
+ * slower.
+ *
+ * \return  whether the module level passes need to run
+ */
+static boolean
+mark_inline_functions(struct gallivm_state *gallivm)
+{
+   LLVMValueRef func;
+   unsigned module_instrs = 0;
+   boolean inline_any = FALSE;
+
+   if (gallivm->opt_level == GALLIVM_OPT_NONE ||
+       (gallivm_perf & GALLIVM_PERF_NO_IPO))
+      return FALSE;
+
+   for (func = LLVMGetFirstFunction(gallivm->module); func;
+        func = LLVMGetNextFunction(func)) {
+      module_instrs += count_function_instrs(func);
+   }
+   if (module_instrs > GALLIVM_IPO_MAX_MODULE_INSTRS)
+      return FALSE;
+
+   for (func = LLVMGetFirstFunction(gallivm->module); func;
+        func = LLVMGetNextFunction(func)) {
+      LLVMUseRef use;
+      unsigned num_calls = 0;
+
+      if (LLVMIsDeclaration(func) ||
+          LLVMGetLinkage(func) != LLVMInternalLinkage)
+         continue;
+
+      for (use = LLVMGetFirstUse(func); use; use = LLVMGetNextUse(use)) {
+         num_calls++;
+      }
+      if (num_calls != 1)
+         continue;
+
+      lp_add_function_attr(func, -1, LP_FUNC_ATTR_ALWAYSINLINE);
+      inline_any = TRUE;
+   }
+
+   return inline_any;
+}
+
+
+/**
+ * Inline what mark_inline_functions() picked, propagate constants across
+ * the remaining calls and drop the functions which became unused.
+ */
+static void
+run_ipo_passes(struct gallivm_state *gallivm)
+{
+   LLVMPassManagerRef ipopassmgr = LLVMCreatePassManager();
+
+   LLVMAddAlwaysInlinerPass(ipopassmgr);
+   LLVMAddIPSCCPPass(ipopassmgr);
+   LLVMAddGlobalDCEPass(ipopassmgr);
+   LLVMRunPassManager(ipopassmgr, gallivm->module);
+   LLVMDisposePassManager(ipopassmgr);
 }
 
 
@@ -255,7 +361,7 @@ init_gallivm_engine(struct gallivm_state *gallivm)
       char *error = NULL;
       int ret;
 
-      if (gallivm_perf & GALLIVM_PERF_NO_OPT) {
+      if (gallivm->opt_level == GALLIVM_OPT_NONE) {
          optlevel = None;
       }
       else {
@@ -322,6 +428,11 @@ init_gallivm_state(struct gallivm_state *gallivm, const char *name,
    if (!gallivm->context)
       goto fail;
 
+   if (gallivm_perf & GALLIVM_PERF_NO_OPT)
+      gallivm->opt_level = GALLIVM_OPT_NONE;
+   else
+      gallivm->opt_level = GALLIVM_OPT_DEFAULT;
+
    gallivm->module_name = NULL;
    if (name) {
       size_t size = strlen(name) + 1;
@@ -396,6 +507,28 @@ fail:
 }
 
 
+/**
+ * Whether 512bit vectors can be used.  Besides the foundation we want BW
+ * for 8/16bit packing, DQ for the mask conversions and VL so that the
+ * remaining 128/256bit code gets EVEX encoded too.  Older LLVM versions
+ * don't pick up the host features (and had rather immature AVX-512 support
+ * anyway), so don't bother there.
+ */
+static boolean
+lp_has_avx512(void)
+{
+#if LLVM_VERSION_MAJOR >= 4
+   return util_cpu_caps.has_avx2 &&
+          util_cpu_caps.has_avx512f &&
+          util_cpu_caps.has_avx512bw &&
+          util_cpu_caps.has_avx512dq &&
+          util_cpu_caps.has_avx512vl;
+#else
+   return FALSE;
+#endif
+}
+
+
 boolean
 lp_build_init(void)
 {
@@ -444,16 +577,44 @@ lp_build_init(void)
    if (util_cpu_caps.has_avx &&
        util_cpu_caps.has_intel) {
       lp_native_vector_width = 256;
+   } else if (util_cpu_caps.has_avx2 &&
+              util_cpu_caps.x86_cpu_type >= 0x17 &&
+              (gallivm_perf & GALLIVM_PERF_AVX2_AMD)) {
+      /* Zen has full-rate AVX2 (Zen 2 and later natively, Zen 1 by splitting
+       * into 128bit ops), so unlike Bulldozer wider vectors may pay off, but
+       * this hasn't been measured widely enough to make it the default.
+       */
+      lp_native_vector_width = 256;
    } else {
       /* Leave it at 128, even when no SIMD extensions are available.
        * Really needs to be a multiple of 128 so can fit 4 floats.
        */
       lp_native_vector_width = 128;
    }
- 
+
+   if (lp_has_avx512() && (gallivm_perf & GALLIVM_PERF_AVX512)) {
+      lp_native_vector_width = 512;
+   }
+
    lp_native_vector_width = debug_get_num_option("LP_NATIVE_VECTOR_WIDTH",
                                                  lp_native_vector_width);
 
+   if (lp_native_vector_width > 256 && !lp_has_avx512()) {
+      debug_printf("%s: no usable AVX-512, using 256bit vectors\n",
+                   __FUNCTION__);
+      lp_native_vector_width = 256;
+   }
+
+   if (lp_native_vector_width < 512) {
+      /* Same as for AVX below: 512bit paths are only guarded by the
+       * "util_cpu_caps.has_avx512*" predicates.
+       */
+      util_cpu_caps.has_avx512f = 0;
+      util_cpu_caps.has_avx512dq = 0;
+      util_cpu_caps.has_avx512bw = 0;
+      util_cpu_caps.has_avx512vl = 0;
+   }
+
    if (lp_native_vector_width <= 128) {
       /* Hide AVX support, as often LLVM AVX intrinsics are only guarded by
        * "util_cpu_caps.has_avx" predicate, and lack the
@@ -563,6 +724,7 @@ gallivm_compile_module(struct gallivm_state *gallivm)
 {
    LLVMValueRef func;
    int64_t time_begin = 0;
+   boolean ipo;
 
    assert(!gallivm->compiled);
 
@@ -571,6 +733,8 @@ gallivm_compile_module(struct gallivm_state *gallivm)
       gallivm->builder = NULL;
    }
 
+   ipo = mark_inline_functions(gallivm);
+
    /* Dump bitcode to a file */
    if (gallivm_debug & GALLIVM_DEBUG_DUMP_BC) {
       char filename[256];
@@ -578,11 +742,12 @@ gallivm_compile_module(struct gallivm_state *gallivm)
       snprintf(filename, sizeof(filename), "ir_%s.bc", gallivm->module_name);
       LLVMWriteBitcodeToFile(gallivm->module, filename);
       debug_printf("%s written\n", filename);
-      debug_printf("Invoke as \"opt %s %s | llc -O%d %s%s\"\n",
-                   gallivm_debug & GALLIVM_PERF_NO_OPT ? "-mem2reg" :
+      debug_printf("Invoke as \"opt %s%s %s | llc -O%d %s%s\"\n",
+                   ipo ? "-always-inline -ipsccp -globaldce " : "",
+                   gallivm->opt_level == GALLIVM_OPT_NONE ? "-mem2reg" :
                    "-sroa -early-cse -simplifycfg -reassociate "
                    "-mem2reg -constprop -instcombine -gvn",
-                   filename, gallivm_debug & GALLIVM_PERF_NO_OPT ? 0 : 2,
+                   filename, gallivm->opt_level == GALLIVM_OPT_NONE ? 0 : 2,
                    "[-mcpu=<-mcpu option>] ",
                    "[-mattr=<-mattr option(s)>]");
    }
@@ -593,7 +758,11 @@ gallivm_compile_module(struct gallivm_state *gallivm)
 #if GALLIVM_HAVE_CORO
    LLVMRunPassManager(gallivm->cgpassmgr, gallivm->module);
 #endif
+   if (ipo)
+      run_ipo_passes(gallivm);
+
    /* Run optimization passes */
+   add_optimization_passes(gallivm);
    LLVMInitializeFunctionPassManager(gallivm->passmgr);
    func = LLVMGetFirstFunction(gallivm->module);
    while (func) {
@@ -608,6 +777,14 @@ gallivm_compile_module(struct gallivm_state *gallivm)
       LLVMAddTargetDependentFunctionAttr(func, "no-frame-pointer-elim-non-leaf", "true");
 #endif
 
+      /* LLVM prefers 256bit vectors on AVX-512 CPUs unless told otherwise,
+       * and would split all our 512bit operations.
+       */
+      if (lp_native_vector_width > 256) {
+         LLVMAddTargetDependentFunctionAttr(func, "prefer-vector-width", "512");
+         LLVMAddTargetDependentFunctionAttr(func, "min-legal-vector-width", "512");
+      }
+
       LLVMRunFunctionPassManager(gallivm->passmgr, func);
       func = LLVMGetNextFunction(func);
    }
@@ -39,6 +39,18 @@
 extern "C" {
 #endif
 
+/**
+ * How much work gallivm_compile_module() puts into the generated code.
+ */
+enum gallivm_opt_level
+{
+   /** Only what the backends need, for the fastest compile. */
+   GALLIVM_OPT_NONE,
+   /** The whole optimization pass pipeline. */
+   GALLIVM_OPT_DEFAULT,
+};
+
+
 struct gallivm_state
 {
    char *module_name;
@@ -52,6 +64,13 @@ struct gallivm_state
    LLVMMCJITMemoryManagerRef memorymgr;
    struct lp_generated_code *code;
    unsigned compiled;
+   /**
+    * Picked by gallivm_create() from GALLIVM_PERF, may be changed until the
+    * module is compiled.
+    */
+   enum gallivm_opt_level opt_level;
+   /** Outermost loop loads are being hoisted out of, see lp_bld_flow.h */
+   struct lp_build_hoist_state *hoist;
 };
 
 
@@ -346,6 +346,17 @@ lp_build_select(struct lp_build_context *bld,
 
       res = LLVMBuildSelect(builder, mask, a, b, "");
    }
+   else if (util_cpu_caps.has_avx512f &&
+            type.width * type.length == 512 &&
+            (type.width >= 32 || util_cpu_caps.has_avx512bw)) {
+      /* There's no blendv with 512bit vectors, the mask has to go through a
+       * mask register, which a vector select on the sign bit gets us.
+       */
+      LLVMValueRef zero = LLVMConstNull(bld->int_vec_type);
+
+      mask = LLVMBuildICmp(builder, LLVMIntSLT, mask, zero, "");
+      res = LLVMBuildSelect(builder, mask, a, b, "");
+   }
    else if (((util_cpu_caps.has_sse4_1 &&
               type.width * type.length == 128) ||
              (util_cpu_caps.has_avx &&
@@ -491,6 +502,28 @@ lp_build_any_true_range(struct lp_build_context *bld,
 
    assert(real_length <= bld->type.length);
 
+   if (util_cpu_caps.has_avx512f &&
+       bld->type.width * bld->type.length == 512 &&
+       (bld->type.width >= 32 || util_cpu_caps.has_avx512bw)) {
+      /*
+       * Bitcasting a 512bit vector to a scalar goes through memory, so
+       * compare into a mask register and test that instead.
+       */
+      LLVMValueRef zero = LLVMConstNull(bld->int_vec_type);
+
+      val = LLVMBuildBitCast(builder, val, bld->int_vec_type, "");
+      val = LLVMBuildICmp(builder, LLVMIntNE, val, zero, "");
+      scalar_type = LLVMIntTypeInContext(bld->gallivm->context,
+                                         bld->type.length);
+      true_type = LLVMIntTypeInContext(bld->gallivm->context, real_length);
+      val = LLVMBuildBitCast(builder, val, scalar_type, "");
+      if (real_length < bld->type.length) {
+         val = LLVMBuildTrunc(builder, val, true_type, "");
+      }
+      return LLVMBuildICmp(builder, LLVMIntNE,
+                           val, LLVMConstNull(true_type), "");
+   }
+
    true_type = LLVMIntTypeInContext(bld->gallivm->context,
                                     bld->type.width * real_length);
    scalar_type = LLVMIntTypeInContext(bld->gallivm->context,
@@ -153,6 +153,33 @@ lp_build_const_unpack_shuffle_16wide(struct gallivm_state *gallivm,
    return LLVMConstVector(elems, 16);
 }
 
+/**
+ * Similar to lp_build_const_unpack_shuffle but interleaving within each
+ * 128bit lane, matching the AVX512BW unpack instructions (and hence the
+ * lane order of the AVX512BW pack instructions).
+ */
+static LLVMValueRef
+lp_build_const_unpack_shuffle_lanes(struct gallivm_state *gallivm,
+                                    struct lp_type type, unsigned lo_hi)
+{
+   LLVMValueRef elems[LP_MAX_VECTOR_LENGTH];
+   const unsigned n = type.length;
+   const unsigned lane = 128 / type.width;
+   unsigned i, j;
+
+   assert(n <= LP_MAX_VECTOR_LENGTH);
+   assert(lo_hi < 2);
+
+   for (i = 0; i < n; i += 2) {
+      j = (i / lane) * lane + lo_hi * (lane / 2) + (i % lane) / 2;
+
+      elems[i + 0] = lp_build_const_int32(gallivm, 0 + j);
+      elems[i + 1] = lp_build_const_int32(gallivm, n + j);
+   }
+
+   return LLVMConstVector(elems, n);
+}
+
 /**
  * Build shuffle vectors that match PACKxx (SSE) instructions or
  * VPERM (Altivec).
@@ -487,6 +514,12 @@ lp_build_unpack2_native(struct gallivm_state *gallivm,
    if (src_type.length * src_type.width == 256 && util_cpu_caps.has_avx2) {
       *dst_lo = lp_build_interleave2_half(gallivm, src_type, src, msb, 0);
       *dst_hi = lp_build_interleave2_half(gallivm, src_type, src, msb, 1);
+   } else if (src_type.length * src_type.width == 512 &&
+              util_cpu_caps.has_avx512bw) {
+      *dst_lo = LLVMBuildShuffleVector(builder, src, msb,
+                   lp_build_const_unpack_shuffle_lanes(gallivm, src_type, 0), "");
+      *dst_hi = LLVMBuildShuffleVector(builder, src, msb,
+                   lp_build_const_unpack_shuffle_lanes(gallivm, src_type, 1), "");
    } else {
       *dst_lo = lp_build_interleave2(gallivm, src_type, src, msb, 0);
       *dst_hi = lp_build_interleave2(gallivm, src_type, src, msb, 1);
@@ -738,7 +771,7 @@ lp_build_pack2_native(struct gallivm_state *gallivm,
    assert(src_type.width == dst_type.width * 2);
    assert(src_type.length * 2 == dst_type.length);
 
-   /* At this point only have special case for avx2 */
+   /* At this point only have special cases for avx2 and avx512bw */
    if (src_type.length * src_type.width == 256 &&
        util_cpu_caps.has_avx2) {
       switch(src_type.width) {
@@ -758,6 +791,25 @@ lp_build_pack2_native(struct gallivm_state *gallivm,
          break;
       }
    }
+   else if (src_type.length * src_type.width == 512 &&
+            util_cpu_caps.has_avx512bw) {
+      switch(src_type.width) {
+      case 32:
+         if (dst_type.sign) {
+            intrinsic = "llvm.x86.avx512.packssdw.512";
+         } else {
+            intrinsic = "llvm.x86.avx512.packusdw.512";
+         }
+         break;
+      case 16:
+         if (dst_type.sign) {
+            intrinsic = "llvm.x86.avx512.packsswb.512";
+         } else {
+            intrinsic = "llvm.x86.avx512.packuswb.512";
+         }
+         break;
+      }
+   }
    if (intrinsic) {
       LLVMTypeRef intr_vec_type = lp_build_vec_type(gallivm, intr_type);
       return lp_build_intrinsic_binary(builder, intrinsic, intr_vec_type,
@@ -38,8 +38,10 @@
 #define LP_BLD_TGSI_H
 
 #include "gallivm/lp_bld.h"
+#include "gallivm/lp_bld_flow.h"
 #include "gallivm/lp_bld_tgsi_action.h"
 #include "gallivm/lp_bld_limits.h"
+#include "gallivm/lp_bld_arit.h"
 #include "gallivm/lp_bld_sample.h"
 #include "lp_bld_type.h"
 #include "pipe/p_compiler.h"
@@ -326,6 +328,7 @@ struct lp_exec_mask {
          LLVMValueRef cont_mask;
          LLVMValueRef break_mask;
          LLVMValueRef break_var;
+         struct lp_build_hoist_state hoist;
       } loop_stack[LP_MAX_TGSI_NESTING];
       int loop_stack_size;
 
@@ -413,6 +416,9 @@ struct lp_build_tgsi_context
 
    boolean soa;
 
+   /* Accuracy of transcendental opcodes not marked as precise. */
+   enum gallivm_precision precision;
+
    int pc;
 
    struct tgsi_full_instruction *instructions;
@@ -51,6 +51,7 @@
 #include "lp_bld_pack.h"
 
 #include "tgsi/tgsi_exec.h"
+#include "tgsi/tgsi_parse.h"
 
 /* XXX: The CPU only defaults should be repaced by generic ones.  In most
  * cases, the CPU defaults are just wrappers around a function in
@@ -628,6 +629,19 @@ static void rcp_emit(
                                    TGSI_OPCODE_DIV, one, emit_data->args[0]);
 }
 
+/*
+ * Precision to use for transcendental opcodes: precise instructions
+ * always get full accuracy.
+ */
+static enum gallivm_precision
+emit_precision(const struct lp_build_tgsi_context * bld_base,
+               const struct lp_build_emit_data * emit_data)
+{
+   if (emit_data->inst && emit_data->inst->Instruction.Precise)
+      return GALLIVM_PRECISION_FULL;
+   return bld_base->precision;
+}
+
 /* TGSI_OPCODE_POW */
 
 static void
@@ -636,8 +650,9 @@ pow_emit(
    struct lp_build_tgsi_context * bld_base,
    struct lp_build_emit_data * emit_data)
 {
-   emit_data->output[emit_data->chan] = lp_build_pow(&bld_base->base,
-                                   emit_data->args[0], emit_data->args[1]);
+   emit_data->output[emit_data->chan] = lp_build_pow_prec(&bld_base->base,
+                                   emit_data->args[0], emit_data->args[1],
+                                   emit_precision(bld_base, emit_data));
 }
 
 static struct lp_build_tgsi_action pow_action = {
@@ -1349,8 +1364,9 @@ cos_emit_cpu(
    struct lp_build_tgsi_context * bld_base,
    struct lp_build_emit_data * emit_data)
 {
-   emit_data->output[emit_data->chan] = lp_build_cos(&bld_base->base,
-                                                       emit_data->args[0]);
+   emit_data->output[emit_data->chan] = lp_build_cos_prec(&bld_base->base,
+                                                         emit_data->args[0],
+                                                         emit_precision(bld_base, emit_data));
 }
 
 /* TGSI_OPCODE_DIV (CPU Only) */
@@ -1371,8 +1387,9 @@ ex2_emit_cpu(
    struct lp_build_tgsi_context * bld_base,
    struct lp_build_emit_data * emit_data)
 {
-   emit_data->output[emit_data->chan] = lp_build_exp2(&bld_base->base,
-                                                        emit_data->args[0]);
+   emit_data->output[emit_data->chan] = lp_build_exp2_prec(&bld_base->base,
+                                                          emit_data->args[0],
+                                                          emit_precision(bld_base, emit_data));
 }
 
 /* TGSI_OPCODE_F2I (CPU Only) */
@@ -1612,8 +1629,9 @@ lg2_emit_cpu(
    struct lp_build_tgsi_context * bld_base,
    struct lp_build_emit_data * emit_data)
 {
-   emit_data->output[emit_data->chan] = lp_build_log2_safe(&bld_base->base,
-                                                           emit_data->args[0]);
+   emit_data->output[emit_data->chan] = lp_build_log2_safe_prec(&bld_base->base,
+                                                               emit_data->args[0],
+                                                               emit_precision(bld_base, emit_data));
 }
 
 /* TGSI_OPCODE_LOG (CPU Only) */
@@ -1736,8 +1754,9 @@ pow_emit_cpu(
    struct lp_build_tgsi_context * bld_base,
    struct lp_build_emit_data * emit_data)
 {
-   emit_data->output[emit_data->chan] = lp_build_pow(&bld_base->base,
-                                   emit_data->args[0], emit_data->args[1]);
+   emit_data->output[emit_data->chan] = lp_build_pow_prec(&bld_base->base,
+                                   emit_data->args[0], emit_data->args[1],
+                                   emit_precision(bld_base, emit_data));
 }
 
 
@@ -1866,8 +1885,9 @@ sin_emit_cpu(
    struct lp_build_tgsi_context * bld_base,
    struct lp_build_emit_data * emit_data)
 {
-   emit_data->output[emit_data->chan] = lp_build_sin(&bld_base->base,
-                                                       emit_data->args[0]);
+   emit_data->output[emit_data->chan] = lp_build_sin_prec(&bld_base->base,
+                                                         emit_data->args[0],
+                                                         emit_precision(bld_base, emit_data));
 }
 
 /* TGSI_OPCODE_SLE (CPU Only) */
@@ -367,6 +367,8 @@ static void lp_exec_bgnloop(struct lp_exec_mask *mask)
    ctx->loop_block = lp_build_insert_new_block(mask->bld->gallivm, "bgnloop");
 
    LLVMBuildBr(builder, ctx->loop_block);
+   lp_build_hoist_begin(&ctx->loop_stack[ctx->loop_stack_size - 1].hoist,
+                        mask->bld->gallivm);
    LLVMPositionBuilderAtEnd(builder, ctx->loop_block);
 
    mask->break_mask = LLVMBuildLoad(builder, ctx->break_var, "");
@@ -506,6 +508,8 @@ static void lp_exec_endloop(struct gallivm_state *gallivm,
    LLVMBuildCondBr(builder,
                    icond, ctx->loop_block, endloop);
 
+   lp_build_hoist_end(&ctx->loop_stack[ctx->loop_stack_size - 1].hoist);
+
    LLVMPositionBuilderAtEnd(builder, endloop);
 
    assert(ctx->loop_stack_size);
@@ -1291,8 +1295,8 @@ emit_fetch_constant(
          scalar2_ptr = LLVMBuildGEP(builder, consts_ptr,
                                     &index, 1, "");
 
-         scalar = LLVMBuildLoad(builder, scalar_ptr, "");
-         scalar2 = LLVMBuildLoad(builder, scalar2_ptr, "");
+         scalar = lp_build_invariant_load(gallivm, scalar_ptr, "");
+         scalar2 = lp_build_invariant_load(gallivm, scalar2_ptr, "");
          shuffles[0] = lp_build_const_int32(gallivm, 0);
          shuffles[1] = lp_build_const_int32(gallivm, 1);
 
@@ -1313,7 +1317,7 @@ emit_fetch_constant(
            scalar_ptr = LLVMBuildBitCast(builder, scalar_ptr, i64ptr_type, "");
            bld_broad = &bld_base->int64_bld;
         }
-        scalar = LLVMBuildLoad(builder, scalar_ptr, "");
+        scalar = lp_build_invariant_load(gallivm, scalar_ptr, "");
         res = lp_build_broadcast_scalar(bld_broad, scalar);
       }
 
@@ -4461,6 +4465,8 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
 
 
    bld.bld_base.soa = TRUE;
+   bld.bld_base.precision = (gallivm_perf & GALLIVM_PERF_MEDIUMP) ?
+                            GALLIVM_PRECISION_MEDIUM : GALLIVM_PRECISION_FULL;
    bld.bld_base.emit_debug = emit_debug;
    bld.bld_base.emit_fetch_funcs[TGSI_FILE_CONSTANT] = emit_fetch_constant;
    bld.bld_base.emit_fetch_funcs[TGSI_FILE_IMMEDIATE] = emit_fetch_immediate;
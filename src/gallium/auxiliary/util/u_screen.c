@@ -271,6 +271,9 @@ u_pipe_screen_get_param_defaults(struct pipe_screen *pscreen,
    case PIPE_CAP_GLSL_OPTIMIZE_CONSERVATIVELY:
       return 1;
 
+   case PIPE_CAP_GLSL_MINIMAL_IR_OPTIMIZATION:
+      return 0;
+
    case PIPE_CAP_GLSL_TESS_LEVELS_AS_INPUTS:
       return 0;
 
@@ -457,6 +457,17 @@ lp_build_occlusion_count(struct gallivm_state *gallivm,
                                        LLVMInt32TypeInContext(context), bits);
       count = LLVMBuildZExt(builder, count, LLVMIntTypeInContext(context, 64), "");
    }
+   else if(util_cpu_caps.has_avx512f && type.length == 16) {
+      const char *popcntintr = "llvm.ctpop.i16";
+      LLVMTypeRef i16t = LLVMInt16TypeInContext(context);
+      LLVMValueRef bits = LLVMBuildBitCast(builder, maskvalue,
+                                           lp_build_int_vec_type(gallivm, type), "");
+      bits = LLVMBuildICmp(builder, LLVMIntNE, bits,
+                           LLVMConstNull(LLVMTypeOf(bits)), "");
+      bits = LLVMBuildBitCast(builder, bits, i16t, "");
+      count = lp_build_intrinsic_unary(builder, popcntintr, i16t, bits);
+      count = LLVMBuildZExt(builder, count, LLVMIntTypeInContext(context, 64), "");
+   }
    else {
       unsigned i;
       LLVMValueRef countv = LLVMBuildAnd(builder, maskvalue, countmask, "countv");
@@ -511,6 +522,33 @@ lp_build_occlusion_count(struct gallivm_state *gallivm,
 }
 
 
+/**
+ * Index into a row-major 4x4 stamp of element i of a 16-wide vector in
+ * quad order, i.e. with bits 1 and 2 swapped.
+ */
+static inline unsigned
+lp_build_depth_quad_index(unsigned i)
+{
+   return (i & 9) | ((i & 2) << 1) | ((i & 4) >> 1);
+}
+
+
+/**
+ * Shuffle between a row-major 4x4 stamp and quad order (both ways).
+ */
+static LLVMValueRef
+lp_build_depth_quad_shuffle(struct gallivm_state *gallivm)
+{
+   LLVMValueRef shuffles[16];
+   unsigned i;
+
+   for (i = 0; i < 16; i++) {
+      shuffles[i] = lp_build_const_int32(gallivm, lp_build_depth_quad_index(i));
+   }
+   return LLVMConstVector(shuffles, 16);
+}
+
+
 /**
  * Load depth/stencil values.
  * The stored values are linear, swizzle them.
@@ -545,7 +583,7 @@ lp_build_depth_stencil_load_swizzled(struct gallivm_state *gallivm,
    struct lp_type zs_type = lp_depth_type(format_desc, z_src_type.length);
    struct lp_type zs_load_type = zs_type;
 
-   zs_load_type.length = zs_load_type.length / 2;
+   zs_load_type.length = zs_load_type.length / (z_src_type.length == 16 ? 4 : 2);
    load_ptr_type = LLVMPointerType(lp_build_vec_type(gallivm, zs_load_type), 0);
 
    if (z_src_type.length == 4) {
@@ -565,6 +603,12 @@ lp_build_depth_stencil_load_swizzled(struct gallivm_state *gallivm,
          shuffles[i] = lp_build_const_int32(gallivm, i);
       }
    }
+   else if (z_src_type.length == 16) {
+      LLVMValueRef loopx4 = LLVMBuildShl(builder, loop_counter,
+                                         lp_build_const_int32(gallivm, 2), "");
+      assert(!is_1d);
+      depth_offset1 = LLVMBuildMul(builder, loopx4, depth_stride, "");
+   }
    else {
       unsigned i;
       LLVMValueRef loopx2 = LLVMBuildShl(builder, loop_counter,
@@ -580,23 +624,42 @@ lp_build_depth_stencil_load_swizzled(struct gallivm_state *gallivm,
       }
    }
 
-   depth_offset2 = LLVMBuildAdd(builder, depth_offset1, depth_stride, "");
+   if (z_src_type.length == 16) {
+      /*
+       * The whole 4x4 stamp, one row per load, reordered into quads.
+       */
+      LLVMValueRef rows[4];
+      unsigned i;
 
-   /* Load current z/stencil values from z/stencil buffer */
-   zs_dst_ptr = LLVMBuildGEP(builder, depth_ptr, &depth_offset1, 1, "");
-   zs_dst_ptr = LLVMBuildBitCast(builder, zs_dst_ptr, load_ptr_type, "");
-   zs_dst1 = LLVMBuildLoad(builder, zs_dst_ptr, "");
-   if (is_1d) {
-      zs_dst2 = lp_build_undef(gallivm, zs_load_type);
+      for (i = 0; i < 4; i++) {
+         zs_dst_ptr = LLVMBuildGEP(builder, depth_ptr, &depth_offset1, 1, "");
+         zs_dst_ptr = LLVMBuildBitCast(builder, zs_dst_ptr, load_ptr_type, "");
+         rows[i] = LLVMBuildLoad(builder, zs_dst_ptr, "");
+         depth_offset1 = LLVMBuildAdd(builder, depth_offset1, depth_stride, "");
+      }
+      zs_dst1 = lp_build_concat(gallivm, rows, zs_load_type, 4);
+      *z_fb = LLVMBuildShuffleVector(builder, zs_dst1, zs_dst1,
+                                     lp_build_depth_quad_shuffle(gallivm), "");
    }
    else {
-      zs_dst_ptr = LLVMBuildGEP(builder, depth_ptr, &depth_offset2, 1, "");
+      depth_offset2 = LLVMBuildAdd(builder, depth_offset1, depth_stride, "");
+
+      /* Load current z/stencil values from z/stencil buffer */
+      zs_dst_ptr = LLVMBuildGEP(builder, depth_ptr, &depth_offset1, 1, "");
       zs_dst_ptr = LLVMBuildBitCast(builder, zs_dst_ptr, load_ptr_type, "");
-      zs_dst2 = LLVMBuildLoad(builder, zs_dst_ptr, "");
-   }
+      zs_dst1 = LLVMBuildLoad(builder, zs_dst_ptr, "");
+      if (is_1d) {
+         zs_dst2 = lp_build_undef(gallivm, zs_load_type);
+      }
+      else {
+         zs_dst_ptr = LLVMBuildGEP(builder, depth_ptr, &depth_offset2, 1, "");
+         zs_dst_ptr = LLVMBuildBitCast(builder, zs_dst_ptr, load_ptr_type, "");
+         zs_dst2 = LLVMBuildLoad(builder, zs_dst_ptr, "");
+      }
 
-   *z_fb = LLVMBuildShuffleVector(builder, zs_dst1, zs_dst2,
-                                  LLVMConstVector(shuffles, zs_type.length), "");
+      *z_fb = LLVMBuildShuffleVector(builder, zs_dst1, zs_dst2,
+                                     LLVMConstVector(shuffles, zs_type.length), "");
+   }
    *s_fb = *z_fb;
 
    if (format_desc->block.bits < z_src_type.width) {
@@ -684,7 +747,7 @@ lp_build_depth_stencil_write_swizzled(struct gallivm_state *gallivm,
    struct lp_type z_type = zs_type;
    struct lp_type zs_load_type = zs_type;
 
-   zs_load_type.length = zs_load_type.length / 2;
+   zs_load_type.length = zs_load_type.length / (z_src_type.length == 16 ? 4 : 2);
    load_ptr_type = LLVMPointerType(lp_build_vec_type(gallivm, zs_load_type), 0);
 
    z_type.width = z_src_type.width;
@@ -706,6 +769,12 @@ lp_build_depth_stencil_write_swizzled(struct gallivm_state *gallivm,
                                    lp_build_const_int32(gallivm, depth_bytes * 2), "");
       depth_offset1 = LLVMBuildAdd(builder, depth_offset1, offset2, "");
    }
+   else if (z_src_type.length == 16) {
+      LLVMValueRef loopx4 = LLVMBuildShl(builder, loop_counter,
+                                         lp_build_const_int32(gallivm, 2), "");
+      assert(!is_1d);
+      depth_offset1 = LLVMBuildMul(builder, loopx4, depth_stride, "");
+   }
    else {
       unsigned i;
       LLVMValueRef loopx2 = LLVMBuildShl(builder, loop_counter,
@@ -747,6 +816,41 @@ lp_build_depth_stencil_write_swizzled(struct gallivm_state *gallivm,
                                lp_build_int_vec_type(gallivm, zs_type), "");
    }
 
+   if (z_src_type.length == 16) {
+      /*
+       * Back from quad order to rows (the shuffle is its own inverse),
+       * interleaving stencil for the 64bit formats, and one store per row.
+       */
+      LLVMValueRef zs_rows;
+      unsigned i;
+
+      if (format_desc->block.bits <= 32) {
+         zs_rows = LLVMBuildShuffleVector(builder, z_value, z_value,
+                                          lp_build_depth_quad_shuffle(gallivm), "");
+      }
+      else {
+         LLVMValueRef shuffles2[32];
+         for (i = 0; i < 16; i++) {
+            unsigned j = lp_build_depth_quad_index(i);
+            shuffles2[i*2] = lp_build_const_int32(gallivm, j);
+            shuffles2[i*2+1] = lp_build_const_int32(gallivm, j + 16);
+         }
+         zs_rows = LLVMBuildShuffleVector(builder, z_value, s_value,
+                                          LLVMConstVector(shuffles2, 32), "");
+         zs_rows = LLVMBuildBitCast(builder, zs_rows,
+                                    lp_build_vec_type(gallivm, zs_type), "");
+      }
+
+      for (i = 0; i < 4; i++) {
+         zs_dst1 = lp_build_extract_range(gallivm, zs_rows, i * 4, 4);
+         zs_dst_ptr1 = LLVMBuildGEP(builder, depth_ptr, &depth_offset1, 1, "");
+         zs_dst_ptr1 = LLVMBuildBitCast(builder, zs_dst_ptr1, load_ptr_type, "");
+         LLVMBuildStore(builder, zs_dst1, zs_dst_ptr1);
+         depth_offset1 = LLVMBuildAdd(builder, depth_offset1, depth_stride, "");
+      }
+      return;
+   }
+
    if (format_desc->block.bits <= 32) {
       if (z_src_type.length == 4) {
          zs_dst1 = lp_build_extract_range(gallivm, z_value, 0, 2);
@@ -1034,6 +1138,19 @@ lp_build_depth_stencil_test(struct gallivm_state *gallivm,
           */
 
          if (!z_type.floating) {
+            struct lp_type f32_type = z_src_type;
+            struct lp_build_context f32_bld;
+
+            /*
+             * Interpolation can take z slightly outside [0, 1] near the
+             * clip planes, and the conversion would wrap it around. Clamp
+             * with a signed type, as the unsigned norm one above would
+             * make the clamp a no-op.
+             */
+            f32_type.sign = TRUE;
+            f32_type.norm = FALSE;
+            lp_build_context_init(&f32_bld, gallivm, f32_type);
+            z_src = lp_build_clamp_zero_one_nanzero(&f32_bld, z_src);
             z_src = lp_build_clamped_float_to_unsigned_norm(gallivm,
                                                             z_src_type,
                                                             z_width,
@@ -148,6 +148,8 @@ struct llvmpipe_context {
    struct lp_fs_variant_list_item fs_variants_list;
    unsigned nr_fs_variants;
    unsigned nr_fs_instrs;
+   /** The fragment shader variant bound to setup */
+   struct lp_fragment_shader_variant *fs_variant;
 
    struct lp_setup_variant_list_item setup_variants_list;
    unsigned nr_setup_variants;
@@ -28,10 +28,60 @@
  * based on threadpool.c but modified heavily to be compute shader tuned.
  */
 
+#include "util/u_atomic.h"
+#include "util/u_math.h"
 #include "util/u_thread.h"
 #include "util/u_memory.h"
 #include "lp_cs_tpool.h"
 
+/* Aim for this many chunks per thread, to balance uneven work groups. */
+#define LP_CS_TPOOL_CHUNKS_PER_THREAD 4
+
+/*
+ * Run chunks of the task until all iterations have been handed out.
+ * Returns the number of iterations run by this thread.
+ */
+static unsigned
+lp_cs_tpool_run_chunks(struct lp_cs_tpool_task *task,
+                       struct lp_cs_local_mem *lmem)
+{
+   unsigned done = 0;
+
+   while (1) {
+      unsigned start, end, old;
+
+      /* claim the next chunk */
+      start = p_atomic_read(&task->iter_start);
+      do {
+         if (start >= task->iter_total)
+            return done;
+         old = start;
+         end = MIN2(start + task->iter_per_chunk, task->iter_total);
+         start = p_atomic_cmpxchg(&task->iter_start, old, end);
+      } while (start != old);
+
+      for (unsigned i = start; i < end; i++)
+         task->work(task->data, i, lmem);
+      done += end - start;
+   }
+}
+
+/*
+ * Account for the iterations a thread ran, called with the pool mutex held.
+ */
+static void
+lp_cs_tpool_task_drop(struct lp_cs_tpool_task *task, unsigned done)
+{
+   /* Everything has been handed out, don't let anybody else pick it up. */
+   if (!list_is_empty(&task->list))
+      list_delinit(&task->list);
+
+   task->iter_finished += done;
+   task->users--;
+   if (task->iter_finished == task->iter_total && task->users == 0)
+      cnd_broadcast(&task->finish);
+}
+
 static int
 lp_cs_tpool_worker(void *data)
 {
@@ -43,6 +93,7 @@ lp_cs_tpool_worker(void *data)
 
    while (!pool->shutdown) {
       struct lp_cs_tpool_task *task;
+      unsigned done;
 
       while (list_is_empty(&pool->workqueue) && !pool->shutdown)
          cnd_wait(&pool->new_work, &pool->m);
@@ -52,17 +103,12 @@ lp_cs_tpool_worker(void *data)
 
       task = list_first_entry(&pool->workqueue, struct lp_cs_tpool_task,
                               list);
-      unsigned this_iter = task->iter_start++;
-
-      if (task->iter_start == task->iter_total)
-         list_del(&task->list);
+      task->users++;
 
       mtx_unlock(&pool->m);
-      task->work(task->data, this_iter, &lmem);
+      done = lp_cs_tpool_run_chunks(task, &lmem);
       mtx_lock(&pool->m);
-      task->iter_finished++;
-      if (task->iter_finished == task->iter_total)
-         cnd_broadcast(&task->finish);
+      lp_cs_tpool_task_drop(task, done);
    }
    mtx_unlock(&pool->m);
    FREE(lmem.local_mem_ptr);
@@ -121,6 +167,7 @@ lp_cs_tpool_queue_task(struct lp_cs_tpool *pool,
       for (unsigned t = 0; t < num_iters; t++) {
          work(data, t, &lmem);
       }
+      FREE(lmem.local_mem_ptr);
       return NULL;
    }
    task = CALLOC_STRUCT(lp_cs_tpool_task);
@@ -131,13 +178,16 @@ lp_cs_tpool_queue_task(struct lp_cs_tpool *pool,
    task->work = work;
    task->data = data;
    task->iter_total = num_iters;
+   /* the waiting thread runs chunks too */
+   task->iter_per_chunk = MAX2(num_iters / ((pool->num_threads + 1) *
+                                            LP_CS_TPOOL_CHUNKS_PER_THREAD), 1);
    cnd_init(&task->finish);
 
    mtx_lock(&pool->m);
 
    list_addtail(&task->list, &pool->workqueue);
 
-   cnd_signal(&pool->new_work);
+   cnd_broadcast(&pool->new_work);
    mtx_unlock(&pool->m);
    return task;
 }
@@ -147,15 +197,28 @@ lp_cs_tpool_wait_for_task(struct lp_cs_tpool *pool,
                           struct lp_cs_tpool_task **task_handle)
 {
    struct lp_cs_tpool_task *task = *task_handle;
+   struct lp_cs_local_mem lmem;
+   unsigned done;
 
    if (!pool || !task)
       return;
 
+   memset(&lmem, 0, sizeof(lmem));
+
+   mtx_lock(&pool->m);
+   task->users++;
+   mtx_unlock(&pool->m);
+
+   done = lp_cs_tpool_run_chunks(task, &lmem);
+
    mtx_lock(&pool->m);
-   while (task->iter_finished < task->iter_total)
+   lp_cs_tpool_task_drop(task, done);
+   while (task->iter_finished < task->iter_total || task->users > 0)
       cnd_wait(&task->finish, &pool->m);
    mtx_unlock(&pool->m);
 
+   FREE(lmem.local_mem_ptr);
+
    cnd_destroy(&task->finish);
    FREE(task);
    *task_handle = NULL;
@@ -28,6 +28,9 @@
  * The item is added to the work queue once, but it must execute
  * number of iterations times. This saves storing a bunch of queue
  * structs with just unique indexes in them.
+ * Iterations are handed out in chunks through an atomic counter, so
+ * the pool mutex is only taken when a thread picks up or drops a task,
+ * and the thread waiting for the task runs chunks as well.
  * It also supports a local memory support struct to be passed from
  * outside the thread exec function.
  */
@@ -64,8 +67,10 @@ struct lp_cs_tpool_task {
    struct list_head list;
    cnd_t finish;
    unsigned iter_total;
-   unsigned iter_start;
-   unsigned iter_finished;
+   unsigned iter_per_chunk;
+   unsigned iter_start;     /* next iteration to hand out, atomic */
+   unsigned iter_finished;  /* protected by the pool mutex */
+   unsigned users;          /* threads running chunks, pool mutex */
 };
 
 struct lp_cs_tpool *lp_cs_tpool_create(unsigned num_threads);
@@ -60,6 +60,9 @@ st_print_current(void);
 #define PERF_NO_BLEND       0x20  	/* disable blending */
 #define PERF_NO_DEPTH       0x40  	/* disable depth buffering entirely */
 #define PERF_NO_ALPHATEST   0x80  	/* disable alpha testing */
+#define PERF_NO_TIER_UP     0x100 	/* compile shaders optimized right away */
+#define PERF_TEX_CACHE      0x200 	/* decode compressed blocks through a cache */
+#define PERF_NO_HIZ         0x400 	/* no coarse depth test in the rasterizer */
 
 
 extern int LP_PERF;
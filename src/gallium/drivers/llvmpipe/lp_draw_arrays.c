@@ -69,6 +69,8 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
    if (lp->dirty)
       llvmpipe_update_derived( lp );
 
+   llvmpipe_tier_up_fs(lp);
+
    /*
     * Map vertex buffers
     */
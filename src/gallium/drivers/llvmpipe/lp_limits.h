@@ -85,6 +85,12 @@
  */
 #define LP_MAX_SHADER_INSTRUCTIONS (2048 * LP_MAX_SHADER_VARIANTS)
 
+/**
+ * Number of draws with a quickly compiled fragment shader variant after
+ * which it gets recompiled with all optimizations.
+ */
+#define LP_FS_TIER_UP_DRAWS 16
+
 /**
  * Max number of setup variants that will be kept around.
  *
@@ -49,9 +49,11 @@ struct lp_counters
    unsigned nr_pure_shade_64;
    unsigned nr_shade_64;
    unsigned nr_shade_opaque_64;
+   unsigned nr_hiz_culled_64;
    unsigned nr_empty_16;
    unsigned nr_fully_covered_16;
    unsigned nr_partially_covered_16;
+   unsigned nr_hiz_culled_16;
    unsigned nr_empty_4;
    unsigned nr_fully_covered_4;
    unsigned nr_partially_covered_4;
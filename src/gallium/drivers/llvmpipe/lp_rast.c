@@ -109,6 +109,9 @@ lp_rast_tile_begin(struct lp_rasterizer_task *task,
    task->thread_data.vis_counter = 0;
    task->thread_data.ps_invocations = 0;
 
+   /* nothing is known about the depth buffer contents until it's cleared */
+   task->hiz.valid = FALSE;
+
    for (i = 0; i < task->scene->fb.nr_cbufs; i++) {
       if (task->scene->fb.cbufs[i]) {
          task->color_tiles[i] = scene->cbufs[i].map +
@@ -170,6 +173,55 @@ lp_rast_clear_color(struct lp_rasterizer_task *task,
 }
 
 
+/**
+ * Reset the coarse depth ranges of the tile after a z/stencil clear.
+ * Only done for single layer framebuffers, as the ranges are not per
+ * layer.
+ */
+static void
+lp_rast_hiz_clear(struct lp_rasterizer_task *task,
+                  uint64_t clear_value64,
+                  uint64_t clear_mask64)
+{
+   const struct lp_scene *scene = task->scene;
+   enum pipe_format format = scene->fb.zsbuf->format;
+   const struct util_format_description *desc = util_format_description(format);
+   const uint64_t zmask64 = util_pack64_mask_z(format, ~0);
+   const struct util_format_channel_description *chan;
+   struct lp_rast_hiz *hiz = &task->hiz;
+   float z;
+   unsigned i;
+
+   if (!util_format_has_depth(desc)) {
+      return;
+   }
+
+   if ((clear_mask64 & zmask64) != zmask64) {
+      /* stencil only clear, depth values unchanged */
+      return;
+   }
+
+   if (scene->fb_max_layer > 0 || (LP_PERF & PERF_NO_HIZ)) {
+      hiz->valid = FALSE;
+      return;
+   }
+
+   desc->unpack_z_float(&z, 0, (const uint8_t *)&clear_value64, 0, 1, 1);
+
+   chan = &desc->channel[desc->swizzle[0]];
+   if (chan->type == UTIL_FORMAT_TYPE_FLOAT)
+      hiz->step = 0.0f;
+   else
+      hiz->step = (float)(1.0 / (double)((1ULL << chan->size) - 1));
+
+   for (i = 0; i < ARRAY_SIZE(hiz->zmin); i++) {
+      hiz->zmin[i] = z;
+      hiz->zmax[i] = z;
+   }
+   hiz->valid = TRUE;
+}
+
+
 /**
  * Clear the rasterizer's current z/stencil tile.
  * This is a bin command called during bin processing.
@@ -281,6 +333,8 @@ lp_rast_clear_zstencil(struct lp_rasterizer_task *task,
          }
          dst_layer += scene->zsbuf.layer_stride;
       }
+
+      lp_rast_hiz_clear(task, clear_value64, clear_mask64);
    }
 }
 
@@ -300,7 +354,7 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
    const struct lp_rast_state *state;
    struct lp_fragment_shader_variant *variant;
    const unsigned tile_x = task->x, tile_y = task->y;
-   unsigned x, y;
+   unsigned bx, by, x, y;
 
    if (inputs->disable) {
       /* This command was partially binned and has been disabled */
@@ -316,53 +370,67 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
    }
    variant = state->variant;
 
-   /* render the whole 64x64 tile in 4x4 chunks */
-   for (y = 0; y < task->height; y += 4){
-      for (x = 0; x < task->width; x += 4) {
-         uint8_t *color[PIPE_MAX_COLOR_BUFS];
-         unsigned stride[PIPE_MAX_COLOR_BUFS];
-         uint8_t *depth = NULL;
-         unsigned depth_stride = 0;
-         unsigned i;
-
-         /* color buffer */
-         for (i = 0; i < scene->fb.nr_cbufs; i++){
-            if (scene->fb.cbufs[i]) {
-               stride[i] = scene->cbufs[i].stride;
-               color[i] = lp_rast_get_color_block_pointer(task, i, tile_x + x,
-                                                          tile_y + y, inputs->layer);
-            }
-            else {
-               stride[i] = 0;
-               color[i] = NULL;
-            }
-         }
-
-         /* depth buffer */
-         if (scene->zsbuf.map) {
-            depth = lp_rast_get_depth_block_pointer(task, tile_x + x,
-                                                    tile_y + y, inputs->layer);
-            depth_stride = scene->zsbuf.stride;
+   /* render the whole 64x64 tile in 4x4 chunks, skipping the 16x16 blocks
+    * where the depth test fails everywhere
+    */
+   for (by = 0; by < task->height; by += 16) {
+      for (bx = 0; bx < task->width; bx += 16) {
+         const unsigned bw = MIN2(task->width - bx, 16);
+         const unsigned bh = MIN2(task->height - by, 16);
+
+         if (!lp_rast_depth_visible(task, inputs, tile_x + bx, tile_y + by,
+                                    bw, bh, TRUE)) {
+            LP_COUNT(nr_hiz_culled_16);
+            continue;
          }
+         for (y = by; y < by + bh; y += 4) {
+            for (x = bx; x < bx + bw; x += 4) {
+               uint8_t *color[PIPE_MAX_COLOR_BUFS];
+               unsigned stride[PIPE_MAX_COLOR_BUFS];
+               uint8_t *depth = NULL;
+               unsigned depth_stride = 0;
+               unsigned i;
+
+               /* color buffer */
+               for (i = 0; i < scene->fb.nr_cbufs; i++){
+                  if (scene->fb.cbufs[i]) {
+                     stride[i] = scene->cbufs[i].stride;
+                     color[i] = lp_rast_get_color_block_pointer(task, i, tile_x + x,
+                                                                tile_y + y, inputs->layer);
+                  }
+                  else {
+                     stride[i] = 0;
+                     color[i] = NULL;
+                  }
+               }
 
-         /* Propagate non-interpolated raster state. */
-         task->thread_data.raster_state.viewport_index = inputs->viewport_index;
+               /* depth buffer */
+               if (scene->zsbuf.map) {
+                  depth = lp_rast_get_depth_block_pointer(task, tile_x + x,
+                                                          tile_y + y, inputs->layer);
+                  depth_stride = scene->zsbuf.stride;
+               }
 
-         /* run shader on 4x4 block */
-         BEGIN_JIT_CALL(state, task);
-         variant->jit_function[RAST_WHOLE]( &state->jit_context,
-                                            tile_x + x, tile_y + y,
-                                            inputs->frontfacing,
-                                            GET_A0(inputs),
-                                            GET_DADX(inputs),
-                                            GET_DADY(inputs),
-                                            color,
-                                            depth,
-                                            0xffff,
-                                            &task->thread_data,
-                                            stride,
-                                            depth_stride);
-         END_JIT_CALL();
+               /* Propagate non-interpolated raster state. */
+               task->thread_data.raster_state.viewport_index = inputs->viewport_index;
+
+               /* run shader on 4x4 block */
+               BEGIN_JIT_CALL(state, task);
+               variant->jit_function[RAST_WHOLE]( &state->jit_context,
+                                                  tile_x + x, tile_y + y,
+                                                  inputs->frontfacing,
+                                                  GET_A0(inputs),
+                                                  GET_DADX(inputs),
+                                                  GET_DADY(inputs),
+                                                  color,
+                                                  depth,
+                                                  0xffff,
+                                                  &task->thread_data,
+                                                  stride,
+                                                  depth_stride);
+               END_JIT_CALL();
+            }
+         }
       }
    }
 }
@@ -667,14 +735,14 @@ rasterize_scene(struct lp_rasterizer_task *task,
 
    /* Clear the cache tags. This should not always be necessary but
       simpler for now. */
-#if LP_USE_TEXTURE_CACHE
-   memset(task->thread_data.cache->cache_tags, 0,
-          sizeof(task->thread_data.cache->cache_tags));
-#if LP_BUILD_FORMAT_CACHE_DEBUG
-   task->thread_data.cache->cache_access_total = 0;
-   task->thread_data.cache->cache_access_miss = 0;
-#endif
-#endif
+   if (LP_PERF & PERF_TEX_CACHE) {
+      memset(task->thread_data.cache->cache_tags, 0,
+             sizeof(task->thread_data.cache->cache_tags));
+      memset(task->thread_data.cache->cache_victim, 0,
+             sizeof(task->thread_data.cache->cache_victim));
+      task->thread_data.cache->cache_access_total = 0;
+      task->thread_data.cache->cache_access_miss = 0;
+   }
 
    if (!task->rast->no_rast) {
       /* loop over scene bins, rasterize each */
@@ -691,8 +759,7 @@ rasterize_scene(struct lp_rasterizer_task *task,
    }
 
 
-#if LP_BUILD_FORMAT_CACHE_DEBUG
-   {
+   if (gallivm_debug & GALLIVM_DEBUG_CACHE) {
       uint64_t total, miss;
       total = task->thread_data.cache->cache_access_total;
       miss = task->thread_data.cache->cache_access_miss;
@@ -703,7 +770,6 @@ rasterize_scene(struct lp_rasterizer_task *task,
                  (float)(total - miss)/(float)total);
       }
    }
-#endif
 
    if (scene->fence) {
       lp_fence_signal(scene->fence);
@@ -76,6 +76,22 @@ extern const struct lp_rasterizer_task *jit_task;
 struct lp_rasterizer;
 struct cmd_bin;
 
+/**
+ * Coarse depth information for the tile being rasterized, as a depth
+ * range per 16x16 block.  The ranges only become known when the tile's
+ * depth buffer is cleared, and are then widened whenever a triangle may
+ * write depth, so that every depth value stored in a block lies within
+ * its range.  That lets the rasterizer drop blocks where the depth test
+ * would fail for all pixels before running the shader.
+ */
+struct lp_rast_hiz
+{
+   boolean valid;
+   float step;   /**< depth buffer resolution, 0 for float formats */
+   float zmin[16];
+   float zmax[16];
+};
+
 /**
  * Per-thread rasterization state
  */
@@ -91,6 +107,8 @@ struct lp_rasterizer_task
    uint8_t *color_tiles[PIPE_MAX_COLOR_BUFS];
    uint8_t *depth_tile;
 
+   struct lp_rast_hiz hiz;
+
    /** "back" pointer */
    struct lp_rasterizer *rast;
 
@@ -214,6 +232,145 @@ lp_rast_get_depth_block_pointer(struct lp_rasterizer_task *task,
 }
 
 
+/**
+ * Range of a triangle's interpolated depth over the pixels
+ * [x, x + w) x [y, y + h), in window coords.  The range is slightly
+ * widened to cover the rounding differences with the shader's own
+ * interpolation.
+ */
+static inline void
+lp_rast_tri_depth_range(const struct lp_rast_state *state,
+                        const struct lp_rast_shader_inputs *inputs,
+                        int x, int y, int w, int h,
+                        float *zmin, float *zmax)
+{
+   const float a0 = GET_A0(inputs)[0][2];
+   const float dzdx = GET_DADX(inputs)[0][2];
+   const float dzdy = GET_DADY(inputs)[0][2];
+   const float zx0 = dzdx * x, zx1 = dzdx * (x + w - 1);
+   const float zy0 = dzdy * y, zy1 = dzdy * (y + h - 1);
+   const float eps = (fabsf(a0) +
+                      MAX2(fabsf(zx0), fabsf(zx1)) +
+                      MAX2(fabsf(zy0), fabsf(zy1))) * (1.0f / (1 << 20));
+
+   *zmin = a0 + MIN2(zx0, zx1) + MIN2(zy0, zy1) - eps;
+   *zmax = a0 + MAX2(zx0, zx1) + MAX2(zy0, zy1) + eps;
+
+   if (state->variant->key.depth_clamp) {
+      const struct lp_jit_viewport *vp =
+         &state->jit_context.viewports[inputs->viewport_index];
+      *zmin = CLAMP(*zmin, vp->min_depth, vp->max_depth);
+      *zmax = CLAMP(*zmax, vp->min_depth, vp->max_depth);
+   }
+}
+
+
+/**
+ * Whether the depth test fails for all depth values in [tri_zmin, tri_zmax]
+ * against all stored values in [zmin, zmax].  Non-strict comparisons need
+ * the ranges a full depth buffer step apart, so that they still hold after
+ * the values are converted to the depth format.
+ */
+static inline boolean
+lp_rast_depth_range_fails(unsigned func, float step,
+                          float tri_zmin, float tri_zmax,
+                          float zmin, float zmax)
+{
+   switch (func) {
+   case PIPE_FUNC_NEVER:
+      return TRUE;
+   case PIPE_FUNC_LESS:
+      return tri_zmin >= zmax;
+   case PIPE_FUNC_LEQUAL:
+      return tri_zmin > zmax + step;
+   case PIPE_FUNC_GREATER:
+      return tri_zmax <= zmin;
+   case PIPE_FUNC_GEQUAL:
+      return tri_zmax < zmin - step;
+   case PIPE_FUNC_EQUAL:
+      return tri_zmin > zmax + step || tri_zmax < zmin - step;
+   default:
+      return FALSE;
+   }
+}
+
+
+/**
+ * Coarse depth test of a triangle against the tile's 16x16 blocks which
+ * overlap [x, x + w) x [y, y + h), in window coords.
+ *
+ * Returns FALSE if the depth test fails for all of the triangle's pixels
+ * there, so the shader doesn't need to run.  Otherwise, if update is set,
+ * widens the depth ranges of the blocks the triangle may write depth to.
+ */
+static inline boolean
+lp_rast_depth_visible(struct lp_rasterizer_task *task,
+                      const struct lp_rast_shader_inputs *inputs,
+                      int x, int y, int w, int h,
+                      boolean update)
+{
+   const struct lp_rast_state *state = task->state;
+   const struct lp_fragment_shader_variant *variant = state->variant;
+   struct lp_rast_hiz *hiz = &task->hiz;
+   const int x0 = MAX2(x, (int)task->x) - task->x;
+   const int y0 = MAX2(y, (int)task->y) - task->y;
+   const int x1 = MIN2(x + w, (int)(task->x + TILE_SIZE)) - task->x;
+   const int y1 = MIN2(y + h, (int)(task->y + TILE_SIZE)) - task->y;
+   boolean visible = FALSE;
+   int bx, by;
+
+   if (!hiz->valid)
+      return TRUE;
+
+   if (variant->hiz_write == LP_HIZ_WRITE_SHADER) {
+      /* there's no telling what the shader writes */
+      hiz->valid = FALSE;
+      return TRUE;
+   }
+
+   if (variant->hiz_func == PIPE_FUNC_ALWAYS &&
+       (variant->hiz_write == LP_HIZ_WRITE_NONE || !update))
+      return TRUE;
+
+   for (by = y0 & ~15; by < y1; by += 16) {
+      for (bx = x0 & ~15; bx < x1; bx += 16) {
+         const unsigned i = (by / 16) * 4 + bx / 16;
+         const int rx0 = MAX2(bx, x0), rx1 = MIN2(bx + 16, x1);
+         const int ry0 = MAX2(by, y0), ry1 = MIN2(by + 16, y1);
+         float tri_zmin, tri_zmax;
+
+         lp_rast_tri_depth_range(state, inputs,
+                                 task->x + rx0, task->y + ry0,
+                                 rx1 - rx0, ry1 - ry0,
+                                 &tri_zmin, &tri_zmax);
+
+         if (lp_rast_depth_range_fails(variant->hiz_func, hiz->step,
+                                       tri_zmin, tri_zmax,
+                                       hiz->zmin[i], hiz->zmax[i]))
+            continue;
+
+         visible = TRUE;
+
+         /*
+          * Depth is only written where the test passes, so e.g. with LESS
+          * the stored values can only decrease.
+          */
+         if (update && variant->hiz_write == LP_HIZ_WRITE_INTERP) {
+            const unsigned func = variant->key.depth.func;
+            if (func != PIPE_FUNC_GREATER && func != PIPE_FUNC_GEQUAL &&
+                func != PIPE_FUNC_EQUAL)
+               hiz->zmin[i] = MIN2(hiz->zmin[i], tri_zmin);
+            if (func != PIPE_FUNC_LESS && func != PIPE_FUNC_LEQUAL &&
+                func != PIPE_FUNC_EQUAL)
+               hiz->zmax[i] = MAX2(hiz->zmax[i], tri_zmax);
+         }
+      }
+   }
+
+   return visible;
+}
+
+
 
 /**
  * Shade all pixels in a 4x4 block.  The fragment code omits the
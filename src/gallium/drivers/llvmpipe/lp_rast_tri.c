@@ -265,6 +265,9 @@ lp_rast_triangle_32_3_16(struct lp_rasterizer_task *task,
    __m128i span_2;                /* 0,dcdx,2dcdx,3dcdx for plane 2 */
    __m128i unused;
 
+   if (!lp_rast_depth_visible(task, &tri->inputs, x, y, 16, 16, TRUE))
+      return;
+
    transpose4_epi32(&p0, &p1, &p2, &zero,
                     &c, &unused, &dcdx, &dcdy);
 
@@ -373,6 +376,9 @@ lp_rast_triangle_32_3_4(struct lp_rasterizer_task *task,
    __m128i span_2;                /* 0,dcdx,2dcdx,3dcdx for plane 2 */
    __m128i unused;
 
+   if (!lp_rast_depth_visible(task, &tri->inputs, x, y, 4, 4, TRUE))
+      return;
+
    transpose4_epi32(&p0, &p1, &p2, &zero,
                     &c, &unused, &dcdx, &dcdy);
 
@@ -566,6 +572,9 @@ lp_rast_triangle_32_3_16(struct lp_rasterizer_task *task,
    vshuf_mask2 = (__m128i) vec_splats((unsigned int) 0x04050607);
 #endif
 
+   if (!lp_rast_depth_visible(task, &tri->inputs, x, y, 16, 16, TRUE))
+      return;
+
    transpose4_epi32(&p0, &p1, &p2, &zero,
                     &c, &dcdx, &dcdy, &rej4);
 
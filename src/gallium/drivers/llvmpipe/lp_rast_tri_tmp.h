@@ -191,6 +191,12 @@ TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
       return;
    }
 
+   if (!lp_rast_depth_visible(task, &tri->inputs, x, y,
+                              TILE_SIZE, TILE_SIZE, FALSE)) {
+      LP_COUNT(nr_hiz_culled_64);
+      return;
+   }
+
    outmask = 0;                 /* outside one or more trivial reject planes */
    partmask = 0;                /* outside one or more trivial accept planes */
 
@@ -294,13 +300,18 @@ TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
       int py = y + iy;
       int64_t cx[NR_PLANES];
 
+      partial_mask &= ~(1 << i);
+
+      if (!lp_rast_depth_visible(task, &tri->inputs, px, py, 16, 16, TRUE)) {
+         LP_COUNT(nr_hiz_culled_16);
+         continue;
+      }
+
       for (j = 0; j < NR_PLANES; j++)
          cx[j] = (c[j]
                   - IMUL64(plane[j].dcdx, ix)
                   + IMUL64(plane[j].dcdy, iy));
 
-      partial_mask &= ~(1 << i);
-
       LP_COUNT(nr_partially_covered_16);
       TAG(do_block_16)(task, tri, plane, px, py, cx);
    }
@@ -316,6 +327,11 @@ TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
 
       inmask &= ~(1 << i);
 
+      if (!lp_rast_depth_visible(task, &tri->inputs, px, py, 16, 16, TRUE)) {
+         LP_COUNT(nr_hiz_culled_16);
+         continue;
+      }
+
       LP_COUNT(nr_fully_covered_16);
       block_full_16(task, tri, px, py);
    }
@@ -345,6 +361,9 @@ TRI_16(struct lp_rasterizer_task *task,
    x += task->x;
    y += task->y;
 
+   if (!lp_rast_depth_visible(task, &tri->inputs, x, y, 16, 16, TRUE))
+      return;
+
    for (j = 0; j < NR_PLANES; j++) {
       const int dcdx = -plane[j].dcdx * 4;
       const int dcdy = plane[j].dcdy * 4;
@@ -410,6 +429,9 @@ TRI_4(struct lp_rasterizer_task *task,
    const int y = task->y + (mask >> 8);
    unsigned j;
 
+   if (!lp_rast_depth_visible(task, &tri->inputs, x, y, 4, 4, TRUE))
+      return;
+
    /* Iterate over partials:
     */
    {
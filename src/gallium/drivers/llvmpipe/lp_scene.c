@@ -36,8 +36,19 @@
 #include "lp_debug.h"
 
 
+#if defined(PIPE_OS_LINUX)
+#include <sys/mman.h>
+#endif
+
+
 #define RESOURCE_REF_SZ 32
 
+/** Offset of the first data block in a slab, past the slab header */
+#define SLAB_HEADER_SIZE 64
+
+#define SLAB_BLOCKS \
+   ((LP_SCENE_SLAB_SIZE - SLAB_HEADER_SIZE) / sizeof(struct data_block))
+
 /** List of resource references */
 struct resource_ref {
    struct pipe_resource *resource[RESOURCE_REF_SZ];
@@ -46,6 +57,70 @@ struct resource_ref {
 };
 
 
+/**
+ * A slab of data blocks.  The blocks follow the header.
+ */
+struct data_slab {
+   struct data_slab *next;
+};
+
+
+/**
+ * Allocate another slab and put its blocks on the free list.
+ */
+static boolean
+new_data_slab(struct data_block_list *list)
+{
+   struct data_slab *slab;
+   unsigned i;
+
+   STATIC_ASSERT(sizeof(struct data_slab) <= SLAB_HEADER_SIZE);
+
+   slab = os_malloc_aligned(LP_SCENE_SLAB_SIZE, LP_SCENE_SLAB_SIZE);
+   if (!slab)
+      return FALSE;
+
+#if defined(PIPE_OS_LINUX) && defined(MADV_HUGEPAGE)
+   /* Scenes touch their data all over the place, ask for huge pages
+    * to keep the TLB misses down.  Failure is harmless.
+    */
+   madvise(slab, LP_SCENE_SLAB_SIZE, MADV_HUGEPAGE);
+#endif
+
+   slab->next = list->slabs;
+   list->slabs = slab;
+
+   for (i = 0; i < SLAB_BLOCKS; i++) {
+      struct data_block *block = (struct data_block *)
+         ((ubyte *)slab + SLAB_HEADER_SIZE + i * sizeof(struct data_block));
+      block->next = list->free_list;
+      list->free_list = block;
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Take a block from the free list, allocating a new slab if necessary.
+ */
+static struct data_block *
+get_free_data_block(struct data_block_list *list)
+{
+   struct data_block *block;
+
+   if (!list->free_list && !new_data_slab(list))
+      return NULL;
+
+   block = list->free_list;
+   list->free_list = block->next;
+
+   block->used = 0;
+   block->next = NULL;
+   return block;
+}
+
+
 /**
  * Create a new scene object.
  * \param queue  the queue to put newly rendered/emptied scenes into
@@ -59,8 +134,11 @@ lp_scene_create( struct pipe_context *pipe )
 
    scene->pipe = pipe;
 
-   scene->data.head =
-      CALLOC_STRUCT(data_block);
+   scene->data.head = get_free_data_block(&scene->data);
+   if (!scene->data.head) {
+      FREE(scene);
+      return NULL;
+   }
 
    (void) mtx_init(&scene->mutex, mtx_plain);
 
@@ -89,10 +167,16 @@ lp_scene_create( struct pipe_context *pipe )
 void
 lp_scene_destroy(struct lp_scene *scene)
 {
+   struct data_slab *slab, *next;
+
    lp_fence_reference(&scene->fence, NULL);
    mtx_destroy(&scene->mutex);
    assert(scene->data.head->next == NULL);
-   FREE(scene->data.head);
+   for (slab = scene->data.slabs; slab; slab = next) {
+      next = slab->next;
+      os_free_aligned(slab);
+   }
+   FREE(scene->tile);
    FREE(scene);
 }
 
@@ -104,14 +188,11 @@ lp_scene_destroy(struct lp_scene *scene)
 boolean
 lp_scene_is_empty(struct lp_scene *scene )
 {
-   unsigned x, y;
+   unsigned i;
 
-   for (y = 0; y < TILES_Y; y++) {
-      for (x = 0; x < TILES_X; x++) {
-         const struct cmd_bin *bin = lp_scene_get_bin(scene, x, y);
-         if (bin->head) {
-            return FALSE;
-         }
+   for (i = 0; i < scene->num_bins; i++) {
+      if (scene->tile[i].head) {
+         return FALSE;
       }
    }
    return TRUE;
@@ -129,6 +210,16 @@ lp_scene_is_oom(struct lp_scene *scene)
 }
 
 
+/* Returns true if the scene has grown enough that it should be flushed
+ * at the next opportunity.
+ */
+boolean
+lp_scene_is_full(const struct lp_scene *scene)
+{
+   return scene->scene_size >= LP_SCENE_FLUSH_SIZE;
+}
+
+
 /* Remove all commands from a bin.  Tries to reuse some of the memory
  * allocated to the bin, however.
  */
@@ -274,7 +365,7 @@ lp_scene_end_rasterization(struct lp_scene *scene )
                       j, scene->resource_reference_size);
    }
 
-   /* Free all scene data blocks:
+   /* Return all scene data blocks but the current one to the free list:
     */
    {
       struct data_block_list *list = &scene->data;
@@ -282,7 +373,8 @@ lp_scene_end_rasterization(struct lp_scene *scene )
 
       for (block = list->head->next; block; block = tmp) {
          tmp = block->next;
-	 FREE(block);
+         block->next = list->free_list;
+         list->free_list = block;
       }
 
       list->head->next = NULL;
@@ -336,13 +428,12 @@ lp_scene_new_data_block( struct lp_scene *scene )
       return NULL;
    }
    else {
-      struct data_block *block = MALLOC_STRUCT(data_block);
+      struct data_block *block = get_free_data_block(&scene->data);
       if (!block)
          return NULL;
-      
+
       scene->scene_size += sizeof *block;
 
-      block->used = 0;
       block->next = scene->data.head;
       scene->data.head = block;
 
@@ -507,20 +598,39 @@ end:
 }
 
 
-void lp_scene_begin_binning(struct lp_scene *scene,
-                            struct pipe_framebuffer_state *fb)
+boolean
+lp_scene_begin_binning(struct lp_scene *scene,
+                       struct pipe_framebuffer_state *fb)
 {
    int i;
    unsigned max_layer = ~0;
+   unsigned tiles_x, tiles_y;
 
    assert(lp_scene_is_empty(scene));
 
    util_copy_framebuffer_state(&scene->fb, fb);
 
-   scene->tiles_x = align(fb->width, TILE_SIZE) / TILE_SIZE;
-   scene->tiles_y = align(fb->height, TILE_SIZE) / TILE_SIZE;
-   assert(scene->tiles_x <= TILES_X);
-   assert(scene->tiles_y <= TILES_Y);
+   tiles_x = align(fb->width, TILE_SIZE) / TILE_SIZE;
+   tiles_y = align(fb->height, TILE_SIZE) / TILE_SIZE;
+   assert(tiles_x <= TILES_X);
+   assert(tiles_y <= TILES_Y);
+
+   /* Only grow the bins, all of them are empty so the layout doesn't
+    * matter when the framebuffer size changes.
+    */
+   if (tiles_x * tiles_y > scene->num_bins) {
+      FREE(scene->tile);
+      scene->tile = CALLOC(tiles_x * tiles_y, sizeof *scene->tile);
+      if (!scene->tile) {
+         scene->num_bins = 0;
+         scene->tiles_x = scene->tiles_y = 0;
+         return FALSE;
+      }
+      scene->num_bins = tiles_x * tiles_y;
+   }
+
+   scene->tiles_x = tiles_x;
+   scene->tiles_y = tiles_y;
 
    /*
     * Determine how many layers the fb has (used for clamping layer value).
@@ -545,6 +655,7 @@ void lp_scene_begin_binning(struct lp_scene *scene,
       max_layer = MIN2(max_layer, zsbuf->u.tex.last_layer - zsbuf->u.tex.first_layer);
    }
    scene->fb_max_layer = max_layer;
+   return TRUE;
 }
 
 
@@ -42,8 +42,8 @@
 struct lp_scene_queue;
 struct lp_rast_state;
 
-/* We're limited to 2K by 2K for 32bit fixed point rasterization.
- * Will need a 64-bit version for larger framebuffers.
+/* Maximum number of bins in each dimension.  The bins themselves are
+ * only allocated for the size of the current framebuffer.
  */
 #define TILES_X (LP_MAX_WIDTH / TILE_SIZE)
 #define TILES_Y (LP_MAX_HEIGHT / TILE_SIZE)
@@ -58,9 +58,19 @@ struct lp_rast_state;
  */
 #define DATA_BLOCK_SIZE (64 * 1024)
 
+/* Data blocks are allocated in slabs of this size, which are kept for
+ * the lifetime of the scene and recycled between frames.
+ */
+#define LP_SCENE_SLAB_SIZE (2*1024*1024)
+
 /* Scene temporary storage is clamped to this size:
  */
-#define LP_SCENE_MAX_SIZE (9*1024*1024)
+#define LP_SCENE_MAX_SIZE (16*1024*1024)
+
+/* Once a scene uses more than this, it is flushed at the next draw,
+ * rather than letting it run out of memory in the middle of a primitive.
+ */
+#define LP_SCENE_FLUSH_SIZE (12*1024*1024)
 
 /* The maximum amount of texture storage referenced by a scene is
  * clamped to this size:
@@ -100,6 +110,8 @@ struct cmd_bin {
 };
    
 
+struct data_slab;
+
 /**
  * This stores bulk data which is used for all memory allocations
  * within a scene.
@@ -107,12 +119,14 @@ struct cmd_bin {
  * Examples include triangle data and state data.  The commands in
  * the per-tile bins will point to chunks of data in this structure.
  *
- * Include the first block of data statically to ensure we can always
- * initiate a scene without relying on malloc succeeding.
+ * The first block is allocated when the scene is created, so that we can
+ * always initiate a scene without relying on malloc succeeding.  Blocks
+ * which are no longer used go to the free list instead of being freed.
  */
 struct data_block_list {
-   struct data_block first;
    struct data_block *head;
+   struct data_block *free_list;
+   struct data_slab *slabs;
 };
 
 struct resource_ref;
@@ -175,7 +189,10 @@ struct lp_scene {
    int curr_x, curr_y;  /**< for iterating over bins */
    mtx_t mutex;
 
-   struct cmd_bin tile[TILES_X][TILES_Y];
+   /** tiles_x * tiles_y bins, grown as needed */
+   struct cmd_bin *tile;
+   unsigned num_bins;
+
    struct data_block_list data;
 };
 
@@ -187,6 +204,7 @@ void lp_scene_destroy(struct lp_scene *scene);
 
 boolean lp_scene_is_empty(struct lp_scene *scene );
 boolean lp_scene_is_oom(struct lp_scene *scene );
+boolean lp_scene_is_full(const struct lp_scene *scene);
 
 
 struct data_block *lp_scene_new_data_block( struct lp_scene *scene );
@@ -284,7 +302,8 @@ lp_scene_putback_data( struct lp_scene *scene, unsigned size)
 static inline struct cmd_bin *
 lp_scene_get_bin(struct lp_scene *scene, unsigned x, unsigned y)
 {
-   return &scene->tile[x][y];
+   assert(x < scene->tiles_x && y < scene->tiles_y);
+   return &scene->tile[y * scene->tiles_x + x];
 }
 
 
@@ -387,7 +406,7 @@ lp_scene_bin_iter_next( struct lp_scene *scene, int *x, int *y );
 
 /* Begin/end binning of a scene
  */
-void
+boolean
 lp_scene_begin_binning(struct lp_scene *scene,
                        struct pipe_framebuffer_state *fb);
 
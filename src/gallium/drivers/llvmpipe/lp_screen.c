@@ -37,6 +37,7 @@
 #include "pipe/p_screen.h"
 #include "draw/draw_context.h"
 #include "gallivm/lp_bld_type.h"
+#include "gallivm/lp_bld_debug.h"
 
 #include "util/os_misc.h"
 #include "util/os_time.h"
@@ -84,6 +85,9 @@ static const struct debug_named_value lp_perf_flags[] = {
    { "no_blend",       PERF_NO_BLEND, NULL },
    { "no_depth",       PERF_NO_DEPTH, NULL },
    { "no_alphatest",   PERF_NO_ALPHATEST, NULL },
+   { "no_tier_up",     PERF_NO_TIER_UP, NULL },
+   { "texcache",       PERF_TEX_CACHE, NULL },
+   { "no_hiz",         PERF_NO_HIZ, NULL },
    DEBUG_NAMED_VALUE_END
 };
 
@@ -651,6 +655,9 @@ llvmpipe_destroy_screen( struct pipe_screen *_screen )
    struct llvmpipe_screen *screen = llvmpipe_screen(_screen);
    struct sw_winsys *winsys = screen->winsys;
 
+   if (util_queue_is_initialized(&screen->fs_compile_queue))
+      util_queue_destroy(&screen->fs_compile_queue);
+
    if (screen->cs_tpool)
       lp_cs_tpool_destroy(screen->cs_tpool);
 
@@ -786,5 +793,15 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    }
    (void) mtx_init(&screen->cs_mutex, mtx_plain);
 
+   /* Without rasterizer threads there is nothing to overlap the optimized
+    * compiles with, so just compile optimized from the start.
+    */
+   if (screen->num_threads && !(LP_PERF & PERF_NO_TIER_UP) &&
+       !(gallivm_perf & GALLIVM_PERF_NO_OPT)) {
+      util_queue_init(&screen->fs_compile_queue, "lpfs", 64, 1,
+                      UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+                      UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY);
+   }
+
    return &screen->base;
 }
@@ -37,6 +37,7 @@
 #include "pipe/p_screen.h"
 #include "pipe/p_defines.h"
 #include "os/os_thread.h"
+#include "util/u_queue.h"
 #include "gallivm/lp_bld.h"
 
 
@@ -60,6 +61,12 @@ struct llvmpipe_screen
 
    struct lp_cs_tpool *cs_tpool;
    mtx_t cs_mutex;
+
+   /* Optimized recompiles of the fragment shader variants that are used
+    * the most.  Not initialized when shaders are compiled optimized right
+    * away.
+    */
+   struct util_queue fs_compile_queue;
 };
 
 
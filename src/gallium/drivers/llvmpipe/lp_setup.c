@@ -64,7 +64,7 @@ static boolean set_scene_state( struct lp_setup_context *, enum setup_state,
 static boolean try_update_scene_state( struct lp_setup_context *setup );
 
 
-static void
+static boolean
 lp_setup_get_empty_scene(struct lp_setup_context *setup)
 {
    assert(setup->scene == NULL);
@@ -82,8 +82,7 @@ lp_setup_get_empty_scene(struct lp_setup_context *setup)
       lp_fence_wait(setup->scene->fence);
    }
 
-   lp_scene_begin_binning(setup->scene, &setup->fb);
-
+   return lp_scene_begin_binning(setup->scene, &setup->fb);
 }
 
 
@@ -311,8 +310,10 @@ set_scene_state( struct lp_setup_context *setup,
 
    /* wait for a free/empty scene
     */
-   if (old_state == SETUP_FLUSHED) 
-      lp_setup_get_empty_scene(setup);
+   if (old_state == SETUP_FLUSHED) {
+      if (!lp_setup_get_empty_scene(setup))
+         goto fail;
+   }
 
    switch (new_state) {
    case SETUP_CLEARED:
@@ -1364,6 +1365,16 @@ lp_setup_update_state( struct lp_setup_context *setup,
    if (update_scene && setup->scene) {
       assert(setup->state == SETUP_ACTIVE);
 
+      /* Stream big scenes to the rasterizer between draws, instead of
+       * running out of scene memory in the middle of one.
+       */
+      if (lp_scene_is_full(setup->scene)) {
+         if (!set_scene_state(setup, SETUP_FLUSHED, "scene size") ||
+             !set_scene_state(setup, SETUP_ACTIVE, __FUNCTION__) ||
+             !setup->scene)
+            return FALSE;
+      }
+
       if (try_update_scene_state(setup))
          return TRUE;
 
@@ -311,31 +311,46 @@ do_triangle_ccw(struct lp_setup_context *setup,
        * slightly different rounding.
        */
       int adj = (setup->bottom_edge_rule != 0) ? 1 : 0;
+      int minx = MIN3(position->x[0], position->x[1], position->x[2]);
+      int miny = MIN3(position->y[0], position->y[1], position->y[2]);
+      int maxx = MAX3(position->x[0], position->x[1], position->x[2]);
+      int maxy = MAX3(position->y[0], position->y[1], position->y[2]);
 
       /* Inclusive x0, exclusive x1 */
-      bbox.x0 =  MIN3(position->x[0], position->x[1], position->x[2]) >> FIXED_ORDER;
-      bbox.x1 = (MAX3(position->x[0], position->x[1], position->x[2]) - 1) >> FIXED_ORDER;
+      bbox.x0 =  minx >> FIXED_ORDER;
+      bbox.x1 = (maxx - 1) >> FIXED_ORDER;
 
       /* Inclusive / exclusive depending upon adj (bottom-left or top-right) */
-      bbox.y0 = (MIN3(position->y[0], position->y[1], position->y[2]) + adj) >> FIXED_ORDER;
-      bbox.y1 = (MAX3(position->y[0], position->y[1], position->y[2]) - 1 + adj) >> FIXED_ORDER;
+      bbox.y0 = (miny + adj) >> FIXED_ORDER;
+      bbox.y1 = (maxy - 1 + adj) >> FIXED_ORDER;
+
+      /*
+       * The pixels whose centers the triangle can actually cover.  This is
+       * smaller than the bounding box above, which is still needed to
+       * tell whether the 32 bit rasterization functions are safe to use.
+       * Tiny triangles which don't cover any pixel center get culled here,
+       * before going through setup, and others get binned as 4x4 or 16x16
+       * block triangles more often.
+       */
+      bboxpos.x0 = (minx + (FIXED_ONE-1)) >> FIXED_ORDER;
+      bboxpos.x1 = bbox.x1;
+      bboxpos.y0 = (miny + (FIXED_ONE-1) + adj) >> FIXED_ORDER;
+      bboxpos.y1 = bbox.y1;
    }
 
-   if (bbox.x1 < bbox.x0 ||
-       bbox.y1 < bbox.y0) {
+   if (bboxpos.x1 < bboxpos.x0 ||
+       bboxpos.y1 < bboxpos.y0) {
       if (0) debug_printf("empty bounding box\n");
       LP_COUNT(nr_culled_tris);
       return TRUE;
    }
 
-   if (!u_rect_test_intersection(&setup->draw_regions[viewport_index], &bbox)) {
+   if (!u_rect_test_intersection(&setup->draw_regions[viewport_index], &bboxpos)) {
       if (0) debug_printf("offscreen\n");
       LP_COUNT(nr_culled_tris);
       return TRUE;
    }
 
-   bboxpos = bbox;
-
    /* Can safely discard negative regions, but need to keep hold of
     * information about when the triangle extends past screen
     * boundaries.  See trimmed_box in lp_setup_bin_triangle().
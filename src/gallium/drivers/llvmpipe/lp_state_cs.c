@@ -76,6 +76,12 @@ generate_compute(struct llvmpipe_context *lp,
    struct lp_type cs_type;
    unsigned i;
 
+   /*
+    * Coroutines are only needed to suspend invocations at barriers,
+    * shaders without barriers just get called in a loop.
+    */
+   boolean use_coro = shader->info.base.opcode_count[TGSI_OPCODE_BARRIER] > 0;
+
    /*
     * This function has two parts
     * a) setup the coroutine execution environment loop.
@@ -111,7 +117,9 @@ generate_compute(struct llvmpipe_context *lp,
    func_type = LLVMFunctionType(LLVMVoidTypeInContext(gallivm->context),
                                 arg_types, ARRAY_SIZE(arg_types) - 2, 0);
 
-   coro_func_type = LLVMFunctionType(LLVMPointerType(LLVMInt8TypeInContext(gallivm->context), 0),
+   coro_func_type = LLVMFunctionType(use_coro ?
+                                     LLVMPointerType(LLVMInt8TypeInContext(gallivm->context), 0) :
+                                     LLVMVoidTypeInContext(gallivm->context),
                                      arg_types, ARRAY_SIZE(arg_types), 0);
 
    function = LLVMAddFunction(gallivm->module, func_name, func_type);
@@ -168,91 +176,127 @@ generate_compute(struct llvmpipe_context *lp,
    num_x_loop = LLVMBuildUDiv(gallivm->builder, num_x_loop, vec_length, "");
    LLVMValueRef partials = LLVMBuildURem(gallivm->builder, x_size_arg, vec_length, "");
 
-   LLVMValueRef coro_num_hdls = LLVMBuildMul(gallivm->builder, num_x_loop, y_size_arg, "");
-   coro_num_hdls = LLVMBuildMul(gallivm->builder, coro_num_hdls, z_size_arg, "");
+   if (use_coro) {
+      LLVMValueRef coro_num_hdls = LLVMBuildMul(gallivm->builder, num_x_loop, y_size_arg, "");
+      coro_num_hdls = LLVMBuildMul(gallivm->builder, coro_num_hdls, z_size_arg, "");
 
-   LLVMTypeRef hdl_ptr_type = LLVMPointerType(LLVMInt8TypeInContext(gallivm->context), 0);
-   LLVMValueRef coro_hdls = LLVMBuildArrayAlloca(gallivm->builder, hdl_ptr_type, coro_num_hdls, "coro_hdls");
+      LLVMTypeRef hdl_ptr_type = LLVMPointerType(LLVMInt8TypeInContext(gallivm->context), 0);
+      LLVMValueRef coro_hdls = LLVMBuildArrayAlloca(gallivm->builder, hdl_ptr_type, coro_num_hdls, "coro_hdls");
 
-   unsigned end_coroutine = INT_MAX;
+      unsigned end_coroutine = INT_MAX;
 
-   /*
-    * This is the main coroutine execution loop. It iterates over the dimensions
-    * and calls the coroutine main entrypoint on the first pass, but in subsequent
-    * passes it checks if the coroutine has completed and resumes it if not.
-    */
-   /* take x_width - round up to type.length width */
-   lp_build_loop_begin(&loop_state[3], gallivm,
-                       lp_build_const_int32(gallivm, 0)); /* coroutine reentry loop */
-   lp_build_loop_begin(&loop_state[2], gallivm,
-                       lp_build_const_int32(gallivm, 0)); /* z loop */
-   lp_build_loop_begin(&loop_state[1], gallivm,
-                       lp_build_const_int32(gallivm, 0)); /* y loop */
-   lp_build_loop_begin(&loop_state[0], gallivm,
-                       lp_build_const_int32(gallivm, 0)); /* x loop */
-   {
-      LLVMValueRef args[13];
-      args[0] = context_ptr;
-      args[1] = loop_state[0].counter;
-      args[2] = loop_state[1].counter;
-      args[3] = loop_state[2].counter;
-      args[4] = grid_x_arg;
-      args[5] = grid_y_arg;
-      args[6] = grid_z_arg;
-      args[7] = grid_size_x_arg;
-      args[8] = grid_size_y_arg;
-      args[9] = grid_size_z_arg;
-      args[10] = thread_data_ptr;
-      args[11] = num_x_loop;
-      args[12] = partials;
-
-      /* idx = (z * (size_x * size_y) + y * size_x + x */
-      LLVMValueRef coro_hdl_idx = LLVMBuildMul(gallivm->builder, loop_state[2].counter,
-                                               LLVMBuildMul(gallivm->builder, num_x_loop, y_size_arg, ""), "");
-      coro_hdl_idx = LLVMBuildAdd(gallivm->builder, coro_hdl_idx,
-                                  LLVMBuildMul(gallivm->builder, loop_state[1].counter,
-                                               num_x_loop, ""), "");
-      coro_hdl_idx = LLVMBuildAdd(gallivm->builder, coro_hdl_idx,
-                                  loop_state[0].counter, "");
-
-      LLVMValueRef coro_entry = LLVMBuildGEP(gallivm->builder, coro_hdls, &coro_hdl_idx, 1, "");
-
-      LLVMValueRef coro_hdl = LLVMBuildLoad(gallivm->builder, coro_entry, "coro_hdl");
-
-      struct lp_build_if_state ifstate;
-      LLVMValueRef cmp = LLVMBuildICmp(gallivm->builder, LLVMIntEQ, loop_state[3].counter,
-                                       lp_build_const_int32(gallivm, 0), "");
-      /* first time here - call the coroutine function entry point */
-      lp_build_if(&ifstate, gallivm, cmp);
-      LLVMValueRef coro_ret = LLVMBuildCall(gallivm->builder, coro, args, 13, "");
-      LLVMBuildStore(gallivm->builder, coro_ret, coro_entry);
-      lp_build_else(&ifstate);
-      /* subsequent calls for this invocation - check if done. */
-      LLVMValueRef coro_done = lp_build_coro_done(gallivm, coro_hdl);
-      struct lp_build_if_state ifstate2;
-      lp_build_if(&ifstate2, gallivm, coro_done);
-      /* if done destroy and force loop exit */
-      lp_build_coro_destroy(gallivm, coro_hdl);
-      lp_build_loop_force_set_counter(&loop_state[3], lp_build_const_int32(gallivm, end_coroutine - 1));
-      lp_build_else(&ifstate2);
-      /* otherwise resume the coroutine */
-      lp_build_coro_resume(gallivm, coro_hdl);
-      lp_build_endif(&ifstate2);
-      lp_build_endif(&ifstate);
-      lp_build_loop_force_reload_counter(&loop_state[3]);
+      /*
+       * This is the main coroutine execution loop. It iterates over the dimensions
+       * and calls the coroutine main entrypoint on the first pass, but in subsequent
+       * passes it checks if the coroutine has completed and resumes it if not.
+       */
+      /* take x_width - round up to type.length width */
+      lp_build_loop_begin(&loop_state[3], gallivm,
+                          lp_build_const_int32(gallivm, 0)); /* coroutine reentry loop */
+      lp_build_loop_begin(&loop_state[2], gallivm,
+                          lp_build_const_int32(gallivm, 0)); /* z loop */
+      lp_build_loop_begin(&loop_state[1], gallivm,
+                          lp_build_const_int32(gallivm, 0)); /* y loop */
+      lp_build_loop_begin(&loop_state[0], gallivm,
+                          lp_build_const_int32(gallivm, 0)); /* x loop */
+      {
+         LLVMValueRef args[13];
+         args[0] = context_ptr;
+         args[1] = loop_state[0].counter;
+         args[2] = loop_state[1].counter;
+         args[3] = loop_state[2].counter;
+         args[4] = grid_x_arg;
+         args[5] = grid_y_arg;
+         args[6] = grid_z_arg;
+         args[7] = grid_size_x_arg;
+         args[8] = grid_size_y_arg;
+         args[9] = grid_size_z_arg;
+         args[10] = thread_data_ptr;
+         args[11] = num_x_loop;
+         args[12] = partials;
+
+         /* idx = (z * (size_x * size_y) + y * size_x + x */
+         LLVMValueRef coro_hdl_idx = LLVMBuildMul(gallivm->builder, loop_state[2].counter,
+                                                  LLVMBuildMul(gallivm->builder, num_x_loop, y_size_arg, ""), "");
+         coro_hdl_idx = LLVMBuildAdd(gallivm->builder, coro_hdl_idx,
+                                     LLVMBuildMul(gallivm->builder, loop_state[1].counter,
+                                                  num_x_loop, ""), "");
+         coro_hdl_idx = LLVMBuildAdd(gallivm->builder, coro_hdl_idx,
+                                     loop_state[0].counter, "");
+
+         LLVMValueRef coro_entry = LLVMBuildGEP(gallivm->builder, coro_hdls, &coro_hdl_idx, 1, "");
+
+         LLVMValueRef coro_hdl = LLVMBuildLoad(gallivm->builder, coro_entry, "coro_hdl");
+
+         struct lp_build_if_state ifstate;
+         LLVMValueRef cmp = LLVMBuildICmp(gallivm->builder, LLVMIntEQ, loop_state[3].counter,
+                                          lp_build_const_int32(gallivm, 0), "");
+         /* first time here - call the coroutine function entry point */
+         lp_build_if(&ifstate, gallivm, cmp);
+         LLVMValueRef coro_ret = LLVMBuildCall(gallivm->builder, coro, args, 13, "");
+         LLVMBuildStore(gallivm->builder, coro_ret, coro_entry);
+         lp_build_else(&ifstate);
+         /* subsequent calls for this invocation - check if done. */
+         LLVMValueRef coro_done = lp_build_coro_done(gallivm, coro_hdl);
+         struct lp_build_if_state ifstate2;
+         lp_build_if(&ifstate2, gallivm, coro_done);
+         /* if done destroy and force loop exit */
+         lp_build_coro_destroy(gallivm, coro_hdl);
+         lp_build_loop_force_set_counter(&loop_state[3], lp_build_const_int32(gallivm, end_coroutine - 1));
+         lp_build_else(&ifstate2);
+         /* otherwise resume the coroutine */
+         lp_build_coro_resume(gallivm, coro_hdl);
+         lp_build_endif(&ifstate2);
+         lp_build_endif(&ifstate);
+         lp_build_loop_force_reload_counter(&loop_state[3]);
+      }
+      lp_build_loop_end_cond(&loop_state[0],
+                             num_x_loop,
+                             NULL,  LLVMIntUGE);
+      lp_build_loop_end_cond(&loop_state[1],
+                             y_size_arg,
+                             NULL,  LLVMIntUGE);
+      lp_build_loop_end_cond(&loop_state[2],
+                             z_size_arg,
+                             NULL,  LLVMIntUGE);
+      lp_build_loop_end_cond(&loop_state[3],
+                             lp_build_const_int32(gallivm, end_coroutine),
+                             NULL, LLVMIntEQ);
+   } else {
+      /* No barriers - run each invocation to completion. */
+      lp_build_loop_begin(&loop_state[2], gallivm,
+                          lp_build_const_int32(gallivm, 0)); /* z loop */
+      lp_build_loop_begin(&loop_state[1], gallivm,
+                          lp_build_const_int32(gallivm, 0)); /* y loop */
+      lp_build_loop_begin(&loop_state[0], gallivm,
+                          lp_build_const_int32(gallivm, 0)); /* x loop */
+      {
+         LLVMValueRef args[13];
+         args[0] = context_ptr;
+         args[1] = loop_state[0].counter;
+         args[2] = loop_state[1].counter;
+         args[3] = loop_state[2].counter;
+         args[4] = grid_x_arg;
+         args[5] = grid_y_arg;
+         args[6] = grid_z_arg;
+         args[7] = grid_size_x_arg;
+         args[8] = grid_size_y_arg;
+         args[9] = grid_size_z_arg;
+         args[10] = thread_data_ptr;
+         args[11] = num_x_loop;
+         args[12] = partials;
+         LLVMBuildCall(gallivm->builder, coro, args, 13, "");
+      }
+      lp_build_loop_end_cond(&loop_state[0],
+                             num_x_loop,
+                             NULL,  LLVMIntUGE);
+      lp_build_loop_end_cond(&loop_state[1],
+                             y_size_arg,
+                             NULL,  LLVMIntUGE);
+      lp_build_loop_end_cond(&loop_state[2],
+                             z_size_arg,
+                             NULL,  LLVMIntUGE);
    }
-   lp_build_loop_end_cond(&loop_state[0],
-                          num_x_loop,
-                          NULL,  LLVMIntUGE);
-   lp_build_loop_end_cond(&loop_state[1],
-                          y_size_arg,
-                          NULL,  LLVMIntUGE);
-   lp_build_loop_end_cond(&loop_state[2],
-                          z_size_arg,
-                          NULL,  LLVMIntUGE);
-   lp_build_loop_end_cond(&loop_state[3],
-                          lp_build_const_int32(gallivm, end_coroutine),
-                          NULL, LLVMIntEQ);
    LLVMBuildRetVoid(builder);
 
    /* This is stage (b) - generate the compute shader code inside the coroutine. */
@@ -287,8 +331,11 @@ generate_compute(struct llvmpipe_context *lp,
       shared_ptr = lp_jit_cs_thread_data_shared(gallivm, thread_data_ptr);
 
       /* these are coroutine entrypoint necessities */
-      LLVMValueRef coro_id = lp_build_coro_id(gallivm);
-      LLVMValueRef coro_hdl = lp_build_coro_begin_alloc_mem(gallivm, coro_id);
+      LLVMValueRef coro_id = NULL, coro_hdl = NULL;
+      if (use_coro) {
+         coro_id = lp_build_coro_id(gallivm);
+         coro_hdl = lp_build_coro_begin_alloc_mem(gallivm, coro_id);
+      }
 
       LLVMValueRef has_partials = LLVMBuildICmp(gallivm->builder, LLVMIntNE, partials, lp_build_const_int32(gallivm, 0), "");
       LLVMValueRef tid_vals[3];
@@ -336,9 +383,12 @@ generate_compute(struct llvmpipe_context *lp,
       lp_build_mask_begin(&mask, gallivm, cs_type, mask_val);
 
       struct lp_build_coro_suspend_info coro_info;
+      LLVMBasicBlockRef sus_block = NULL, clean_block = NULL;
 
-      LLVMBasicBlockRef sus_block = LLVMAppendBasicBlockInContext(gallivm->context, coro, "suspend");
-      LLVMBasicBlockRef clean_block = LLVMAppendBasicBlockInContext(gallivm->context, coro, "cleanup");
+      if (use_coro) {
+         sus_block = LLVMAppendBasicBlockInContext(gallivm->context, coro, "suspend");
+         clean_block = LLVMAppendBasicBlockInContext(gallivm->context, coro, "cleanup");
+      }
 
       coro_info.suspend = sus_block;
       coro_info.cleanup = clean_block;
@@ -358,22 +408,26 @@ generate_compute(struct llvmpipe_context *lp,
       params.ssbo_sizes_ptr = num_ssbo_ptr;
       params.image = image;
       params.shared_ptr = shared_ptr;
-      params.coro = &coro_info;
+      params.coro = use_coro ? &coro_info : NULL;
 
       lp_build_tgsi_soa(gallivm, tokens, &params, NULL);
 
       mask_val = lp_build_mask_end(&mask);
 
-      lp_build_coro_suspend_switch(gallivm, &coro_info, NULL, true);
-      LLVMPositionBuilderAtEnd(builder, clean_block);
+      if (use_coro) {
+         lp_build_coro_suspend_switch(gallivm, &coro_info, NULL, true);
+         LLVMPositionBuilderAtEnd(builder, clean_block);
 
-      lp_build_coro_free_mem(gallivm, coro_id, coro_hdl);
+         lp_build_coro_free_mem(gallivm, coro_id, coro_hdl);
 
-      LLVMBuildBr(builder, sus_block);
-      LLVMPositionBuilderAtEnd(builder, sus_block);
+         LLVMBuildBr(builder, sus_block);
+         LLVMPositionBuilderAtEnd(builder, sus_block);
 
-      lp_build_coro_end(gallivm, coro_hdl);
-      LLVMBuildRet(builder, coro_hdl);
+         lp_build_coro_end(gallivm, coro_hdl);
+         LLVMBuildRet(builder, coro_hdl);
+      } else {
+         LLVMBuildRetVoid(builder);
+      }
    }
 
    sampler->destroy(sampler);
@@ -59,6 +59,7 @@
 
 #include <limits.h>
 #include "pipe/p_defines.h"
+#include "util/u_atomic.h"
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
 #include "util/u_pointer.h"
@@ -102,6 +103,7 @@
 #include "lp_flush.h"
 #include "lp_state_fs.h"
 #include "lp_rast.h"
+#include "lp_screen.h"
 
 
 /** Fragment shader number (for debugging) */
@@ -2413,6 +2415,30 @@ generate_unswizzled_blend(struct gallivm_state *gallivm,
 }
 
 
+/**
+ * Replace the pointers to num_fs vectors of a fragment shader output with
+ * pointers to their two halves, of half_type.
+ */
+static void
+split_fs_output(struct gallivm_state *gallivm,
+                struct lp_type half_type,
+                unsigned num_fs,
+                LLVMValueRef *ptrs)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef half_ptr_type =
+      LLVMPointerType(lp_build_vec_type(gallivm, half_type), 0);
+   LLVMValueRef index1 = lp_build_const_int32(gallivm, 1);
+   unsigned i;
+
+   for (i = num_fs; i-- > 0; ) {
+      LLVMValueRef ptr = LLVMBuildBitCast(builder, ptrs[i], half_ptr_type, "");
+      ptrs[2*i + 0] = ptr;
+      ptrs[2*i + 1] = LLVMBuildGEP(builder, ptr, &index1, 1, "");
+   }
+}
+
+
 /**
  * Generate the runtime callable function for the whole fragment pipeline.
  * Note that the function which we generate operates on a block of 16
@@ -2420,8 +2446,7 @@ generate_unswizzled_blend(struct gallivm_state *gallivm,
  * 2x2 pixels.
  */
 static void
-generate_fragment(struct llvmpipe_context *lp,
-                  struct lp_fragment_shader *shader,
+generate_fragment(struct lp_fragment_shader *shader,
                   struct lp_fragment_shader_variant *variant,
                   unsigned partial_mask)
 {
@@ -2430,6 +2455,7 @@ generate_fragment(struct llvmpipe_context *lp,
    struct lp_shader_input inputs[PIPE_MAX_SHADER_INPUTS];
    char func_name[64];
    struct lp_type fs_type;
+   struct lp_type blend_fs_type;
    struct lp_type blend_type;
    LLVMTypeRef fs_elem_type;
    LLVMTypeRef blend_vec_type;
@@ -2459,6 +2485,7 @@ generate_fragment(struct llvmpipe_context *lp,
    LLVMValueRef function;
    LLVMValueRef facing;
    unsigned num_fs;
+   unsigned num_blend_fs;
    unsigned i;
    unsigned chan;
    unsigned cbuf;
@@ -2493,6 +2520,9 @@ generate_fragment(struct llvmpipe_context *lp,
    fs_type.norm = FALSE;         /* values are not limited to [0,1] or [-1,1] */
    fs_type.width = 32;           /* 32-bit float */
    fs_type.length = MIN2(lp_native_vector_width / 32, 16); /* n*4 elements per vector */
+   /* 1d resources only run the upper half of the stamp, can't with 16-wide */
+   if (key->resource_1d)
+      fs_type.length = MIN2(fs_type.length, 8);
 
    memset(&blend_type, 0, sizeof blend_type);
    blend_type.floating = FALSE; /* values are integers */
@@ -2690,6 +2720,34 @@ generate_fragment(struct llvmpipe_context *lp,
 
    sampler->destroy(sampler);
    image->destroy(image);
+
+   /*
+    * The blend code deals with up to 8-wide vectors, so with 16-wide ones
+    * hand it both halves of everything instead.
+    */
+   blend_fs_type = fs_type;
+   num_blend_fs = num_fs;
+   if (fs_type.length == 16) {
+      blend_fs_type.length = 8;
+      num_blend_fs = 2 * num_fs;
+      for (i = num_fs; i-- > 0; ) {
+         fs_mask[2*i + 1] = lp_build_extract_range(gallivm, fs_mask[i], 8, 8);
+         fs_mask[2*i + 0] = lp_build_extract_range(gallivm, fs_mask[i], 0, 8);
+      }
+      for (cbuf = 0; cbuf < key->nr_cbufs; cbuf++) {
+         for (chan = 0; chan < TGSI_NUM_CHANNELS; ++chan) {
+            split_fs_output(gallivm, blend_fs_type, num_fs,
+                            fs_out_color[cbuf][chan]);
+         }
+      }
+      if (dual_source_blend && key->nr_cbufs < 2) {
+         for (chan = 0; chan < TGSI_NUM_CHANNELS; ++chan) {
+            split_fs_output(gallivm, blend_fs_type, num_fs,
+                            fs_out_color[1][chan]);
+         }
+      }
+   }
+
    /* Loop over color outputs / color buffers to do blending.
     */
    for(cbuf = 0; cbuf < key->nr_cbufs; cbuf++) {
@@ -2716,7 +2774,8 @@ generate_fragment(struct llvmpipe_context *lp,
 
          generate_unswizzled_blend(gallivm, cbuf, variant,
                                    key->cbuf_format[cbuf],
-                                   num_fs, fs_type, fs_mask, fs_out_color,
+                                   num_blend_fs, blend_fs_type,
+                                   fs_mask, fs_out_color,
                                    context_ptr, color_ptr, stride,
                                    partial_mask, do_branch);
       }
@@ -2848,6 +2907,53 @@ lp_debug_fs_variant(struct lp_fragment_shader_variant *variant)
 }
 
 
+/**
+ * Generate and compile the code of a variant.  This only touches the
+ * variant and reads the shader, so it is safe to run on another thread if
+ * the variant has an LLVM context of its own.
+ */
+static void
+compile_variant(struct lp_fragment_shader *shader,
+                struct lp_fragment_shader_variant *variant)
+{
+   lp_jit_init_types(variant);
+
+   if (variant->jit_function[RAST_EDGE_TEST] == NULL)
+      generate_fragment(shader, variant, RAST_EDGE_TEST);
+
+   if (variant->jit_function[RAST_WHOLE] == NULL) {
+      if (variant->opaque) {
+         /* Specialized shader, which doesn't need to read the color buffer. */
+         generate_fragment(shader, variant, RAST_WHOLE);
+      }
+   }
+
+   /*
+    * Compile everything
+    */
+
+   gallivm_compile_module(variant->gallivm);
+
+   variant->nr_instrs += lp_build_count_ir_module(variant->gallivm->module);
+
+   if (variant->function[RAST_EDGE_TEST]) {
+      variant->jit_function[RAST_EDGE_TEST] = (lp_jit_frag_func)
+            gallivm_jit_function(variant->gallivm,
+                                 variant->function[RAST_EDGE_TEST]);
+   }
+
+   if (variant->function[RAST_WHOLE]) {
+         variant->jit_function[RAST_WHOLE] = (lp_jit_frag_func)
+               gallivm_jit_function(variant->gallivm,
+                                    variant->function[RAST_WHOLE]);
+   } else if (!variant->jit_function[RAST_WHOLE]) {
+      variant->jit_function[RAST_WHOLE] = variant->jit_function[RAST_EDGE_TEST];
+   }
+
+   gallivm_free_ir(variant->gallivm);
+}
+
+
 /**
  * Generate a new fragment shader variant from the shader code and
  * other state indicated by the key.
@@ -2857,6 +2963,7 @@ generate_variant(struct llvmpipe_context *lp,
                  struct lp_fragment_shader *shader,
                  const struct lp_fragment_shader_variant_key *key)
 {
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
    struct lp_fragment_shader_variant *variant;
    const struct util_format_description *cbuf0_format_desc = NULL;
    boolean fullcolormask;
@@ -2881,6 +2988,15 @@ generate_variant(struct llvmpipe_context *lp,
    variant->list_item_local.base = variant;
    variant->no = shader->variants_created++;
 
+   /* Compile quickly now, and optimized later if the variant is used. */
+   util_queue_fence_init(&variant->tier_up_fence);
+   if (util_queue_is_initialized(&screen->fs_compile_queue)) {
+      variant->gallivm->opt_level = GALLIVM_OPT_NONE;
+      variant->tier = LP_FS_TIER_FAST;
+   } else {
+      variant->tier = LP_FS_TIER_OPTIMIZED;
+   }
+
    memcpy(&variant->key, key, shader->variant_key_size);
 
    /*
@@ -2904,47 +3020,140 @@ generate_variant(struct llvmpipe_context *lp,
          !shader->info.base.writes_samplemask
       ? TRUE : FALSE;
 
+   /*
+    * Blocks failing the depth test can't be skipped if the shader computes
+    * depth, or if that would also skip stencil ops or memory writes.
+    */
+   variant->hiz_func = PIPE_FUNC_ALWAYS;
+   variant->hiz_write = LP_HIZ_WRITE_NONE;
+   if (key->depth.enabled) {
+      if (key->depth.writemask) {
+         variant->hiz_write = shader->info.base.writes_z ?
+            LP_HIZ_WRITE_SHADER : LP_HIZ_WRITE_INTERP;
+      }
+      if (!shader->info.base.writes_z &&
+          !key->stencil[0].enabled &&
+          (!shader->info.base.writes_memory ||
+           shader->info.base.properties[TGSI_PROPERTY_FS_EARLY_DEPTH_STENCIL])) {
+         variant->hiz_func = key->depth.func;
+      }
+   }
+
    if ((LP_DEBUG & DEBUG_FS) || (gallivm_debug & GALLIVM_DEBUG_IR)) {
       lp_debug_fs_variant(variant);
    }
 
-   lp_jit_init_types(variant);
-   
-   if (variant->jit_function[RAST_EDGE_TEST] == NULL)
-      generate_fragment(lp, shader, variant, RAST_EDGE_TEST);
+   compile_variant(shader, variant);
 
-   if (variant->jit_function[RAST_WHOLE] == NULL) {
-      if (variant->opaque) {
-         /* Specialized shader, which doesn't need to read the color buffer. */
-         generate_fragment(lp, shader, variant, RAST_WHOLE);
-      }
-   }
+   return variant;
+}
 
-   /*
-    * Compile everything
-    */
 
-   gallivm_compile_module(variant->gallivm);
 
-   variant->nr_instrs += lp_build_count_ir_module(variant->gallivm->module);
+/**
+ * Recompile a variant with all optimizations.  Runs on the screen's compile
+ * queue, so it builds the code in an LLVM context of its own.
+ */
+static void
+tier_up_variant(void *data, int thread_index)
+{
+   struct lp_fragment_shader_variant *variant = data;
+   struct lp_fragment_shader *shader = variant->shader;
+   struct lp_fragment_shader_variant *optimized;
+   LLVMContextRef context;
+   char module_name[64];
 
-   if (variant->function[RAST_EDGE_TEST]) {
-      variant->jit_function[RAST_EDGE_TEST] = (lp_jit_frag_func)
-            gallivm_jit_function(variant->gallivm,
-                                 variant->function[RAST_EDGE_TEST]);
+   optimized = MALLOC(sizeof *optimized + shader->variant_key_size - sizeof optimized->key);
+   if (!optimized)
+      return;
+
+   memset(optimized, 0, sizeof(*optimized));
+   snprintf(module_name, sizeof(module_name), "fs%u_variant%u_opt",
+            shader->no, variant->no);
+
+   context = LLVMContextCreate();
+   if (!context) {
+      FREE(optimized);
+      return;
    }
 
-   if (variant->function[RAST_WHOLE]) {
-         variant->jit_function[RAST_WHOLE] = (lp_jit_frag_func)
-               gallivm_jit_function(variant->gallivm,
-                                    variant->function[RAST_WHOLE]);
-   } else if (!variant->jit_function[RAST_WHOLE]) {
-      variant->jit_function[RAST_WHOLE] = variant->jit_function[RAST_EDGE_TEST];
+   optimized->gallivm = gallivm_create(module_name, context);
+   if (!optimized->gallivm) {
+      LLVMContextDispose(context);
+      FREE(optimized);
+      return;
    }
 
-   gallivm_free_ir(variant->gallivm);
+   optimized->shader = shader;
+   optimized->no = variant->no;
+   optimized->opaque = variant->opaque;
+   optimized->hiz_func = variant->hiz_func;
+   optimized->hiz_write = variant->hiz_write;
+   memcpy(&optimized->key, &variant->key, shader->variant_key_size);
 
-   return variant;
+   compile_variant(shader, optimized);
+
+   /* The IR is gone, only the generated code is left. */
+   LLVMContextDispose(context);
+
+   variant->optimized = optimized;
+}
+
+
+/**
+ * Called before each draw.  Counts the draws with the bound fragment shader
+ * variant, queues its optimized recompile once it has been used enough, and
+ * switches it over to the optimized code once that is ready.  Scenes binned
+ * from then on run the new code, the ones in flight may still run the old.
+ */
+void
+llvmpipe_tier_up_fs(struct llvmpipe_context *lp)
+{
+   struct lp_fragment_shader_variant *variant = lp->fs_variant;
+   struct llvmpipe_screen *screen;
+   unsigned i;
+
+   if (!variant)
+      return;
+
+   switch (variant->tier) {
+   case LP_FS_TIER_OPTIMIZED:
+      break;
+
+   case LP_FS_TIER_FAST:
+      if (++variant->draws < LP_FS_TIER_UP_DRAWS)
+         break;
+
+      screen = llvmpipe_screen(lp->pipe.screen);
+      variant->tier = LP_FS_TIER_COMPILING;
+      util_queue_add_job(&screen->fs_compile_queue, variant,
+                         &variant->tier_up_fence, tier_up_variant, NULL, 0);
+      break;
+
+   case LP_FS_TIER_COMPILING:
+      if (!util_queue_fence_is_signalled(&variant->tier_up_fence))
+         break;
+
+      variant->tier = LP_FS_TIER_OPTIMIZED;
+
+      /* Keep the quickly compiled code if the recompile failed. */
+      if (!variant->optimized)
+         break;
+
+      for (i = 0; i < ARRAY_SIZE(variant->jit_function); i++) {
+         p_atomic_set(&variant->jit_function[i],
+                      variant->optimized->jit_function[i]);
+      }
+
+      variant->nr_instrs += variant->optimized->nr_instrs;
+      lp->nr_fs_instrs += variant->optimized->nr_instrs;
+
+      if (gallivm_debug & GALLIVM_DEBUG_PERF) {
+         debug_printf("llvmpipe: fs #%u variant %u optimized after %u draws\n",
+                      variant->shader->no, variant->no, variant->draws);
+      }
+      break;
+   }
 }
 
 
@@ -3078,8 +3287,22 @@ llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
                    lp->nr_fs_variants, variant->nr_instrs, lp->nr_fs_instrs);
    }
 
+   if (variant->tier == LP_FS_TIER_COMPILING) {
+      struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
+      util_queue_drop_job(&screen->fs_compile_queue, &variant->tier_up_fence);
+   }
+   util_queue_fence_destroy(&variant->tier_up_fence);
+
+   if (variant->optimized) {
+      gallivm_destroy(variant->optimized->gallivm);
+      FREE(variant->optimized);
+   }
+
    gallivm_destroy(variant->gallivm);
 
+   if (lp->fs_variant == variant)
+      lp->fs_variant = NULL;
+
    /* remove from shader's list */
    remove_from_list(&variant->list_item_local);
    variant->shader->variants_cached--;
@@ -3587,6 +3810,7 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
    }
 
    /* Bind this variant */
+   lp->fs_variant = variant;
    lp_setup_set_fs_variant(lp->setup, variant);
 }
 
@@ -32,6 +32,7 @@
 
 #include "pipe/p_compiler.h"
 #include "pipe/p_state.h"
+#include "util/u_queue.h"
 #include "tgsi/tgsi_scan.h" /* for tgsi_shader_info */
 #include "gallivm/lp_bld_sample.h" /* for struct lp_sampler_static_state */
 #include "gallivm/lp_bld_tgsi.h" /* for lp_tgsi_info */
@@ -112,6 +113,23 @@ lp_fs_variant_key_images(struct lp_fragment_shader_variant_key *key)
       &key->samplers[key->nr_samplers];
 }
 
+/**
+ * Variants are first compiled quickly so that drawing can start right away,
+ * and the ones that keep being used are recompiled with all optimizations
+ * in the background.
+ */
+enum lp_fs_variant_tier
+{
+   LP_FS_TIER_OPTIMIZED,   /**< final code */
+   LP_FS_TIER_FAST,        /**< quickly compiled code, counting draws */
+   LP_FS_TIER_COMPILING,   /**< optimized code on the compile queue */
+};
+
+/** How a variant writes depth, for the rasterizer's coarse depth test */
+#define LP_HIZ_WRITE_NONE     0  /**< depth buffer isn't written */
+#define LP_HIZ_WRITE_INTERP   1  /**< interpolated depth is written */
+#define LP_HIZ_WRITE_SHADER   2  /**< shader computed depth is written */
+
 /** doubly-linked list item */
 struct lp_fs_variant_list_item
 {
@@ -125,6 +143,13 @@ struct lp_fragment_shader_variant
 
    boolean opaque;
 
+   /**
+    * Depth func the rasterizer may reject blocks with before running the
+    * shader, or PIPE_FUNC_ALWAYS if that would skip side effects.
+    */
+   unsigned hiz_func:3;
+   unsigned hiz_write:2;   /**< LP_HIZ_WRITE_x */
+
    struct gallivm_state *gallivm;
 
    LLVMTypeRef jit_context_ptr_type;
@@ -138,6 +163,15 @@ struct lp_fragment_shader_variant
    /* Total number of LLVM instructions generated */
    unsigned nr_instrs;
 
+   enum lp_fs_variant_tier tier;
+   unsigned draws;
+   struct util_queue_fence tier_up_fence;
+   /* Holds the optimized code.  Both this and the quickly compiled code
+    * are kept until the variant is deleted, as scenes in flight may still
+    * run the latter.
+    */
+   struct lp_fragment_shader_variant *optimized;
+
    struct lp_fs_variant_list_item list_item_global, list_item_local;
    struct lp_fragment_shader *shader;
 
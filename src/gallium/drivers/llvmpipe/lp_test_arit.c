@@ -39,6 +39,8 @@
 #include "gallivm/lp_bld_debug.h"
 #include "gallivm/lp_bld_init.h"
 #include "gallivm/lp_bld_arit.h"
+#include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_flow.h"
 
 #include "lp_test.h"
 
@@ -48,7 +50,11 @@ write_tsv_header(FILE *fp)
 {
    fprintf(fp,
            "result\t"
-           "format\n");
+           "function\t"
+           "precision\t"
+           "max_ulp\t"
+           "min_bits\t"
+           "cycles_per_value\n");
 
    fflush(fp);
 }
@@ -289,6 +295,34 @@ const float fract_values[] = {
 };
 
 
+static LLVMValueRef
+build_exp2_mediump(struct lp_build_context *bld, LLVMValueRef a)
+{
+   return lp_build_exp2_prec(bld, a, GALLIVM_PRECISION_MEDIUM);
+}
+
+
+static LLVMValueRef
+build_log2_mediump(struct lp_build_context *bld, LLVMValueRef a)
+{
+   return lp_build_log2_safe_prec(bld, a, GALLIVM_PRECISION_MEDIUM);
+}
+
+
+static LLVMValueRef
+build_sin_mediump(struct lp_build_context *bld, LLVMValueRef a)
+{
+   return lp_build_sin_prec(bld, a, GALLIVM_PRECISION_MEDIUM);
+}
+
+
+static LLVMValueRef
+build_cos_mediump(struct lp_build_context *bld, LLVMValueRef a)
+{
+   return lp_build_cos_prec(bld, a, GALLIVM_PRECISION_MEDIUM);
+}
+
+
 /*
  * Unary test cases.
  */
@@ -306,6 +340,10 @@ unary_tests[] = {
    {"rsqrt", &lp_build_rsqrt, &rsqrtf, rsqrt_values, ARRAY_SIZE(rsqrt_values), 20.0 },
    {"sin", &lp_build_sin, &sinf, sincos_values, ARRAY_SIZE(sincos_values), 20.0 },
    {"cos", &lp_build_cos, &cosf, sincos_values, ARRAY_SIZE(sincos_values), 20.0 },
+   {"exp2_mediump", &build_exp2_mediump, &exp2f, exp2_values, ARRAY_SIZE(exp2_values), 11.0 },
+   {"log2_mediump", &build_log2_mediump, &log2f, log2_values, ARRAY_SIZE(log2_values), 11.0 },
+   {"sin_mediump", &build_sin_mediump, &sinf, sincos_values, ARRAY_SIZE(sincos_values), 11.0 },
+   {"cos_mediump", &build_cos_mediump, &cosf, sincos_values, ARRAY_SIZE(sincos_values), 11.0 },
    {"sgn", &lp_build_sgn, &sgnf, sgn_values, ARRAY_SIZE(sgn_values), 20.0 },
    {"round", &lp_build_round, &nearbyintf, round_values, ARRAY_SIZE(round_values), 24.0 },
    {"trunc", &lp_build_trunc, &truncf, round_values, ARRAY_SIZE(round_values), 24.0 },
@@ -498,14 +536,234 @@ test_unary(unsigned verbose, FILE *fp, const struct unary_test_t *test, unsigned
 }
 
 
+#define SWEEP_NUM_VALUES 4096
+
+typedef void (*sweep_func_t)(float *out, const float *in, int32_t count);
+
+
+/**
+ * Describe a dense error / throughput sweep of one transcendental function
+ * at both precision levels.
+ */
+struct sweep_test_t
+{
+   const char *name;
+
+   LLVMValueRef
+   (*builder)(struct lp_build_context *bld, LLVMValueRef a,
+              enum gallivm_precision precision);
+
+   float
+   (*ref)(float a);
+
+   /*
+    * Input range, sampled geometrically if log_scale is set.
+    */
+   float min, max;
+   boolean log_scale;
+
+   /*
+    * Errors are measured relative to max(|ref|, abs_floor), so a non-zero
+    * floor measures absolute error near the zeros of the function.
+    */
+   double abs_floor;
+
+   /*
+    * Required precision in bits, indexed by enum gallivm_precision.
+    */
+   double precision[2];
+};
+
+
+static LLVMValueRef
+build_pow_2_2(struct lp_build_context *bld, LLVMValueRef a,
+              enum gallivm_precision precision)
+{
+   return lp_build_pow_prec(bld, a,
+                            lp_build_const_vec(bld->gallivm, bld->type, 2.2),
+                            precision);
+}
+
+
+static float powf_2_2(float x)
+{
+   return powf(x, 2.2f);
+}
+
+
+static const struct sweep_test_t
+sweep_tests[] = {
+   {"exp2", &lp_build_exp2_prec, &exp2f, -16.0f, 16.0f, FALSE, 0.0, { 18.0, 12.0 } },
+   {"log2", &lp_build_log2_prec, &log2f, 1e-6f, 1e6f, TRUE, 1.0, { 20.0, 14.0 } },
+   {"sin", &lp_build_sin_prec, &sinf, -16.0f, 16.0f, FALSE, 1.0, { 20.0, 14.0 } },
+   {"cos", &lp_build_cos_prec, &cosf, -16.0f, 16.0f, FALSE, 1.0, { 20.0, 13.0 } },
+   {"pow2.2", &build_pow_2_2, &powf_2_2, 1e-3f, 1.0f, TRUE, 0.0, { 16.0, 11.0 } },
+};
+
+
+/*
+ * Build LLVM function applying the builder to count vectors.
+ */
+static LLVMValueRef
+build_sweep_test_func(struct gallivm_state *gallivm,
+                      const struct sweep_test_t *test,
+                      enum gallivm_precision precision,
+                      unsigned length,
+                      const char *test_name)
+{
+   struct lp_type type = lp_type_float_vec(32, length * 32);
+   LLVMContextRef context = gallivm->context;
+   LLVMModuleRef module = gallivm->module;
+   LLVMTypeRef vf32t = lp_build_vec_type(gallivm, type);
+   LLVMTypeRef args[3] = { LLVMPointerType(vf32t, 0), LLVMPointerType(vf32t, 0),
+                           LLVMInt32TypeInContext(context) };
+   LLVMValueRef func = LLVMAddFunction(module, test_name,
+                                       LLVMFunctionType(LLVMVoidTypeInContext(context),
+                                                        args, ARRAY_SIZE(args), 0));
+   LLVMValueRef out_ptr = LLVMGetParam(func, 0);
+   LLVMValueRef in_ptr = LLVMGetParam(func, 1);
+   LLVMValueRef count = LLVMGetParam(func, 2);
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMBasicBlockRef block = LLVMAppendBasicBlockInContext(context, func, "entry");
+   struct lp_build_loop_state loop;
+   LLVMValueRef in, out;
+
+   struct lp_build_context bld;
+
+   lp_build_context_init(&bld, gallivm, type);
+
+   LLVMSetFunctionCallConv(func, LLVMCCallConv);
+
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   lp_build_loop_begin(&loop, gallivm, lp_build_const_int32(gallivm, 0));
+   {
+      in = LLVMBuildLoad(builder,
+                         LLVMBuildGEP(builder, in_ptr, &loop.counter, 1, ""), "");
+      out = test->builder(&bld, in, precision);
+      LLVMBuildStore(builder, out,
+                     LLVMBuildGEP(builder, out_ptr, &loop.counter, 1, ""));
+   }
+   lp_build_loop_end_cond(&loop, count, NULL, LLVMIntUGE);
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, func);
+
+   return func;
+}
+
+
+/*
+ * Measure the worst error (in ulps and in bits) over a dense sweep of the
+ * input range, and the throughput of the generated code.
+ */
+PIPE_ALIGN_STACK
+static boolean
+test_sweep(unsigned verbose, FILE *fp, const struct sweep_test_t *test,
+           enum gallivm_precision precision, unsigned length)
+{
+   const char *precision_name =
+      precision == GALLIVM_PRECISION_MEDIUM ? "medium" : "full";
+   char test_name[128];
+   LLVMContextRef context;
+   struct gallivm_state *gallivm;
+   LLVMValueRef test_func;
+   sweep_func_t test_func_jit;
+   int64_t cycles_min = INT64_MAX;
+   double max_ulp = 0.0;
+   double min_bits = FLT_MANT_DIG;
+   float worst = 0.0f;
+   boolean success;
+   unsigned i;
+   float *in, *out;
+
+   snprintf(test_name, sizeof test_name, "%s.%s.v%u",
+            test->name, precision_name, length);
+
+   in = align_malloc(SWEEP_NUM_VALUES * sizeof(float), 64);
+   out = align_malloc(SWEEP_NUM_VALUES * sizeof(float), 64);
+
+   for (i = 0; i < SWEEP_NUM_VALUES; i++) {
+      double t = (i + 0.5) / SWEEP_NUM_VALUES;
+      if (test->log_scale)
+         in[i] = test->min * pow(test->max / test->min, t);
+      else
+         in[i] = test->min + (test->max - test->min) * t;
+   }
+
+   context = LLVMContextCreate();
+   gallivm = gallivm_create("test_module", context);
+
+   test_func = build_sweep_test_func(gallivm, test, precision, length, test_name);
+
+   gallivm_compile_module(gallivm);
+
+   test_func_jit = (sweep_func_t) gallivm_jit_function(gallivm, test_func);
+
+   gallivm_free_ir(gallivm);
+
+   for (i = 0; i < LP_TEST_NUM_SAMPLES; i++) {
+      int64_t start_counter = rdtsc();
+      test_func_jit(out, in, SWEEP_NUM_VALUES / length);
+      int64_t end_counter = rdtsc();
+
+      cycles_min = MIN2(cycles_min, end_counter - start_counter);
+   }
+
+   for (i = 0; i < SWEEP_NUM_VALUES; i++) {
+      float ref = test->ref(in[i]);
+      double error = fabs((double)out[i] - ref);
+      double scale = MAX2(fabs(ref), test->abs_floor);
+      double ulp = nextafterf(fabsf(ref), INFINITY) - fabsf(ref);
+      double bits = error ? -log2(error / scale) : FLT_MANT_DIG;
+
+      max_ulp = MAX2(max_ulp, error / ulp);
+      if (bits < min_bits) {
+         min_bits = bits;
+         worst = in[i];
+      }
+   }
+
+   success = min_bits >= test->precision[precision];
+
+   if (!success || verbose) {
+      printf("%s: max error = %.1f ulp, precision = %f bits (at %.9g), "
+             "%.2f cycles/value, %s\n",
+             test_name, max_ulp, min_bits, worst,
+             (double)cycles_min / SWEEP_NUM_VALUES,
+             success ? "PASS" : "FAIL");
+      fflush(stdout);
+   }
+
+   if (fp) {
+      fprintf(fp, "%s\t", success ? "pass" : "fail");
+      fprintf(fp, "%s\t", test->name);
+      fprintf(fp, "%s\t", precision_name);
+      fprintf(fp, "%.1f\t", max_ulp);
+      fprintf(fp, "%.2f\t", min_bits);
+      fprintf(fp, "%.2f\n", (double)cycles_min / SWEEP_NUM_VALUES);
+      fflush(fp);
+   }
+
+   gallivm_destroy(gallivm);
+   LLVMContextDispose(context);
+
+   align_free(in);
+   align_free(out);
+
+   return success;
+}
+
+
 boolean
 test_all(unsigned verbose, FILE *fp)
 {
+   unsigned max_length = lp_native_vector_width / 32;
    boolean success = TRUE;
    int i;
 
    for (i = 0; i < ARRAY_SIZE(unary_tests); ++i) {
-      unsigned max_length = lp_native_vector_width / 32;
       unsigned length;
       for (length = 1; length <= max_length; length *= 2) {
          if (!test_unary(verbose, fp, &unary_tests[i], length)) {
@@ -514,6 +772,17 @@ test_all(unsigned verbose, FILE *fp)
       }
    }
 
+   for (i = 0; i < ARRAY_SIZE(sweep_tests); ++i) {
+      if (!test_sweep(verbose, fp, &sweep_tests[i],
+                      GALLIVM_PRECISION_FULL, max_length)) {
+         success = FALSE;
+      }
+      if (!test_sweep(verbose, fp, &sweep_tests[i],
+                      GALLIVM_PRECISION_MEDIUM, max_length)) {
+         success = FALSE;
+      }
+   }
+
    return success;
 }
 
@@ -64,7 +64,8 @@ write_tsv_header(FILE *fp)
            "rgb_dst_factor\t"
            "alpha_func\t"
            "alpha_src_factor\t"
-           "alpha_dst_factor\n");
+           "alpha_dst_factor\t"
+           "vector_width\n");
 
    fflush(fp);
 }
@@ -94,7 +95,7 @@ write_tsv_row(FILE *fp,
            blend->rt[0].rgb_dst_factor != blend->rt[0].alpha_dst_factor ? "true" : "false");
 
    fprintf(fp,
-           "%s\t%s\t%s\t%s\t%s\t%s\n",
+           "%s\t%s\t%s\t%s\t%s\t%s\t",
            util_str_blend_func(blend->rt[0].rgb_func, TRUE),
            util_str_blend_factor(blend->rt[0].rgb_src_factor, TRUE),
            util_str_blend_factor(blend->rt[0].rgb_dst_factor, TRUE),
@@ -102,6 +103,8 @@ write_tsv_row(FILE *fp,
            util_str_blend_factor(blend->rt[0].alpha_src_factor, TRUE),
            util_str_blend_factor(blend->rt[0].alpha_dst_factor, TRUE));
 
+   fprintf(fp, "%u\n", lp_native_vector_width);
+
    fflush(fp);
 }
 
@@ -0,0 +1,630 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR THEIR SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Compute shader micro-benchmarks: checks the results of a few small
+ * kernels and reports how dispatch time scales with the number of
+ * compute threads.
+ */
+
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "tgsi/tgsi_text.h"
+#include "util/os_time.h"
+#include "util/u_box.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "sw/null/null_sw_winsys.h"
+
+#include "lp_public.h"
+#include "lp_screen.h"
+#include "lp_cs_tpool.h"
+#include "lp_limits.h"
+#include "lp_test.h"
+
+
+#define COMPUTE_TEST_ITERATIONS 8
+
+#define SAXPY_SIZE (1 << 20)
+#define REDUCE_SIZE (1 << 20)
+#define REDUCE_BLOCK 64
+#define FILTER_SIZE 1024
+#define FILTER_BLOCK 8
+
+
+struct compute_test;
+
+/**
+ * Describe one compute micro-benchmark.
+ */
+struct compute_kernel
+{
+   const char *name;
+
+   /* TGSI text, with the x block size as printf argument. */
+   const char *text;
+
+   unsigned block[3];
+   unsigned grid[3];
+   unsigned req_local_mem;
+
+   /* Create and bind resources, and fill them with the initial data. */
+   void (*setup)(struct compute_test *test);
+
+   /* Check the results of a single dispatch after setup. */
+   boolean (*check)(struct compute_test *test);
+};
+
+
+struct compute_test
+{
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+   const struct compute_kernel *kernel;
+   struct pipe_resource *res[2];
+   float *src;
+};
+
+
+static const char saxpy_text[] =
+   "COMP\n"
+   "PROPERTY CS_FIXED_BLOCK_WIDTH %u\n"
+   "PROPERTY CS_FIXED_BLOCK_HEIGHT 1\n"
+   "PROPERTY CS_FIXED_BLOCK_DEPTH 1\n"
+   "DCL SV[0], THREAD_ID\n"
+   "DCL SV[1], BLOCK_ID\n"
+   "DCL BUFFER[0]\n"
+   "DCL BUFFER[1]\n"
+   "DCL TEMP[0..2], LOCAL\n"
+   "IMM[0] UINT32 { %u, 4, 0, 0 }\n"
+   "IMM[1] FLT32 { 2.0, 0.0, 0.0, 0.0 }\n"
+   "UMAD TEMP[0].x, SV[1].xxxx, IMM[0].xxxx, SV[0].xxxx\n"
+   "UMUL TEMP[0].x, TEMP[0].xxxx, IMM[0].yyyy\n"
+   "LOAD TEMP[1].x, BUFFER[0], TEMP[0].xxxx\n"
+   "LOAD TEMP[2].x, BUFFER[1], TEMP[0].xxxx\n"
+   "MAD TEMP[2].x, IMM[1].xxxx, TEMP[1].xxxx, TEMP[2].xxxx\n"
+   "STORE BUFFER[1].x, TEMP[0].xxxx, TEMP[2].xxxx\n"
+   "END\n";
+
+
+/* Same as saxpy, but the barrier forces the coroutine path. */
+static const char saxpy_barrier_text[] =
+   "COMP\n"
+   "PROPERTY CS_FIXED_BLOCK_WIDTH %u\n"
+   "PROPERTY CS_FIXED_BLOCK_HEIGHT 1\n"
+   "PROPERTY CS_FIXED_BLOCK_DEPTH 1\n"
+   "DCL SV[0], THREAD_ID\n"
+   "DCL SV[1], BLOCK_ID\n"
+   "DCL BUFFER[0]\n"
+   "DCL BUFFER[1]\n"
+   "DCL TEMP[0..2], LOCAL\n"
+   "IMM[0] UINT32 { %u, 4, 0, 0 }\n"
+   "IMM[1] FLT32 { 2.0, 0.0, 0.0, 0.0 }\n"
+   "UMAD TEMP[0].x, SV[1].xxxx, IMM[0].xxxx, SV[0].xxxx\n"
+   "UMUL TEMP[0].x, TEMP[0].xxxx, IMM[0].yyyy\n"
+   "LOAD TEMP[1].x, BUFFER[0], TEMP[0].xxxx\n"
+   "LOAD TEMP[2].x, BUFFER[1], TEMP[0].xxxx\n"
+   "BARRIER\n"
+   "MAD TEMP[2].x, IMM[1].xxxx, TEMP[1].xxxx, TEMP[2].xxxx\n"
+   "STORE BUFFER[1].x, TEMP[0].xxxx, TEMP[2].xxxx\n"
+   "END\n";
+
+
+/* Tree reduction of each work group in shared memory. */
+static const char reduce_text[] =
+   "COMP\n"
+   "PROPERTY CS_FIXED_BLOCK_WIDTH %u\n"
+   "PROPERTY CS_FIXED_BLOCK_HEIGHT 1\n"
+   "PROPERTY CS_FIXED_BLOCK_DEPTH 1\n"
+   "DCL SV[0], THREAD_ID\n"
+   "DCL SV[1], BLOCK_ID\n"
+   "DCL BUFFER[0]\n"
+   "DCL BUFFER[1]\n"
+   "DCL MEMORY[0], SHARED\n"
+   "DCL TEMP[0..4], LOCAL\n"
+   "IMM[0] UINT32 { %u, 4, 0, 1 }\n"
+   "UMAD TEMP[0].x, SV[1].xxxx, IMM[0].xxxx, SV[0].xxxx\n"
+   "UMUL TEMP[0].x, TEMP[0].xxxx, IMM[0].yyyy\n"
+   "UMUL TEMP[0].y, SV[0].xxxx, IMM[0].yyyy\n"
+   "LOAD TEMP[1].x, BUFFER[0], TEMP[0].xxxx\n"
+   "STORE MEMORY[0].x, TEMP[0].yyyy, TEMP[1].xxxx\n"
+   "BARRIER\n"
+   "USHR TEMP[2].x, IMM[0].xxxx, IMM[0].wwww\n"
+   "BGNLOOP\n"
+   "  USLT TEMP[3].x, SV[0].xxxx, TEMP[2].xxxx\n"
+   "  UIF TEMP[3].xxxx\n"
+   "    UMAD TEMP[3].y, TEMP[2].xxxx, IMM[0].yyyy, TEMP[0].yyyy\n"
+   "    LOAD TEMP[4].x, MEMORY[0], TEMP[0].yyyy\n"
+   "    LOAD TEMP[4].y, MEMORY[0], TEMP[3].yyyy\n"
+   "    ADD TEMP[4].x, TEMP[4].xxxx, TEMP[4].yyyy\n"
+   "    STORE MEMORY[0].x, TEMP[0].yyyy, TEMP[4].xxxx\n"
+   "  ENDIF\n"
+   "  BARRIER\n"
+   "  USHR TEMP[2].x, TEMP[2].xxxx, IMM[0].wwww\n"
+   "  USEQ TEMP[3].x, TEMP[2].xxxx, IMM[0].zzzz\n"
+   "  UIF TEMP[3].xxxx\n"
+   "    BRK\n"
+   "  ENDIF\n"
+   "ENDLOOP\n"
+   "USEQ TEMP[3].x, SV[0].xxxx, IMM[0].zzzz\n"
+   "UIF TEMP[3].xxxx\n"
+   "  LOAD TEMP[4].x, MEMORY[0], IMM[0].zzzz\n"
+   "  UMUL TEMP[3].y, SV[1].xxxx, IMM[0].yyyy\n"
+   "  STORE BUFFER[1].x, TEMP[3].yyyy, TEMP[4].xxxx\n"
+   "ENDIF\n"
+   "END\n";
+
+
+/*
+ * 3x3 box filter, dst(x, y) is the average of src(x..x+2, y..y+2) so
+ * that no load goes out of bounds.
+ */
+static const char filter_text[] =
+   "COMP\n"
+   "PROPERTY CS_FIXED_BLOCK_WIDTH %u\n"
+   "PROPERTY CS_FIXED_BLOCK_HEIGHT 8\n"
+   "PROPERTY CS_FIXED_BLOCK_DEPTH 1\n"
+   "DCL SV[0], THREAD_ID\n"
+   "DCL SV[1], BLOCK_ID\n"
+   "DCL IMAGE[0], 2D, PIPE_FORMAT_R32_FLOAT\n"
+   "DCL IMAGE[1], 2D, PIPE_FORMAT_R32_FLOAT, WR\n"
+   "DCL TEMP[0..3], LOCAL\n"
+   "IMM[0] UINT32 { %u, 8, 0, 0 }\n"
+   "IMM[1] UINT32 { 0, 1, 2, 0 }\n"
+   "IMM[2] FLT32 { 0.0, 0.111111111, 0.0, 0.0 }\n"
+   "UMAD TEMP[0].xy, SV[1].xyyy, IMM[0].xyyy, SV[0].xyyy\n"
+   "MOV TEMP[2].x, IMM[2].xxxx\n"
+   "UADD TEMP[1].xy, TEMP[0].xyyy, IMM[1].xxxx\n"
+   "LOAD TEMP[3].x, IMAGE[0], TEMP[1].xyyy, 2D, PIPE_FORMAT_R32_FLOAT\n"
+   "ADD TEMP[2].x, TEMP[2].xxxx, TEMP[3].xxxx\n"
+   "UADD TEMP[1].xy, TEMP[0].xyyy, IMM[1].yxxx\n"
+   "LOAD TEMP[3].x, IMAGE[0], TEMP[1].xyyy, 2D, PIPE_FORMAT_R32_FLOAT\n"
+   "ADD TEMP[2].x, TEMP[2].xxxx, TEMP[3].xxxx\n"
+   "UADD TEMP[1].xy, TEMP[0].xyyy, IMM[1].zxxx\n"
+   "LOAD TEMP[3].x, IMAGE[0], TEMP[1].xyyy, 2D, PIPE_FORMAT_R32_FLOAT\n"
+   "ADD TEMP[2].x, TEMP[2].xxxx, TEMP[3].xxxx\n"
+   "UADD TEMP[1].xy, TEMP[0].xyyy, IMM[1].xyyy\n"
+   "LOAD TEMP[3].x, IMAGE[0], TEMP[1].xyyy, 2D, PIPE_FORMAT_R32_FLOAT\n"
+   "ADD TEMP[2].x, TEMP[2].xxxx, TEMP[3].xxxx\n"
+   "UADD TEMP[1].xy, TEMP[0].xyyy, IMM[1].yyyy\n"
+   "LOAD TEMP[3].x, IMAGE[0], TEMP[1].xyyy, 2D, PIPE_FORMAT_R32_FLOAT\n"
+   "ADD TEMP[2].x, TEMP[2].xxxx, TEMP[3].xxxx\n"
+   "UADD TEMP[1].xy, TEMP[0].xyyy, IMM[1].zyyy\n"
+   "LOAD TEMP[3].x, IMAGE[0], TEMP[1].xyyy, 2D, PIPE_FORMAT_R32_FLOAT\n"
+   "ADD TEMP[2].x, TEMP[2].xxxx, TEMP[3].xxxx\n"
+   "UADD TEMP[1].xy, TEMP[0].xyyy, IMM[1].xzzz\n"
+   "LOAD TEMP[3].x, IMAGE[0], TEMP[1].xyyy, 2D, PIPE_FORMAT_R32_FLOAT\n"
+   "ADD TEMP[2].x, TEMP[2].xxxx, TEMP[3].xxxx\n"
+   "UADD TEMP[1].xy, TEMP[0].xyyy, IMM[1].yzzz\n"
+   "LOAD TEMP[3].x, IMAGE[0], TEMP[1].xyyy, 2D, PIPE_FORMAT_R32_FLOAT\n"
+   "ADD TEMP[2].x, TEMP[2].xxxx, TEMP[3].xxxx\n"
+   "UADD TEMP[1].xy, TEMP[0].xyyy, IMM[1].zzzz\n"
+   "LOAD TEMP[3].x, IMAGE[0], TEMP[1].xyyy, 2D, PIPE_FORMAT_R32_FLOAT\n"
+   "ADD TEMP[2].x, TEMP[2].xxxx, TEMP[3].xxxx\n"
+   "MUL TEMP[2].x, TEMP[2].xxxx, IMM[2].yyyy\n"
+   "STORE IMAGE[1], TEMP[0].xyyy, TEMP[2].xxxx, 2D, PIPE_FORMAT_R32_FLOAT\n"
+   "END\n";
+
+
+static struct pipe_resource *
+create_buffer(struct compute_test *test, const float *data, unsigned size)
+{
+   struct pipe_resource *res;
+
+   res = pipe_buffer_create(test->screen, PIPE_BIND_SHADER_BUFFER,
+                            PIPE_USAGE_DEFAULT, size);
+   if (data)
+      pipe_buffer_write(test->pipe, res, 0, size, data);
+   return res;
+}
+
+
+static void
+bind_buffers(struct compute_test *test, unsigned size0, unsigned size1)
+{
+   struct pipe_shader_buffer sb[2];
+
+   memset(sb, 0, sizeof sb);
+   sb[0].buffer = test->res[0];
+   sb[0].buffer_size = size0;
+   sb[1].buffer = test->res[1];
+   sb[1].buffer_size = size1;
+   test->pipe->set_shader_buffers(test->pipe, PIPE_SHADER_COMPUTE, 0, 2,
+                                  sb, 0x2);
+}
+
+
+static void
+saxpy_setup(struct compute_test *test)
+{
+   unsigned i;
+
+   test->src = MALLOC(2 * SAXPY_SIZE * sizeof(float));
+   for (i = 0; i < 2 * SAXPY_SIZE; i++)
+      test->src[i] = (float)(i % 61);
+
+   test->res[0] = create_buffer(test, test->src, SAXPY_SIZE * sizeof(float));
+   test->res[1] = create_buffer(test, test->src + SAXPY_SIZE,
+                                SAXPY_SIZE * sizeof(float));
+   bind_buffers(test, SAXPY_SIZE * sizeof(float), SAXPY_SIZE * sizeof(float));
+}
+
+
+static boolean
+saxpy_check(struct compute_test *test)
+{
+   float *out = MALLOC(SAXPY_SIZE * sizeof(float));
+   boolean success = TRUE;
+   unsigned i;
+
+   pipe_buffer_read(test->pipe, test->res[1], 0, SAXPY_SIZE * sizeof(float), out);
+   for (i = 0; i < SAXPY_SIZE; i++) {
+      float ref = 2.0f * test->src[i] + test->src[SAXPY_SIZE + i];
+      if (out[i] != ref) {
+         fprintf(stderr, "%s: [%u] got %f, expected %f\n",
+                 test->kernel->name, i, out[i], ref);
+         success = FALSE;
+         break;
+      }
+   }
+   FREE(out);
+   return success;
+}
+
+
+static void
+reduce_setup(struct compute_test *test)
+{
+   unsigned i;
+
+   /* small integers so that the sums are exact in any order */
+   test->src = MALLOC(REDUCE_SIZE * sizeof(float));
+   for (i = 0; i < REDUCE_SIZE; i++)
+      test->src[i] = (float)(i % 13);
+
+   test->res[0] = create_buffer(test, test->src, REDUCE_SIZE * sizeof(float));
+   test->res[1] = create_buffer(test, NULL,
+                                REDUCE_SIZE / REDUCE_BLOCK * sizeof(float));
+   bind_buffers(test, REDUCE_SIZE * sizeof(float),
+                REDUCE_SIZE / REDUCE_BLOCK * sizeof(float));
+}
+
+
+static boolean
+reduce_check(struct compute_test *test)
+{
+   const unsigned num_sums = REDUCE_SIZE / REDUCE_BLOCK;
+   float *out = MALLOC(num_sums * sizeof(float));
+   boolean success = TRUE;
+   unsigned i, j;
+
+   pipe_buffer_read(test->pipe, test->res[1], 0, num_sums * sizeof(float), out);
+   for (i = 0; i < num_sums; i++) {
+      float ref = 0.0f;
+      for (j = 0; j < REDUCE_BLOCK; j++)
+         ref += test->src[i * REDUCE_BLOCK + j];
+      if (out[i] != ref) {
+         fprintf(stderr, "%s: [%u] got %f, expected %f\n",
+                 test->kernel->name, i, out[i], ref);
+         success = FALSE;
+         break;
+      }
+   }
+   FREE(out);
+   return success;
+}
+
+
+static struct pipe_resource *
+create_image(struct compute_test *test, const float *data,
+             unsigned width, unsigned height)
+{
+   struct pipe_resource templ;
+   struct pipe_resource *res;
+
+   memset(&templ, 0, sizeof templ);
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = PIPE_FORMAT_R32_FLOAT;
+   templ.width0 = width;
+   templ.height0 = height;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.bind = PIPE_BIND_SHADER_IMAGE;
+   res = test->screen->resource_create(test->screen, &templ);
+
+   if (data) {
+      struct pipe_box box;
+      u_box_2d(0, 0, width, height, &box);
+      test->pipe->texture_subdata(test->pipe, res, 0, PIPE_TRANSFER_WRITE,
+                                  &box, data, width * sizeof(float), 0);
+   }
+   return res;
+}
+
+
+static void
+filter_setup(struct compute_test *test)
+{
+   const unsigned src_size = FILTER_SIZE + 2;
+   struct pipe_image_view images[2];
+   unsigned x, y, i;
+
+   test->src = MALLOC(src_size * src_size * sizeof(float));
+   for (y = 0; y < src_size; y++)
+      for (x = 0; x < src_size; x++)
+         test->src[y * src_size + x] = (float)((x * 7 + y * 13) % 32);
+
+   test->res[0] = create_image(test, test->src, src_size, src_size);
+   test->res[1] = create_image(test, NULL, FILTER_SIZE, FILTER_SIZE);
+
+   memset(images, 0, sizeof images);
+   for (i = 0; i < 2; i++) {
+      images[i].resource = test->res[i];
+      images[i].format = PIPE_FORMAT_R32_FLOAT;
+      images[i].access = images[i].shader_access =
+         i ? PIPE_IMAGE_ACCESS_WRITE : PIPE_IMAGE_ACCESS_READ;
+   }
+   test->pipe->set_shader_images(test->pipe, PIPE_SHADER_COMPUTE, 0, 2, images);
+}
+
+
+static boolean
+filter_check(struct compute_test *test)
+{
+   const unsigned src_size = FILTER_SIZE + 2;
+   struct pipe_transfer *transfer;
+   const uint8_t *map;
+   boolean success = TRUE;
+   unsigned x, y, i, j;
+
+   map = pipe_transfer_map(test->pipe, test->res[1], 0, 0, PIPE_TRANSFER_READ,
+                           0, 0, FILTER_SIZE, FILTER_SIZE, &transfer);
+   for (y = 0; y < FILTER_SIZE && success; y++) {
+      const float *row = (const float *)(map + y * transfer->stride);
+      for (x = 0; x < FILTER_SIZE; x++) {
+         float ref = 0.0f;
+         for (j = 0; j < 3; j++)
+            for (i = 0; i < 3; i++)
+               ref += test->src[(y + j) * src_size + x + i];
+         ref *= 0.111111111f;
+         if (fabsf(row[x] - ref) > 1e-5f * ref) {
+            fprintf(stderr, "%s: [%u, %u] got %f, expected %f\n",
+                    test->kernel->name, x, y, row[x], ref);
+            success = FALSE;
+            break;
+         }
+      }
+   }
+   pipe_transfer_unmap(test->pipe, transfer);
+   return success;
+}
+
+
+static const struct compute_kernel
+compute_kernels[] = {
+   { "saxpy", saxpy_text, { 8, 1, 1 }, { SAXPY_SIZE / 8, 1, 1 }, 0,
+     saxpy_setup, saxpy_check },
+   { "saxpy", saxpy_text, { 64, 1, 1 }, { SAXPY_SIZE / 64, 1, 1 }, 0,
+     saxpy_setup, saxpy_check },
+   { "saxpy_barrier", saxpy_barrier_text, { 64, 1, 1 }, { SAXPY_SIZE / 64, 1, 1 }, 0,
+     saxpy_setup, saxpy_check },
+   { "reduce", reduce_text, { REDUCE_BLOCK, 1, 1 }, { REDUCE_SIZE / REDUCE_BLOCK, 1, 1 },
+     REDUCE_BLOCK * sizeof(float), reduce_setup, reduce_check },
+   { "filter", filter_text, { FILTER_BLOCK, FILTER_BLOCK, 1 },
+     { FILTER_SIZE / FILTER_BLOCK, FILTER_SIZE / FILTER_BLOCK, 1 }, 0,
+     filter_setup, filter_check },
+};
+
+
+void
+write_tsv_header(FILE *fp)
+{
+   fprintf(fp,
+           "result\t"
+           "kernel\t"
+           "block\t"
+           "threads\t"
+           "usec_per_dispatch\t"
+           "speedup\n");
+
+   fflush(fp);
+}
+
+
+static void
+launch(struct compute_test *test)
+{
+   const struct compute_kernel *kernel = test->kernel;
+   struct pipe_grid_info info;
+
+   memset(&info, 0, sizeof info);
+   info.work_dim = 3;
+   memcpy(info.block, kernel->block, sizeof info.block);
+   memcpy(info.grid, kernel->grid, sizeof info.grid);
+   test->pipe->launch_grid(test->pipe, &info);
+}
+
+
+/*
+ * Replace the screen's compute thread pool. The thread launching the
+ * grid runs work groups too, so there is always one more thread than
+ * pool workers.
+ */
+static void
+set_num_threads(struct compute_test *test, unsigned num_threads)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(test->screen);
+
+   lp_cs_tpool_destroy(screen->cs_tpool);
+   screen->cs_tpool = lp_cs_tpool_create(num_threads - 1);
+}
+
+
+static boolean
+test_kernel(unsigned verbose, FILE *fp, struct compute_test *test,
+            const struct compute_kernel *kernel, unsigned max_threads)
+{
+   struct pipe_context *pipe = test->pipe;
+   struct tgsi_token tokens[1024];
+   struct pipe_compute_state cs;
+   char text[4096];
+   double usec_single = 0.0;
+   boolean success;
+   void *shader;
+   unsigned num_threads, i;
+
+   snprintf(text, sizeof text, kernel->text, kernel->block[0], kernel->block[0]);
+   if (!tgsi_text_translate(text, tokens, ARRAY_SIZE(tokens))) {
+      fprintf(stderr, "%s: failed to translate shader\n", kernel->name);
+      return FALSE;
+   }
+
+   memset(&cs, 0, sizeof cs);
+   cs.ir_type = PIPE_SHADER_IR_TGSI;
+   cs.prog = tokens;
+   cs.req_local_mem = kernel->req_local_mem;
+   shader = pipe->create_compute_state(pipe, &cs);
+   pipe->bind_compute_state(pipe, shader);
+
+   test->kernel = kernel;
+   kernel->setup(test);
+
+   set_num_threads(test, max_threads);
+   launch(test);
+   success = kernel->check(test);
+
+   /* powers of two, then the full thread count if it isn't one */
+   for (num_threads = 1; num_threads <= max_threads;
+        num_threads = num_threads == max_threads ? max_threads + 1 :
+                      MIN2(num_threads * 2, max_threads)) {
+      int64_t nsec_min = INT64_MAX;
+      double usec;
+
+      set_num_threads(test, num_threads);
+      for (i = 0; i < COMPUTE_TEST_ITERATIONS; i++) {
+         int64_t start = os_time_get_nano();
+         launch(test);
+         nsec_min = MIN2(nsec_min, os_time_get_nano() - start);
+      }
+
+      usec = nsec_min / 1000.0;
+      if (num_threads == 1)
+         usec_single = usec;
+
+      if (verbose >= 1) {
+         fprintf(stderr, "%s block=%u threads=%u: %.1f usec, %.2fx, %s\n",
+                 kernel->name, kernel->block[0] * kernel->block[1],
+                 num_threads, usec, usec_single / usec,
+                 success ? "PASS" : "FAIL");
+      }
+
+      if (fp) {
+         fprintf(fp, "%s\t", success ? "pass" : "fail");
+         fprintf(fp, "%s\t", kernel->name);
+         fprintf(fp, "%u\t", kernel->block[0] * kernel->block[1]);
+         fprintf(fp, "%u\t", num_threads);
+         fprintf(fp, "%.1f\t", usec);
+         fprintf(fp, "%.2f\n", usec_single / usec);
+         fflush(fp);
+      }
+   }
+
+   if (!success)
+      fprintf(stderr, "%s: FAIL\n", kernel->name);
+
+   pipe->bind_compute_state(pipe, NULL);
+   pipe->delete_compute_state(pipe, shader);
+   pipe->set_shader_buffers(pipe, PIPE_SHADER_COMPUTE, 0, 2, NULL, 0);
+   pipe->set_shader_images(pipe, PIPE_SHADER_COMPUTE, 0, 2, NULL);
+   for (i = 0; i < 2; i++)
+      pipe_resource_reference(&test->res[i], NULL);
+   FREE(test->src);
+   test->src = NULL;
+
+   return success;
+}
+
+
+static boolean
+test_kernels(unsigned verbose, FILE *fp, unsigned num_kernels)
+{
+   struct compute_test test;
+   unsigned max_threads;
+   boolean success = TRUE;
+   unsigned i;
+
+   memset(&test, 0, sizeof test);
+   test.screen = llvmpipe_create_screen(null_sw_create());
+   if (!test.screen)
+      return FALSE;
+   test.pipe = test.screen->context_create(test.screen, NULL, 0);
+
+   max_threads = MIN2(MAX2(util_cpu_caps.nr_cpus, 1), LP_MAX_THREADS + 1);
+
+   for (i = 0; i < num_kernels; i++) {
+      if (!test_kernel(verbose, fp, &test, &compute_kernels[i], max_threads))
+         success = FALSE;
+   }
+
+   test.pipe->destroy(test.pipe);
+   test.screen->destroy(test.screen);
+
+   return success;
+}
+
+
+boolean
+test_all(unsigned verbose, FILE *fp)
+{
+   return test_kernels(verbose, fp, ARRAY_SIZE(compute_kernels));
+}
+
+
+boolean
+test_some(unsigned verbose, FILE *fp,
+          unsigned long n)
+{
+   return test_all(verbose, fp);
+}
+
+
+boolean
+test_single(unsigned verbose, FILE *fp)
+{
+   return test_kernels(verbose, fp, 1);
+}
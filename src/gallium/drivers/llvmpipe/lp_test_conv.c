@@ -53,7 +53,8 @@ write_tsv_header(FILE *fp)
            "result\t"
            "cycles_per_channel\t"
            "src_type\t"
-           "dst_type\n");
+           "dst_type\t"
+           "vector_width\n");
 
    fflush(fp);
 }
@@ -74,7 +75,9 @@ write_tsv_row(FILE *fp,
    fprintf(fp, "\t");
 
    dump_type(fp, dst_type);
-   fprintf(fp, "\n");
+   fprintf(fp, "\t");
+
+   fprintf(fp, "%u\n", lp_native_vector_width);
 
    fflush(fp);
 }
@@ -173,6 +176,12 @@ test_one(unsigned verbose,
       return TRUE;
    }
 
+   /* 512bit vectors only when they are native */
+   if (MAX2(lp_type_width(src_type), lp_type_width(dst_type)) >
+       MAX2(lp_native_vector_width, 256)) {
+      return TRUE;
+   }
+
    /* Known failures
     * - fixed point 32 -> float 32
     * - float 32 -> signed normalised integer 32
@@ -352,6 +361,11 @@ const struct lp_type conv_types[] = {
    {   TRUE, FALSE, FALSE,  TRUE,    32,   8 },
    {   TRUE, FALSE, FALSE, FALSE,    32,   8 },
 
+   {   TRUE, FALSE,  TRUE,  TRUE,    32,  16 },
+   {   TRUE, FALSE,  TRUE, FALSE,    32,  16 },
+   {   TRUE, FALSE, FALSE,  TRUE,    32,  16 },
+   {   TRUE, FALSE, FALSE, FALSE,    32,  16 },
+
    /* Fixed */
    {  FALSE,  TRUE,  TRUE,  TRUE,    32,   4 },
    {  FALSE,  TRUE,  TRUE, FALSE,    32,   4 },
@@ -374,6 +388,11 @@ const struct lp_type conv_types[] = {
    {  FALSE, FALSE, FALSE,  TRUE,    32,   8 },
    {  FALSE, FALSE, FALSE, FALSE,    32,   8 },
 
+   {  FALSE, FALSE,  TRUE,  TRUE,    32,  16 },
+   {  FALSE, FALSE,  TRUE, FALSE,    32,  16 },
+   {  FALSE, FALSE, FALSE,  TRUE,    32,  16 },
+   {  FALSE, FALSE, FALSE, FALSE,    32,  16 },
+
    {  FALSE, FALSE,  TRUE,  TRUE,    16,   8 },
    {  FALSE, FALSE,  TRUE, FALSE,    16,   8 },
    {  FALSE, FALSE, FALSE,  TRUE,    16,   8 },
@@ -0,0 +1,504 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR THEIR SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+
+/**
+ * @file
+ * Coarse depth test differential test.
+ *
+ * Draws random depth tested triangles with random depth funcs, depth
+ * writes, depth clamp and depth clears in the middle of the frame, once
+ * with the per block depth ranges of the rasterizer and once with
+ * LP_PERF=no_hiz.  The color and depth buffers must be identical.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "tgsi/tgsi_text.h"
+#include "util/os_time.h"
+#include "util/u_format.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "sw/null/null_sw_winsys.h"
+
+#include "lp_debug.h"
+#include "lp_perf.h"
+#include "lp_public.h"
+#include "lp_test.h"
+
+
+#define HIZ_FB_SIZE 256
+
+/** Clears and draws per frame */
+#define HIZ_STEPS 24
+
+#define HIZ_TRIS_PER_DRAW 6
+
+#define HIZ_RUNS 10
+
+
+static const enum pipe_format hiz_formats[] = {
+   PIPE_FORMAT_Z16_UNORM,
+   PIPE_FORMAT_Z32_UNORM,
+   PIPE_FORMAT_Z32_FLOAT,
+   PIPE_FORMAT_Z24_UNORM_S8_UINT,
+};
+
+
+static const char vs_text[] =
+   "VERT\n"
+   "DCL IN[0]\n"
+   "DCL IN[1]\n"
+   "DCL OUT[0], POSITION\n"
+   "DCL OUT[1], COLOR\n"
+   "MOV OUT[0], IN[0]\n"
+   "MOV OUT[1], IN[1]\n"
+   "END\n";
+
+static const char fs_text[] =
+   "FRAG\n"
+   "DCL IN[0], COLOR, LINEAR\n"
+   "DCL OUT[0], COLOR\n"
+   "MOV OUT[0], IN[0]\n"
+   "END\n";
+
+
+struct hiz_test
+{
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+
+   /** Indexed by depth func, then by depth writemask */
+   void *dsa[8][2];
+   /** Indexed by depth clamp */
+   void *rast[2];
+
+   float vertices[HIZ_TRIS_PER_DRAW * 3][2][4];
+};
+
+
+void
+write_tsv_header(FILE *fp)
+{
+   fprintf(fp,
+           "result\t"
+           "format\t"
+           "run\t"
+           "msec_hiz\t"
+           "msec_no_hiz\n");
+
+   fflush(fp);
+}
+
+
+static void *
+create_shader(struct hiz_test *test, const char *text, boolean fragment)
+{
+   struct pipe_context *pipe = test->pipe;
+   struct tgsi_token tokens[256];
+   struct pipe_shader_state state;
+
+   if (!tgsi_text_translate(text, tokens, ARRAY_SIZE(tokens)))
+      return NULL;
+
+   pipe_shader_state_from_tgsi(&state, tokens);
+   return fragment ? pipe->create_fs_state(pipe, &state) :
+                     pipe->create_vs_state(pipe, &state);
+}
+
+
+/**
+ * Create the state objects the frames pick from and bind the rest.
+ */
+static boolean
+bind_state(struct hiz_test *test)
+{
+   struct pipe_context *pipe = test->pipe;
+   struct pipe_blend_state blend;
+   struct pipe_depth_stencil_alpha_state dsa;
+   struct pipe_rasterizer_state rast;
+   struct pipe_vertex_element velems[2];
+   struct pipe_vertex_buffer vbuf;
+   struct pipe_viewport_state vp;
+   void *vs, *fs;
+   unsigned func, i;
+
+   memset(&blend, 0, sizeof blend);
+   blend.rt[0].colormask = PIPE_MASK_RGBA;
+   pipe->bind_blend_state(pipe, pipe->create_blend_state(pipe, &blend));
+
+   for (func = 0; func < 8; func++) {
+      for (i = 0; i < 2; i++) {
+         memset(&dsa, 0, sizeof dsa);
+         dsa.depth.enabled = 1;
+         dsa.depth.func = func;
+         dsa.depth.writemask = i;
+         test->dsa[func][i] = pipe->create_depth_stencil_alpha_state(pipe, &dsa);
+      }
+   }
+
+   for (i = 0; i < 2; i++) {
+      memset(&rast, 0, sizeof rast);
+      rast.cull_face = PIPE_FACE_NONE;
+      rast.fill_front = PIPE_POLYGON_MODE_FILL;
+      rast.fill_back = PIPE_POLYGON_MODE_FILL;
+      rast.half_pixel_center = 1;
+      rast.bottom_edge_rule = 1;
+      rast.depth_clip_near = !i;
+      rast.depth_clip_far = !i;
+      test->rast[i] = pipe->create_rasterizer_state(pipe, &rast);
+   }
+
+   memset(velems, 0, sizeof velems);
+   velems[0].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   velems[1].src_offset = 4 * sizeof(float);
+   velems[1].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   pipe->bind_vertex_elements_state(pipe,
+      pipe->create_vertex_elements_state(pipe, 2, velems));
+
+   memset(&vbuf, 0, sizeof vbuf);
+   vbuf.stride = sizeof test->vertices[0];
+   vbuf.is_user_buffer = true;
+   vbuf.buffer.user = test->vertices;
+   pipe->set_vertex_buffers(pipe, 0, 1, &vbuf);
+
+   pipe->set_sample_mask(pipe, ~0);
+
+   vp.scale[0] = vp.scale[1] = HIZ_FB_SIZE * 0.5f;
+   vp.scale[2] = 0.5f;
+   vp.translate[0] = vp.translate[1] = HIZ_FB_SIZE * 0.5f;
+   vp.translate[2] = 0.5f;
+   pipe->set_viewport_states(pipe, 0, 1, &vp);
+
+   vs = create_shader(test, vs_text, FALSE);
+   fs = create_shader(test, fs_text, TRUE);
+   if (!vs || !fs)
+      return FALSE;
+   pipe->bind_vs_state(pipe, vs);
+   pipe->bind_fs_state(pipe, fs);
+
+   return TRUE;
+}
+
+
+static float
+random_range(float min, float max)
+{
+   return min + (max - min) * random_float();
+}
+
+
+/**
+ * Random triangles which mostly cover several tiles, with a flat color
+ * each and z reaching a bit beyond the near and far planes, so that both
+ * depth clipping and depth clamping have something to do.
+ */
+static void
+random_triangles(struct hiz_test *test)
+{
+   unsigned t, v, c;
+
+   for (t = 0; t < HIZ_TRIS_PER_DRAW; t++) {
+      float color[4];
+
+      for (c = 0; c < 4; c++)
+         color[c] = random_float();
+
+      for (v = 0; v < 3; v++) {
+         float (*vert)[4] = test->vertices[t * 3 + v];
+         vert[0][0] = random_range(-1.5f, 1.5f);
+         vert[0][1] = random_range(-1.5f, 1.5f);
+         vert[0][2] = random_range(-1.2f, 1.2f);
+         vert[0][3] = 1.0f;
+         memcpy(vert[1], color, sizeof color);
+      }
+   }
+}
+
+
+/**
+ * Draw a frame of random clears and triangles from the given seed, so that
+ * the same frame can be drawn again.  The frame starts with a clear, as
+ * the depth ranges are only known after one.
+ */
+static void
+draw_frame(struct hiz_test *test, unsigned seed)
+{
+   struct pipe_context *pipe = test->pipe;
+   struct pipe_fence_handle *fence = NULL;
+   union pipe_color_union clear_color;
+   struct pipe_draw_info info;
+   unsigned step;
+
+   srand(seed);
+
+   memset(&clear_color, 0, sizeof clear_color);
+   pipe->clear(pipe, PIPE_CLEAR_COLOR0 | PIPE_CLEAR_DEPTHSTENCIL,
+               &clear_color, random_float(), 0);
+
+   for (step = 0; step < HIZ_STEPS; step++) {
+      if (rand() % 6 == 0) {
+         /* Clear values at both ends are the ones HiZ can do most with */
+         static const double ends[] = { 0.0, 1.0 };
+         double depth = rand() % 2 ? ends[rand() % 2] : random_float();
+         pipe->clear(pipe, PIPE_CLEAR_DEPTH, NULL, depth, 0);
+         continue;
+      }
+
+      pipe->bind_depth_stencil_alpha_state(pipe,
+         test->dsa[rand() % 8][rand() % 4 != 0]);
+      pipe->bind_rasterizer_state(pipe, test->rast[rand() % 2]);
+
+      random_triangles(test);
+
+      memset(&info, 0, sizeof info);
+      info.mode = PIPE_PRIM_TRIANGLES;
+      info.count = HIZ_TRIS_PER_DRAW * 3;
+      info.instance_count = 1;
+      info.max_index = HIZ_TRIS_PER_DRAW * 3 - 1;
+      pipe->draw_vbo(pipe, &info);
+   }
+
+   pipe->flush(pipe, &fence, 0);
+   test->screen->fence_finish(test->screen, NULL, fence, PIPE_TIMEOUT_INFINITE);
+   test->screen->fence_reference(test->screen, &fence, NULL);
+}
+
+
+static void
+read_resource(struct hiz_test *test, struct pipe_resource *res, uint8_t *dst)
+{
+   const unsigned row_size = util_format_get_stride(res->format, HIZ_FB_SIZE);
+   struct pipe_transfer *transfer;
+   const uint8_t *map;
+   unsigned y;
+
+   map = pipe_transfer_map(test->pipe, res, 0, 0, PIPE_TRANSFER_READ,
+                           0, 0, HIZ_FB_SIZE, HIZ_FB_SIZE, &transfer);
+   for (y = 0; y < HIZ_FB_SIZE; y++)
+      memcpy(dst + y * row_size, map + y * transfer->stride, row_size);
+   pipe_transfer_unmap(test->pipe, transfer);
+}
+
+
+/**
+ * Report the first pixel where the two results differ.
+ */
+static boolean
+compare_resource(struct pipe_resource *res, const char *name,
+                 const uint8_t *hiz, const uint8_t *no_hiz)
+{
+   const unsigned bpp = util_format_get_blocksize(res->format);
+   const unsigned size = HIZ_FB_SIZE * HIZ_FB_SIZE * bpp;
+   unsigned i;
+
+   for (i = 0; i < size; i += bpp) {
+      if (memcmp(hiz + i, no_hiz + i, bpp) != 0) {
+         fprintf(stderr, "%s: %s of pixel (%u, %u) differs\n",
+                 util_format_short_name(res->format), name,
+                 (i / bpp) % HIZ_FB_SIZE, (i / bpp) / HIZ_FB_SIZE);
+         return FALSE;
+      }
+   }
+   return TRUE;
+}
+
+
+static boolean
+test_format(unsigned verbose, FILE *fp, struct hiz_test *test,
+            enum pipe_format format, unsigned num_runs)
+{
+   struct pipe_context *pipe = test->pipe;
+   const int perf = LP_PERF;
+   struct pipe_resource templ, *cbuf, *zsbuf;
+   struct pipe_surface surf_templ;
+   struct pipe_framebuffer_state fb;
+   uint8_t *results[2][2];
+   boolean success = TRUE;
+   unsigned run, i;
+
+   if (!test->screen->is_format_supported(test->screen, format,
+                                          PIPE_TEXTURE_2D, 0, 0,
+                                          PIPE_BIND_DEPTH_STENCIL)) {
+      if (verbose >= 1)
+         fprintf(stderr, "%s: not supported\n",
+                 util_format_short_name(format));
+      return TRUE;
+   }
+
+   memset(&templ, 0, sizeof templ);
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = PIPE_FORMAT_R8G8B8A8_UNORM;
+   templ.width0 = HIZ_FB_SIZE;
+   templ.height0 = HIZ_FB_SIZE;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.bind = PIPE_BIND_RENDER_TARGET;
+   cbuf = test->screen->resource_create(test->screen, &templ);
+
+   templ.format = format;
+   templ.bind = PIPE_BIND_DEPTH_STENCIL;
+   zsbuf = test->screen->resource_create(test->screen, &templ);
+
+   if (!cbuf || !zsbuf) {
+      pipe_resource_reference(&cbuf, NULL);
+      pipe_resource_reference(&zsbuf, NULL);
+      return FALSE;
+   }
+
+   memset(&fb, 0, sizeof fb);
+   fb.width = HIZ_FB_SIZE;
+   fb.height = HIZ_FB_SIZE;
+   fb.nr_cbufs = 1;
+   memset(&surf_templ, 0, sizeof surf_templ);
+   surf_templ.format = cbuf->format;
+   fb.cbufs[0] = pipe->create_surface(pipe, cbuf, &surf_templ);
+   surf_templ.format = format;
+   fb.zsbuf = pipe->create_surface(pipe, zsbuf, &surf_templ);
+   pipe->set_framebuffer_state(pipe, &fb);
+
+   for (i = 0; i < 2; i++) {
+      results[i][0] = MALLOC(HIZ_FB_SIZE * HIZ_FB_SIZE * 4);
+      results[i][1] = MALLOC(HIZ_FB_SIZE * HIZ_FB_SIZE *
+                             util_format_get_blocksize(format));
+   }
+
+   for (run = 0; run < num_runs; run++) {
+      double msec[2];
+      boolean run_success;
+
+      for (i = 0; i < 2; i++) {
+         int64_t start;
+
+         LP_PERF = i ? perf | PERF_NO_HIZ : perf & ~PERF_NO_HIZ;
+         start = os_time_get_nano();
+         draw_frame(test, run);
+         msec[i] = (os_time_get_nano() - start) / 1000000.0;
+
+         read_resource(test, cbuf, results[i][0]);
+         read_resource(test, zsbuf, results[i][1]);
+      }
+      LP_PERF = perf;
+
+      run_success = compare_resource(cbuf, "color",
+                                     results[0][0], results[1][0]) &&
+                    compare_resource(zsbuf, "depth",
+                                     results[0][1], results[1][1]);
+      if (!run_success)
+         success = FALSE;
+
+      if (verbose >= 1) {
+         fprintf(stderr, "%s run %u: %.2f / %.2f msec (hiz / no_hiz), %s\n",
+                 util_format_short_name(format), run, msec[0], msec[1],
+                 run_success ? "PASS" : "FAIL");
+      }
+
+      if (fp) {
+         fprintf(fp, "%s\t", run_success ? "pass" : "fail");
+         fprintf(fp, "%s\t", util_format_short_name(format));
+         fprintf(fp, "%u\t", run);
+         fprintf(fp, "%.3f\t", msec[0]);
+         fprintf(fp, "%.3f\n", msec[1]);
+         fflush(fp);
+      }
+   }
+
+   for (i = 0; i < 2; i++) {
+      FREE(results[i][0]);
+      FREE(results[i][1]);
+   }
+
+   pipe_surface_reference(&fb.cbufs[0], NULL);
+   pipe_surface_reference(&fb.zsbuf, NULL);
+   memset(&fb, 0, sizeof fb);
+   pipe->set_framebuffer_state(pipe, &fb);
+   pipe_resource_reference(&cbuf, NULL);
+   pipe_resource_reference(&zsbuf, NULL);
+
+   return success;
+}
+
+
+static boolean
+test_formats(unsigned verbose, FILE *fp, unsigned num_formats,
+             unsigned num_runs)
+{
+   struct hiz_test test;
+   boolean success = TRUE;
+   unsigned i;
+
+   memset(&test, 0, sizeof test);
+   test.screen = llvmpipe_create_screen(null_sw_create());
+   if (!test.screen)
+      return FALSE;
+   test.pipe = test.screen->context_create(test.screen, NULL, 0);
+
+   if (!bind_state(&test)) {
+      success = FALSE;
+      num_formats = 0;
+   }
+
+   for (i = 0; i < num_formats; i++) {
+      if (!test_format(verbose, fp, &test, hiz_formats[i], num_runs))
+         success = FALSE;
+   }
+
+   test.pipe->destroy(test.pipe);
+   test.screen->destroy(test.screen);
+
+   return success;
+}
+
+
+boolean
+test_all(unsigned verbose, FILE *fp)
+{
+   return test_formats(verbose, fp, ARRAY_SIZE(hiz_formats), HIZ_RUNS);
+}
+
+
+boolean
+test_some(unsigned verbose, FILE *fp,
+          unsigned long n)
+{
+   return test_formats(verbose, fp, ARRAY_SIZE(hiz_formats), n);
+}
+
+
+boolean
+test_single(unsigned verbose, FILE *fp)
+{
+   return test_formats(verbose, fp, 1, 1);
+}
@@ -0,0 +1,281 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR THEIR SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Unit tests and benchmark for hoisting invariant loads out of loops.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "util/u_memory.h"
+#include "util/u_pointer.h"
+#include "gallivm/lp_bld.h"
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_swizzle.h"
+#include "gallivm/lp_bld_type.h"
+#include "gallivm/lp_bld_debug.h"
+#include "gallivm/lp_bld_flow.h"
+
+#include "lp_test.h"
+
+
+#define LOOP_TEST_NUM_CONSTS 12
+#define LOOP_TEST_ITERATIONS 1024
+#define LOOP_TEST_MAX_LANES (LP_MAX_VECTOR_WIDTH / 32)
+
+
+typedef void (*loop_test_ptr_t)(const uint32_t *consts, const uint32_t *in,
+                                uint32_t *out, int32_t count);
+
+
+void
+write_tsv_header(FILE *fp)
+{
+   fprintf(fp,
+           "result\t"
+           "cycles_per_iteration\t"
+           "hoist\n");
+
+   fflush(fp);
+}
+
+
+static void
+write_tsv_row(FILE *fp,
+              boolean hoist,
+              double cycles,
+              boolean success)
+{
+   fprintf(fp, "%s\t", success ? "pass" : "fail");
+   fprintf(fp, "%.1f\t", cycles / LOOP_TEST_ITERATIONS);
+   fprintf(fp, "%s\n", hoist ? "yes" : "no");
+   fflush(fp);
+}
+
+
+/**
+ * Much like a shader reading scalar constants and broadcasting them:
+ *
+ * for (i = 0; i < count; i++) {
+ *    v = in[i];
+ *    for (j = 0; j < LOOP_TEST_NUM_CONSTS; j++)
+ *       v = j & 1 ? v ^ consts[j] : v + consts[j];
+ *    out[i] = v;
+ * }
+ *
+ * The iterations are independent, so the loop is bound by throughput
+ * rather than latency, and the store keeps the backend from moving the
+ * loads out of the loop by itself.
+ */
+static LLVMValueRef
+add_loop_test(struct gallivm_state *gallivm, struct lp_type type)
+{
+   LLVMModuleRef module = gallivm->module;
+   LLVMContextRef context = gallivm->context;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef i32t = LLVMInt32TypeInContext(context);
+   LLVMTypeRef vec_type = lp_build_vec_type(gallivm, type);
+   LLVMTypeRef args[4];
+   LLVMValueRef func;
+   LLVMValueRef consts_ptr;
+   LLVMValueRef in_ptr;
+   LLVMValueRef out_ptr;
+   LLVMValueRef count;
+   LLVMValueRef v;
+   LLVMBasicBlockRef block;
+   struct lp_build_loop_state loop;
+   unsigned j;
+
+   args[0] = LLVMPointerType(i32t, 0);
+   args[1] = LLVMPointerType(vec_type, 0);
+   args[2] = LLVMPointerType(vec_type, 0);
+   args[3] = i32t;
+   func = LLVMAddFunction(module, "test",
+                          LLVMFunctionType(LLVMVoidTypeInContext(context),
+                                           args, 4, 0));
+   LLVMSetFunctionCallConv(func, LLVMCCallConv);
+   consts_ptr = LLVMGetParam(func, 0);
+   in_ptr = LLVMGetParam(func, 1);
+   out_ptr = LLVMGetParam(func, 2);
+   count = LLVMGetParam(func, 3);
+
+   block = LLVMAppendBasicBlockInContext(context, func, "entry");
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   lp_build_loop_begin(&loop, gallivm, lp_build_const_int32(gallivm, 0));
+   {
+      v = LLVMBuildLoad(builder,
+                        LLVMBuildGEP(builder, in_ptr, &loop.counter, 1, ""), "");
+      for (j = 0; j < LOOP_TEST_NUM_CONSTS; j++) {
+         LLVMValueRef index = lp_build_const_int32(gallivm, j);
+         LLVMValueRef ptr = LLVMBuildGEP(builder, consts_ptr, &index, 1, "");
+         LLVMValueRef value = lp_build_invariant_load(gallivm, ptr, "");
+
+         value = lp_build_broadcast(gallivm, vec_type, value);
+         if (j & 1)
+            v = LLVMBuildXor(builder, v, value, "");
+         else
+            v = LLVMBuildAdd(builder, v, value, "");
+      }
+      LLVMBuildStore(builder, v,
+                     LLVMBuildGEP(builder, out_ptr, &loop.counter, 1, ""));
+   }
+   lp_build_loop_end_cond(&loop, count, NULL, LLVMIntUGE);
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, func);
+
+   return func;
+}
+
+
+PIPE_ALIGN_STACK
+static boolean
+test_loop(unsigned verbose, FILE *fp, boolean hoist)
+{
+   const unsigned length = MIN2(lp_native_vector_width / 32,
+                                LOOP_TEST_MAX_LANES);
+   const unsigned num_values = LOOP_TEST_ITERATIONS * length;
+   struct lp_type type = lp_type_int_vec(32, length * 32);
+   LLVMContextRef context;
+   struct gallivm_state *gallivm;
+   LLVMValueRef func;
+   loop_test_ptr_t loop_test_ptr;
+   uint32_t consts[LOOP_TEST_NUM_CONSTS];
+   uint32_t *in, *out, *ref;
+   int64_t cycles_min = INT64_MAX;
+   unsigned saved_perf = gallivm_perf;
+   boolean success = TRUE;
+   unsigned i, j;
+
+   in = align_malloc(num_values * sizeof(uint32_t), 64);
+   out = align_malloc(num_values * sizeof(uint32_t), 64);
+   ref = align_malloc(num_values * sizeof(uint32_t), 64);
+
+   for (j = 0; j < LOOP_TEST_NUM_CONSTS; j++)
+      consts[j] = rand();
+
+   for (i = 0; i < num_values; i++) {
+      uint32_t v = in[i] = rand();
+      for (j = 0; j < LOOP_TEST_NUM_CONSTS; j++)
+         v = j & 1 ? v ^ consts[j] : v + consts[j];
+      ref[i] = v;
+   }
+
+   if (hoist)
+      gallivm_perf &= ~GALLIVM_PERF_NO_HOIST;
+   else
+      gallivm_perf |= GALLIVM_PERF_NO_HOIST;
+
+   context = LLVMContextCreate();
+   gallivm = gallivm_create("test_module", context);
+
+   func = add_loop_test(gallivm, type);
+
+   gallivm_compile_module(gallivm);
+
+   gallivm_perf = saved_perf;
+
+   loop_test_ptr = (loop_test_ptr_t)gallivm_jit_function(gallivm, func);
+
+   gallivm_free_ir(gallivm);
+
+   for (i = 0; i < LP_TEST_NUM_SAMPLES && success; i++) {
+      int64_t start_counter, end_counter;
+
+      memset(out, 0, num_values * sizeof(uint32_t));
+
+      start_counter = rdtsc();
+      loop_test_ptr(consts, in, out, LOOP_TEST_ITERATIONS);
+      end_counter = rdtsc();
+
+      cycles_min = MIN2(cycles_min, end_counter - start_counter);
+
+      for (j = 0; j < num_values; j++) {
+         if (out[j] != ref[j]) {
+            fprintf(stderr, "MISMATCH: hoist=%s value %u got 0x%08x, "
+                    "expected 0x%08x\n",
+                    hoist ? "yes" : "no", j, out[j], ref[j]);
+            success = FALSE;
+            break;
+         }
+      }
+   }
+
+   if (verbose >= 1) {
+      fprintf(stderr, "hoist=%s: %s\n",
+              hoist ? "yes" : "no", success ? "PASS" : "FAIL");
+   }
+
+   if (fp)
+      write_tsv_row(fp, hoist, (double)cycles_min, success);
+
+   gallivm_destroy(gallivm);
+   LLVMContextDispose(context);
+
+   align_free(in);
+   align_free(out);
+   align_free(ref);
+
+   return success;
+}
+
+
+boolean
+test_all(unsigned verbose, FILE *fp)
+{
+   boolean success = TRUE;
+
+   if (!test_loop(verbose, fp, TRUE))
+      success = FALSE;
+   if (!test_loop(verbose, fp, FALSE))
+      success = FALSE;
+
+   return success;
+}
+
+
+boolean
+test_some(unsigned verbose, FILE *fp,
+          unsigned long n)
+{
+   return test_all(verbose, fp);
+}
+
+
+boolean
+test_single(unsigned verbose, FILE *fp)
+{
+   return test_loop(verbose, fp, TRUE);
+}
@@ -381,13 +381,6 @@ int main(int argc, char **argv)
    boolean single = FALSE;
    unsigned fpstate;
 
-   util_cpu_detect();
-   fpstate = util_fpstate_get();
-   util_fpstate_set_denorms_to_zero(fpstate);
-
-   if (!lp_build_init())
-      return 1;
-
    for(i = 1; i < argc; ++i) {
       if(strcmp(argv[i], "-v") == 0)
          ++verbose;
@@ -395,10 +388,25 @@ int main(int argc, char **argv)
          single = TRUE;
       else if(strcmp(argv[i], "-o") == 0)
          fp = fopen(argv[++i], "wt");
+      else if(strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+         /* vector width to benchmark, same as LP_NATIVE_VECTOR_WIDTH */
+#ifdef _WIN32
+         _putenv_s("LP_NATIVE_VECTOR_WIDTH", argv[++i]);
+#else
+         setenv("LP_NATIVE_VECTOR_WIDTH", argv[++i], 1);
+#endif
+      }
       else
          n = atoi(argv[i]);
    }
 
+   util_cpu_detect();
+   fpstate = util_fpstate_get();
+   util_fpstate_set_denorms_to_zero(fpstate);
+
+   if (!lp_build_init())
+      return 1;
+
 #ifdef DEBUG
    if (verbose >= 2) {
       gallivm_debug |= GALLIVM_DEBUG_IR;
@@ -0,0 +1,424 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR THEIR SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * High polygon count mesh benchmark.
+ *
+ * Renders a finely tessellated, jittered grid covering the whole viewport
+ * at several resolutions, so that triangles go from well below a pixel to
+ * a few pixels in size.  The triangles are drawn with additive blending,
+ * which also checks that the mesh is rasterized watertight: every pixel
+ * must be hit exactly once.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "tgsi/tgsi_text.h"
+#include "util/os_time.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "sw/null/null_sw_winsys.h"
+
+#include "lp_public.h"
+#include "lp_test.h"
+
+
+/** Grid cells per side, two triangles per cell */
+#define MESH_GRID 724
+
+#define MESH_TEST_ITERATIONS 4
+
+
+static const unsigned mesh_sizes[] = { 128, 256, 512, 1024, 2048 };
+
+
+static const char vs_text[] =
+   "VERT\n"
+   "DCL IN[0]\n"
+   "DCL OUT[0], POSITION\n"
+   "MOV OUT[0], IN[0]\n"
+   "END\n";
+
+/* 1/255, so that every hit adds one to the unorm8 red channel */
+static const char fs_text[] =
+   "FRAG\n"
+   "DCL OUT[0], COLOR\n"
+   "IMM[0] FLT32 { 0.0039215689, 0.0, 0.0, 1.0 }\n"
+   "MOV OUT[0], IMM[0]\n"
+   "END\n";
+
+
+struct mesh_test
+{
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+
+   float *vertices;
+   uint32_t *indices;
+   unsigned num_vertices;
+   unsigned num_indices;
+};
+
+
+void
+write_tsv_header(FILE *fp)
+{
+   fprintf(fp,
+           "result\t"
+           "size\t"
+           "triangles\t"
+           "pixels_per_triangle\t"
+           "msec_per_frame\t"
+           "mtris_per_sec\n");
+
+   fflush(fp);
+}
+
+
+/**
+ * Build the grid in clip space.  Interior vertices are moved around by
+ * up to 0.2 cells, which keeps the triangles from folding over while giving
+ * them arbitrary subpixel positions.
+ */
+static void
+build_mesh(struct mesh_test *test)
+{
+   const unsigned n = MESH_GRID + 1;
+   unsigned i, j, k;
+
+   test->num_vertices = n * n;
+   test->num_indices = MESH_GRID * MESH_GRID * 6;
+   test->vertices = MALLOC(test->num_vertices * 2 * sizeof(float));
+   test->indices = MALLOC(test->num_indices * sizeof(uint32_t));
+
+   for (j = 0; j < n; j++) {
+      for (i = 0; i < n; i++) {
+         float x = (float)i, y = (float)j;
+         if (i > 0 && i < MESH_GRID)
+            x += 0.4f * ((float)rand() / RAND_MAX - 0.5f);
+         if (j > 0 && j < MESH_GRID)
+            y += 0.4f * ((float)rand() / RAND_MAX - 0.5f);
+         test->vertices[(j * n + i) * 2 + 0] = 2.0f * x / MESH_GRID - 1.0f;
+         test->vertices[(j * n + i) * 2 + 1] = 2.0f * y / MESH_GRID - 1.0f;
+      }
+   }
+
+   k = 0;
+   for (j = 0; j < MESH_GRID; j++) {
+      for (i = 0; i < MESH_GRID; i++) {
+         uint32_t v0 = j * n + i;
+         uint32_t v1 = v0 + 1;
+         uint32_t v2 = v0 + n;
+         uint32_t v3 = v2 + 1;
+         test->indices[k++] = v0;
+         test->indices[k++] = v1;
+         test->indices[k++] = v2;
+         test->indices[k++] = v2;
+         test->indices[k++] = v1;
+         test->indices[k++] = v3;
+      }
+   }
+}
+
+
+static void *
+create_shader(struct mesh_test *test, const char *text, boolean fragment)
+{
+   struct pipe_context *pipe = test->pipe;
+   struct tgsi_token tokens[256];
+   struct pipe_shader_state state;
+
+   if (!tgsi_text_translate(text, tokens, ARRAY_SIZE(tokens)))
+      return NULL;
+
+   pipe_shader_state_from_tgsi(&state, tokens);
+   return fragment ? pipe->create_fs_state(pipe, &state) :
+                     pipe->create_vs_state(pipe, &state);
+}
+
+
+/**
+ * Bind the state which doesn't depend on the framebuffer size.
+ */
+static boolean
+bind_state(struct mesh_test *test)
+{
+   struct pipe_context *pipe = test->pipe;
+   struct pipe_blend_state blend;
+   struct pipe_depth_stencil_alpha_state dsa;
+   struct pipe_rasterizer_state rast;
+   struct pipe_vertex_element velem;
+   struct pipe_vertex_buffer vbuf;
+   void *vs, *fs;
+
+   memset(&blend, 0, sizeof blend);
+   blend.rt[0].blend_enable = 1;
+   blend.rt[0].rgb_func = PIPE_BLEND_ADD;
+   blend.rt[0].rgb_src_factor = PIPE_BLENDFACTOR_ONE;
+   blend.rt[0].rgb_dst_factor = PIPE_BLENDFACTOR_ONE;
+   blend.rt[0].alpha_func = PIPE_BLEND_ADD;
+   blend.rt[0].alpha_src_factor = PIPE_BLENDFACTOR_ONE;
+   blend.rt[0].alpha_dst_factor = PIPE_BLENDFACTOR_ZERO;
+   blend.rt[0].colormask = PIPE_MASK_RGBA;
+   pipe->bind_blend_state(pipe, pipe->create_blend_state(pipe, &blend));
+
+   memset(&dsa, 0, sizeof dsa);
+   pipe->bind_depth_stencil_alpha_state(pipe,
+      pipe->create_depth_stencil_alpha_state(pipe, &dsa));
+
+   memset(&rast, 0, sizeof rast);
+   rast.cull_face = PIPE_FACE_NONE;
+   rast.fill_front = PIPE_POLYGON_MODE_FILL;
+   rast.fill_back = PIPE_POLYGON_MODE_FILL;
+   rast.half_pixel_center = 1;
+   rast.bottom_edge_rule = 1;
+   rast.depth_clip_near = 1;
+   rast.depth_clip_far = 1;
+   pipe->bind_rasterizer_state(pipe, pipe->create_rasterizer_state(pipe, &rast));
+
+   memset(&velem, 0, sizeof velem);
+   velem.src_format = PIPE_FORMAT_R32G32_FLOAT;
+   pipe->bind_vertex_elements_state(pipe,
+      pipe->create_vertex_elements_state(pipe, 1, &velem));
+
+   memset(&vbuf, 0, sizeof vbuf);
+   vbuf.stride = 2 * sizeof(float);
+   vbuf.is_user_buffer = true;
+   vbuf.buffer.user = test->vertices;
+   pipe->set_vertex_buffers(pipe, 0, 1, &vbuf);
+
+   pipe->set_sample_mask(pipe, ~0);
+
+   vs = create_shader(test, vs_text, FALSE);
+   fs = create_shader(test, fs_text, TRUE);
+   if (!vs || !fs)
+      return FALSE;
+   pipe->bind_vs_state(pipe, vs);
+   pipe->bind_fs_state(pipe, fs);
+
+   return TRUE;
+}
+
+
+static void
+draw_frame(struct mesh_test *test)
+{
+   struct pipe_context *pipe = test->pipe;
+   struct pipe_fence_handle *fence = NULL;
+   union pipe_color_union clear_color;
+   struct pipe_draw_info info;
+
+   memset(&clear_color, 0, sizeof clear_color);
+   pipe->clear(pipe, PIPE_CLEAR_COLOR0, &clear_color, 0.0, 0);
+
+   memset(&info, 0, sizeof info);
+   info.mode = PIPE_PRIM_TRIANGLES;
+   info.index_size = 4;
+   info.has_user_indices = 1;
+   info.index.user = test->indices;
+   info.count = test->num_indices;
+   info.instance_count = 1;
+   info.min_index = 0;
+   info.max_index = test->num_vertices - 1;
+   pipe->draw_vbo(pipe, &info);
+
+   pipe->flush(pipe, &fence, 0);
+   test->screen->fence_finish(test->screen, NULL, fence, PIPE_TIMEOUT_INFINITE);
+   test->screen->fence_reference(test->screen, &fence, NULL);
+}
+
+
+/**
+ * Every pixel center lies in exactly one triangle.
+ */
+static boolean
+check_frame(struct mesh_test *test, struct pipe_resource *tex, unsigned size)
+{
+   struct pipe_transfer *transfer;
+   const uint8_t *map;
+   boolean success = TRUE;
+   unsigned x, y;
+
+   map = pipe_transfer_map(test->pipe, tex, 0, 0, PIPE_TRANSFER_READ,
+                           0, 0, size, size, &transfer);
+   for (y = 0; y < size && success; y++) {
+      const uint8_t *row = map + y * transfer->stride;
+      for (x = 0; x < size; x++) {
+         if (row[x * 4] != 1) {
+            fprintf(stderr, "size %u: pixel (%u, %u) hit %u times\n",
+                    size, x, y, row[x * 4]);
+            success = FALSE;
+            break;
+         }
+      }
+   }
+   pipe_transfer_unmap(test->pipe, transfer);
+   return success;
+}
+
+
+static boolean
+test_size(unsigned verbose, FILE *fp, struct mesh_test *test, unsigned size)
+{
+   struct pipe_context *pipe = test->pipe;
+   const unsigned num_tris = test->num_indices / 3;
+   struct pipe_resource templ, *tex;
+   struct pipe_surface surf_templ, *surf;
+   struct pipe_framebuffer_state fb;
+   struct pipe_viewport_state vp;
+   int64_t nsec_min = INT64_MAX;
+   double msec;
+   boolean success;
+   unsigned i;
+
+   memset(&templ, 0, sizeof templ);
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = PIPE_FORMAT_R8G8B8A8_UNORM;
+   templ.width0 = size;
+   templ.height0 = size;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.bind = PIPE_BIND_RENDER_TARGET;
+   tex = test->screen->resource_create(test->screen, &templ);
+   if (!tex)
+      return FALSE;
+
+   memset(&surf_templ, 0, sizeof surf_templ);
+   surf_templ.format = templ.format;
+   surf = pipe->create_surface(pipe, tex, &surf_templ);
+
+   memset(&fb, 0, sizeof fb);
+   fb.width = size;
+   fb.height = size;
+   fb.nr_cbufs = 1;
+   fb.cbufs[0] = surf;
+   pipe->set_framebuffer_state(pipe, &fb);
+
+   vp.scale[0] = vp.scale[1] = size * 0.5f;
+   vp.scale[2] = 0.5f;
+   vp.translate[0] = vp.translate[1] = size * 0.5f;
+   vp.translate[2] = 0.5f;
+   pipe->set_viewport_states(pipe, 0, 1, &vp);
+
+   draw_frame(test);
+   success = check_frame(test, tex, size);
+
+   for (i = 0; i < MESH_TEST_ITERATIONS; i++) {
+      int64_t start = os_time_get_nano();
+      draw_frame(test);
+      nsec_min = MIN2(nsec_min, os_time_get_nano() - start);
+   }
+   msec = nsec_min / 1000000.0;
+
+   if (verbose >= 1) {
+      fprintf(stderr, "%ux%u: %u tris, %.1f msec, %.1f Mtris/s, %s\n",
+              size, size, num_tris, msec, num_tris / (msec * 1000.0),
+              success ? "PASS" : "FAIL");
+   }
+
+   if (fp) {
+      fprintf(fp, "%s\t", success ? "pass" : "fail");
+      fprintf(fp, "%u\t", size);
+      fprintf(fp, "%u\t", num_tris);
+      fprintf(fp, "%.3f\t", (double)size * size / num_tris);
+      fprintf(fp, "%.2f\t", msec);
+      fprintf(fp, "%.2f\n", num_tris / (msec * 1000.0));
+      fflush(fp);
+   }
+
+   memset(&fb, 0, sizeof fb);
+   pipe->set_framebuffer_state(pipe, &fb);
+   pipe_surface_reference(&surf, NULL);
+   pipe_resource_reference(&tex, NULL);
+
+   return success;
+}
+
+
+static boolean
+test_sizes(unsigned verbose, FILE *fp, unsigned num_sizes)
+{
+   struct mesh_test test;
+   boolean success = TRUE;
+   unsigned i;
+
+   memset(&test, 0, sizeof test);
+   test.screen = llvmpipe_create_screen(null_sw_create());
+   if (!test.screen)
+      return FALSE;
+   test.pipe = test.screen->context_create(test.screen, NULL, 0);
+
+   build_mesh(&test);
+
+   if (!bind_state(&test)) {
+      success = FALSE;
+      num_sizes = 0;
+   }
+
+   for (i = 0; i < num_sizes; i++) {
+      if (!test_size(verbose, fp, &test, mesh_sizes[i]))
+         success = FALSE;
+   }
+
+   test.pipe->destroy(test.pipe);
+   test.screen->destroy(test.screen);
+   FREE(test.vertices);
+   FREE(test.indices);
+
+   return success;
+}
+
+
+boolean
+test_all(unsigned verbose, FILE *fp)
+{
+   return test_sizes(verbose, fp, ARRAY_SIZE(mesh_sizes));
+}
+
+
+boolean
+test_some(unsigned verbose, FILE *fp,
+          unsigned long n)
+{
+   return test_all(verbose, fp);
+}
+
+
+boolean
+test_single(unsigned verbose, FILE *fp)
+{
+   return test_sizes(verbose, fp, 1);
+}
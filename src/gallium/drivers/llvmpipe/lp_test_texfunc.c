@@ -0,0 +1,591 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR THEIR SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+
+/**
+ * @file
+ * Texture function inlining test and benchmark.
+ *
+ * Draws a perspective quad with fragment shaders that sample a float
+ * mipmapped texture with trilinear filtering, which goes through the
+ * texfunc_* sampling functions, once with the module level IPO passes and
+ * once with GALLIVM_PERF=no_ipo.  The two results must be bit identical.
+ *
+ * Blending is enabled, so that llvmpipe only generates the partial block
+ * function and a texture function with a single sample instruction has a
+ * single caller, which is what gets inlined.  The unrolled shaders call the
+ * same three texture functions more and more times; the compile and frame
+ * times of both modes are reported for each of them.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gallivm/lp_bld_debug.h"
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "tgsi/tgsi_text.h"
+#include "util/os_time.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_sampler.h"
+#include "sw/null/null_sw_winsys.h"
+
+#include "lp_public.h"
+#include "lp_test.h"
+
+
+#define TEXFUNC_FB_SIZE 256
+#define TEXFUNC_TEX_SIZE 128
+#define TEXFUNC_TEX_LEVELS 8
+
+#define TEXFUNC_TEST_ITERATIONS 4
+
+
+/**
+ * Number of TXB/TEX/TXL groups of the unrolled shaders.  0 is the loop
+ * shader.
+ */
+static const unsigned texfunc_groups[] = { 0, 1, 2, 4, 8, 16, 32 };
+
+
+static const char vs_text[] =
+   "VERT\n"
+   "DCL IN[0]\n"
+   "DCL IN[1]\n"
+   "DCL OUT[0], POSITION\n"
+   "DCL OUT[1], GENERIC[0]\n"
+   "MOV OUT[0], IN[0]\n"
+   "MOV OUT[1], IN[1]\n"
+   "END\n";
+
+/* Only used to get the vertex shader compiled before the timed draws */
+static const char fs_warmup_text[] =
+   "FRAG\n"
+   "DCL IN[0], GENERIC[0], PERSPECTIVE\n"
+   "DCL OUT[0], COLOR\n"
+   "MOV OUT[0], IN[0]\n"
+   "END\n";
+
+/* TXB and TEX with a bias and coordinates which change every iteration */
+static const char fs_loop_text[] =
+   "FRAG\n"
+   "DCL IN[0], GENERIC[0], PERSPECTIVE\n"
+   "DCL OUT[0], COLOR\n"
+   "DCL SAMP[0]\n"
+   "DCL SVIEW[0], 2D, FLOAT\n"
+   "DCL TEMP[0..3]\n"
+   "IMM[0] FLT32 { 0.0, 1.0, 4.0, 0.5 }\n"
+   "MOV TEMP[0], IMM[0].xxxx\n"
+   "MOV TEMP[1], IMM[0].xxxx\n"
+   "MOV TEMP[3].x, IMM[0].xxxx\n"
+   "BGNLOOP\n"
+   "  SGE TEMP[3].y, TEMP[3].xxxx, IMM[0].zzzz\n"
+   "  IF TEMP[3].yyyy\n"
+   "    BRK\n"
+   "  ENDIF\n"
+   "  MAD TEMP[1].xy, IN[0].xyyy, TEMP[3].xxxx, IN[0].xyyy\n"
+   "  MUL TEMP[1].w, TEMP[3].xxxx, IMM[0].wwww\n"
+   "  TXB TEMP[2], TEMP[1], SAMP[0], 2D\n"
+   "  ADD TEMP[0], TEMP[0], TEMP[2]\n"
+   "  TEX TEMP[2], TEMP[1], SAMP[0], 2D\n"
+   "  ADD TEMP[0], TEMP[0], TEMP[2]\n"
+   "  ADD TEMP[3].x, TEMP[3].xxxx, IMM[0].yyyy\n"
+   "ENDLOOP\n"
+   "MOV OUT[0], TEMP[0]\n"
+   "END\n";
+
+
+struct texfunc_test
+{
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+
+   struct pipe_resource *fb_tex;
+   struct pipe_resource *tex;
+};
+
+
+void
+write_tsv_header(FILE *fp)
+{
+   fprintf(fp,
+           "result\t"
+           "shader\t"
+           "compile_msec_ipo\t"
+           "compile_msec_no_ipo\t"
+           "msec_per_frame_ipo\t"
+           "msec_per_frame_no_ipo\n");
+
+   fflush(fp);
+}
+
+
+/**
+ * Write the unrolled shader with the given number of groups.  Each group
+ * samples at its own scale and offset with TXB, TEX and TXL with a
+ * constant lod, which the IPO passes can fold into the texture function.
+ */
+static void
+write_unrolled_text(char *text, size_t size, unsigned groups)
+{
+   size_t len;
+   unsigned i;
+
+   len = snprintf(text, size,
+                  "FRAG\n"
+                  "DCL IN[0], GENERIC[0], PERSPECTIVE\n"
+                  "DCL OUT[0], COLOR\n"
+                  "DCL SAMP[0]\n"
+                  "DCL SVIEW[0], 2D, FLOAT\n"
+                  "DCL TEMP[0..2]\n");
+   for (i = 0; i < groups; i++) {
+      len += snprintf(text + len, size - len,
+                      "IMM[%u] FLT32 { %f, %f, %f, %f }\n", i,
+                      1.0 + 0.125 * i, 0.03125 * i,
+                      0.25 * (i % 4), 0.5 * (i % 8));
+   }
+   len += snprintf(text + len, size - len,
+                   "MOV TEMP[0], IMM[0].yyyy\n"
+                   "MOV TEMP[1], IMM[0].yyyy\n");
+   for (i = 0; i < groups; i++) {
+      len += snprintf(text + len, size - len,
+                      "MAD TEMP[1].xy, IN[0].xyyy, IMM[%u].xxxx, IMM[%u].yyyy\n"
+                      "MOV TEMP[1].w, IMM[%u].zzzz\n"
+                      "TXB TEMP[2], TEMP[1], SAMP[0], 2D\n"
+                      "ADD TEMP[0], TEMP[0], TEMP[2]\n"
+                      "TEX TEMP[2], TEMP[1], SAMP[0], 2D\n"
+                      "ADD TEMP[0], TEMP[0], TEMP[2]\n"
+                      "MOV TEMP[1].w, IMM[%u].wwww\n"
+                      "TXL TEMP[2], TEMP[1], SAMP[0], 2D\n"
+                      "ADD TEMP[0], TEMP[0], TEMP[2]\n",
+                      i, i, i, i);
+   }
+   snprintf(text + len, size - len,
+            "MOV OUT[0], TEMP[0]\n"
+            "END\n");
+}
+
+
+static void *
+create_shader(struct texfunc_test *test, const char *text, boolean fragment)
+{
+   struct pipe_context *pipe = test->pipe;
+   static struct tgsi_token tokens[8192];
+   struct pipe_shader_state state;
+
+   if (!tgsi_text_translate(text, tokens, ARRAY_SIZE(tokens)))
+      return NULL;
+
+   pipe_shader_state_from_tgsi(&state, tokens);
+   return fragment ? pipe->create_fs_state(pipe, &state) :
+                     pipe->create_vs_state(pipe, &state);
+}
+
+
+/**
+ * Random texels in every level, so that a wrong lod or filter weight shows.
+ */
+static struct pipe_sampler_view *
+create_texture(struct texfunc_test *test)
+{
+   struct pipe_context *pipe = test->pipe;
+   struct pipe_resource templ;
+   struct pipe_sampler_view view_templ;
+   float *texels;
+   unsigned level, i;
+
+   memset(&templ, 0, sizeof templ);
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   templ.width0 = TEXFUNC_TEX_SIZE;
+   templ.height0 = TEXFUNC_TEX_SIZE;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.last_level = TEXFUNC_TEX_LEVELS - 1;
+   templ.bind = PIPE_BIND_SAMPLER_VIEW;
+   test->tex = test->screen->resource_create(test->screen, &templ);
+   if (!test->tex)
+      return NULL;
+
+   texels = MALLOC(TEXFUNC_TEX_SIZE * TEXFUNC_TEX_SIZE * 4 * sizeof(float));
+   for (level = 0; level < TEXFUNC_TEX_LEVELS; level++) {
+      unsigned size = TEXFUNC_TEX_SIZE >> level;
+      struct pipe_box box;
+
+      for (i = 0; i < size * size * 4; i++)
+         texels[i] = random_float();
+
+      u_box_2d(0, 0, size, size, &box);
+      pipe->texture_subdata(pipe, test->tex, level, PIPE_TRANSFER_WRITE, &box,
+                            texels, size * 4 * sizeof(float), 0);
+   }
+   FREE(texels);
+
+   u_sampler_view_default_template(&view_templ, test->tex, templ.format);
+   return pipe->create_sampler_view(pipe, test->tex, &view_templ);
+}
+
+
+/**
+ * Bind everything but the fragment shader.
+ */
+static boolean
+bind_state(struct texfunc_test *test)
+{
+   /* A quad which gets four times smaller towards the top, so that the lod
+    * changes over the framebuffer.
+    */
+   static const float vertices[4][2][4] = {
+      { { -1.0f, -1.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, 0.0f, 1.0f } },
+      { {  1.0f, -1.0f, 0.0f, 1.0f }, { 4.0f, 0.0f, 0.0f, 1.0f } },
+      { { -4.0f,  4.0f, 0.0f, 4.0f }, { 0.0f, 4.0f, 0.0f, 1.0f } },
+      { {  4.0f,  4.0f, 0.0f, 4.0f }, { 4.0f, 4.0f, 0.0f, 1.0f } },
+   };
+   struct pipe_context *pipe = test->pipe;
+   struct pipe_blend_state blend;
+   struct pipe_depth_stencil_alpha_state dsa;
+   struct pipe_rasterizer_state rast;
+   struct pipe_sampler_state sampler;
+   struct pipe_sampler_view *view;
+   struct pipe_vertex_element velems[2];
+   struct pipe_vertex_buffer vbuf;
+   struct pipe_resource templ;
+   struct pipe_surface surf_templ, *surf;
+   struct pipe_framebuffer_state fb;
+   struct pipe_viewport_state vp;
+   void *sampler_cso, *vs;
+
+   memset(&blend, 0, sizeof blend);
+   blend.rt[0].blend_enable = 1;
+   blend.rt[0].rgb_func = PIPE_BLEND_ADD;
+   blend.rt[0].rgb_src_factor = PIPE_BLENDFACTOR_ONE;
+   blend.rt[0].rgb_dst_factor = PIPE_BLENDFACTOR_ZERO;
+   blend.rt[0].alpha_func = PIPE_BLEND_ADD;
+   blend.rt[0].alpha_src_factor = PIPE_BLENDFACTOR_ONE;
+   blend.rt[0].alpha_dst_factor = PIPE_BLENDFACTOR_ZERO;
+   blend.rt[0].colormask = PIPE_MASK_RGBA;
+   pipe->bind_blend_state(pipe, pipe->create_blend_state(pipe, &blend));
+
+   memset(&dsa, 0, sizeof dsa);
+   pipe->bind_depth_stencil_alpha_state(pipe,
+      pipe->create_depth_stencil_alpha_state(pipe, &dsa));
+
+   memset(&rast, 0, sizeof rast);
+   rast.cull_face = PIPE_FACE_NONE;
+   rast.fill_front = PIPE_POLYGON_MODE_FILL;
+   rast.fill_back = PIPE_POLYGON_MODE_FILL;
+   rast.half_pixel_center = 1;
+   rast.bottom_edge_rule = 1;
+   rast.depth_clip_near = 1;
+   rast.depth_clip_far = 1;
+   pipe->bind_rasterizer_state(pipe, pipe->create_rasterizer_state(pipe, &rast));
+
+   memset(&sampler, 0, sizeof sampler);
+   sampler.wrap_s = PIPE_TEX_WRAP_REPEAT;
+   sampler.wrap_t = PIPE_TEX_WRAP_REPEAT;
+   sampler.wrap_r = PIPE_TEX_WRAP_REPEAT;
+   sampler.min_img_filter = PIPE_TEX_FILTER_LINEAR;
+   sampler.mag_img_filter = PIPE_TEX_FILTER_LINEAR;
+   sampler.min_mip_filter = PIPE_TEX_MIPFILTER_LINEAR;
+   sampler.max_lod = TEXFUNC_TEX_LEVELS - 1;
+   sampler.normalized_coords = 1;
+   sampler_cso = pipe->create_sampler_state(pipe, &sampler);
+   pipe->bind_sampler_states(pipe, PIPE_SHADER_FRAGMENT, 0, 1, &sampler_cso);
+
+   view = create_texture(test);
+   if (!view)
+      return FALSE;
+   pipe->set_sampler_views(pipe, PIPE_SHADER_FRAGMENT, 0, 1, &view);
+   pipe_sampler_view_reference(&view, NULL);
+
+   memset(velems, 0, sizeof velems);
+   velems[0].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   velems[1].src_offset = 4 * sizeof(float);
+   velems[1].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   pipe->bind_vertex_elements_state(pipe,
+      pipe->create_vertex_elements_state(pipe, 2, velems));
+
+   memset(&vbuf, 0, sizeof vbuf);
+   vbuf.stride = sizeof vertices[0];
+   vbuf.is_user_buffer = true;
+   vbuf.buffer.user = vertices;
+   pipe->set_vertex_buffers(pipe, 0, 1, &vbuf);
+
+   pipe->set_sample_mask(pipe, ~0);
+
+   memset(&templ, 0, sizeof templ);
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   templ.width0 = TEXFUNC_FB_SIZE;
+   templ.height0 = TEXFUNC_FB_SIZE;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.bind = PIPE_BIND_RENDER_TARGET;
+   test->fb_tex = test->screen->resource_create(test->screen, &templ);
+   if (!test->fb_tex)
+      return FALSE;
+
+   memset(&surf_templ, 0, sizeof surf_templ);
+   surf_templ.format = templ.format;
+   surf = pipe->create_surface(pipe, test->fb_tex, &surf_templ);
+
+   memset(&fb, 0, sizeof fb);
+   fb.width = TEXFUNC_FB_SIZE;
+   fb.height = TEXFUNC_FB_SIZE;
+   fb.nr_cbufs = 1;
+   fb.cbufs[0] = surf;
+   pipe->set_framebuffer_state(pipe, &fb);
+   pipe_surface_reference(&surf, NULL);
+
+   vp.scale[0] = vp.scale[1] = TEXFUNC_FB_SIZE * 0.5f;
+   vp.scale[2] = 0.5f;
+   vp.translate[0] = vp.translate[1] = TEXFUNC_FB_SIZE * 0.5f;
+   vp.translate[2] = 0.5f;
+   pipe->set_viewport_states(pipe, 0, 1, &vp);
+
+   vs = create_shader(test, vs_text, FALSE);
+   if (!vs)
+      return FALSE;
+   pipe->bind_vs_state(pipe, vs);
+
+   return TRUE;
+}
+
+
+static void
+draw_frame(struct texfunc_test *test)
+{
+   struct pipe_context *pipe = test->pipe;
+   struct pipe_fence_handle *fence = NULL;
+   struct pipe_draw_info info;
+
+   memset(&info, 0, sizeof info);
+   info.mode = PIPE_PRIM_TRIANGLE_STRIP;
+   info.count = 4;
+   info.instance_count = 1;
+   info.max_index = 3;
+   pipe->draw_vbo(pipe, &info);
+
+   pipe->flush(pipe, &fence, 0);
+   test->screen->fence_finish(test->screen, NULL, fence, PIPE_TIMEOUT_INFINITE);
+   test->screen->fence_reference(test->screen, &fence, NULL);
+}
+
+
+static void
+read_frame(struct texfunc_test *test, float *dst)
+{
+   const unsigned row_size = TEXFUNC_FB_SIZE * 4 * sizeof(float);
+   struct pipe_transfer *transfer;
+   const uint8_t *map;
+   unsigned y;
+
+   map = pipe_transfer_map(test->pipe, test->fb_tex, 0, 0, PIPE_TRANSFER_READ,
+                           0, 0, TEXFUNC_FB_SIZE, TEXFUNC_FB_SIZE, &transfer);
+   for (y = 0; y < TEXFUNC_FB_SIZE; y++) {
+      memcpy((uint8_t *)dst + y * row_size, map + y * transfer->stride,
+             row_size);
+   }
+   pipe_transfer_unmap(test->pipe, transfer);
+}
+
+
+/**
+ * Draw with a new fragment shader, so that its variant gets compiled with
+ * the current gallivm_perf flags.  The first frame includes the compile,
+ * the compile time is what it took over the fastest of the other frames.
+ */
+static boolean
+run_shader(struct texfunc_test *test, const char *text, float *dst,
+           double *compile_msec, double *frame_msec)
+{
+   struct pipe_context *pipe = test->pipe;
+   int64_t nsec_min = INT64_MAX;
+   int64_t start, nsec_first;
+   void *fs;
+   unsigned i;
+
+   fs = create_shader(test, text, TRUE);
+   if (!fs)
+      return FALSE;
+   pipe->bind_fs_state(pipe, fs);
+
+   start = os_time_get_nano();
+   draw_frame(test);
+   nsec_first = os_time_get_nano() - start;
+
+   for (i = 0; i < TEXFUNC_TEST_ITERATIONS; i++) {
+      start = os_time_get_nano();
+      draw_frame(test);
+      nsec_min = MIN2(nsec_min, os_time_get_nano() - start);
+   }
+
+   read_frame(test, dst);
+
+   pipe->bind_fs_state(pipe, NULL);
+   pipe->delete_fs_state(pipe, fs);
+
+   *compile_msec = (nsec_first - nsec_min) / 1000000.0;
+   *frame_msec = nsec_min / 1000000.0;
+   return TRUE;
+}
+
+
+static boolean
+test_shader(unsigned verbose, FILE *fp, struct texfunc_test *test,
+            unsigned groups)
+{
+   const unsigned num_floats = TEXFUNC_FB_SIZE * TEXFUNC_FB_SIZE * 4;
+   const unsigned perf = gallivm_perf;
+   static char text[16384];
+   char name[32];
+   double compile_msec[2], frame_msec[2];
+   float *results[2];
+   boolean success;
+   unsigned i;
+
+   if (groups) {
+      write_unrolled_text(text, sizeof text, groups);
+      snprintf(name, sizeof name, "unrolled_%u", groups);
+   } else {
+      snprintf(text, sizeof text, "%s", fs_loop_text);
+      snprintf(name, sizeof name, "loop");
+   }
+
+   results[0] = MALLOC(num_floats * sizeof(float));
+   results[1] = MALLOC(num_floats * sizeof(float));
+
+   gallivm_perf = perf & ~GALLIVM_PERF_NO_IPO;
+   success = run_shader(test, text, results[0],
+                        &compile_msec[0], &frame_msec[0]);
+   gallivm_perf = perf | GALLIVM_PERF_NO_IPO;
+   success = success && run_shader(test, text, results[1],
+                                   &compile_msec[1], &frame_msec[1]);
+   gallivm_perf = perf;
+
+   if (success) {
+      for (i = 0; i < num_floats; i++) {
+         if (memcmp(&results[0][i], &results[1][i], sizeof(float)) != 0) {
+            unsigned pixel = i / 4;
+            fprintf(stderr, "%s: pixel (%u, %u) channel %u is %.9g with IPO "
+                    "and %.9g without\n", name,
+                    pixel % TEXFUNC_FB_SIZE, pixel / TEXFUNC_FB_SIZE, i % 4,
+                    results[0][i], results[1][i]);
+            success = FALSE;
+            break;
+         }
+      }
+   }
+
+   if (verbose >= 1) {
+      fprintf(stderr, "%s: compile %.1f / %.1f msec, frame %.2f / %.2f msec "
+              "(ipo / no_ipo), %s\n", name,
+              compile_msec[0], compile_msec[1], frame_msec[0], frame_msec[1],
+              success ? "PASS" : "FAIL");
+   }
+
+   if (fp) {
+      fprintf(fp, "%s\t", success ? "pass" : "fail");
+      fprintf(fp, "%s\t", name);
+      fprintf(fp, "%.2f\t", compile_msec[0]);
+      fprintf(fp, "%.2f\t", compile_msec[1]);
+      fprintf(fp, "%.3f\t", frame_msec[0]);
+      fprintf(fp, "%.3f\n", frame_msec[1]);
+      fflush(fp);
+   }
+
+   FREE(results[0]);
+   FREE(results[1]);
+
+   return success;
+}
+
+
+static boolean
+test_shaders(unsigned verbose, FILE *fp, unsigned num_shaders)
+{
+   struct texfunc_test test;
+   double compile_msec, frame_msec;
+   float *warmup;
+   boolean success = TRUE;
+   unsigned i;
+
+   memset(&test, 0, sizeof test);
+   test.screen = llvmpipe_create_screen(null_sw_create());
+   if (!test.screen)
+      return FALSE;
+   test.pipe = test.screen->context_create(test.screen, NULL, 0);
+
+   if (bind_state(&test)) {
+      warmup = MALLOC(TEXFUNC_FB_SIZE * TEXFUNC_FB_SIZE * 4 * sizeof(float));
+      run_shader(&test, fs_warmup_text, warmup, &compile_msec, &frame_msec);
+      FREE(warmup);
+   } else {
+      success = FALSE;
+      num_shaders = 0;
+   }
+
+   for (i = 0; i < num_shaders; i++) {
+      if (!test_shader(verbose, fp, &test, texfunc_groups[i]))
+         success = FALSE;
+   }
+
+   test.pipe->destroy(test.pipe);
+   pipe_resource_reference(&test.fb_tex, NULL);
+   pipe_resource_reference(&test.tex, NULL);
+   test.screen->destroy(test.screen);
+
+   return success;
+}
+
+
+boolean
+test_all(unsigned verbose, FILE *fp)
+{
+   return test_shaders(verbose, fp, ARRAY_SIZE(texfunc_groups));
+}
+
+
+boolean
+test_some(unsigned verbose, FILE *fp,
+          unsigned long n)
+{
+   return test_all(verbose, fp);
+}
+
+
+boolean
+test_single(unsigned verbose, FILE *fp)
+{
+   return test_shaders(verbose, fp, 1);
+}
@@ -44,6 +44,7 @@
 #include "pipe/p_shader_tokens.h"
 #include "gallivm/lp_bld_debug.h"
 #include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_flow.h"
 #include "gallivm/lp_bld_type.h"
 #include "gallivm/lp_bld_sample.h"
 #include "gallivm/lp_bld_tgsi.h"
@@ -132,7 +133,7 @@ lp_llvm_texture_member(const struct lp_sampler_dynamic_state *base,
    ptr = LLVMBuildGEP(builder, context_ptr, indices, ARRAY_SIZE(indices), "");
 
    if (emit_load)
-      res = LLVMBuildLoad(builder, ptr, "");
+      res = lp_build_invariant_load(gallivm, ptr, "");
    else
       res = ptr;
 
@@ -210,7 +211,7 @@ lp_llvm_sampler_member(const struct lp_sampler_dynamic_state *base,
    ptr = LLVMBuildGEP(builder, context_ptr, indices, ARRAY_SIZE(indices), "");
 
    if (emit_load)
-      res = LLVMBuildLoad(builder, ptr, "");
+      res = lp_build_invariant_load(gallivm, ptr, "");
    else
       res = ptr;
 
@@ -274,7 +275,7 @@ lp_llvm_image_member(const struct lp_sampler_dynamic_state *base,
    ptr = LLVMBuildGEP(builder, context_ptr, indices, ARRAY_SIZE(indices), "");
 
    if (emit_load)
-      res = LLVMBuildLoad(builder, ptr, "");
+      res = lp_build_invariant_load(gallivm, ptr, "");
    else
       res = ptr;
 
@@ -312,7 +313,6 @@ LP_LLVM_IMAGE_MEMBER(base_ptr,   LP_JIT_IMAGE_BASE, TRUE)
 LP_LLVM_IMAGE_MEMBER(row_stride, LP_JIT_IMAGE_ROW_STRIDE, TRUE)
 LP_LLVM_IMAGE_MEMBER(img_stride, LP_JIT_IMAGE_IMG_STRIDE, TRUE)
 
-#if LP_USE_TEXTURE_CACHE
 static LLVMValueRef
 lp_llvm_texture_cache_ptr(const struct lp_sampler_dynamic_state *base,
                           struct gallivm_state *gallivm,
@@ -324,7 +324,6 @@ lp_llvm_texture_cache_ptr(const struct lp_sampler_dynamic_state *base,
 
    return lp_jit_thread_data_cache(gallivm, thread_data_ptr);
 }
-#endif
 
 
 static void
@@ -406,9 +405,9 @@ lp_llvm_sampler_soa_create(const struct lp_sampler_static_state *static_state)
    sampler->dynamic_state.base.lod_bias = lp_llvm_sampler_lod_bias;
    sampler->dynamic_state.base.border_color = lp_llvm_sampler_border_color;
 
-#if LP_USE_TEXTURE_CACHE
-   sampler->dynamic_state.base.cache_ptr = lp_llvm_texture_cache_ptr;
-#endif
+   if (LP_PERF & PERF_TEX_CACHE) {
+      sampler->dynamic_state.base.cache_ptr = lp_llvm_texture_cache_ptr;
+   }
 
    sampler->dynamic_state.static_state = static_state;
 
@@ -216,6 +216,7 @@ static int si_get_param(struct pipe_screen *pscreen, enum pipe_cap param)
 
 	case PIPE_CAP_PACKED_UNIFORMS:
 	case PIPE_CAP_SHADER_SAMPLES_IDENTICAL:
+	case PIPE_CAP_GLSL_MINIMAL_IR_OPTIMIZATION:
 		if (sscreen->options.enable_nir)
 			return 1;
 		return 0;
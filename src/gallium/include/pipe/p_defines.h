@@ -909,6 +909,7 @@ enum pipe_cap
    PIPE_CAP_POINT_SIZE_FIXED,
    PIPE_CAP_TWO_SIDED_COLOR,
    PIPE_CAP_CLIP_PLANES,
+   PIPE_CAP_GLSL_MINIMAL_IR_OPTIMIZATION,
 };
 
 /**
@@ -3922,6 +3922,14 @@ struct gl_constants
     */
    bool GLSLOptimizeConservatively;
 
+   /**
+    * For stages the driver compiles from NIR, only run the GLSL IR passes
+    * linking needs and leave the rest to the driver's NIR optimization loop.
+    * Uniforms that only GLSL IR constant folding would have proven unused
+    * may then be reported as active.
+    */
+   bool GLSLMinimalIROptimization;
+
    /**
     * Whether to call lower_const_arrays_to_uniforms() during linking.
     */
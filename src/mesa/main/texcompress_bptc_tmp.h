@@ -661,7 +661,7 @@ decompress_rgba_unorm_block(int src_width, int src_height,
 {
    int mode_num = ffs(block[0]);
    const struct bptc_unorm_mode *mode;
-   int bit_offset, secondary_bit_offset;
+   int bit_offset, texel_bit_offset, secondary_bit_offset;
    int partition_num;
    int subset_num;
    int rotation;
@@ -745,7 +745,9 @@ decompress_rgba_unorm_block(int src_width, int src_height,
                                  anchors_before_texel);
 
          /* Calculate the offset to the primary index for this texel */
-         bit_offset += mode->n_index_bits * texel - anchors_before_texel;
+         texel_bit_offset = (bit_offset +
+                             mode->n_index_bits * texel -
+                             anchors_before_texel);
 
          subset_num = (subsets >> (texel * 2)) & 3;
 
@@ -754,7 +756,7 @@ decompress_rgba_unorm_block(int src_width, int src_height,
          index_bits = mode->n_index_bits;
          if (anchor)
             index_bits--;
-         indices[0] = extract_bits(block, bit_offset, index_bits);
+         indices[0] = extract_bits(block, texel_bit_offset, index_bits);
 
          if (mode->n_secondary_index_bits) {
             index_bits = mode->n_secondary_index_bits;
@@ -1053,7 +1055,7 @@ decompress_rgb_float_block(unsigned src_width, unsigned src_height,
 {
    int mode_num;
    const struct bptc_float_mode *mode;
-   int bit_offset;
+   int bit_offset, texel_bit_offset;
    int partition_num;
    int subset_num;
    int index_bits;
@@ -1115,14 +1117,16 @@ decompress_rgb_float_block(unsigned src_width, unsigned src_height,
             count_anchors_before_texel(n_subsets, partition_num, texel);
 
          /* Calculate the offset to the primary index for this texel */
-         bit_offset += mode->n_index_bits * texel - anchors_before_texel;
+         texel_bit_offset = (bit_offset +
+                             mode->n_index_bits * texel -
+                             anchors_before_texel);
 
          subset_num = (subsets >> (texel * 2)) & 3;
 
          index_bits = mode->n_index_bits;
          if (is_anchor(n_subsets, partition_num, texel))
             index_bits--;
-         index = extract_bits(block, bit_offset, index_bits);
+         index = extract_bits(block, texel_bit_offset, index_bits);
 
          for (component = 0; component < 3; component++) {
             value = interpolate(endpoints[subset_num * 2][component],
@@ -3131,11 +3131,9 @@ _mesa_ir_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
    return prog->data->LinkStatus;
 }
 
-/**
- * Link a GLSL shader program.  Called via glLinkProgram().
- */
-void
-_mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
+static void
+link_shader_program(struct gl_context *ctx, struct gl_shader_program *prog,
+                    bool retry_on_cache_failure)
 {
    unsigned int i;
    bool spirv = false;
@@ -3184,6 +3182,15 @@ _mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
    }
 
    if (prog->data->LinkStatus && !ctx->Driver.LinkShader(ctx, prog)) {
+      /* The driver couldn't use the IR it had stored in the shader cache and
+       * evicted the cache item, so compile and link from source instead.
+       */
+      if (prog->data->LinkStatus == LINKING_SKIPPED &&
+          retry_on_cache_failure) {
+         link_shader_program(ctx, prog, false);
+         return;
+      }
+
       prog->data->LinkStatus = LINKING_FAILURE;
    }
 
@@ -3208,4 +3215,13 @@ _mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
 #endif
 }
 
+/**
+ * Link a GLSL shader program.  Called via glLinkProgram().
+ */
+void
+_mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
+{
+   link_shader_program(ctx, prog, true);
+}
+
 } /* extern "C" */
@@ -52,10 +52,12 @@ st_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
                                 PIPE_SHADER_CAP_PREFERRED_IR);
    bool use_nir = preferred_ir == PIPE_SHADER_IR_NIR;
 
-   /* Return early if we are loading the shader from on-disk cache */
-   if (st_load_ir_from_disk_cache(ctx, prog, use_nir)) {
-      return GL_TRUE;
-   }
+   /* Return early if we are loading the shader from on-disk cache.  If the
+    * cached IR can't be used, it has been evicted and failing here makes
+    * _mesa_glsl_link_shader() compile and link from source.
+    */
+   if (prog->data->LinkStatus == LINKING_SKIPPED)
+      return st_load_ir_from_disk_cache(ctx, prog, use_nir);
 
    assert(prog->data->LinkStatus);
 
@@ -44,6 +44,7 @@
 #include "st_shader_cache.h"
 
 #include "compiler/nir/nir.h"
+#include "compiler/nir/nir_pass_pipeline.h"
 #include "compiler/glsl_types.h"
 #include "compiler/glsl/glsl_to_nir.h"
 #include "compiler/glsl/gl_nir.h"
@@ -244,47 +245,56 @@ void
 st_nir_opts(nir_shader *nir)
 {
    bool progress;
+   nir_pass_pipeline pipeline;
+
+   nir_pass_pipeline_init(&pipeline);
 
    do {
       progress = false;
 
-      NIR_PASS_V(nir, nir_lower_vars_to_ssa);
-      
+      NIR_PIPELINE_PASS_V(&pipeline, nir, nir_lower_vars_to_ssa);
+
       /* Linking deals with unused inputs/outputs, but here we can remove
        * things local to the shader in the hopes that we can cleanup other
        * things. This pass will also remove variables with only stores, so we
        * might be able to make progress after it.
        */
-      NIR_PASS(progress, nir, nir_remove_dead_variables,
-               (nir_variable_mode)(nir_var_function_temp |
-                                   nir_var_shader_temp |
-                                   nir_var_mem_shared));
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_remove_dead_variables,
+                        (nir_variable_mode)(nir_var_function_temp |
+                                            nir_var_shader_temp |
+                                            nir_var_mem_shared));
 
-      NIR_PASS(progress, nir, nir_opt_copy_prop_vars);
-      NIR_PASS(progress, nir, nir_opt_dead_write_vars);
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_copy_prop_vars);
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_dead_write_vars);
 
       if (nir->options->lower_to_scalar) {
-         NIR_PASS_V(nir, nir_lower_alu_to_scalar, NULL, NULL);
-         NIR_PASS_V(nir, nir_lower_phis_to_scalar);
+         NIR_PIPELINE_PASS_V(&pipeline, nir, nir_lower_alu_to_scalar,
+                             NULL, NULL);
+         NIR_PIPELINE_PASS_V(&pipeline, nir, nir_lower_phis_to_scalar);
       }
 
-      NIR_PASS_V(nir, nir_lower_alu);
-      NIR_PASS_V(nir, nir_lower_pack);
-      NIR_PASS(progress, nir, nir_copy_prop);
-      NIR_PASS(progress, nir, nir_opt_remove_phis);
-      NIR_PASS(progress, nir, nir_opt_dce);
-      if (nir_opt_trivial_continues(nir)) {
+      NIR_PIPELINE_PASS_V(&pipeline, nir, nir_lower_alu);
+      NIR_PIPELINE_PASS_V(&pipeline, nir, nir_lower_pack);
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_copy_prop);
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_remove_phis);
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_dce);
+
+      bool trivial_continues_progress = false;
+      NIR_PIPELINE_PASS(trivial_continues_progress, &pipeline, nir,
+                        nir_opt_trivial_continues);
+      if (trivial_continues_progress) {
          progress = true;
-         NIR_PASS(progress, nir, nir_copy_prop);
-         NIR_PASS(progress, nir, nir_opt_dce);
+         NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_copy_prop);
+         NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_dce);
       }
-      NIR_PASS(progress, nir, nir_opt_if, false);
-      NIR_PASS(progress, nir, nir_opt_dead_cf);
-      NIR_PASS(progress, nir, nir_opt_cse);
-      NIR_PASS(progress, nir, nir_opt_peephole_select, 8, true, true);
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_if, false);
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_dead_cf);
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_cse);
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_peephole_select,
+                        8, true, true);
 
-      NIR_PASS(progress, nir, nir_opt_algebraic);
-      NIR_PASS(progress, nir, nir_opt_constant_folding);
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_algebraic);
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_constant_folding);
 
       if (!nir->info.flrp_lowered) {
          unsigned lower_flrp =
@@ -295,13 +305,14 @@ st_nir_opts(nir_shader *nir)
          if (lower_flrp) {
             bool lower_flrp_progress = false;
 
-            NIR_PASS(lower_flrp_progress, nir, nir_lower_flrp,
-                     lower_flrp,
-                     false /* always_precise */,
-                     nir->options->lower_ffma);
+            NIR_PIPELINE_PASS(lower_flrp_progress, &pipeline, nir,
+                              nir_lower_flrp,
+                              lower_flrp,
+                              false /* always_precise */,
+                              nir->options->lower_ffma);
             if (lower_flrp_progress) {
-               NIR_PASS(progress, nir,
-                        nir_opt_constant_folding);
+               NIR_PIPELINE_PASS(progress, &pipeline, nir,
+                                 nir_opt_constant_folding);
                progress = true;
             }
          }
@@ -312,10 +323,11 @@ st_nir_opts(nir_shader *nir)
          nir->info.flrp_lowered = true;
       }
 
-      NIR_PASS(progress, nir, nir_opt_undef);
-      NIR_PASS(progress, nir, nir_opt_conditional_discard);
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_undef);
+      NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_conditional_discard);
       if (nir->options->max_unroll_iterations) {
-         NIR_PASS(progress, nir, nir_opt_loop_unroll, (nir_variable_mode)0);
+         NIR_PIPELINE_PASS(progress, &pipeline, nir, nir_opt_loop_unroll,
+                           (nir_variable_mode)0);
       }
    } while (progress);
 }
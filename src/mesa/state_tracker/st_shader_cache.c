@@ -27,8 +27,8 @@
 #include "st_shader_cache.h"
 #include "st_util.h"
 #include "compiler/glsl/program.h"
+#include "compiler/glsl/shader_cache.h"
 #include "compiler/nir/nir.h"
-#include "compiler/nir/nir_serialize.h"
 #include "pipe/p_shader_tokens.h"
 #include "program/ir_to_mesa.h"
 #include "tgsi/tgsi_parse.h"
@@ -70,7 +70,7 @@ write_tgsi_to_cache(struct blob *blob, const struct tgsi_token *tokens,
 static void
 write_nir_to_cache(struct blob *blob, struct gl_program *prog)
 {
-   nir_serialize(blob, prog->nir, false);
+   shader_cache_write_nir(blob, prog);
    copy_blob_to_driver_cache_blob(blob, prog);
 }
 
@@ -171,7 +171,7 @@ read_tgsi_from_cache(struct blob_reader *blob_reader,
    blob_copy_bytes(blob_reader, (uint8_t *) *tokens, tokens_size);
 }
 
-static void
+static bool
 st_deserialise_ir_program(struct gl_context *ctx,
                           struct gl_shader_program *shProg,
                           struct gl_program *prog, bool nir)
@@ -179,8 +179,6 @@ st_deserialise_ir_program(struct gl_context *ctx,
    struct st_context *st = st_context(ctx);
    size_t size = prog->driver_cache_blob_size;
    uint8_t *buffer = (uint8_t *) prog->driver_cache_blob;
-   const struct nir_shader_compiler_options *options =
-      ctx->Const.ShaderCompilerOptions[prog->info.stage].NirOptions;
 
    assert(prog->driver_cache_blob && prog->driver_cache_blob_size > 0);
 
@@ -206,8 +204,9 @@ st_deserialise_ir_program(struct gl_context *ctx,
       if (nir) {
          stvp->state.type = PIPE_SHADER_IR_NIR;
          stvp->shader_program = shProg;
-         stvp->state.ir.nir = nir_deserialize(NULL, options, &blob_reader);
-         prog->nir = stvp->state.ir.nir;
+         if (!shader_cache_read_nir(ctx, &blob_reader, prog))
+            return false;
+         stvp->state.ir.nir = prog->nir;
       } else {
          read_tgsi_from_cache(&blob_reader, &stvp->state.tokens);
       }
@@ -235,9 +234,10 @@ st_deserialise_ir_program(struct gl_context *ctx,
 
       if (nir) {
          stcp->state.type = PIPE_SHADER_IR_NIR;
-         stcp->state.ir.nir = nir_deserialize(NULL, options, &blob_reader);
+         if (!shader_cache_read_nir(ctx, &blob_reader, prog))
+            return false;
+         stcp->state.ir.nir = prog->nir;
          stcp->shader_program = shProg;
-         prog->nir = stcp->state.ir.nir;
       } else {
          read_tgsi_from_cache(&blob_reader, &stcp->state.tokens);
       }
@@ -274,6 +274,8 @@ st_deserialise_ir_program(struct gl_context *ctx,
    if (ST_DEBUG & DEBUG_PRECOMPILE ||
        st->shader_has_one_variant[prog->info.stage])
       st_precompile_shader_variant(st, prog);
+
+   return true;
 }
 
 bool
@@ -290,25 +292,40 @@ st_load_ir_from_disk_cache(struct gl_context *ctx,
    if (prog->data->LinkStatus != LINKING_SKIPPED)
       return false;
 
+   bool ok = true;
+
    for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
       if (prog->_LinkedShaders[i] == NULL)
          continue;
 
       struct gl_program *glprog = prog->_LinkedShaders[i]->Program;
-      st_deserialise_ir_program(ctx, prog, glprog, nir);
+      if (ok)
+         ok = st_deserialise_ir_program(ctx, prog, glprog, nir);
 
       /* We don't need the cached blob anymore so free it */
       ralloc_free(glprog->driver_cache_blob);
       glprog->driver_cache_blob = NULL;
       glprog->driver_cache_blob_size = 0;
 
-      if (ctx->_Shader->Flags & GLSL_CACHE_INFO) {
+      if (ok && (ctx->_Shader->Flags & GLSL_CACHE_INFO)) {
          fprintf(stderr, "%s state tracker IR retrieved from cache\n",
                  _mesa_shader_stage_to_string(i));
       }
    }
 
-   return true;
+   /* NIR written by an older Mesa is rejected by nir_deserialize().  Drop
+    * the cache item so that the program gets rebuilt from source.
+    */
+   if (!ok) {
+      if (ctx->_Shader->Flags & GLSL_CACHE_INFO) {
+         fprintf(stderr, "Error reading program from cache (invalid NIR "
+                 "cache item)\n");
+      }
+
+      disk_cache_remove(ctx->Cache, prog->data->sha1);
+   }
+
+   return ok;
 }
 
 void
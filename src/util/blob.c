@@ -197,6 +197,20 @@ blob_reserve_intptr(struct blob *blob)
    return blob_reserve_bytes(blob, sizeof(intptr_t));
 }
 
+bool
+blob_write_uint8(struct blob *blob, uint8_t value)
+{
+   return blob_write_bytes(blob, &value, sizeof(value));
+}
+
+bool
+blob_write_uint16(struct blob *blob, uint16_t value)
+{
+   align_blob(blob, sizeof(value));
+
+   return blob_write_bytes(blob, &value, sizeof(value));
+}
+
 bool
 blob_write_uint32(struct blob *blob, uint32_t value)
 {
@@ -205,6 +219,21 @@ blob_write_uint32(struct blob *blob, uint32_t value)
    return blob_write_bytes(blob, &value, sizeof(value));
 }
 
+bool
+blob_write_varint(struct blob *blob, uint32_t value)
+{
+   uint8_t bytes[5];
+   unsigned size = 0;
+
+   while (value >= 0x80) {
+      bytes[size++] = (value & 0x7f) | 0x80;
+      value >>= 7;
+   }
+   bytes[size++] = value;
+
+   return blob_write_bytes(blob, bytes, size);
+}
+
 #define ASSERT_ALIGNED(_offset, _align) \
    assert(ALIGN((_offset), (_align)) == (_offset))
 
@@ -309,10 +338,43 @@ blob_skip_bytes(struct blob_reader *blob, size_t size)
       blob->current += size;
 }
 
-/* These next three read functions have identical form. If we add any beyond
- * these first three we should probably switch to generating these with a
- * preprocessor macro.
+uint8_t
+blob_read_uint8(struct blob_reader *blob)
+{
+   uint8_t ret;
+
+   if (! ensure_can_read(blob, sizeof(ret)))
+      return 0;
+
+   ret = *blob->current;
+
+   blob->current += sizeof(ret);
+
+   return ret;
+}
+
+/* These next four read functions have identical form. If we add any beyond
+ * these we should probably switch to generating these with a preprocessor
+ * macro.
 */
+uint16_t
+blob_read_uint16(struct blob_reader *blob)
+{
+   uint16_t ret;
+   int size = sizeof(ret);
+
+   align_blob_reader(blob, size);
+
+   if (! ensure_can_read(blob, size))
+      return 0;
+
+   ret = *((uint16_t*) blob->current);
+
+   blob->current += size;
+
+   return ret;
+}
+
 uint32_t
 blob_read_uint32(struct blob_reader *blob)
 {
@@ -331,6 +393,32 @@ blob_read_uint32(struct blob_reader *blob)
    return ret;
 }
 
+uint32_t
+blob_read_varint(struct blob_reader *blob)
+{
+   uint32_t ret = 0;
+
+   if (blob->overrun)
+      return 0;
+
+   /* Single-byte values are by far the most common. */
+   if (blob->current < blob->end && !(*blob->current & 0x80))
+      return *blob->current++;
+
+   for (unsigned shift = 0; shift < 35; shift += 7) {
+      if (blob->current >= blob->end)
+         break;
+
+      uint8_t byte = *blob->current++;
+      ret |= (uint32_t)(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+         return ret;
+   }
+
+   blob->overrun = true;
+   return 0;
+}
+
 uint64_t
 blob_read_uint64(struct blob_reader *blob)
 {
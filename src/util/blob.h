@@ -175,6 +175,27 @@ blob_overwrite_bytes(struct blob *blob,
                      const void *bytes,
                      size_t to_write);
 
+/**
+ * Add a uint8_t to a blob.
+ *
+ * \return True unless allocation failed.
+ */
+bool
+blob_write_uint8(struct blob *blob, uint8_t value);
+
+/**
+ * Add a uint16_t to a blob.
+ *
+ * \note This function will only write to a uint16_t-aligned offset from the
+ * beginning of the blob's data, so some padding bytes may be added to the
+ * blob if this write follows some unaligned write (such as
+ * blob_write_string).
+ *
+ * \return True unless allocation failed.
+ */
+bool
+blob_write_uint16(struct blob *blob, uint16_t value);
+
 /**
  * Add a uint32_t to a blob.
  *
@@ -188,6 +209,19 @@ blob_overwrite_bytes(struct blob *blob,
 bool
 blob_write_uint32(struct blob *blob, uint32_t value);
 
+/**
+ * Add a uint32_t to a blob as a variable-length integer.
+ *
+ * The value is stored 7 bits per byte, least significant bits first, with
+ * the top bit of each byte set when more bytes follow (LEB128). Values below
+ * 128 take a single byte and no alignment padding is ever added, which makes
+ * this the better choice for counts and indices that are usually small.
+ *
+ * \return True unless allocation failed.
+ */
+bool
+blob_write_varint(struct blob *blob, uint32_t value);
+
 /**
  * Overwrite a uint32_t previously written to the blob.
  *
@@ -303,6 +337,27 @@ blob_copy_bytes(struct blob_reader *blob, void *dest, size_t size);
 void
 blob_skip_bytes(struct blob_reader *blob, size_t size);
 
+/**
+ * Read a uint8_t from the current location, (and update the current location
+ * to just past this uint8_t).
+ *
+ * \return The uint8_t read
+ */
+uint8_t
+blob_read_uint8(struct blob_reader *blob);
+
+/**
+ * Read a uint16_t from the current location, (and update the current location
+ * to just past this uint16_t).
+ *
+ * \note This function will only read from a uint16_t-aligned offset from the
+ * beginning of the blob's data, so some padding bytes may be skipped.
+ *
+ * \return The uint16_t read
+ */
+uint16_t
+blob_read_uint16(struct blob_reader *blob);
+
 /**
  * Read a uint32_t from the current location, (and update the current location
  * to just past this uint32_t).
@@ -315,6 +370,16 @@ blob_skip_bytes(struct blob_reader *blob, size_t size);
 uint32_t
 blob_read_uint32(struct blob_reader *blob);
 
+/**
+ * Read a variable-length integer written by blob_write_varint from the
+ * current location, (and update the current location to just past it).
+ *
+ * \return The value read, or 0 and the overrun flag set if the encoding is
+ * truncated or longer than five bytes.
+ */
+uint32_t
+blob_read_varint(struct blob_reader *blob);
+
 /**
  * Read a uint64_t from the current location, (and update the current location
  * to just past this uint64_t).
@@ -34,6 +34,7 @@ typedef SSIZE_T ssize_t;
 #endif
 
 #include "util/ralloc.h"
+#include "util/macros.h"
 #include "blob.h"
 
 #define bytes_test_str     "bytes_test"
@@ -42,6 +43,8 @@ typedef SSIZE_T ssize_t;
 /* This placeholder must be the same length as the next overwrite_test_str */
 #define placeholder_str    "XXXXXXXXXXXXXX"
 #define overwrite_test_str "overwrite_test"
+#define uint8_test         0x12
+#define uint16_test        0x1234
 #define uint32_test        0x12345678
 #define uint32_placeholder 0xDEADBEEF
 #define uint32_overwrite   0xA1B2C3D4
@@ -141,6 +144,10 @@ test_write_and_read_functions (void)
    str_offset = blob.size;
    blob_write_bytes(&blob, placeholder_str, sizeof(placeholder_str));
 
+   blob_write_uint8(&blob, uint8_test);
+
+   blob_write_uint16(&blob, uint16_test);
+
    blob_write_uint32(&blob, uint32_test);
 
    /* Write a placeholder, (to be replaced later via overwrite_uint32) */
@@ -153,6 +160,8 @@ test_write_and_read_functions (void)
 
    blob_write_string(&blob, string_test_str);
 
+   blob_write_varint(&blob, uint32_test);
+
    /* Finally, overwrite our placeholders. */
    blob_overwrite_bytes(&blob, str_offset, overwrite_test_str,
                         sizeof(overwrite_test_str));
@@ -173,6 +182,10 @@ test_write_and_read_functions (void)
                     blob_read_bytes(&reader, sizeof(overwrite_test_str)),
                     "blob_overwrite_bytes");
 
+   expect_equal(uint8_test, blob_read_uint8(&reader),
+                "blob_write/read_uint8");
+   expect_equal(uint16_test, blob_read_uint16(&reader),
+                "blob_write/read_uint16");
    expect_equal(uint32_test, blob_read_uint32(&reader),
                 "blob_write/read_uint32");
    expect_equal(uint32_overwrite, blob_read_uint32(&reader),
@@ -183,6 +196,8 @@ test_write_and_read_functions (void)
                 "blob_write/read_intptr");
    expect_equal_str(string_test_str, blob_read_string(&reader),
                     "blob_write/read_string");
+   expect_equal(uint32_test, blob_read_varint(&reader),
+                "blob_write/read_varint");
 
    expect_equal(reader.end - reader.data, reader.current - reader.data,
                 "read_consumes_all_bytes");
@@ -249,6 +264,38 @@ test_alignment(void)
    blob_finish(&blob);
 }
 
+/* Test the encoded size of variable-length integers at the boundaries. */
+static void
+test_varint(void)
+{
+   static const uint32_t values[] = {
+      0, 1, 0x7f, 0x80, 0x3fff, 0x4000, 0x1fffff, 0x200000,
+      0xfffffff, 0x10000000, 0xffffffff,
+   };
+   static const unsigned sizes[] = { 1, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5 };
+   struct blob blob;
+   struct blob_reader reader;
+
+   for (unsigned i = 0; i < ARRAY_SIZE(values); i++) {
+      blob_init(&blob);
+      blob_write_varint(&blob, values[i]);
+      expect_equal(sizes[i], blob.size, "varint size");
+
+      blob_reader_init(&reader, blob.data, blob.size);
+      expect_equal(values[i], blob_read_varint(&reader), "varint value");
+      expect_equal(false, reader.overrun, "varint does not overrun");
+
+      /* Every truncation of a multi-byte value is an overrun. */
+      if (blob.size > 1) {
+         blob_reader_init(&reader, blob.data, blob.size - 1);
+         expect_equal(0, blob_read_varint(&reader), "truncated varint");
+         expect_equal(true, reader.overrun, "truncated varint overrun");
+      }
+
+      blob_finish(&blob);
+   }
+}
+
 /* Test that we detect overrun. */
 static void
 test_overrun(void)
@@ -321,6 +368,7 @@ main (void)
 {
    test_write_and_read_functions ();
    test_alignment ();
+   test_varint ();
    test_overrun ();
    test_big_objects ();
 
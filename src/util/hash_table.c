@@ -33,9 +33,10 @@
  */
 
 /**
- * Implements an open-addressing, linear-reprobing hash table.
+ * Implements an open-addressing hash table with SIMD-probed control bytes.
  *
- * For more information, see:
+ * The probing scheme is shared with set.c, see hash_table_ctrl.h.  The
+ * original design this replaced is described at:
  *
  * http://cgit.freedesktop.org/~anholt/hash_table/tree/README
  */
@@ -45,81 +46,55 @@
 #include <assert.h>
 
 #include "hash_table.h"
+#include "hash_table_ctrl.h"
 #include "ralloc.h"
 #include "macros.h"
 #include "main/hash.h"
-#include "fast_urem_by_const.h"
 
 static const uint32_t deleted_key_value;
 
-/**
- * From Knuth -- a good choice for hash/rehash values is p, p-2 where
- * p and p-2 are both prime.  These tables are sized to have an extra 10%
- * free to avoid exponential performance degradation as the hash table fills
- */
-static const struct {
-   uint32_t max_entries, size, rehash;
-   uint64_t size_magic, rehash_magic;
-} hash_sizes[] = {
-#define ENTRY(max_entries, size, rehash) \
-   { max_entries, size, rehash, \
-      REMAINDER_MAGIC(size), REMAINDER_MAGIC(rehash) }
-
-   ENTRY(2,            5,            3            ),
-   ENTRY(4,            7,            5            ),
-   ENTRY(8,            13,           11           ),
-   ENTRY(16,           19,           17           ),
-   ENTRY(32,           43,           41           ),
-   ENTRY(64,           73,           71           ),
-   ENTRY(128,          151,          149          ),
-   ENTRY(256,          283,          281          ),
-   ENTRY(512,          571,          569          ),
-   ENTRY(1024,         1153,         1151         ),
-   ENTRY(2048,         2269,         2267         ),
-   ENTRY(4096,         4519,         4517         ),
-   ENTRY(8192,         9013,         9011         ),
-   ENTRY(16384,        18043,        18041        ),
-   ENTRY(32768,        36109,        36107        ),
-   ENTRY(65536,        72091,        72089        ),
-   ENTRY(131072,       144409,       144407       ),
-   ENTRY(262144,       288361,       288359       ),
-   ENTRY(524288,       576883,       576881       ),
-   ENTRY(1048576,      1153459,      1153457      ),
-   ENTRY(2097152,      2307163,      2307161      ),
-   ENTRY(4194304,      4613893,      4613891      ),
-   ENTRY(8388608,      9227641,      9227639      ),
-   ENTRY(16777216,     18455029,     18455027     ),
-   ENTRY(33554432,     36911011,     36911009     ),
-   ENTRY(67108864,     73819861,     73819859     ),
-   ENTRY(134217728,    147639589,    147639587    ),
-   ENTRY(268435456,    295279081,    295279079    ),
-   ENTRY(536870912,    590559793,    590559791    ),
-   ENTRY(1073741824,   1181116273,   1181116271   ),
-   ENTRY(2147483648ul, 2362232233ul, 2362232231ul )
-};
-
 static inline bool
 key_pointer_is_reserved(const struct hash_table *ht, const void *key)
 {
    return key == NULL || key == ht->deleted_key;
 }
 
-static int
-entry_is_free(const struct hash_entry *entry)
+static inline uint32_t
+entry_index(const struct hash_table *ht, const struct hash_entry *entry)
+{
+   return entry - ht->table;
+}
+
+static inline bool
+entry_is_present(const struct hash_table *ht, const struct hash_entry *entry)
 {
-   return entry->key == NULL;
+   return hash_ctrl_is_full(ht->ctrl[entry_index(ht, entry)]);
 }
 
-static int
-entry_is_deleted(const struct hash_table *ht, struct hash_entry *entry)
+/* Allocate the entries and control bytes of a table of 2^size_log2 slots
+ * as a single block.
+ */
+static struct hash_entry *
+alloc_table(void *mem_ctx, unsigned size_log2, uint8_t **ctrl)
 {
-   return entry->key == ht->deleted_key;
+   uint32_t size = 1u << size_log2;
+   struct hash_entry *table =
+      rzalloc_size(mem_ctx, (size_t) size * sizeof(struct hash_entry) +
+                            hash_ctrl_bytes(size_log2));
+   if (table == NULL)
+      return NULL;
+
+   *ctrl = (uint8_t *) (table + size);
+   hash_ctrl_reset(*ctrl, size_log2);
+   return table;
 }
 
-static int
-entry_is_present(const struct hash_table *ht, struct hash_entry *entry)
+static void
+set_size(struct hash_table *ht, unsigned size_log2)
 {
-   return entry->key != NULL && entry->key != ht->deleted_key;
+   ht->size_index = size_log2;
+   ht->size = 1u << size_log2;
+   ht->max_entries = hash_ctrl_max_entries(size_log2);
 }
 
 bool
@@ -129,15 +104,10 @@ _mesa_hash_table_init(struct hash_table *ht,
                       bool (*key_equals_function)(const void *a,
                                                   const void *b))
 {
-   ht->size_index = 0;
-   ht->size = hash_sizes[ht->size_index].size;
-   ht->rehash = hash_sizes[ht->size_index].rehash;
-   ht->size_magic = hash_sizes[ht->size_index].size_magic;
-   ht->rehash_magic = hash_sizes[ht->size_index].rehash_magic;
-   ht->max_entries = hash_sizes[ht->size_index].max_entries;
+   set_size(ht, HASH_CTRL_MIN_SIZE_LOG2);
    ht->key_hash_function = key_hash_function;
    ht->key_equals_function = key_equals_function;
-   ht->table = rzalloc_array(mem_ctx, struct hash_entry, ht->size);
+   ht->table = alloc_table(mem_ctx, ht->size_index, &ht->ctrl);
    ht->entries = 0;
    ht->deleted_entries = 0;
    ht->deleted_key = &deleted_key_value;
@@ -179,13 +149,16 @@ _mesa_hash_table_clone(struct hash_table *src, void *dst_mem_ctx)
 
    memcpy(ht, src, sizeof(struct hash_table));
 
-   ht->table = ralloc_array(ht, struct hash_entry, ht->size);
+   size_t table_size = (size_t) ht->size * sizeof(struct hash_entry) +
+                       hash_ctrl_bytes(ht->size_index);
+   ht->table = ralloc_size(ht, table_size);
    if (ht->table == NULL) {
       ralloc_free(ht);
       return NULL;
    }
 
-   memcpy(ht->table, src->table, ht->size * sizeof(struct hash_entry));
+   memcpy(ht->table, src->table, table_size);
+   ht->ctrl = (uint8_t *) (ht->table + ht->size);
 
    return ht;
 }
@@ -221,18 +194,15 @@ void
 _mesa_hash_table_clear(struct hash_table *ht,
                        void (*delete_function)(struct hash_entry *entry))
 {
-   struct hash_entry *entry;
-
-   for (entry = ht->table; entry != ht->table + ht->size; entry++) {
-      if (entry->key == NULL)
-         continue;
-
-      if (delete_function != NULL && entry->key != ht->deleted_key)
+   if (delete_function != NULL) {
+      hash_table_foreach(ht, entry)
          delete_function(entry);
-
-      entry->key = NULL;
    }
 
+   for (uint32_t i = 0; i < ht->size; i++)
+      ht->table[i].key = NULL;
+   hash_ctrl_reset(ht->ctrl, ht->size_index);
+
    ht->entries = 0;
    ht->deleted_entries = 0;
 }
@@ -253,32 +223,37 @@ _mesa_hash_table_set_deleted_key(struct hash_table *ht, const void *deleted_key)
    ht->deleted_key = deleted_key;
 }
 
+static inline uint32_t
+num_groups(const struct hash_table *ht)
+{
+   return MAX2(ht->size / HASH_CTRL_GROUP_SIZE, 1);
+}
+
 static struct hash_entry *
 hash_table_search(struct hash_table *ht, uint32_t hash, const void *key)
 {
    assert(!key_pointer_is_reserved(ht, key));
 
-   uint32_t size = ht->size;
-   uint32_t start_hash_address = util_fast_urem32(hash, size, ht->size_magic);
-   uint32_t double_hash = 1 + util_fast_urem32(hash, ht->rehash,
-                                               ht->rehash_magic);
-   uint32_t hash_address = start_hash_address;
+   uint8_t tag = hash_ctrl_tag(hash);
+   struct hash_ctrl_probe probe = hash_ctrl_probe_start(hash, ht->size_index);
 
-   do {
-      struct hash_entry *entry = ht->table + hash_address;
+   for (uint32_t i = num_groups(ht); i > 0; i--) {
+      const uint8_t *group = ht->ctrl + probe.group;
 
-      if (entry_is_free(entry)) {
-         return NULL;
-      } else if (entry_is_present(ht, entry) && entry->hash == hash) {
-         if (ht->key_equals_function(key, entry->key)) {
+      hash_ctrl_mask match = hash_ctrl_match(group, tag);
+      while (match) {
+         struct hash_entry *entry =
+            ht->table + probe.group + hash_ctrl_mask_next(&match);
+
+         if (entry->hash == hash && ht->key_equals_function(key, entry->key))
             return entry;
-         }
       }
 
-      hash_address += double_hash;
-      if (hash_address >= size)
-         hash_address -= size;
-   } while (hash_address != start_hash_address);
+      if (hash_ctrl_match(group, HASH_CTRL_EMPTY))
+         return NULL;
+
+      hash_ctrl_probe_next(&probe);
+   }
 
    return NULL;
 }
@@ -304,32 +279,28 @@ _mesa_hash_table_search_pre_hashed(struct hash_table *ht, uint32_t hash,
    return hash_table_search(ht, hash, key);
 }
 
-static struct hash_entry *
-hash_table_insert(struct hash_table *ht, uint32_t hash,
-                  const void *key, void *data);
-
 static void
 hash_table_insert_rehash(struct hash_table *ht, uint32_t hash,
                          const void *key, void *data)
 {
-   uint32_t size = ht->size;
-   uint32_t start_hash_address = util_fast_urem32(hash, size, ht->size_magic);
-   uint32_t double_hash = 1 + util_fast_urem32(hash, ht->rehash,
-                                               ht->rehash_magic);
-   uint32_t hash_address = start_hash_address;
+   struct hash_ctrl_probe probe = hash_ctrl_probe_start(hash, ht->size_index);
+
    do {
-      struct hash_entry *entry = ht->table + hash_address;
+      hash_ctrl_mask available =
+         hash_ctrl_match(ht->ctrl + probe.group, HASH_CTRL_EMPTY);
+
+      if (likely(available)) {
+         uint32_t index = probe.group + hash_ctrl_mask_next(&available);
+         struct hash_entry *entry = ht->table + index;
 
-      if (likely(entry->key == NULL)) {
+         ht->ctrl[index] = hash_ctrl_tag(hash);
          entry->hash = hash;
          entry->key = key;
          entry->data = data;
          return;
       }
 
-      hash_address += double_hash;
-      if (hash_address >= size)
-         hash_address -= size;
+      hash_ctrl_probe_next(&probe);
    } while (true);
 }
 
@@ -338,24 +309,20 @@ _mesa_hash_table_rehash(struct hash_table *ht, unsigned new_size_index)
 {
    struct hash_table old_ht;
    struct hash_entry *table;
+   uint8_t *ctrl;
 
-   if (new_size_index >= ARRAY_SIZE(hash_sizes))
+   if (new_size_index >= 32)
       return;
 
-   table = rzalloc_array(ralloc_parent(ht->table), struct hash_entry,
-                         hash_sizes[new_size_index].size);
+   table = alloc_table(ralloc_parent(ht->table), new_size_index, &ctrl);
    if (table == NULL)
       return;
 
    old_ht = *ht;
 
    ht->table = table;
-   ht->size_index = new_size_index;
-   ht->size = hash_sizes[ht->size_index].size;
-   ht->rehash = hash_sizes[ht->size_index].rehash;
-   ht->size_magic = hash_sizes[ht->size_index].size_magic;
-   ht->rehash_magic = hash_sizes[ht->size_index].rehash_magic;
-   ht->max_entries = hash_sizes[ht->size_index].max_entries;
+   ht->ctrl = ctrl;
+   set_size(ht, new_size_index);
    ht->entries = 0;
    ht->deleted_entries = 0;
 
@@ -382,21 +349,11 @@ hash_table_insert(struct hash_table *ht, uint32_t hash,
       _mesa_hash_table_rehash(ht, ht->size_index);
    }
 
-   uint32_t size = ht->size;
-   uint32_t start_hash_address = util_fast_urem32(hash, size, ht->size_magic);
-   uint32_t double_hash = 1 + util_fast_urem32(hash, ht->rehash,
-                                               ht->rehash_magic);
-   uint32_t hash_address = start_hash_address;
-   do {
-      struct hash_entry *entry = ht->table + hash_address;
-
-      if (!entry_is_present(ht, entry)) {
-         /* Stash the first available entry we find */
-         if (available_entry == NULL)
-            available_entry = entry;
-         if (entry_is_free(entry))
-            break;
-      }
+   uint8_t tag = hash_ctrl_tag(hash);
+   struct hash_ctrl_probe probe = hash_ctrl_probe_start(hash, ht->size_index);
+
+   for (uint32_t i = num_groups(ht); i > 0; i--) {
+      const uint8_t *group = ht->ctrl + probe.group;
 
       /* Implement replacement when another insert happens
        * with a matching key.  This is a relatively common
@@ -409,22 +366,38 @@ hash_table_insert(struct hash_table *ht, uint32_t hash,
        * required to avoid memory leaks, perform a search
        * before inserting.
        */
-      if (!entry_is_deleted(ht, entry) &&
-          entry->hash == hash &&
-          ht->key_equals_function(key, entry->key)) {
-         entry->key = key;
-         entry->data = data;
-         return entry;
+      hash_ctrl_mask match = hash_ctrl_match(group, tag);
+      while (match) {
+         struct hash_entry *entry =
+            ht->table + probe.group + hash_ctrl_mask_next(&match);
+
+         if (entry->hash == hash && ht->key_equals_function(key, entry->key)) {
+            entry->key = key;
+            entry->data = data;
+            return entry;
+         }
+      }
+
+      /* Stash the first available entry we find */
+      if (available_entry == NULL) {
+         hash_ctrl_mask available = hash_ctrl_match_available(group);
+         if (available) {
+            available_entry = ht->table + probe.group +
+                              hash_ctrl_mask_next(&available);
+         }
       }
 
-      hash_address += double_hash;
-      if (hash_address >= size)
-         hash_address -= size;
-   } while (hash_address != start_hash_address);
+      if (hash_ctrl_match(group, HASH_CTRL_EMPTY))
+         break;
+
+      hash_ctrl_probe_next(&probe);
+   }
 
    if (available_entry) {
-      if (entry_is_deleted(ht, available_entry))
+      uint32_t index = entry_index(ht, available_entry);
+      if (ht->ctrl[index] == HASH_CTRL_DELETED)
          ht->deleted_entries--;
+      ht->ctrl[index] = tag;
       available_entry->hash = hash;
       available_entry->key = key;
       available_entry->data = data;
@@ -472,9 +445,24 @@ _mesa_hash_table_remove(struct hash_table *ht,
    if (!entry)
       return;
 
+   uint32_t index = entry_index(ht, entry);
+   uint32_t group = ht->size > HASH_CTRL_GROUP_SIZE ?
+                    index & ~(HASH_CTRL_GROUP_SIZE - 1) : 0;
+
+   /* A probe only moves past a group that has no empty slot, and a group
+    * never gets an empty slot back before the next rehash.  So if this
+    * group still has one, nothing was ever probed past it and the slot can
+    * be made empty rather than leaving a tombstone.
+    */
+   if (hash_ctrl_match(ht->ctrl + group, HASH_CTRL_EMPTY)) {
+      ht->ctrl[index] = HASH_CTRL_EMPTY;
+   } else {
+      ht->ctrl[index] = HASH_CTRL_DELETED;
+      ht->deleted_entries++;
+   }
+
    entry->key = ht->deleted_key;
    ht->entries--;
-   ht->deleted_entries++;
 }
 
 /**
@@ -496,15 +484,11 @@ struct hash_entry *
 _mesa_hash_table_next_entry(struct hash_table *ht,
                             struct hash_entry *entry)
 {
-   if (entry == NULL)
-      entry = ht->table;
-   else
-      entry = entry + 1;
+   uint32_t i = entry == NULL ? 0 : entry_index(ht, entry) + 1;
 
-   for (; entry != ht->table + ht->size; entry++) {
-      if (entry_is_present(ht, entry)) {
-         return entry;
-      }
+   for (; i < ht->size; i++) {
+      if (hash_ctrl_is_full(ht->ctrl[i]))
+         return ht->table + i;
    }
 
    return NULL;
@@ -0,0 +1,208 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * \file hash_table_ctrl.h
+ *
+ * Control bytes shared by the hash_table and set implementations.
+ *
+ * Both are open-addressing tables with a power-of-two number of slots.  Next
+ * to the array of entries they keep one control byte per slot, which is
+ * either one of the reserved values below or, for a slot in use, a 7-bit tag
+ * taken from the hash of its key.  Slots are probed a group of
+ * HASH_CTRL_GROUP_SIZE at a time: a single SSE2 compare finds every slot of
+ * the group whose tag matches, so the entries themselves (and the key
+ * comparison callback) are only touched for likely matches.  Groups are
+ * visited in triangular order, which covers all of them for a power-of-two
+ * group count, and a probe stops at the first group with an empty slot.
+ *
+ * Tables smaller than a group still have a full group of control bytes; the
+ * slots past the end are HASH_CTRL_SENTINEL and never match anything.
+ *
+ * This header is internal to hash_table.c and set.c.
+ */
+
+#ifndef HASH_TABLE_CTRL_H
+#define HASH_TABLE_CTRL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bitscan.h"
+#include "macros.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define HASH_CTRL_EMPTY    ((uint8_t) 0x80)
+#define HASH_CTRL_DELETED  ((uint8_t) 0xfe)
+#define HASH_CTRL_SENTINEL ((uint8_t) 0xff)
+
+#define HASH_CTRL_GROUP_SIZE 16
+#define HASH_CTRL_MIN_SIZE_LOG2 2
+
+/* Bitmask with one bit per slot of a group. */
+typedef uint32_t hash_ctrl_mask;
+
+static inline bool
+hash_ctrl_is_full(uint8_t ctrl)
+{
+   return ctrl < 0x80;
+}
+
+/* Tag stored in the control byte of a slot in use. */
+static inline uint8_t
+hash_ctrl_tag(uint32_t hash)
+{
+   return (hash * 0x85ebca6bu) >> 25;
+}
+
+/* First slot to probe for a table of 2^size_log2 slots. */
+static inline uint32_t
+hash_ctrl_start(uint32_t hash, unsigned size_log2)
+{
+   /* Fibonacci hashing: the top bits of the product depend on all of the
+    * bits of the hash, which matters for the weak pointer hashes.
+    */
+   return (hash * 0x9e3779b1u) >> (32 - size_log2);
+}
+
+/* Number of control bytes for a table of 2^size_log2 slots. */
+static inline uint32_t
+hash_ctrl_bytes(unsigned size_log2)
+{
+   return MAX2(1u << size_log2, HASH_CTRL_GROUP_SIZE);
+}
+
+/* Maximum number of entries (present or deleted) before resizing, leaving
+ * 1/8th of the slots empty so that probes terminate quickly.
+ */
+static inline uint32_t
+hash_ctrl_max_entries(unsigned size_log2)
+{
+   uint32_t size = 1u << size_log2;
+   return size - size / 8 - (size < 8);
+}
+
+static inline void
+hash_ctrl_reset(uint8_t *ctrl, unsigned size_log2)
+{
+   uint32_t size = 1u << size_log2;
+
+   memset(ctrl, HASH_CTRL_EMPTY, size);
+   if (size < HASH_CTRL_GROUP_SIZE)
+      memset(ctrl + size, HASH_CTRL_SENTINEL, HASH_CTRL_GROUP_SIZE - size);
+}
+
+#ifdef __SSE2__
+
+static inline hash_ctrl_mask
+hash_ctrl_match(const uint8_t *group, uint8_t value)
+{
+   __m128i ctrl = _mm_loadu_si128((const __m128i *) group);
+   __m128i match = _mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char) value));
+   return _mm_movemask_epi8(match);
+}
+
+static inline hash_ctrl_mask
+hash_ctrl_match_available(const uint8_t *group)
+{
+   /* Empty and deleted slots are the only ones with the high bit set apart
+    * from the sentinels.
+    */
+   __m128i ctrl = _mm_loadu_si128((const __m128i *) group);
+   __m128i sentinel = _mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char) 0xff));
+   return _mm_movemask_epi8(_mm_andnot_si128(sentinel, ctrl));
+}
+
+#else
+
+static inline hash_ctrl_mask
+hash_ctrl_match(const uint8_t *group, uint8_t value)
+{
+   hash_ctrl_mask mask = 0;
+   for (unsigned i = 0; i < HASH_CTRL_GROUP_SIZE; i++)
+      mask |= (hash_ctrl_mask) (group[i] == value) << i;
+   return mask;
+}
+
+static inline hash_ctrl_mask
+hash_ctrl_match_available(const uint8_t *group)
+{
+   hash_ctrl_mask mask = 0;
+   for (unsigned i = 0; i < HASH_CTRL_GROUP_SIZE; i++) {
+      mask |= (hash_ctrl_mask) (group[i] == HASH_CTRL_EMPTY ||
+                                group[i] == HASH_CTRL_DELETED) << i;
+   }
+   return mask;
+}
+
+#endif
+
+/**
+ * Iterate over the groups of a probe sequence.
+ *
+ * \p group is the index of the first slot of the current group.  For tables
+ * smaller than a group there is only one.
+ */
+struct hash_ctrl_probe {
+   uint32_t group;
+   uint32_t group_mask;
+   uint32_t stride;
+};
+
+static inline struct hash_ctrl_probe
+hash_ctrl_probe_start(uint32_t hash, unsigned size_log2)
+{
+   struct hash_ctrl_probe probe;
+
+   if ((1u << size_log2) <= HASH_CTRL_GROUP_SIZE) {
+      probe.group = 0;
+      probe.group_mask = 0;
+   } else {
+      probe.group = hash_ctrl_start(hash, size_log2) &
+                    ~(HASH_CTRL_GROUP_SIZE - 1);
+      probe.group_mask = (1u << size_log2) - 1;
+   }
+   probe.stride = 0;
+
+   return probe;
+}
+
+static inline void
+hash_ctrl_probe_next(struct hash_ctrl_probe *probe)
+{
+   probe->stride += HASH_CTRL_GROUP_SIZE;
+   probe->group = (probe->group + probe->stride) & probe->group_mask;
+}
+
+/* Pop the lowest slot out of a match mask. */
+static inline unsigned
+hash_ctrl_mask_next(hash_ctrl_mask *mask)
+{
+   return u_bit_scan(mask);
+}
+
+#endif /* HASH_TABLE_CTRL_H */
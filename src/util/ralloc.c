@@ -66,6 +66,12 @@ struct
    unsigned canary;
 #endif
 
+   /* Where the block's storage comes from, see ralloc_block_kind.  This
+    * fits in the padding left by the alignment, so it doesn't grow the
+    * header on 64-bit.
+    */
+   unsigned flags;
+
    struct ralloc_header *parent;
 
    /* The first child (head of a linked list) */
@@ -83,6 +89,260 @@ typedef struct ralloc_header ralloc_header;
 static void unlink_block(ralloc_header *info);
 static void unsafe_free(ralloc_header *info);
 
+/***************************************************************************
+ * Slab-backed contexts.
+ ***************************************************************************
+ *
+ * A context created with ralloc_slab_context() owns a pool, and every
+ * descendant of that context is carved out of the pool's pages instead of
+ * being malloc'ed on its own.  Blocks are rounded up to a multiple of
+ * RALLOC_SLAB_GRANULE bytes (header included) and freed blocks go to a free
+ * list per size class, so freeing and reallocating small objects never
+ * touches malloc.  Blocks too large for the slabs are malloc'ed with a
+ * pointer to the pool stored in front of the header so that their own
+ * children still come from the pool.
+ *
+ * The pool is reference-counted by the blocks that point to it.  When the
+ * last one is freed (normally the slab context itself, after all its
+ * children) every page is released at once.  A block that was
+ * ralloc_steal'ed into another tree simply keeps the pool alive until it is
+ * freed, so stealing keeps working.  A pool is not thread-safe, so blocks
+ * stolen out of it must not be freed on another thread while the original
+ * tree is still in use.
+ */
+
+enum ralloc_block_kind {
+   /* Plain malloc'ed block outside of any pool. */
+   RALLOC_BLOCK_MALLOC = 0,
+   /* malloc'ed block with a ralloc_pool_prefix in front of the header. */
+   RALLOC_BLOCK_POOL_MALLOC = 1,
+   /* Block carved out of a pool page. */
+   RALLOC_BLOCK_SLAB = 2,
+};
+
+#define RALLOC_KIND_MASK 0x3
+#define RALLOC_CLASS_SHIFT 2
+#define RALLOC_CLASS_MASK 0x3f
+#define RALLOC_PAGE_OFFSET_SHIFT 8
+
+#define RALLOC_SLAB_GRANULE 16
+#define RALLOC_SLAB_CLASSES 32
+#define RALLOC_SLAB_MAX_BLOCK (RALLOC_SLAB_GRANULE * RALLOC_SLAB_CLASSES)
+#define RALLOC_SLAB_MIN_PAGE_SIZE (4 * 1024)
+#define RALLOC_SLAB_MAX_PAGE_SIZE (64 * 1024)
+
+struct ralloc_slab_page {
+   struct ralloc_slab_pool *pool;
+   struct ralloc_slab_page *next;
+};
+
+struct ralloc_slab_pool {
+   /* Freed blocks, linked through ralloc_header::next */
+   ralloc_header *free_list[RALLOC_SLAB_CLASSES];
+
+   struct ralloc_slab_page *pages;
+
+   /* Unused tail of the most recent page */
+   char *cur;
+   size_t cur_left;
+   size_t next_page_size;
+
+   struct ralloc_slab_stats stats;
+};
+
+struct
+#ifdef _MSC_VER
+ __declspec(align(8))
+#elif defined(__LP64__)
+ __attribute__((aligned(16)))
+#else
+ __attribute__((aligned(8)))
+#endif
+   ralloc_pool_prefix {
+   struct ralloc_slab_pool *pool;
+};
+
+#define SLAB_PAGE_HEADER_SIZE \
+   ALIGN_POT(sizeof(struct ralloc_slab_page), RALLOC_SLAB_GRANULE)
+
+static inline unsigned
+block_kind(const ralloc_header *info)
+{
+   return info->flags & RALLOC_KIND_MASK;
+}
+
+static inline unsigned
+slab_block_size(const ralloc_header *info)
+{
+   unsigned size_class = (info->flags >> RALLOC_CLASS_SHIFT) &
+                         RALLOC_CLASS_MASK;
+   return (size_class + 1) * RALLOC_SLAB_GRANULE;
+}
+
+static inline struct ralloc_slab_page *
+slab_block_page(const ralloc_header *info)
+{
+   size_t offset = (size_t) (info->flags >> RALLOC_PAGE_OFFSET_SHIFT) *
+                   RALLOC_SLAB_GRANULE;
+   return (struct ralloc_slab_page *) ((char *) info - offset);
+}
+
+static inline struct ralloc_pool_prefix *
+get_pool_prefix(const ralloc_header *info)
+{
+   return ((struct ralloc_pool_prefix *) info) - 1;
+}
+
+static struct ralloc_slab_pool *
+get_pool(const ralloc_header *info)
+{
+   switch (block_kind(info)) {
+   case RALLOC_BLOCK_POOL_MALLOC:
+      return get_pool_prefix(info)->pool;
+   case RALLOC_BLOCK_SLAB:
+      return slab_block_page(info)->pool;
+   default:
+      return NULL;
+   }
+}
+
+static void
+destroy_pool(struct ralloc_slab_pool *pool)
+{
+   struct ralloc_slab_page *page = pool->pages;
+
+   while (page) {
+      struct ralloc_slab_page *next = page->next;
+      free(page);
+      page = next;
+   }
+
+   free(pool);
+}
+
+static inline void
+pool_release(struct ralloc_slab_pool *pool)
+{
+   assert(pool->stats.live_blocks > 0);
+   if (--pool->stats.live_blocks == 0)
+      destroy_pool(pool);
+}
+
+static bool
+pool_grow(struct ralloc_slab_pool *pool, size_t min_size)
+{
+   /* Start small so that short-lived contexts stay cheap, then double up
+    * to the maximum page size.
+    */
+   size_t size = pool->next_page_size;
+   while (size < SLAB_PAGE_HEADER_SIZE + min_size)
+      size *= 2;
+
+   struct ralloc_slab_page *page = malloc(size);
+   if (unlikely(page == NULL))
+      return false;
+
+   page->pool = pool;
+   page->next = pool->pages;
+   pool->pages = page;
+
+   pool->cur = (char *) page + SLAB_PAGE_HEADER_SIZE;
+   pool->cur_left = size - SLAB_PAGE_HEADER_SIZE;
+   pool->next_page_size = MIN2(size * 2, RALLOC_SLAB_MAX_PAGE_SIZE);
+
+   pool->stats.page_count++;
+   pool->stats.page_bytes += size;
+   return true;
+}
+
+/* Allocate a block with room for \p size bytes after the header out of
+ * \p pool, and return its header with flags set.
+ */
+static ralloc_header *
+pool_alloc(struct ralloc_slab_pool *pool, size_t size)
+{
+   ralloc_header *info;
+
+   if (unlikely(size > RALLOC_SLAB_MAX_BLOCK - sizeof(ralloc_header))) {
+      struct ralloc_pool_prefix *prefix =
+         malloc(sizeof(struct ralloc_pool_prefix) + sizeof(ralloc_header) +
+                size);
+      if (unlikely(prefix == NULL))
+         return NULL;
+
+      prefix->pool = pool;
+      info = (ralloc_header *) &prefix[1];
+      info->flags = RALLOC_BLOCK_POOL_MALLOC;
+
+      pool->stats.malloc_allocs++;
+      pool->stats.live_blocks++;
+      return info;
+   }
+
+   unsigned size_class = (sizeof(ralloc_header) + size +
+                          RALLOC_SLAB_GRANULE - 1) / RALLOC_SLAB_GRANULE - 1;
+   unsigned block_size = (size_class + 1) * RALLOC_SLAB_GRANULE;
+
+   info = pool->free_list[size_class];
+   if (info != NULL) {
+      pool->free_list[size_class] = info->next;
+      pool->stats.freelist_reuses++;
+   } else {
+      if (unlikely(pool->cur_left < block_size) &&
+          !pool_grow(pool, block_size))
+         return NULL;
+
+      info = (ralloc_header *) pool->cur;
+      pool->cur += block_size;
+      pool->cur_left -= block_size;
+
+      size_t offset = (char *) info - (char *) pool->pages;
+      info->flags = RALLOC_BLOCK_SLAB |
+                    (size_class << RALLOC_CLASS_SHIFT) |
+                    (unsigned) (offset / RALLOC_SLAB_GRANULE)
+                       << RALLOC_PAGE_OFFSET_SHIFT;
+   }
+
+   pool->stats.slab_allocs++;
+   pool->stats.live_blocks++;
+   pool->stats.live_slab_bytes += block_size;
+   pool->stats.peak_slab_bytes = MAX2(pool->stats.peak_slab_bytes,
+                                      pool->stats.live_slab_bytes);
+   return info;
+}
+
+/* Return the storage of a block, without looking at its children. */
+static void
+free_block(ralloc_header *info)
+{
+   struct ralloc_slab_pool *pool;
+
+   switch (block_kind(info)) {
+   case RALLOC_BLOCK_MALLOC:
+      free(info);
+      break;
+   case RALLOC_BLOCK_POOL_MALLOC: {
+      struct ralloc_pool_prefix *prefix = get_pool_prefix(info);
+      pool = prefix->pool;
+      free(prefix);
+      pool_release(pool);
+      break;
+   }
+   case RALLOC_BLOCK_SLAB: {
+      unsigned size_class = (info->flags >> RALLOC_CLASS_SHIFT) &
+                            RALLOC_CLASS_MASK;
+      pool = slab_block_page(info)->pool;
+      info->next = pool->free_list[size_class];
+      pool->free_list[size_class] = info;
+      pool->stats.live_slab_bytes -= slab_block_size(info);
+      pool_release(pool);
+      break;
+   }
+   default:
+      unreachable("invalid ralloc block kind");
+   }
+}
+
 static ralloc_header *
 get_header(const void *ptr)
 {
@@ -116,14 +376,21 @@ ralloc_context(const void *ctx)
 void *
 ralloc_size(const void *ctx, size_t size)
 {
-   void *block = malloc(size + sizeof(ralloc_header));
+   ralloc_header *parent = ctx != NULL ? get_header(ctx) : NULL;
+   struct ralloc_slab_pool *pool = parent != NULL ? get_pool(parent) : NULL;
    ralloc_header *info;
-   ralloc_header *parent;
 
-   if (unlikely(block == NULL))
+   if (pool != NULL) {
+      info = pool_alloc(pool, size);
+   } else {
+      info = malloc(size + sizeof(ralloc_header));
+      if (likely(info != NULL))
+         info->flags = RALLOC_BLOCK_MALLOC;
+   }
+
+   if (unlikely(info == NULL))
       return NULL;
 
-   info = (ralloc_header *) block;
    /* measurements have shown that calloc is slower (because of
     * the multiplication overflow checking?), so clear things
     * manually
@@ -134,8 +401,6 @@ ralloc_size(const void *ctx, size_t size)
    info->next = NULL;
    info->destructor = NULL;
 
-   parent = ctx != NULL ? get_header(ctx) : NULL;
-
    add_child(parent, info);
 
 #ifndef NDEBUG
@@ -163,7 +428,37 @@ resize(void *ptr, size_t size)
    ralloc_header *child, *old, *info;
 
    old = get_header(ptr);
-   info = realloc(old, size + sizeof(ralloc_header));
+
+   switch (block_kind(old)) {
+   case RALLOC_BLOCK_MALLOC:
+      info = realloc(old, size + sizeof(ralloc_header));
+      break;
+   case RALLOC_BLOCK_POOL_MALLOC: {
+      struct ralloc_pool_prefix *prefix =
+         realloc(get_pool_prefix(old), sizeof(struct ralloc_pool_prefix) +
+                                       sizeof(ralloc_header) + size);
+      info = prefix ? (ralloc_header *) &prefix[1] : NULL;
+      break;
+   }
+   case RALLOC_BLOCK_SLAB: {
+      unsigned old_size = slab_block_size(old) - sizeof(ralloc_header);
+      if (size <= old_size)
+         return ptr;
+
+      /* Move to a bigger block, keeping the links of the old header. */
+      info = pool_alloc(slab_block_page(old)->pool, size);
+      if (info == NULL)
+         return NULL;
+
+      unsigned flags = info->flags;
+      memcpy(info, old, sizeof(ralloc_header) + old_size);
+      info->flags = flags;
+      free_block(old);
+      break;
+   }
+   default:
+      unreachable("invalid ralloc block kind");
+   }
 
    if (info == NULL)
       return NULL;
@@ -296,7 +591,57 @@ unsafe_free(ralloc_header *info)
    if (info->destructor != NULL)
       info->destructor(PTR_FROM_HEADER(info));
 
-   free(info);
+   free_block(info);
+}
+
+void *
+ralloc_slab_context(const void *ctx)
+{
+   struct ralloc_slab_pool *pool = calloc(1, sizeof(*pool));
+   if (unlikely(pool == NULL))
+      return NULL;
+
+   pool->next_page_size = RALLOC_SLAB_MIN_PAGE_SIZE;
+
+   struct ralloc_pool_prefix *prefix =
+      malloc(sizeof(struct ralloc_pool_prefix) + sizeof(ralloc_header));
+   if (unlikely(prefix == NULL)) {
+      free(pool);
+      return NULL;
+   }
+
+   prefix->pool = pool;
+   pool->stats.live_blocks = 1;
+
+   ralloc_header *info = (ralloc_header *) &prefix[1];
+   info->flags = RALLOC_BLOCK_POOL_MALLOC;
+   info->parent = NULL;
+   info->child = NULL;
+   info->prev = NULL;
+   info->next = NULL;
+   info->destructor = NULL;
+
+   add_child(ctx != NULL ? get_header(ctx) : NULL, info);
+
+#ifndef NDEBUG
+   info->canary = CANARY;
+#endif
+
+   return PTR_FROM_HEADER(info);
+}
+
+bool
+ralloc_slab_get_stats(const void *ptr, struct ralloc_slab_stats *stats)
+{
+   struct ralloc_slab_pool *pool = ptr ? get_pool(get_header(ptr)) : NULL;
+
+   if (pool == NULL) {
+      memset(stats, 0, sizeof(*stats));
+      return false;
+   }
+
+   *stats = pool->stats;
+   return true;
 }
 
 void
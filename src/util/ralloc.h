@@ -91,6 +91,51 @@ extern "C" {
  */
 void *ralloc_context(const void *ctx);
 
+/**
+ * Allocate a new slab-backed ralloc context.
+ *
+ * This behaves exactly like ralloc_context(), but the context and all of its
+ * descendants allocate from per-context slabs: small blocks are carved out
+ * of large pages and recycled through size-class free lists instead of going
+ * through malloc and free one by one, and the pages are released in bulk
+ * once the context and everything allocated under it has been freed.
+ *
+ * Use it for large, short-lived trees of small allocations such as the IR
+ * of a shader being compiled.  A slab context is not thread-safe: blocks
+ * that are ralloc_steal'ed out of it keep its pages alive and must not be
+ * freed concurrently with allocations in the original tree.
+ */
+void *ralloc_slab_context(const void *ctx);
+
+/**
+ * Allocator statistics of a slab-backed context, see ralloc_slab_get_stats().
+ */
+struct ralloc_slab_stats {
+   /** Number of blocks carved out of the slabs, including reuses. */
+   size_t slab_allocs;
+   /** Number of slab blocks recycled from a free list. */
+   size_t freelist_reuses;
+   /** Number of blocks too large for the slabs, which were malloc'ed. */
+   size_t malloc_allocs;
+   /** Number of live blocks using the pool, the context included. */
+   size_t live_blocks;
+   /** Bytes of slab blocks currently in use, headers included. */
+   size_t live_slab_bytes;
+   /** Maximum of live_slab_bytes over the pool's lifetime. */
+   size_t peak_slab_bytes;
+   /** Number and total size of the slab pages allocated. */
+   size_t page_count;
+   size_t page_bytes;
+};
+
+/**
+ * Get the allocator statistics of the slab context \p ptr belongs to.
+ *
+ * \p ptr may be the slab context itself or any of its descendants.  Returns
+ * false and zeroes \p stats if \p ptr is not slab-backed.
+ */
+bool ralloc_slab_get_stats(const void *ptr, struct ralloc_slab_stats *stats);
+
 /**
  * Allocate memory chained off of the given context.
  *
@@ -71,14 +71,27 @@
  */
 
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
 
 #include "ralloc.h"
 #include "main/imports.h"
 #include "main/macros.h"
 #include "util/bitset.h"
+#include "util/u_math.h"
+#include "util/simple_mtx.h"
+#include "util/u_debug.h"
 #include "register_allocate.h"
 
 #define NO_REG ~0U
+#define NO_NODE ~0U
+
+/* Graphs with more nodes than this don't get an adjacency bitset per node,
+ * which takes n^2 bits in total and is mostly empty for big shaders.
+ * Checking for an existing edge walks the shorter of the two adjacency
+ * lists instead.
+ */
+#define RA_MAX_DENSE_NODES 4096
 
 struct ra_reg {
    BITSET_WORD *conflicts;
@@ -125,6 +138,8 @@ struct ra_node {
     *
     * List of which nodes this node interferes with.  This should be
     * symmetric with the other node.
+    *
+    * The adjacency bitset is NULL in sparse graphs.
     */
    BITSET_WORD *adjacency;
    unsigned int *adjacency_list;
@@ -171,6 +186,9 @@ struct ra_graph {
 
    unsigned int alloc; /**< count of nodes allocated. */
 
+   /** Whether the graph is too big for per-node adjacency bitsets */
+   bool sparse;
+
    unsigned int (*select_reg_callback)(struct ra_graph *g, BITSET_WORD *regs,
                                        void *data);
    void *select_reg_callback_data;
@@ -189,14 +207,22 @@ struct ra_graph {
       /** Bit-set indicating, for each register, the value of the pq test */
       BITSET_WORD *pq_test;
 
-      /** For each BITSET_WORD, the minimum q value or ~0 if unknown */
-      unsigned int *min_q_total;
+      /**
+       * Bit-set indicating, for each BITSET_WORD of pq_test, whether it may
+       * have nodes that can be pushed on the stack.  Cleared lazily.
+       */
+      BITSET_WORD *pq_words;
 
-      /*
-       * * For each BITSET_WORD, the node with the minimum q_total if
-       * min_q_total[i] != ~0.
+      /**
+       * Tournament tree over the BITSET_WORDs of nodes, for picking the node
+       * to push optimistically: the node with the lowest q_total that is
+       * neither in the stack nor trivially colorable, or NO_NODE.  Leaves
+       * start at min_q_leaves and the root is at 1.  Only built the first
+       * time simplify gets stuck.
        */
-      unsigned int *min_q_node;
+      unsigned int *min_q_tree;
+      unsigned int min_q_leaves;
+      bool min_q_tree_valid;
 
       /**
        * Tracks the start of the set of optimistically-colored registers in the
@@ -417,10 +443,32 @@ ra_set_finalize(struct ra_regs *regs, unsigned int **q_values)
    }
 }
 
+static bool
+ra_nodes_interfere(struct ra_graph *g, unsigned int n1, unsigned int n2)
+{
+   if (!g->sparse)
+      return BITSET_TEST(g->nodes[n1].adjacency, n2);
+
+   /* Adjacency is symmetric, so walking either list will do. */
+   if (g->nodes[n1].adjacency_count > g->nodes[n2].adjacency_count) {
+      unsigned int tmp = n1;
+      n1 = n2;
+      n2 = tmp;
+   }
+
+   for (unsigned int i = 0; i < g->nodes[n1].adjacency_count; i++) {
+      if (g->nodes[n1].adjacency_list[i] == n2)
+         return true;
+   }
+
+   return false;
+}
+
 static void
 ra_add_node_adjacency(struct ra_graph *g, unsigned int n1, unsigned int n2)
 {
-   BITSET_SET(g->nodes[n1].adjacency, n2);
+   if (!g->sparse)
+      BITSET_SET(g->nodes[n1].adjacency, n2);
 
    assert(n1 != n2);
 
@@ -443,7 +491,8 @@ ra_add_node_adjacency(struct ra_graph *g, unsigned int n1, unsigned int n2)
 static void
 ra_node_remove_adjacency(struct ra_graph *g, unsigned int n1, unsigned int n2)
 {
-   BITSET_CLEAR(g->nodes[n1].adjacency, n2);
+   if (!g->sparse)
+      BITSET_CLEAR(g->nodes[n1].adjacency, n2);
 
    assert(n1 != n2);
 
@@ -481,17 +530,31 @@ ra_realloc_interference_graph(struct ra_graph *g, unsigned int alloc)
 
    unsigned g_bitset_count = BITSET_WORDS(g->alloc);
    unsigned bitset_count = BITSET_WORDS(alloc);
+
+   if (alloc > RA_MAX_DENSE_NODES && !g->sparse) {
+      /* The adjacency lists have everything, so the bitsets can just go. */
+      for (unsigned i = 0; i < g->alloc; i++) {
+         ralloc_free(g->nodes[i].adjacency);
+         g->nodes[i].adjacency = NULL;
+      }
+      g->sparse = true;
+   }
+
    /* For nodes already in the graph, we just have to grow the adjacency set */
-   for (unsigned i = 0; i < g->alloc; i++) {
-      assert(g->nodes[i].adjacency != NULL);
-      g->nodes[i].adjacency = rerzalloc(g, g->nodes[i].adjacency, BITSET_WORD,
-                                        g_bitset_count, bitset_count);
+   if (!g->sparse) {
+      for (unsigned i = 0; i < g->alloc; i++) {
+         assert(g->nodes[i].adjacency != NULL);
+         g->nodes[i].adjacency = rerzalloc(g, g->nodes[i].adjacency,
+                                           BITSET_WORD,
+                                           g_bitset_count, bitset_count);
+      }
    }
 
    /* For new nodes, we have to fully initialize them */
    for (unsigned i = g->alloc; i < alloc; i++) {
       memset(&g->nodes[i], 0, sizeof(g->nodes[i]));
-      g->nodes[i].adjacency = rzalloc_array(g, BITSET_WORD, bitset_count);
+      if (!g->sparse)
+         g->nodes[i].adjacency = rzalloc_array(g, BITSET_WORD, bitset_count);
       g->nodes[i].adjacency_list_size = 4;
       g->nodes[i].adjacency_list =
          ralloc_array(g, unsigned int, g->nodes[i].adjacency_list_size);
@@ -511,10 +574,12 @@ ra_realloc_interference_graph(struct ra_graph *g, unsigned int alloc)
    g->tmp.reg_assigned = reralloc(g, g->tmp.reg_assigned, BITSET_WORD,
                                   bitset_count);
    g->tmp.pq_test = reralloc(g, g->tmp.pq_test, BITSET_WORD, bitset_count);
-   g->tmp.min_q_total = reralloc(g, g->tmp.min_q_total, unsigned int,
-                                 bitset_count);
-   g->tmp.min_q_node = reralloc(g, g->tmp.min_q_node, unsigned int,
-                                bitset_count);
+   g->tmp.pq_words = reralloc(g, g->tmp.pq_words, BITSET_WORD,
+                              BITSET_WORDS(bitset_count));
+
+   g->tmp.min_q_leaves = util_next_power_of_two(bitset_count);
+   g->tmp.min_q_tree = reralloc(g, g->tmp.min_q_tree, unsigned int,
+                                2 * g->tmp.min_q_leaves);
 
    g->alloc = alloc;
 }
@@ -580,7 +645,7 @@ ra_add_node_interference(struct ra_graph *g,
                          unsigned int n1, unsigned int n2)
 {
    assert(n1 < g->count && n2 < g->count);
-   if (n1 != n2 && !BITSET_TEST(g->nodes[n1].adjacency, n2)) {
+   if (n1 != n2 && !ra_nodes_interfere(g, n1, n2)) {
       ra_add_node_adjacency(g, n1, n2);
       ra_add_node_adjacency(g, n2, n1);
    }
@@ -592,31 +657,126 @@ ra_reset_node_interference(struct ra_graph *g, unsigned int n)
    for (unsigned int i = 0; i < g->nodes[n].adjacency_count; i++)
       ra_node_remove_adjacency(g, g->nodes[n].adjacency_list[i], n);
 
-   memset(g->nodes[n].adjacency, 0,
-          BITSET_WORDS(g->count) * sizeof(BITSET_WORD));
+   if (!g->sparse) {
+      memset(g->nodes[n].adjacency, 0,
+             BITSET_WORDS(g->count) * sizeof(BITSET_WORD));
+   }
    g->nodes[n].adjacency_count = 0;
 }
 
+/**
+ * Returns whether n1 is a better node than n2 to push optimistically: it has
+ * the lower q total, or the higher node index for the same q total.  Either
+ * may be NO_NODE.
+ */
+static bool
+is_better_optimistic_node(struct ra_graph *g, unsigned int n1, unsigned int n2)
+{
+   if (n1 == NO_NODE)
+      return false;
+   if (n2 == NO_NODE)
+      return true;
+
+   return g->nodes[n1].tmp.q_total < g->nodes[n2].tmp.q_total ||
+          (g->nodes[n1].tmp.q_total == g->nodes[n2].tmp.q_total && n1 > n2);
+}
+
+static unsigned int
+better_optimistic_node(struct ra_graph *g, unsigned int n1, unsigned int n2)
+{
+   return is_better_optimistic_node(g, n1, n2) ? n1 : n2;
+}
+
+/**
+ * Returns the best node to push optimistically out of the i-th BITSET_WORD
+ * of nodes.
+ */
+static unsigned int
+compute_min_q_word(struct ra_graph *g, unsigned int i)
+{
+   BITSET_WORD candidates = ~(g->tmp.in_stack[i] | g->tmp.reg_assigned[i] |
+                              g->tmp.pq_test[i]);
+   if (i == BITSET_WORDS(g->count) - 1)
+      candidates &= BITSET_MASK(g->count);
+
+   unsigned int best = NO_NODE;
+   while (candidates) {
+      unsigned int n = i * BITSET_WORDBITS + u_bit_scan(&candidates);
+      best = better_optimistic_node(g, n, best);
+   }
+
+   return best;
+}
+
+/**
+ * Recomputes the min_q_tree leaf for the i-th BITSET_WORD of nodes and the
+ * path from it to the root.
+ */
+static void
+update_min_q_word(struct ra_graph *g, unsigned int i)
+{
+   unsigned int *tree = g->tmp.min_q_tree;
+   unsigned int t = g->tmp.min_q_leaves + i;
+
+   tree[t] = compute_min_q_word(g, i);
+   for (t /= 2; t >= 1; t /= 2)
+      tree[t] = better_optimistic_node(g, tree[2 * t], tree[2 * t + 1]);
+}
+
+/**
+ * Updates the min_q_tree after the q_total of node n went down.
+ */
+static void
+min_q_node_decreased(struct ra_graph *g, unsigned int n)
+{
+   unsigned int *tree = g->tmp.min_q_tree;
+
+   /* Only n moved, so it can only win more comparisons than before. */
+   for (unsigned int t = g->tmp.min_q_leaves + n / BITSET_WORDBITS;
+        t >= 1; t /= 2) {
+      if (tree[t] != n) {
+         if (!is_better_optimistic_node(g, n, tree[t]))
+            break;
+         tree[t] = n;
+      }
+   }
+}
+
+static void
+build_min_q_tree(struct ra_graph *g)
+{
+   unsigned int *tree = g->tmp.min_q_tree;
+   unsigned int leaves = g->tmp.min_q_leaves;
+
+   for (unsigned int i = 0; i < leaves; i++) {
+      tree[leaves + i] = i < BITSET_WORDS(g->count) ?
+                         compute_min_q_word(g, i) : NO_NODE;
+   }
+
+   for (unsigned int t = leaves - 1; t >= 1; t--)
+      tree[t] = better_optimistic_node(g, tree[2 * t], tree[2 * t + 1]);
+
+   g->tmp.min_q_tree_valid = true;
+}
+
 static void
 update_pq_info(struct ra_graph *g, unsigned int n)
 {
-   int i = n / BITSET_WORDBITS;
    int n_class = g->nodes[n].class;
    if (g->nodes[n].tmp.q_total < g->regs->classes[n_class]->p) {
+      if (BITSET_TEST(g->tmp.pq_test, n))
+         return;
+
       BITSET_SET(g->tmp.pq_test, n);
-   } else if (g->tmp.min_q_total[i] != UINT_MAX) {
-      /* Only update min_q_total and min_q_node if min_q_total != UINT_MAX so
-       * that we don't update while we have stale data and accidentally mark
-       * it as non-stale.  Also, in order to remain consistent with the old
-       * naive implementation of the algorithm, we do a lexicographical sort
-       * to ensure that we always choose the node with the highest node index.
-       */
-      if (g->nodes[n].tmp.q_total < g->tmp.min_q_total[i] ||
-          (g->nodes[n].tmp.q_total == g->tmp.min_q_total[i] &&
-           n > g->tmp.min_q_node[i])) {
-         g->tmp.min_q_total[i] = g->nodes[n].tmp.q_total;
-         g->tmp.min_q_node[i] = n;
-      }
+      BITSET_SET(g->tmp.pq_words, n / BITSET_WORDBITS);
+
+      /* The node isn't a candidate for optimistic coloring anymore. */
+      unsigned int i = n / BITSET_WORDBITS;
+      if (g->tmp.min_q_tree_valid &&
+          g->tmp.min_q_tree[g->tmp.min_q_leaves + i] == n)
+         update_min_q_word(g, i);
+   } else if (g->tmp.min_q_tree_valid) {
+      min_q_node_decreased(g, n);
    }
 }
 
@@ -644,8 +804,43 @@ add_node_to_stack(struct ra_graph *g, unsigned int n)
    g->tmp.stack_count++;
    BITSET_SET(g->tmp.in_stack, n);
 
-   /* Flag the min_q_total for n's block as dirty so it gets recalculated */
-   g->tmp.min_q_total[n / BITSET_WORDBITS] = UINT_MAX;
+   if (g->tmp.min_q_tree_valid)
+      update_min_q_word(g, n / BITSET_WORDBITS);
+}
+
+/**
+ * Returns the highest-numbered node below limit that passes the pq test and
+ * isn't in the stack or pre-assigned yet, or NO_NODE.
+ */
+static unsigned int
+find_pq_node(struct ra_graph *g, unsigned int limit)
+{
+   while (limit > 0) {
+      unsigned int i = (limit - 1) / BITSET_WORDBITS;
+      BITSET_WORD mask = BITSET_MASK(limit);
+      BITSET_WORD pq = g->tmp.pq_test[i] & mask &
+                       ~(g->tmp.in_stack[i] | g->tmp.reg_assigned[i]);
+      if (pq)
+         return i * BITSET_WORDBITS + util_last_bit(pq) - 1;
+
+      if (mask == ~(BITSET_WORD)0)
+         BITSET_CLEAR(g->tmp.pq_words, i);
+
+      /* Skip ahead to the next lower word that may have something. */
+      limit = 0;
+      while (i > 0) {
+         unsigned int s = (i - 1) / BITSET_WORDBITS;
+         BITSET_WORD words = g->tmp.pq_words[s] & BITSET_MASK(i);
+         if (words) {
+            limit = (s * BITSET_WORDBITS + util_last_bit(words)) *
+                    BITSET_WORDBITS;
+            break;
+         }
+         i = s * BITSET_WORDBITS;
+      }
+   }
+
+   return NO_NODE;
 }
 
 /**
@@ -661,119 +856,62 @@ add_node_to_stack(struct ra_graph *g, unsigned int n)
 static void
 ra_simplify(struct ra_graph *g)
 {
-   bool progress = true;
    unsigned int stack_optimistic_start = UINT_MAX;
 
-   /* Figure out the high bit and bit mask for the first iteration of a loop
-    * over BITSET_WORDs.
-    */
-   const unsigned int top_word_high_bit = (g->count - 1) % BITSET_WORDBITS;
-
    /* Do a quick pre-pass to set things up */
    g->tmp.stack_count = 0;
-   for (int i = BITSET_WORDS(g->count) - 1, high_bit = top_word_high_bit;
-        i >= 0; i--, high_bit = BITSET_WORDBITS - 1) {
+   g->tmp.min_q_tree_valid = false;
+   memset(g->tmp.pq_words, 0,
+          BITSET_WORDS(BITSET_WORDS(g->count)) * sizeof(BITSET_WORD));
+   for (unsigned int i = 0; i < BITSET_WORDS(g->count); i++) {
       g->tmp.in_stack[i] = 0;
       g->tmp.reg_assigned[i] = 0;
       g->tmp.pq_test[i] = 0;
-      g->tmp.min_q_total[i] = UINT_MAX;
-      g->tmp.min_q_node[i] = UINT_MAX;
-      for (int j = high_bit; j >= 0; j--) {
-         unsigned int n = i * BITSET_WORDBITS + j;
-         g->nodes[n].reg = g->nodes[n].forced_reg;
-         g->nodes[n].tmp.q_total = g->nodes[n].q_total;
-         if (g->nodes[n].reg != NO_REG)
-            g->tmp.reg_assigned[i] |= BITSET_BIT(j);
-         update_pq_info(g, n);
-      }
+   }
+   for (unsigned int n = 0; n < g->count; n++) {
+      g->nodes[n].reg = g->nodes[n].forced_reg;
+      g->nodes[n].tmp.q_total = g->nodes[n].q_total;
+      if (g->nodes[n].reg != NO_REG)
+         BITSET_SET(g->tmp.reg_assigned, n);
+      update_pq_info(g, n);
    }
 
-   while (progress) {
-      unsigned int min_q_total = UINT_MAX;
-      unsigned int min_q_node = UINT_MAX;
-
-      progress = false;
-
-      for (int i = BITSET_WORDS(g->count) - 1, high_bit = top_word_high_bit;
-           i >= 0; i--, high_bit = BITSET_WORDBITS - 1) {
-         BITSET_WORD mask = ~(BITSET_WORD)0 >> (31 - high_bit);
-
-         BITSET_WORD skip = g->tmp.in_stack[i] | g->tmp.reg_assigned[i];
-         if (skip == mask)
-            continue;
-
-         BITSET_WORD pq = g->tmp.pq_test[i] & ~skip;
-         if (pq) {
-            /* In this case, we have stuff we can immediately take off the
-             * stack.  This also means that we're guaranteed to make progress
-             * and we don't need to bother updating lowest_q_total because we
-             * know we're going to loop again before attempting to do anything
-             * optimistic.
-             */
-            for (int j = high_bit; j >= 0; j--) {
-               if (pq & BITSET_BIT(j)) {
-                  unsigned int n = i * BITSET_WORDBITS + j;
-                  assert(n < g->count);
-                  add_node_to_stack(g, n);
-                  /* add_node_to_stack() may update pq_test for this word so
-                   * we need to update our local copy.
-                   */
-                  pq = g->tmp.pq_test[i] & ~skip;
-                  progress = true;
-               }
-            }
-         } else if (!progress) {
-            if (g->tmp.min_q_total[i] == UINT_MAX) {
-               /* The min_q_total and min_q_node are dirty because we added
-                * one of these nodes to the stack.  It needs to be
-                * recalculated.
-                */
-               for (int j = high_bit; j >= 0; j--) {
-                  if (skip & BITSET_BIT(j))
-                     continue;
-
-                  unsigned int n = i * BITSET_WORDBITS + j;
-                  assert(n < g->count);
-                  if (g->nodes[n].tmp.q_total < g->tmp.min_q_total[i]) {
-                     g->tmp.min_q_total[i] = g->nodes[n].tmp.q_total;
-                     g->tmp.min_q_node[i] = n;
-                  }
-               }
-            }
-            if (g->tmp.min_q_total[i] < min_q_total) {
-               min_q_node = g->tmp.min_q_node[i];
-               min_q_total = g->tmp.min_q_total[i];
-            }
-         }
+   /* Trivially colorable nodes are pushed in sweeps from the highest node
+    * number down.  Pushing a node can make its neighbors trivially
+    * colorable: the ones below it get pushed in the same sweep and the ones
+    * above it in the next one.
+    */
+   unsigned int limit = g->count;
+   bool progress = false;
+   while (g->count > 0) {
+      unsigned int n = find_pq_node(g, limit);
+      if (n != NO_NODE) {
+         add_node_to_stack(g, n);
+         limit = n;
+         progress = true;
+         continue;
       }
 
-      if (!progress && min_q_total != UINT_MAX) {
-         if (stack_optimistic_start == UINT_MAX)
-            stack_optimistic_start = g->tmp.stack_count;
-
-         add_node_to_stack(g, min_q_node);
-         progress = true;
+      limit = g->count;
+      if (progress) {
+         progress = false;
+         continue;
       }
-   }
 
-   g->tmp.stack_optimistic_start = stack_optimistic_start;
-}
+      if (!g->tmp.min_q_tree_valid)
+         build_min_q_tree(g);
 
-static bool
-ra_any_neighbors_conflict(struct ra_graph *g, unsigned int n, unsigned int r)
-{
-   unsigned int i;
+      n = g->tmp.min_q_tree[1];
+      if (n == NO_NODE)
+         break;
 
-   for (i = 0; i < g->nodes[n].adjacency_count; i++) {
-      unsigned int n2 = g->nodes[n].adjacency_list[i];
+      if (stack_optimistic_start == UINT_MAX)
+         stack_optimistic_start = g->tmp.stack_count;
 
-      if (!BITSET_TEST(g->tmp.in_stack, n2) &&
-          BITSET_TEST(g->regs->regs[r].conflicts, g->nodes[n2].reg)) {
-         return true;
-      }
+      add_node_to_stack(g, n);
    }
 
-   return false;
+   g->tmp.stack_optimistic_start = stack_optimistic_start;
 }
 
 /* Computes a bitfield of what regs are available for a given register
@@ -811,6 +949,29 @@ ra_compute_available_regs(struct ra_graph *g, unsigned int n, BITSET_WORD *regs)
    return false;
 }
 
+/**
+ * Returns the first register in the set, starting the search at start and
+ * wrapping around.  The set must not be empty.
+ */
+static unsigned int
+ra_find_first_reg(const BITSET_WORD *regs, unsigned int count,
+                  unsigned int start)
+{
+   start %= count;
+
+   unsigned int i = start / BITSET_WORDBITS;
+   BITSET_WORD word = regs[i] & ~(BITSET_BIT(start) - 1);
+   for (unsigned int w = 0; w <= BITSET_WORDS(count); w++) {
+      if (word)
+         return i * BITSET_WORDBITS + u_bit_scan(&word);
+
+      i = (i + 1) % BITSET_WORDS(count);
+      word = regs[i];
+   }
+
+   unreachable("no register in the set");
+}
+
 /**
  * Pops nodes from the stack back into the graph, coloring them with
  * registers as they go.
@@ -822,44 +983,30 @@ static bool
 ra_select(struct ra_graph *g)
 {
    int start_search_reg = 0;
-   BITSET_WORD *select_regs = NULL;
-
-   if (g->select_reg_callback)
-      select_regs = malloc(BITSET_WORDS(g->regs->count) * sizeof(BITSET_WORD));
+   BITSET_WORD *select_regs =
+      malloc(BITSET_WORDS(g->regs->count) * sizeof(BITSET_WORD));
 
    while (g->tmp.stack_count != 0) {
-      unsigned int ri;
-      unsigned int r = -1;
+      unsigned int r;
       int n = g->tmp.stack[g->tmp.stack_count - 1];
-      struct ra_class *c = g->regs->classes[g->nodes[n].class];
 
       /* set this to false even if we return here so that
        * ra_get_best_spill_node() considers this node later.
        */
       BITSET_CLEAR(g->tmp.in_stack, n);
 
-      if (g->select_reg_callback) {
-         if (!ra_compute_available_regs(g, n, select_regs)) {
-            free(select_regs);
-            return false;
-         }
+      if (!ra_compute_available_regs(g, n, select_regs)) {
+         free(select_regs);
+         return false;
+      }
 
+      if (g->select_reg_callback) {
          r = g->select_reg_callback(g, select_regs, g->select_reg_callback_data);
       } else {
          /* Find the lowest-numbered reg which is not used by a member
           * of the graph adjacent to us.
           */
-         for (ri = 0; ri < g->regs->count; ri++) {
-            r = (start_search_reg + ri) % g->regs->count;
-            if (!reg_belongs_to_class(r, c))
-               continue;
-
-            if (!ra_any_neighbors_conflict(g, n, r))
-               break;
-         }
-
-         if (ri >= g->regs->count)
-            return false;
+         r = ra_find_first_reg(select_regs, g->regs->count, start_search_reg);
       }
 
       g->nodes[n].reg = r;
@@ -884,9 +1031,34 @@ ra_select(struct ra_graph *g)
    return true;
 }
 
+DEBUG_GET_ONCE_OPTION(ra_dump, "MESA_RA_DUMP", NULL)
+
+/**
+ * Appends the graph to the file named by MESA_RA_DUMP, if set, for use
+ * with the register allocator benchmark.
+ */
+static void
+ra_dump_graph_to_env_file(struct ra_graph *g)
+{
+   static simple_mtx_t dump_mtx = _SIMPLE_MTX_INITIALIZER_NP;
+
+   const char *path = debug_get_option_ra_dump();
+   if (!path)
+      return;
+
+   simple_mtx_lock(&dump_mtx);
+   FILE *fp = fopen(path, "a");
+   if (fp) {
+      ra_dump_graph(g, fp);
+      fclose(fp);
+   }
+   simple_mtx_unlock(&dump_mtx);
+}
+
 bool
 ra_allocate(struct ra_graph *g)
 {
+   ra_dump_graph_to_env_file(g);
    ra_simplify(g);
    return ra_select(g);
 }
@@ -987,3 +1159,71 @@ ra_set_node_spill_cost(struct ra_graph *g, unsigned int n, float cost)
 {
    g->nodes[n].spill_cost = cost;
 }
+
+/**
+ * Writes the register set and the interference graph as text, in the
+ * format read by the register allocator benchmark in
+ * src/util/tests/register_allocate:
+ *
+ *    ra_graph <regs> <classes> <nodes>
+ *    reg <r> <count> <conflicting regs...>
+ *    class <c> <count> <regs...> q <q(c, 0)> ... <q(c, classes - 1)>
+ *    node <n> <class> <forced reg or -1> <count> <interfering nodes above n...>
+ *    end
+ */
+void
+ra_dump_graph(struct ra_graph *g, FILE *fp)
+{
+   struct ra_regs *regs = g->regs;
+
+   fprintf(fp, "ra_graph %u %u %u\n", regs->count, regs->class_count,
+           g->count);
+
+   for (unsigned int r = 0; r < regs->count; r++) {
+      BITSET_WORD tmp;
+      int c;
+
+      unsigned int count = 0;
+      for (unsigned int i = 0; i < BITSET_WORDS(regs->count); i++)
+         count += util_bitcount(regs->regs[r].conflicts[i]);
+
+      fprintf(fp, "reg %u %u", r, count);
+      BITSET_FOREACH_SET(c, tmp, regs->regs[r].conflicts, regs->count)
+         fprintf(fp, " %d", c);
+      fprintf(fp, "\n");
+   }
+
+   for (unsigned int c = 0; c < regs->class_count; c++) {
+      struct ra_class *class = regs->classes[c];
+      BITSET_WORD tmp;
+      int r;
+
+      fprintf(fp, "class %u %u", c, class->p);
+      BITSET_FOREACH_SET(r, tmp, class->regs, regs->count)
+         fprintf(fp, " %d", r);
+      fprintf(fp, " q");
+      for (unsigned int c2 = 0; c2 < regs->class_count; c2++)
+         fprintf(fp, " %u", class->q[c2]);
+      fprintf(fp, "\n");
+   }
+
+   for (unsigned int n = 0; n < g->count; n++) {
+      struct ra_node *node = &g->nodes[n];
+      unsigned int count = 0;
+
+      for (unsigned int i = 0; i < node->adjacency_count; i++) {
+         if (node->adjacency_list[i] > n)
+            count++;
+      }
+
+      fprintf(fp, "node %u %u %d %u", n, node->class,
+              node->forced_reg == NO_REG ? -1 : (int)node->forced_reg, count);
+      for (unsigned int i = 0; i < node->adjacency_count; i++) {
+         if (node->adjacency_list[i] > n)
+            fprintf(fp, " %u", node->adjacency_list[i]);
+      }
+      fprintf(fp, "\n");
+   }
+
+   fprintf(fp, "end\n");
+}
@@ -29,6 +29,7 @@
 #define REGISTER_ALLOCATE_H
 
 #include <stdbool.h>
+#include <stdio.h>
 #include "util/bitset.h"
 
 #ifdef __cplusplus
@@ -97,6 +98,8 @@ void ra_set_node_spill_cost(struct ra_graph *g, unsigned int n, float cost);
 int ra_get_best_spill_node(struct ra_graph *g);
 /** @} */
 
+void ra_dump_graph(struct ra_graph *g, FILE *fp);
+
 
 #ifdef __cplusplus
 }  // extern "C"
@@ -40,80 +40,64 @@
 #include "macros.h"
 #include "ralloc.h"
 #include "set.h"
-#include "fast_urem_by_const.h"
+#include "hash_table_ctrl.h"
 
 /*
- * From Knuth -- a good choice for hash/rehash values is p, p-2 where
- * p and p-2 are both prime.  These tables are sized to have an extra 10%
- * free to avoid exponential performance degradation as the hash table fills
+ * The set uses the same control-byte probing as the hash table, see
+ * hash_table_ctrl.h.
  */
 
 static const uint32_t deleted_key_value;
 static const void *deleted_key = &deleted_key_value;
 
-static const struct {
-   uint32_t max_entries, size, rehash;
-   uint64_t size_magic, rehash_magic;
-} hash_sizes[] = {
-#define ENTRY(max_entries, size, rehash) \
-   { max_entries, size, rehash, \
-      REMAINDER_MAGIC(size), REMAINDER_MAGIC(rehash) }
-
-   ENTRY(2,            5,            3            ),
-   ENTRY(4,            7,            5            ),
-   ENTRY(8,            13,           11           ),
-   ENTRY(16,           19,           17           ),
-   ENTRY(32,           43,           41           ),
-   ENTRY(64,           73,           71           ),
-   ENTRY(128,          151,          149          ),
-   ENTRY(256,          283,          281          ),
-   ENTRY(512,          571,          569          ),
-   ENTRY(1024,         1153,         1151         ),
-   ENTRY(2048,         2269,         2267         ),
-   ENTRY(4096,         4519,         4517         ),
-   ENTRY(8192,         9013,         9011         ),
-   ENTRY(16384,        18043,        18041        ),
-   ENTRY(32768,        36109,        36107        ),
-   ENTRY(65536,        72091,        72089        ),
-   ENTRY(131072,       144409,       144407       ),
-   ENTRY(262144,       288361,       288359       ),
-   ENTRY(524288,       576883,       576881       ),
-   ENTRY(1048576,      1153459,      1153457      ),
-   ENTRY(2097152,      2307163,      2307161      ),
-   ENTRY(4194304,      4613893,      4613891      ),
-   ENTRY(8388608,      9227641,      9227639      ),
-   ENTRY(16777216,     18455029,     18455027     ),
-   ENTRY(33554432,     36911011,     36911009     ),
-   ENTRY(67108864,     73819861,     73819859     ),
-   ENTRY(134217728,    147639589,    147639587    ),
-   ENTRY(268435456,    295279081,    295279079    ),
-   ENTRY(536870912,    590559793,    590559791    ),
-   ENTRY(1073741824,   1181116273,   1181116271   ),
-   ENTRY(2147483648ul, 2362232233ul, 2362232231ul )
-};
-
 static inline bool
 key_pointer_is_reserved(const void *key)
 {
    return key == NULL || key == deleted_key;
 }
 
-static int
-entry_is_free(struct set_entry *entry)
+static inline uint32_t
+entry_index(const struct set *ht, const struct set_entry *entry)
 {
-   return entry->key == NULL;
+   return entry - ht->table;
 }
 
-static int
-entry_is_deleted(struct set_entry *entry)
+static inline bool
+entry_is_present(const struct set *ht, const struct set_entry *entry)
 {
-   return entry->key == deleted_key;
+   return hash_ctrl_is_full(ht->ctrl[entry_index(ht, entry)]);
 }
 
-static int
-entry_is_present(struct set_entry *entry)
+static inline uint32_t
+num_groups(const struct set *ht)
 {
-   return entry->key != NULL && entry->key != deleted_key;
+   return MAX2(ht->size / HASH_CTRL_GROUP_SIZE, 1);
+}
+
+/* Allocate the entries and control bytes of a set of 2^size_log2 slots as a
+ * single block.
+ */
+static struct set_entry *
+alloc_table(void *mem_ctx, unsigned size_log2, uint8_t **ctrl)
+{
+   uint32_t size = 1u << size_log2;
+   struct set_entry *table =
+      rzalloc_size(mem_ctx, (size_t) size * sizeof(struct set_entry) +
+                            hash_ctrl_bytes(size_log2));
+   if (table == NULL)
+      return NULL;
+
+   *ctrl = (uint8_t *) (table + size);
+   hash_ctrl_reset(*ctrl, size_log2);
+   return table;
+}
+
+static void
+set_size(struct set *ht, unsigned size_log2)
+{
+   ht->size_index = size_log2;
+   ht->size = 1u << size_log2;
+   ht->max_entries = hash_ctrl_max_entries(size_log2);
 }
 
 struct set *
@@ -128,15 +112,10 @@ _mesa_set_create(void *mem_ctx,
    if (ht == NULL)
       return NULL;
 
-   ht->size_index = 0;
-   ht->size = hash_sizes[ht->size_index].size;
-   ht->rehash = hash_sizes[ht->size_index].rehash;
-   ht->size_magic = hash_sizes[ht->size_index].size_magic;
-   ht->rehash_magic = hash_sizes[ht->size_index].rehash_magic;
-   ht->max_entries = hash_sizes[ht->size_index].max_entries;
+   set_size(ht, HASH_CTRL_MIN_SIZE_LOG2);
    ht->key_hash_function = key_hash_function;
    ht->key_equals_function = key_equals_function;
-   ht->table = rzalloc_array(ht, struct set_entry, ht->size);
+   ht->table = alloc_table(ht, ht->size_index, &ht->ctrl);
    ht->entries = 0;
    ht->deleted_entries = 0;
 
@@ -159,13 +138,16 @@ _mesa_set_clone(struct set *set, void *dst_mem_ctx)
 
    memcpy(clone, set, sizeof(struct set));
 
-   clone->table = ralloc_array(clone, struct set_entry, clone->size);
+   size_t table_size = (size_t) clone->size * sizeof(struct set_entry) +
+                       hash_ctrl_bytes(clone->size_index);
+   clone->table = ralloc_size(clone, table_size);
    if (clone->table == NULL) {
       ralloc_free(clone);
       return NULL;
    }
 
-   memcpy(clone->table, set->table, clone->size * sizeof(struct set_entry));
+   memcpy(clone->table, set->table, table_size);
+   clone->ctrl = (uint8_t *) (clone->table + clone->size);
 
    return clone;
 }
@@ -209,6 +191,7 @@ _mesa_set_clear(struct set *set, void (*delete_function)(struct set_entry *entry
       entry->key = deleted_key;
    }
 
+   hash_ctrl_reset(set->ctrl, set->size_index);
    set->entries = set->deleted_entries = 0;
 }
 
@@ -222,26 +205,26 @@ set_search(const struct set *ht, uint32_t hash, const void *key)
 {
    assert(!key_pointer_is_reserved(key));
 
-   uint32_t size = ht->size;
-   uint32_t start_address = util_fast_urem32(hash, size, ht->size_magic);
-   uint32_t double_hash = util_fast_urem32(hash, ht->rehash,
-                                           ht->rehash_magic) + 1;
-   uint32_t hash_address = start_address;
-   do {
-      struct set_entry *entry = ht->table + hash_address;
+   uint8_t tag = hash_ctrl_tag(hash);
+   struct hash_ctrl_probe probe = hash_ctrl_probe_start(hash, ht->size_index);
 
-      if (entry_is_free(entry)) {
-         return NULL;
-      } else if (entry_is_present(entry) && entry->hash == hash) {
-         if (ht->key_equals_function(key, entry->key)) {
+   for (uint32_t i = num_groups(ht); i > 0; i--) {
+      const uint8_t *group = ht->ctrl + probe.group;
+
+      hash_ctrl_mask match = hash_ctrl_match(group, tag);
+      while (match) {
+         struct set_entry *entry =
+            ht->table + probe.group + hash_ctrl_mask_next(&match);
+
+         if (entry->hash == hash && ht->key_equals_function(key, entry->key))
             return entry;
-         }
       }
 
-      hash_address += double_hash;
-      if (hash_address >= size)
-         hash_address -= size;
-   } while (hash_address != start_address);
+      if (hash_ctrl_match(group, HASH_CTRL_EMPTY))
+         return NULL;
+
+      hash_ctrl_probe_next(&probe);
+   }
 
    return NULL;
 }
@@ -265,22 +248,23 @@ _mesa_set_search_pre_hashed(const struct set *set, uint32_t hash,
 static void
 set_add_rehash(struct set *ht, uint32_t hash, const void *key)
 {
-   uint32_t size = ht->size;
-   uint32_t start_address = util_fast_urem32(hash, size, ht->size_magic);
-   uint32_t double_hash = util_fast_urem32(hash, ht->rehash,
-                                           ht->rehash_magic) + 1;
-   uint32_t hash_address = start_address;
+   struct hash_ctrl_probe probe = hash_ctrl_probe_start(hash, ht->size_index);
+
    do {
-      struct set_entry *entry = ht->table + hash_address;
-      if (likely(entry->key == NULL)) {
+      hash_ctrl_mask available =
+         hash_ctrl_match(ht->ctrl + probe.group, HASH_CTRL_EMPTY);
+
+      if (likely(available)) {
+         uint32_t index = probe.group + hash_ctrl_mask_next(&available);
+         struct set_entry *entry = ht->table + index;
+
+         ht->ctrl[index] = hash_ctrl_tag(hash);
          entry->hash = hash;
          entry->key = key;
          return;
       }
 
-      hash_address = hash_address + double_hash;
-      if (hash_address >= size)
-         hash_address -= size;
+      hash_ctrl_probe_next(&probe);
    } while (true);
 }
 
@@ -289,24 +273,20 @@ set_rehash(struct set *ht, unsigned new_size_index)
 {
    struct set old_ht;
    struct set_entry *table;
+   uint8_t *ctrl;
 
-   if (new_size_index >= ARRAY_SIZE(hash_sizes))
+   if (new_size_index >= 32)
       return;
 
-   table = rzalloc_array(ht, struct set_entry,
-                         hash_sizes[new_size_index].size);
+   table = alloc_table(ht, new_size_index, &ctrl);
    if (table == NULL)
       return;
 
    old_ht = *ht;
 
    ht->table = table;
-   ht->size_index = new_size_index;
-   ht->size = hash_sizes[ht->size_index].size;
-   ht->rehash = hash_sizes[ht->size_index].rehash;
-   ht->size_magic = hash_sizes[ht->size_index].size_magic;
-   ht->rehash_magic = hash_sizes[ht->size_index].rehash_magic;
-   ht->max_entries = hash_sizes[ht->size_index].max_entries;
+   ht->ctrl = ctrl;
+   set_size(ht, new_size_index);
    ht->entries = 0;
    ht->deleted_entries = 0;
 
@@ -326,8 +306,8 @@ _mesa_set_resize(struct set *set, uint32_t entries)
    if (set->entries > entries)
       entries = set->entries;
 
-   unsigned size_index = 0;
-   while (hash_sizes[size_index].max_entries < entries)
+   unsigned size_index = HASH_CTRL_MIN_SIZE_LOG2;
+   while (size_index < 31 && hash_ctrl_max_entries(size_index) < entries)
       size_index++;
 
    set_rehash(set, size_index);
@@ -353,39 +333,45 @@ set_search_or_add(struct set *ht, uint32_t hash, const void *key, bool *found)
       set_rehash(ht, ht->size_index);
    }
 
-   uint32_t size = ht->size;
-   uint32_t start_address = util_fast_urem32(hash, size, ht->size_magic);
-   uint32_t double_hash = util_fast_urem32(hash, ht->rehash,
-                                           ht->rehash_magic) + 1;
-   uint32_t hash_address = start_address;
-   do {
-      struct set_entry *entry = ht->table + hash_address;
-
-      if (!entry_is_present(entry)) {
-         /* Stash the first available entry we find */
-         if (available_entry == NULL)
-            available_entry = entry;
-         if (entry_is_free(entry))
-            break;
+   uint8_t tag = hash_ctrl_tag(hash);
+   struct hash_ctrl_probe probe = hash_ctrl_probe_start(hash, ht->size_index);
+
+   for (uint32_t i = num_groups(ht); i > 0; i--) {
+      const uint8_t *group = ht->ctrl + probe.group;
+
+      hash_ctrl_mask match = hash_ctrl_match(group, tag);
+      while (match) {
+         struct set_entry *entry =
+            ht->table + probe.group + hash_ctrl_mask_next(&match);
+
+         if (entry->hash == hash && ht->key_equals_function(key, entry->key)) {
+            if (found)
+               *found = true;
+            return entry;
+         }
       }
 
-      if (!entry_is_deleted(entry) &&
-          entry->hash == hash &&
-          ht->key_equals_function(key, entry->key)) {
-         if (found)
-            *found = true;
-         return entry;
+      /* Stash the first available entry we find */
+      if (available_entry == NULL) {
+         hash_ctrl_mask available = hash_ctrl_match_available(group);
+         if (available) {
+            available_entry = ht->table + probe.group +
+                              hash_ctrl_mask_next(&available);
+         }
       }
 
-      hash_address = hash_address + double_hash;
-      if (hash_address >= size)
-         hash_address -= size;
-   } while (hash_address != start_address);
+      if (hash_ctrl_match(group, HASH_CTRL_EMPTY))
+         break;
+
+      hash_ctrl_probe_next(&probe);
+   }
 
    if (available_entry) {
       /* There is no matching entry, create it. */
-      if (entry_is_deleted(available_entry))
+      uint32_t index = entry_index(ht, available_entry);
+      if (ht->ctrl[index] == HASH_CTRL_DELETED)
          ht->deleted_entries--;
+      ht->ctrl[index] = tag;
       available_entry->hash = hash;
       available_entry->key = key;
       ht->entries++;
@@ -497,9 +483,22 @@ _mesa_set_remove(struct set *ht, struct set_entry *entry)
    if (!entry)
       return;
 
+   uint32_t index = entry_index(ht, entry);
+   uint32_t group = ht->size > HASH_CTRL_GROUP_SIZE ?
+                    index & ~(HASH_CTRL_GROUP_SIZE - 1) : 0;
+
+   /* No probe ever went past a group that still has an empty slot, see
+    * _mesa_hash_table_remove().
+    */
+   if (hash_ctrl_match(ht->ctrl + group, HASH_CTRL_EMPTY)) {
+      ht->ctrl[index] = HASH_CTRL_EMPTY;
+   } else {
+      ht->ctrl[index] = HASH_CTRL_DELETED;
+      ht->deleted_entries++;
+   }
+
    entry->key = deleted_key;
    ht->entries--;
-   ht->deleted_entries++;
 }
 
 /**
@@ -520,15 +519,11 @@ _mesa_set_remove_key(struct set *set, const void *key)
 struct set_entry *
 _mesa_set_next_entry(const struct set *ht, struct set_entry *entry)
 {
-   if (entry == NULL)
-      entry = ht->table;
-   else
-      entry = entry + 1;
+   uint32_t i = entry == NULL ? 0 : entry_index(ht, entry) + 1;
 
-   for (; entry != ht->table + ht->size; entry++) {
-      if (entry_is_present(entry)) {
-         return entry;
-      }
+   for (; i < ht->size; i++) {
+      if (hash_ctrl_is_full(ht->ctrl[i]))
+         return ht->table + i;
    }
 
    return NULL;
@@ -545,14 +540,14 @@ _mesa_set_random_entry(struct set *ht,
       return NULL;
 
    for (entry = ht->table + i; entry != ht->table + ht->size; entry++) {
-      if (entry_is_present(entry) &&
+      if (entry_is_present(ht, entry) &&
           (!predicate || predicate(entry))) {
          return entry;
       }
    }
 
    for (entry = ht->table; entry != ht->table + i; entry++) {
-      if (entry_is_present(entry) &&
+      if (entry_is_present(ht, entry) &&
           (!predicate || predicate(entry))) {
          return entry;
       }
@@ -43,13 +43,13 @@ struct set_entry {
 struct set {
    void *mem_ctx;
    struct set_entry *table;
+   /* One control byte per entry, see hash_table_ctrl.h */
+   uint8_t *ctrl;
    uint32_t (*key_hash_function)(const void *key);
    bool (*key_equals_function)(const void *a, const void *b);
    uint32_t size;
-   uint32_t rehash;
-   uint64_t size_magic;
-   uint64_t rehash_magic;
    uint32_t max_entries;
+   /* log2 of size */
    uint32_t size_index;
    uint32_t entries;
    uint32_t deleted_entries;
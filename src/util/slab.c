@@ -31,6 +31,9 @@
 #define SLAB_MAGIC_ALLOCATED 0xcafe4321
 #define SLAB_MAGIC_FREE 0x7ee01234
 
+/* Value of slab_child_pool::migrated once the pool is being destroyed. */
+#define SLAB_MIGRATED_CLOSED ((struct slab_element_header *)(intptr_t)1)
+
 #ifndef NDEBUG
 #define SET_MAGIC(element, value)   (element)->magic = (value)
 #define CHECK_MAGIC(element, value) assert((element)->magic == (value))
@@ -95,6 +98,104 @@ slab_free_orphaned(struct slab_element_header *elt)
       free(page);
 }
 
+/* Atomically replace the migrated list of a pool and return the old one. */
+static struct slab_element_header *
+slab_swap_migrated(struct slab_child_pool *pool,
+                   struct slab_element_header *value)
+{
+   struct slab_element_header *head = p_atomic_read(&pool->migrated);
+
+   for (;;) {
+      struct slab_element_header *old =
+         p_atomic_cmpxchg(&pool->migrated, head, value);
+      if (old == head)
+         return head;
+      head = old;
+   }
+}
+
+/* Push the chain first..last onto the migrated list of its owner. Returns
+ * false if the owner is being destroyed, in which case all elements of the
+ * chain have been orphaned and the caller must free them as such.
+ *
+ * Must be called with the remote_frees_in_flight counter of the parent
+ * raised, which keeps the owner alive.
+ */
+static bool
+slab_push_migrated(struct slab_child_pool *owner,
+                   struct slab_element_header *first,
+                   struct slab_element_header *last)
+{
+   struct slab_element_header *head = p_atomic_read(&owner->migrated);
+
+   for (;;) {
+      struct slab_element_header *old;
+
+      if (head == SLAB_MIGRATED_CLOSED)
+         return false;
+
+      last->next = head;
+      old = p_atomic_cmpxchg(&owner->migrated, head, first);
+      if (old == head)
+         return true;
+      head = old;
+   }
+}
+
+/* Hand the magazine of remote frees back to its owner. */
+static void
+slab_flush_magazine(struct slab_child_pool *pool)
+{
+   struct slab_parent_pool *parent = pool->parent;
+   struct slab_child_pool *owner = pool->magazine_owner;
+   struct slab_element_header *first = NULL, *last = NULL;
+   struct slab_element_header *elt = pool->magazine;
+
+   if (!elt)
+      return;
+
+   pool->magazine = NULL;
+   pool->magazine_owner = NULL;
+   pool->magazine_count = 0;
+
+   /* While this is raised, slab_destroy_child of the owner cannot return.
+    * Use a full read-modify-write so that it orders against the owner
+    * updates done there before it checks the counter.
+    */
+   p_atomic_inc(&parent->remote_frees_in_flight);
+
+   /* The owner may have been destroyed since the elements were added to the
+    * magazine, in which case they have been orphaned and another pool may
+    * even live at the same address now. Only elements that still point to
+    * the owner can be pushed to it.
+    */
+   while (elt) {
+      struct slab_element_header *next = elt->next;
+      intptr_t owner_int = p_atomic_read(&elt->owner);
+
+      if (owner_int & 1) {
+         slab_free_orphaned(elt);
+      } else {
+         assert(owner_int == (intptr_t)owner);
+         elt->next = first;
+         first = elt;
+         if (!last)
+            last = elt;
+      }
+      elt = next;
+   }
+
+   if (first && !slab_push_migrated(owner, first, last)) {
+      while (first) {
+         elt = first;
+         first = elt == last ? NULL : elt->next;
+         slab_free_orphaned(elt);
+      }
+   }
+
+   p_atomic_dec(&parent->remote_frees_in_flight);
+}
+
 /**
  * Create a parent pool for the allocation of same-sized objects.
  *
@@ -106,16 +207,16 @@ slab_create_parent(struct slab_parent_pool *parent,
                    unsigned item_size,
                    unsigned num_items)
 {
-   mtx_init(&parent->mutex, mtx_plain);
    parent->element_size = ALIGN_POT(sizeof(struct slab_element_header) + item_size,
                                     sizeof(intptr_t));
    parent->num_elements = num_items;
+   parent->remote_frees_in_flight = 0;
 }
 
 void
 slab_destroy_parent(struct slab_parent_pool *parent)
 {
-   mtx_destroy(&parent->mutex);
+   assert(!parent->remote_frees_in_flight);
 }
 
 /**
@@ -128,6 +229,9 @@ void slab_create_child(struct slab_child_pool *pool,
    pool->pages = NULL;
    pool->free = NULL;
    pool->migrated = NULL;
+   pool->magazine_owner = NULL;
+   pool->magazine = NULL;
+   pool->magazine_count = 0;
 }
 
 /**
@@ -138,10 +242,12 @@ void slab_create_child(struct slab_child_pool *pool,
  */
 void slab_destroy_child(struct slab_child_pool *pool)
 {
+   struct slab_element_header *migrated;
+
    if (!pool->parent)
       return; /* the slab probably wasn't even created */
 
-   mtx_lock(&pool->parent->mutex);
+   slab_flush_magazine(pool);
 
    while (pool->pages) {
       struct slab_page_header *page = pool->pages;
@@ -154,13 +260,21 @@ void slab_destroy_child(struct slab_child_pool *pool)
       }
    }
 
-   while (pool->migrated) {
-      struct slab_element_header *elt = pool->migrated;
-      pool->migrated = elt->next;
+   /* From now on, remote frees see the closed list and the orphaned owner.
+    * Everything pushed before is ours to free.
+    */
+   migrated = slab_swap_migrated(pool, SLAB_MIGRATED_CLOSED);
+   while (migrated) {
+      struct slab_element_header *elt = migrated;
+      migrated = elt->next;
       slab_free_orphaned(elt);
    }
 
-   mtx_unlock(&pool->parent->mutex);
+   /* Wait for remote frees that may still be looking at this pool. This is
+    * a read-modify-write rather than a plain read, see slab_flush_magazine.
+    */
+   while (p_atomic_cmpxchg(&pool->parent->remote_frees_in_flight, 0, 0))
+      thrd_yield();
 
    while (pool->free) {
       struct slab_element_header *elt = pool->free;
@@ -211,10 +325,8 @@ slab_alloc(struct slab_child_pool *pool)
       /* First, collect elements that belong to us but were freed from a
        * different child pool.
        */
-      mtx_lock(&pool->parent->mutex);
-      pool->free = pool->migrated;
-      pool->migrated = NULL;
-      mtx_unlock(&pool->parent->mutex);
+      if (p_atomic_read(&pool->migrated))
+         pool->free = slab_swap_migrated(pool, NULL);
 
       /* Now allocate a new page. */
       if (!pool->free && !slab_add_new_page(pool))
@@ -237,7 +349,10 @@ slab_alloc(struct slab_child_pool *pool)
  *
  * Freeing an object in a different child pool from the one where it was
  * allocated is allowed, as long the pool belong to the same parent. No
- * additional locking is required in this case.
+ * additional locking is required in this case. Such objects are batched in
+ * the magazine of the freeing pool and only returned to their owner when the
+ * magazine is full, when an object of a different owner is freed, or by
+ * slab_flush_remote_frees.
  */
 void slab_free(struct slab_child_pool *pool, void *ptr)
 {
@@ -257,23 +372,40 @@ void slab_free(struct slab_child_pool *pool, void *ptr)
    }
 
    /* The slow case: migration or an orphaned page. */
-   mtx_lock(&pool->parent->mutex);
-
-   /* Note: we _must_ re-read elt->owner here because the owning child pool
-    * may have been destroyed by another thread in the meantime.
-    */
    owner_int = p_atomic_read(&elt->owner);
 
-   if (!(owner_int & 1)) {
-      struct slab_child_pool *owner = (struct slab_child_pool *)owner_int;
-      elt->next = owner->migrated;
-      owner->migrated = elt;
-      mtx_unlock(&pool->parent->mutex);
-   } else {
-      mtx_unlock(&pool->parent->mutex);
-
+   if (owner_int & 1) {
       slab_free_orphaned(elt);
+      return;
+   }
+
+   /* The owner is only dereferenced when the magazine is flushed, which
+    * deals with it having been destroyed in the meantime.
+    */
+   if (pool->magazine_owner != (struct slab_child_pool *)owner_int ||
+       pool->magazine_count == SLAB_MAGAZINE_SIZE) {
+      slab_flush_magazine(pool);
+      pool->magazine_owner = (struct slab_child_pool *)owner_int;
    }
+
+   elt->next = pool->magazine;
+   pool->magazine = elt;
+   pool->magazine_count++;
+}
+
+/**
+ * Return the objects that were freed in this child pool but belong to
+ * another one to their owner. Single-threaded, like slab_free.
+ *
+ * This happens on its own when enough of them have accumulated; calling it
+ * is only useful when a pool stops freeing objects of other pools for a long
+ * time while keeping them from their owner would waste memory.
+ */
+void
+slab_flush_remote_frees(struct slab_child_pool *pool)
+{
+   if (pool->parent)
+      slab_flush_magazine(pool);
 }
 
 /**
@@ -32,8 +32,10 @@
  *
  * Allocations obtained from one child pool should usually be freed in the
  * same child pool. Freeing an allocation in a different child pool associated
- * to the same parent is allowed (and requires no locking by the caller), but
- * it is discouraged because it implies a performance penalty.
+ * to the same parent is allowed (and requires no locking by the caller). Such
+ * remote frees are collected in a small per-child-pool magazine and pushed in
+ * batches onto a lock-free stack of the owning pool, which takes them all
+ * back at once when it runs out of free elements.
  *
  * For convenience and to ease the transition, there is also a set of wrapper
  * functions around a single parent-child pair.
@@ -47,10 +49,16 @@
 struct slab_element_header;
 struct slab_page_header;
 
+#define SLAB_MAGAZINE_SIZE 32
+
 struct slab_parent_pool {
-   mtx_t mutex;
    unsigned element_size;
    unsigned num_elements;
+
+   /* Number of threads currently pushing elements onto the migrated list of
+    * a child pool, which slab_destroy_child has to wait for.
+    */
+   unsigned remote_frees_in_flight;
 };
 
 struct slab_child_pool {
@@ -64,9 +72,17 @@ struct slab_child_pool {
    /* Elements that are owned by this pool but were freed with a different
     * pool as the argument to slab_free.
     *
-    * This list is protected by the parent mutex.
+    * This is a lock-free stack: other pools push onto it with a
+    * compare-and-swap, and this pool takes the whole list at once.
     */
    struct slab_element_header *migrated;
+
+   /* Elements owned by magazine_owner that were freed in this pool and not
+    * yet handed back, linked through their next pointers.
+    */
+   struct slab_child_pool *magazine_owner;
+   struct slab_element_header *magazine;
+   unsigned magazine_count;
 };
 
 void slab_create_parent(struct slab_parent_pool *parent,
@@ -78,6 +94,7 @@ void slab_create_child(struct slab_child_pool *pool,
 void slab_destroy_child(struct slab_child_pool *pool);
 void *slab_alloc(struct slab_child_pool *pool);
 void slab_free(struct slab_child_pool *pool, void *ptr);
+void slab_flush_remote_frees(struct slab_child_pool *pool);
 
 struct slab_mempool {
    struct slab_parent_pool parent;
@@ -0,0 +1,166 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+/**
+ * Microbenchmark for the hash table and set.
+ *
+ * Times insert, successful and unsuccessful search and delete of pointer
+ * keys for a range of table sizes.  Because the tables grow by doubling,
+ * the sizes are picked to land at different load factors right after the
+ * last insertion.  Run through "meson test --benchmark" or directly.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "hash_table.h"
+#include "set.h"
+#include "os_time.h"
+
+#define TOTAL_OPS (4 * 1024 * 1024)
+
+static const uint32_t sizes[] = {
+   8, 100, 1000, 1800, 3500, 10000, 100000, 200000, 900000,
+};
+
+static void *
+make_key(uint32_t i)
+{
+   /* Pointer-like keys, as in the compiler's pointer-keyed tables. */
+   return (void *)(uintptr_t)(0x10000 + i * 48);
+}
+
+static double
+ns_per_op(int64_t start, uint32_t ops)
+{
+   return (double)(os_time_get_nano() - start) / ops;
+}
+
+static void
+bench_hash_table(uint32_t size)
+{
+   uint32_t rounds = MAX2(TOTAL_OPS / size, 1);
+   double insert = 0, hit = 0, miss = 0, remove = 0;
+   unsigned load = 0;
+   uintptr_t sum = 0;
+
+   for (uint32_t r = 0; r < rounds; r++) {
+      struct hash_table *ht = _mesa_pointer_hash_table_create(NULL);
+      int64_t start;
+
+      start = os_time_get_nano();
+      for (uint32_t i = 0; i < size; i++)
+         _mesa_hash_table_insert(ht, make_key(i), make_key(i));
+      insert += ns_per_op(start, size);
+
+      load = ht->entries * 100 / ht->size;
+
+      start = os_time_get_nano();
+      for (uint32_t i = 0; i < size; i++)
+         sum += (uintptr_t)_mesa_hash_table_search(ht, make_key(i))->data;
+      hit += ns_per_op(start, size);
+
+      start = os_time_get_nano();
+      for (uint32_t i = size; i < 2 * size; i++)
+         sum += (uintptr_t)_mesa_hash_table_search(ht, make_key(i));
+      miss += ns_per_op(start, size);
+
+      start = os_time_get_nano();
+      for (uint32_t i = 0; i < size; i++)
+         _mesa_hash_table_remove_key(ht, make_key(i));
+      remove += ns_per_op(start, size);
+
+      _mesa_hash_table_destroy(ht, NULL);
+   }
+
+   printf("hash_table %8u %5u%% %10.2f %10.2f %10.2f %10.2f\n", size, load,
+          insert / rounds, hit / rounds, miss / rounds, remove / rounds);
+
+   /* Keep the searches from being optimized away. */
+   if (sum == 1)
+      printf("\n");
+}
+
+static void
+bench_set(uint32_t size)
+{
+   uint32_t rounds = MAX2(TOTAL_OPS / size, 1);
+   double insert = 0, hit = 0, miss = 0, remove = 0;
+   unsigned load = 0;
+   uintptr_t sum = 0;
+
+   for (uint32_t r = 0; r < rounds; r++) {
+      struct set *s = _mesa_pointer_set_create(NULL);
+      int64_t start;
+
+      start = os_time_get_nano();
+      for (uint32_t i = 0; i < size; i++)
+         _mesa_set_add(s, make_key(i));
+      insert += ns_per_op(start, size);
+
+      load = s->entries * 100 / s->size;
+
+      start = os_time_get_nano();
+      for (uint32_t i = 0; i < size; i++)
+         sum += (uintptr_t)_mesa_set_search(s, make_key(i))->key;
+      hit += ns_per_op(start, size);
+
+      start = os_time_get_nano();
+      for (uint32_t i = size; i < 2 * size; i++)
+         sum += (uintptr_t)_mesa_set_search(s, make_key(i));
+      miss += ns_per_op(start, size);
+
+      start = os_time_get_nano();
+      for (uint32_t i = 0; i < size; i++)
+         _mesa_set_remove_key(s, make_key(i));
+      remove += ns_per_op(start, size);
+
+      _mesa_set_destroy(s, NULL);
+   }
+
+   printf("set        %8u %5u%% %10.2f %10.2f %10.2f %10.2f\n", size, load,
+          insert / rounds, hit / rounds, miss / rounds, remove / rounds);
+
+   if (sum == 1)
+      printf("\n");
+}
+
+int
+main(int argc, char **argv)
+{
+   (void) argc;
+   (void) argv;
+
+   printf("%-10s %8s %6s %10s %10s %10s %10s\n", "table", "entries", "load",
+          "insert", "hit", "miss", "delete");
+   printf("%-10s %8s %6s %10s %10s %10s %10s\n", "", "", "",
+          "(ns/op)", "(ns/op)", "(ns/op)", "(ns/op)");
+
+   for (unsigned i = 0; i < ARRAY_SIZE(sizes); i++)
+      bench_hash_table(sizes[i]);
+   for (unsigned i = 0; i < ARRAY_SIZE(sizes); i++)
+      bench_set(sizes[i]);
+
+   return 0;
+}
@@ -0,0 +1,193 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+#include <string.h>
+#include "util/ralloc.h"
+
+static unsigned destroyed;
+
+static void
+count_destructor(void *ptr)
+{
+   destroyed++;
+}
+
+TEST(ralloc_slab, basic)
+{
+   void *ctx = ralloc_slab_context(NULL);
+   ASSERT_TRUE(ctx);
+
+   int *a = ralloc_array(ctx, int, 4);
+   int *b = ralloc_array(a, int, 4);
+   for (unsigned i = 0; i < 4; i++) {
+      a[i] = i;
+      b[i] = i * 2;
+   }
+
+   EXPECT_EQ(ralloc_parent(a), ctx);
+   EXPECT_EQ(ralloc_parent(b), a);
+   for (unsigned i = 0; i < 4; i++) {
+      EXPECT_EQ(a[i], (int)i);
+      EXPECT_EQ(b[i], (int)(i * 2));
+   }
+
+   struct ralloc_slab_stats stats;
+   EXPECT_TRUE(ralloc_slab_get_stats(b, &stats));
+   EXPECT_EQ(stats.slab_allocs, 2u);
+   EXPECT_EQ(stats.live_blocks, 3u);
+   EXPECT_EQ(stats.malloc_allocs, 0u);
+
+   ralloc_free(ctx);
+}
+
+TEST(ralloc_slab, not_slab)
+{
+   void *ctx = ralloc_context(NULL);
+   struct ralloc_slab_stats stats;
+
+   EXPECT_FALSE(ralloc_slab_get_stats(ctx, &stats));
+   EXPECT_EQ(stats.slab_allocs, 0u);
+
+   ralloc_free(ctx);
+}
+
+TEST(ralloc_slab, free_list_reuse)
+{
+   void *ctx = ralloc_slab_context(NULL);
+   struct ralloc_slab_stats stats;
+
+   void *first = ralloc_size(ctx, 24);
+   ralloc_free(first);
+   void *second = ralloc_size(ctx, 20);
+   EXPECT_EQ(first, second);
+
+   ralloc_slab_get_stats(ctx, &stats);
+   EXPECT_EQ(stats.freelist_reuses, 1u);
+   EXPECT_EQ(stats.live_blocks, 2u);
+
+   ralloc_free(ctx);
+}
+
+TEST(ralloc_slab, large_blocks)
+{
+   void *ctx = ralloc_slab_context(NULL);
+   struct ralloc_slab_stats stats;
+
+   char *big = (char *)ralloc_size(ctx, 4096);
+   memset(big, 0x55, 4096);
+
+   /* Children of a large block still come from the slabs. */
+   void *child = ralloc_size(big, 8);
+   ralloc_slab_get_stats(child, &stats);
+   EXPECT_EQ(stats.malloc_allocs, 1u);
+   EXPECT_EQ(stats.slab_allocs, 1u);
+
+   ralloc_free(ctx);
+}
+
+TEST(ralloc_slab, resize)
+{
+   void *ctx = ralloc_slab_context(NULL);
+   char *str = ralloc_strdup(ctx, "a");
+   void *child = ralloc_size(str, 8);
+
+   for (unsigned i = 0; i < 1000; i++)
+      ralloc_strcat(&str, "b");
+
+   EXPECT_EQ(strlen(str), 1001u);
+   EXPECT_EQ(str[0], 'a');
+   EXPECT_EQ(str[1000], 'b');
+   EXPECT_EQ(ralloc_parent(str), ctx);
+   EXPECT_EQ(ralloc_parent(child), str);
+
+   ralloc_free(ctx);
+}
+
+TEST(ralloc_slab, destructors)
+{
+   void *ctx = ralloc_slab_context(NULL);
+
+   destroyed = 0;
+   for (unsigned i = 0; i < 100; i++) {
+      void *p = ralloc_size(ctx, i);
+      ralloc_set_destructor(p, count_destructor);
+   }
+   ralloc_set_destructor(ctx, count_destructor);
+
+   ralloc_free(ctx);
+   EXPECT_EQ(destroyed, 101u);
+}
+
+TEST(ralloc_slab, steal_out)
+{
+   void *ctx = ralloc_slab_context(NULL);
+   void *other = ralloc_context(NULL);
+
+   int *value = ralloc(ctx, int);
+   *value = 42;
+   int *grandchild = ralloc(value, int);
+   *grandchild = 43;
+
+   /* The stolen block keeps the slab pages alive. */
+   ralloc_steal(other, value);
+   ralloc_free(ctx);
+
+   EXPECT_EQ(*value, 42);
+   EXPECT_EQ(*grandchild, 43);
+   EXPECT_EQ(ralloc_parent(value), other);
+
+   struct ralloc_slab_stats stats;
+   EXPECT_TRUE(ralloc_slab_get_stats(value, &stats));
+   EXPECT_EQ(stats.live_blocks, 2u);
+
+   ralloc_free(other);
+}
+
+TEST(ralloc_slab, many)
+{
+   void *ctx = ralloc_slab_context(NULL);
+   void **ptrs = ralloc_array(NULL, void *, 100000);
+
+   /* Every 7th allocation is a child of the previous one. */
+   for (unsigned i = 0; i < 100000; i++) {
+      ptrs[i] = ralloc_size(i % 7 == 0 && i ? ptrs[i - 1] : ctx, i % 200);
+      memset(ptrs[i], i & 0xff, i % 200);
+   }
+
+   for (unsigned i = 1; i < 100000; i += 3) {
+      if (i % 7 != 0 && (i + 1) % 7 != 0)
+         ralloc_free(ptrs[i]);
+   }
+
+   for (unsigned i = 0; i < 100000; i++)
+      ptrs[i] = ralloc_size(ctx, i % 100);
+
+   struct ralloc_slab_stats stats;
+   ralloc_slab_get_stats(ctx, &stats);
+   EXPECT_LE(stats.live_slab_bytes, stats.page_bytes);
+   EXPECT_LE(stats.live_slab_bytes, stats.peak_slab_bytes);
+
+   ralloc_free(ctx);
+   ralloc_free(ptrs);
+}
@@ -0,0 +1,362 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Register allocator microbenchmark.
+ *
+ * Usage: ra_bench [dump files...]
+ *
+ * Graphs are read from files written with MESA_RA_DUMP=<file> set while
+ * compiling shaders (see ra_dump_graph()); a file can hold any number of
+ * graphs.  Without arguments, synthetic graphs are used: live ranges of
+ * random length allocated to a register file laid out like the Intel one,
+ * 128 registers with classes of 1, 2, 4 and 8 contiguous registers.
+ *
+ * For every graph, the time to build the interference graph and to
+ * allocate it is printed.  When allocation fails, the best spill candidate
+ * is dropped from the graph and allocation retried, like drivers do, up to
+ * MAX_SPILLS times.  The checksum of the final assignment makes it easy to
+ * check that a change to the allocator doesn't change its results.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/macros.h"
+#include "util/os_time.h"
+#include "util/ralloc.h"
+#include "util/register_allocate.h"
+
+#define MAX_SPILLS 32
+
+static bool
+expect_word(FILE *fp, const char *word)
+{
+   char buf[16];
+   return fscanf(fp, "%15s", buf) == 1 && strcmp(buf, word) == 0;
+}
+
+struct bench_graph {
+   struct ra_regs *regs;
+   unsigned num_nodes;
+   unsigned *classes;
+   int *forced_regs;
+   /* Pairs of interfering nodes */
+   unsigned *edges;
+   unsigned num_edges;
+};
+
+static void
+add_edge(void *mem_ctx, struct bench_graph *bg, unsigned *edges_size,
+         unsigned n1, unsigned n2)
+{
+   if (bg->num_edges == *edges_size) {
+      *edges_size = MAX2(*edges_size * 2, 1024);
+      bg->edges = reralloc(mem_ctx, bg->edges, unsigned, *edges_size * 2);
+   }
+   bg->edges[bg->num_edges * 2] = n1;
+   bg->edges[bg->num_edges * 2 + 1] = n2;
+   bg->num_edges++;
+}
+
+static bool
+read_graph(void *mem_ctx, FILE *fp, struct bench_graph *bg)
+{
+   unsigned num_regs, num_classes;
+
+   if (fscanf(fp, " ra_graph %u %u %u", &num_regs, &num_classes,
+              &bg->num_nodes) != 3)
+      return false;
+
+   bg->regs = ra_alloc_reg_set(mem_ctx, num_regs, false);
+   for (unsigned r = 0; r < num_regs; r++) {
+      unsigned reg, count;
+      if (fscanf(fp, " reg %u %u", &reg, &count) != 2)
+         return false;
+      for (unsigned i = 0; i < count; i++) {
+         unsigned other;
+         if (fscanf(fp, "%u", &other) != 1)
+            return false;
+         ra_add_reg_conflict(bg->regs, reg, other);
+      }
+   }
+
+   unsigned **q_values = ralloc_array(mem_ctx, unsigned *, num_classes);
+   for (unsigned c = 0; c < num_classes; c++) {
+      unsigned class, p;
+      if (fscanf(fp, " class %u %u", &class, &p) != 2)
+         return false;
+
+      unsigned class_index = ra_alloc_reg_class(bg->regs);
+      for (unsigned i = 0; i < p; i++) {
+         unsigned reg;
+         if (fscanf(fp, "%u", &reg) != 1)
+            return false;
+         ra_class_add_reg(bg->regs, class_index, reg);
+      }
+
+      q_values[c] = ralloc_array(q_values, unsigned, num_classes);
+      if (!expect_word(fp, "q"))
+         return false;
+      for (unsigned c2 = 0; c2 < num_classes; c2++) {
+         if (fscanf(fp, "%u", &q_values[c][c2]) != 1)
+            return false;
+      }
+   }
+   ra_set_finalize(bg->regs, q_values);
+
+   bg->classes = ralloc_array(mem_ctx, unsigned, bg->num_nodes);
+   bg->forced_regs = ralloc_array(mem_ctx, int, bg->num_nodes);
+   bg->edges = NULL;
+   bg->num_edges = 0;
+
+   unsigned edges_size = 0;
+   for (unsigned n = 0; n < bg->num_nodes; n++) {
+      unsigned node, count;
+      if (fscanf(fp, " node %u %u %d %u", &node, &bg->classes[n],
+                 &bg->forced_regs[n], &count) != 4)
+         return false;
+      for (unsigned i = 0; i < count; i++) {
+         unsigned other;
+         if (fscanf(fp, "%u", &other) != 1)
+            return false;
+         add_edge(mem_ctx, bg, &edges_size, node, other);
+      }
+   }
+
+   return expect_word(fp, "end");
+}
+
+static unsigned
+rand_next(unsigned *state)
+{
+   *state = *state * 1103515245 + 12345;
+   return (*state >> 16) & 0x7fff;
+}
+
+static struct ra_regs *
+make_intel_like_regs(void *mem_ctx)
+{
+   static const unsigned sizes[] = { 1, 2, 4, 8 };
+   const unsigned base_regs = 128;
+
+   unsigned count = 0;
+   for (unsigned s = 0; s < ARRAY_SIZE(sizes); s++)
+      count += base_regs - sizes[s] + 1;
+
+   struct ra_regs *regs = ra_alloc_reg_set(mem_ctx, count, true);
+
+   unsigned reg = 0;
+   for (unsigned s = 0; s < ARRAY_SIZE(sizes); s++) {
+      unsigned class = ra_alloc_reg_class(regs);
+      for (unsigned i = 0; i <= base_regs - sizes[s]; i++) {
+         ra_class_add_reg(regs, class, reg);
+         if (s > 0) {
+            for (unsigned j = 0; j < sizes[s]; j++)
+               ra_add_transitive_reg_conflict(regs, i + j, reg);
+         }
+         reg++;
+      }
+   }
+
+   ra_set_finalize(regs, NULL);
+   return regs;
+}
+
+/* Live ranges with random starts and lengths, so that on average about
+ * "pressure" registers are live.  A few long-lived nodes forced to fixed
+ * registers stand in for the payload.
+ */
+static void
+make_synthetic_graph(void *mem_ctx, struct ra_regs *regs, unsigned num_nodes,
+                     unsigned pressure, struct bench_graph *bg)
+{
+   static const unsigned class_sizes[] = { 1, 2, 4, 8 };
+   const unsigned num_payload = 4;
+   const unsigned mean_length = 64;
+   unsigned seed = num_nodes * 31 + pressure;
+
+   bg->regs = regs;
+   bg->num_nodes = num_nodes;
+   bg->classes = ralloc_array(mem_ctx, unsigned, num_nodes);
+   bg->forced_regs = ralloc_array(mem_ctx, int, num_nodes);
+   bg->edges = NULL;
+   bg->num_edges = 0;
+
+   unsigned *start = ralloc_array(mem_ctx, unsigned, num_nodes);
+   unsigned *end = ralloc_array(mem_ctx, unsigned, num_nodes);
+
+   unsigned total_size = 0;
+   for (unsigned n = 0; n < num_nodes; n++) {
+      unsigned r = rand_next(&seed) % 100;
+      unsigned c = r < 70 ? 0 : r < 85 ? 1 : r < 95 ? 2 : 3;
+      bg->classes[n] = c;
+      bg->forced_regs[n] = -1;
+      total_size += class_sizes[c];
+   }
+
+   /* Live ranges start in node order, which is what drivers tend to
+    * produce.
+    */
+   unsigned length = total_size * mean_length / pressure;
+   for (unsigned n = 0; n < num_nodes; n++) {
+      start[n] = (uint64_t)n * length / num_nodes;
+      end[n] = start[n] + 1 + rand_next(&seed) % (2 * mean_length);
+   }
+
+   for (unsigned n = 0; n < num_payload && n < num_nodes; n++) {
+      bg->classes[n] = 0;
+      bg->forced_regs[n] = n;
+      start[n] = 0;
+      end[n] = length + 2 * mean_length;
+   }
+
+   /* Sweep over the start points, keeping a list of the live ranges. */
+   unsigned *active = ralloc_array(mem_ctx, unsigned, num_nodes);
+   unsigned num_active = 0, edges_size = 0;
+   for (unsigned n = 0; n < num_nodes; n++) {
+      unsigned j = 0;
+      for (unsigned i = 0; i < num_active; i++) {
+         if (end[active[i]] > start[n]) {
+            add_edge(mem_ctx, bg, &edges_size, active[i], n);
+            active[j++] = active[i];
+         }
+      }
+      num_active = j;
+      active[num_active++] = n;
+   }
+}
+
+static void
+run_graph(const char *name, struct bench_graph *bg)
+{
+   int64_t start = os_time_get_nano();
+
+   struct ra_graph *g = ra_alloc_interference_graph(bg->regs, bg->num_nodes);
+   for (unsigned n = 0; n < bg->num_nodes; n++) {
+      ra_set_node_class(g, n, bg->classes[n]);
+      if (bg->forced_regs[n] >= 0)
+         ra_set_node_reg(g, n, bg->forced_regs[n]);
+      else
+         ra_set_node_spill_cost(g, n, 1.0f + n % 7);
+   }
+   for (unsigned e = 0; e < bg->num_edges; e++)
+      ra_add_node_interference(g, bg->edges[e * 2], bg->edges[e * 2 + 1]);
+
+   int64_t built = os_time_get_nano();
+
+   unsigned spills = 0;
+   bool ok;
+   while (!(ok = ra_allocate(g)) && spills < MAX_SPILLS) {
+      int n = ra_get_best_spill_node(g);
+      if (n < 0)
+         break;
+
+      /* Pretend the spill split the live range into pieces small enough to
+       * not interfere with anything.
+       */
+      ra_reset_node_interference(g, n);
+      ra_set_node_spill_cost(g, n, 0.0f);
+      spills++;
+   }
+
+   int64_t allocated = os_time_get_nano();
+
+   unsigned checksum = 0;
+   for (unsigned n = 0; n < bg->num_nodes; n++)
+      checksum = checksum * 31 + ra_get_node_reg(g, n);
+
+   printf("%-24s %8u %10u %10.1f %10.1f %6u%s %08x\n", name,
+          bg->num_nodes, bg->num_edges,
+          (built - start) / 1000000.0, (allocated - built) / 1000000.0,
+          spills, ok ? " " : "+", checksum);
+
+   ralloc_free(g);
+}
+
+int
+main(int argc, char **argv)
+{
+   static const struct {
+      unsigned nodes;
+      unsigned pressure;
+   } synthetic[] = {
+      { 1000,  48 },
+      { 4000,  64 },
+      { 4000,  96 },
+      { 16000, 64 },
+      { 16000, 96 },
+      { 64000, 64 },
+   };
+
+   void *mem_ctx = ralloc_context(NULL);
+
+   printf("%-24s %8s %10s %10s %10s %7s %8s\n", "graph", "nodes", "edges",
+          "build ms", "alloc ms", "spills", "checksum");
+
+   if (argc < 2) {
+      struct ra_regs *regs = make_intel_like_regs(mem_ctx);
+
+      for (unsigned i = 0; i < ARRAY_SIZE(synthetic); i++) {
+         void *graph_ctx = ralloc_context(mem_ctx);
+         struct bench_graph bg;
+         char name[64];
+
+         make_synthetic_graph(graph_ctx, regs, synthetic[i].nodes,
+                              synthetic[i].pressure, &bg);
+         snprintf(name, sizeof(name), "synthetic-%u-%u",
+                  synthetic[i].nodes, synthetic[i].pressure);
+         run_graph(name, &bg);
+         ralloc_free(graph_ctx);
+      }
+   }
+
+   for (int a = 1; a < argc; a++) {
+      FILE *fp = fopen(argv[a], "r");
+      if (!fp) {
+         fprintf(stderr, "Failed to open %s\n", argv[a]);
+         return 1;
+      }
+
+      for (unsigned i = 0; ; i++) {
+         void *graph_ctx = ralloc_context(mem_ctx);
+         struct bench_graph bg;
+         char name[64];
+
+         if (!read_graph(graph_ctx, fp, &bg)) {
+            ralloc_free(graph_ctx);
+            break;
+         }
+
+         const char *base = strrchr(argv[a], '/');
+         snprintf(name, sizeof(name), "%s:%u", base ? base + 1 : argv[a], i);
+         run_graph(name, &bg);
+         ralloc_free(graph_ctx);
+      }
+
+      fclose(fp);
+   }
+
+   ralloc_free(mem_ctx);
+   return 0;
+}
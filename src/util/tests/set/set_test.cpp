@@ -146,3 +146,44 @@ TEST(set, search_or_add)
 
    _mesa_set_destroy(s, NULL);
 }
+
+TEST(set, random_operations)
+{
+   struct set *s = _mesa_set_create(NULL, _mesa_hash_pointer,
+                                    _mesa_key_pointer_equal);
+   static bool present[4096];
+   unsigned count = 0;
+
+   /* Mix adds and removes so that the table sees tombstones, rehashes at
+    * the same size and growth, and check it against a plain array.
+    */
+   srand(1234);
+   for (unsigned i = 0; i < 200000; i++) {
+      unsigned k = rand() % ARRAY_SIZE(present);
+      const void *key = (const void *)(uintptr_t)((k + 1) * 64);
+
+      if (rand() % 3) {
+         _mesa_set_add(s, key);
+         count += !present[k];
+         present[k] = true;
+      } else {
+         _mesa_set_remove_key(s, key);
+         count -= present[k];
+         present[k] = false;
+      }
+
+      ASSERT_EQ(s->entries, count);
+   }
+
+   for (unsigned k = 0; k < ARRAY_SIZE(present); k++) {
+      const void *key = (const void *)(uintptr_t)((k + 1) * 64);
+      EXPECT_EQ(_mesa_set_search(s, key) != NULL, present[k]);
+   }
+
+   unsigned iterated = 0;
+   set_foreach(s, entry)
+      iterated++;
+   EXPECT_EQ(iterated, count);
+
+   _mesa_set_destroy(s, NULL);
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Cost of slab_alloc/slab_free pairs when objects are freed in the pool of
+ * another thread, as the gallium transfer pools do, compared to objects
+ * freed in the pool that allocated them.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "c11/threads.h"
+#include "util/macros.h"
+#include "util/os_time.h"
+#include "util/slab.h"
+
+#define OPS_PER_THREAD (2 * 1024 * 1024)
+#define BATCH 64
+
+static const unsigned thread_counts[] = { 1, 2, 4, 8 };
+
+struct obj {
+   struct obj *next;
+   uint64_t payload[3];
+};
+
+struct mailbox {
+   mtx_t mutex;
+   struct obj *list;
+};
+
+static struct slab_parent_pool parent;
+static struct mailbox mailboxes[8];
+static unsigned num_threads;
+static bool remote;
+
+static int
+bench_thread(void *data)
+{
+   unsigned thread = (uintptr_t)data;
+   struct mailbox *own = &mailboxes[thread];
+   struct mailbox *next = &mailboxes[(thread + 1) % num_threads];
+   struct slab_child_pool pool;
+
+   slab_create_child(&pool, &parent);
+
+   for (unsigned done = 0; done < OPS_PER_THREAD; done += BATCH) {
+      struct obj *list = NULL, *tail = NULL;
+
+      for (unsigned i = 0; i < BATCH; i++) {
+         struct obj *obj = slab_alloc(&pool);
+         obj->next = list;
+         list = obj;
+         if (!tail)
+            tail = obj;
+      }
+
+      if (remote) {
+         mtx_lock(&next->mutex);
+         tail->next = next->list;
+         next->list = list;
+         mtx_unlock(&next->mutex);
+
+         mtx_lock(&own->mutex);
+         list = own->list;
+         own->list = NULL;
+         mtx_unlock(&own->mutex);
+      }
+
+      while (list) {
+         struct obj *obj = list;
+         list = obj->next;
+         slab_free(&pool, obj);
+      }
+   }
+
+   slab_destroy_child(&pool);
+   return 0;
+}
+
+static double
+run(unsigned threads, bool remote_frees)
+{
+   thrd_t thrds[8];
+   struct slab_child_pool pool;
+   int64_t start;
+
+   num_threads = threads;
+   remote = remote_frees;
+   slab_create_parent(&parent, sizeof(struct obj), 64);
+   for (unsigned i = 0; i < threads; i++) {
+      mtx_init(&mailboxes[i].mutex, mtx_plain);
+      mailboxes[i].list = NULL;
+   }
+
+   start = os_time_get_nano();
+   for (unsigned i = 0; i < threads; i++)
+      thrd_create(&thrds[i], bench_thread, (void *)(uintptr_t)i);
+   for (unsigned i = 0; i < threads; i++)
+      thrd_join(thrds[i], NULL);
+   double ns = (double)(os_time_get_nano() - start) / OPS_PER_THREAD;
+
+   slab_create_child(&pool, &parent);
+   for (unsigned i = 0; i < threads; i++) {
+      while (mailboxes[i].list) {
+         struct obj *obj = mailboxes[i].list;
+         mailboxes[i].list = obj->next;
+         slab_free(&pool, obj);
+      }
+      mtx_destroy(&mailboxes[i].mutex);
+   }
+   slab_destroy_child(&pool);
+   slab_destroy_parent(&parent);
+
+   return ns;
+}
+
+int
+main(int argc, char **argv)
+{
+   printf("%8s %12s %12s\n", "threads", "local ns", "remote ns");
+
+   for (unsigned i = 0; i < ARRAY_SIZE(thread_counts); i++) {
+      unsigned threads = thread_counts[i];
+      printf("%8u %12.2f %12.2f\n", threads,
+             run(threads, false), run(threads, true));
+   }
+
+   return 0;
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#undef NDEBUG
+
+#include "util/slab.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "c11/threads.h"
+
+/* Threads allocate objects from their own child pool and hand them to the
+ * next thread, which frees them in its pool. Threads finish at different
+ * times, so objects are also freed after their owner has been destroyed.
+ */
+
+#define NUM_THREADS 8
+#define NUM_RUNS 8
+#define NUM_ROUNDS 256
+#define MAX_BATCH 100
+
+#define OBJ_IN_USE 0x600dcafe
+
+struct obj {
+   struct obj *next;
+   unsigned in_use;
+   unsigned thread;
+   unsigned serial;
+};
+
+struct mailbox {
+   mtx_t mutex;
+   struct obj *list;
+};
+
+static struct slab_parent_pool parent;
+static struct mailbox mailboxes[NUM_THREADS];
+
+static struct obj *
+take_mail(unsigned thread)
+{
+   struct mailbox *box = &mailboxes[thread];
+
+   mtx_lock(&box->mutex);
+   struct obj *list = box->list;
+   box->list = NULL;
+   mtx_unlock(&box->mutex);
+
+   return list;
+}
+
+static void
+free_list(struct slab_child_pool *pool, struct obj *list)
+{
+   while (list) {
+      struct obj *next = list->next;
+      assert(list->in_use == OBJ_IN_USE);
+      list->in_use = 0;
+      slab_free(pool, list);
+      list = next;
+   }
+}
+
+static int
+test_thread(void *data)
+{
+   unsigned thread = (uintptr_t)data;
+   unsigned rounds = NUM_ROUNDS / 2 + rand() % NUM_ROUNDS;
+   struct mailbox *next_box = &mailboxes[(thread + 1) % NUM_THREADS];
+   struct slab_child_pool pool;
+   unsigned serial = 0;
+
+   slab_create_child(&pool, &parent);
+
+   for (unsigned r = 0; r < rounds; r++) {
+      unsigned count = 1 + rand() % MAX_BATCH;
+      struct obj *local = NULL, *sent = NULL, *sent_tail = NULL;
+
+      for (unsigned i = 0; i < count; i++) {
+         struct obj *obj = slab_alloc(&pool);
+         assert(obj);
+         assert(obj->in_use != OBJ_IN_USE);
+         obj->in_use = OBJ_IN_USE;
+         obj->thread = thread;
+         obj->serial = serial++;
+
+         if (i & 1) {
+            obj->next = local;
+            local = obj;
+         } else {
+            obj->next = sent;
+            sent = obj;
+            if (!sent_tail)
+               sent_tail = obj;
+         }
+      }
+
+      mtx_lock(&next_box->mutex);
+      sent_tail->next = next_box->list;
+      next_box->list = sent;
+      mtx_unlock(&next_box->mutex);
+
+      free_list(&pool, local);
+      free_list(&pool, take_mail(thread));
+   }
+
+   slab_destroy_child(&pool);
+   return 0;
+}
+
+static void
+run_test(unsigned run_idx)
+{
+   struct slab_child_pool pool;
+   thrd_t threads[NUM_THREADS];
+
+   slab_create_parent(&parent, sizeof(struct obj), 4 << (run_idx % 4));
+   for (unsigned i = 0; i < NUM_THREADS; i++) {
+      mtx_init(&mailboxes[i].mutex, mtx_plain);
+      mailboxes[i].list = NULL;
+   }
+
+   for (unsigned i = 0; i < NUM_THREADS; i++) {
+      int ret = thrd_create(&threads[i], test_thread, (void *)(uintptr_t)i);
+      assert(ret == thrd_success);
+   }
+
+   for (unsigned i = 0; i < NUM_THREADS; i++) {
+      int ret = thrd_join(threads[i], NULL);
+      assert(ret == thrd_success);
+   }
+
+   /* Whatever is left belongs to destroyed pools. */
+   slab_create_child(&pool, &parent);
+   for (unsigned i = 0; i < NUM_THREADS; i++) {
+      free_list(&pool, take_mail(i));
+      mtx_destroy(&mailboxes[i].mutex);
+   }
+   slab_destroy_child(&pool);
+   slab_destroy_parent(&parent);
+}
+
+int
+main(int argc, char **argv)
+{
+   for (unsigned i = 0; i < NUM_RUNS; i++)
+      run_test(i);
+
+   return 0;
+}